@@ -0,0 +1,87 @@
+#include "ApiTraceRecorder.h"
+#include <QDateTime>
+#include <QDebug>
+
+namespace {
+constexpr const char *kTraceFileVariable = "SIGMATERIAL_API_TRACE";
+}
+
+thread_local int ApiTraceRecorder::Scope::s_depth = 0;
+
+ApiTraceRecorder *ApiTraceRecorder::instance()
+{
+    static ApiTraceRecorder recorder;
+    return &recorder;
+}
+
+ApiTraceRecorder::~ApiTraceRecorder()
+{
+    stop();
+}
+
+bool ApiTraceRecorder::start(const QString &filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_enabled.load(std::memory_order_relaxed)) {
+        qWarning() << "ApiTraceRecorder: Already recording to" << m_file.fileName();
+        return false;
+    }
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "ApiTraceRecorder: Could not open" << filePath << m_file.errorString();
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_6_0);
+    m_stream << kMagic << kFormatVersion << QDateTime::currentMSecsSinceEpoch();
+    m_methodIds.clear();
+    m_clock.start();
+
+    m_enabled.store(true, std::memory_order_relaxed);
+    qDebug() << "Recording Database API trace to" << filePath;
+    return true;
+}
+
+bool ApiTraceRecorder::startFromEnvironment()
+{
+    const QString filePath = qEnvironmentVariable(kTraceFileVariable);
+    return !filePath.isEmpty() && start(filePath);
+}
+
+void ApiTraceRecorder::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    m_enabled.store(false, std::memory_order_relaxed);
+    m_stream.setDevice(nullptr);
+    m_file.close();
+}
+
+void ApiTraceRecorder::record(const char *method, const QVariantList &args, qint64 startNs, qint64 durationNs)
+{
+    QMutexLocker locker(&m_mutex);
+    // Stopped while the call was running
+    if (!m_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    const QByteArray name(method);
+    auto id = m_methodIds.constFind(name);
+    if (id == m_methodIds.constEnd()) {
+        id = m_methodIds.insert(name, quint16(m_methodIds.size()));
+        m_stream << quint8(MethodRecord) << *id << name;
+    }
+    m_stream << quint8(CallRecord) << *id << startNs << durationNs << args;
+
+    if (m_stream.status() != QDataStream::Ok) {
+        qWarning() << "ApiTraceRecorder: Write failed, stopping" << m_file.errorString();
+        m_enabled.store(false, std::memory_order_relaxed);
+        m_stream.setDevice(nullptr);
+        m_file.close();
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef APITRACERECORDER_H
+#define APITRACERECORDER_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVariantList>
+#include <QVector>
+#include <atomic>
+
+// Opt-in recorder for Database's QML-facing API, replayed by
+// sigmaterial-replay (see ApiTraceReplayer).
+// - Enabled with SIGMATERIAL_API_TRACE=<file>; when off, a traced call costs
+//   one thread-local increment and one relaxed load.
+// - Only the outermost traced call on a thread is logged, so loginUser()
+//   is one record even though it calls loadBooks().
+// - Password arguments are written as redacted().
+//
+// Trace format (QDataStream, Qt 6.0 encoding):
+//   header   quint32 kMagic, quint16 kFormatVersion, qint64 recordedAt (ms since epoch)
+//   method   quint8 0, quint16 id, QByteArray name      (first use of a name)
+//   call     quint8 1, quint16 id, qint64 startNs, qint64 durationNs, QVariantList args
+// startNs counts from the start of the trace.
+class ApiTraceRecorder
+{
+public:
+    static constexpr quint32 kMagic = 0x53475452;   // "SGTR"
+    static constexpr quint16 kFormatVersion = 1;
+    enum RecordKind : quint8 { MethodRecord = 0, CallRecord = 1 };
+
+    static ApiTraceRecorder *instance();
+
+    bool start(const QString &filePath);
+    bool startFromEnvironment();
+    void stop();
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    static QString redacted() { return QStringLiteral("<redacted>"); }
+
+    // Records one call when it is the outermost traced call on its thread.
+    // The argument list is only built while recording.
+    class Scope
+    {
+    public:
+        template <typename MakeArgs>
+        Scope(const char *method, MakeArgs makeArgs)
+        {
+            if (s_depth++ == 0 && instance()->isEnabled()) {
+                m_method = method;
+                m_args = makeArgs();
+                m_startNs = instance()->elapsedNs();
+                m_active = true;
+            }
+        }
+
+        ~Scope()
+        {
+            --s_depth;
+            if (m_active) {
+                ApiTraceRecorder *recorder = instance();
+                recorder->record(m_method, m_args, m_startNs, recorder->elapsedNs() - m_startNs);
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        static thread_local int s_depth;
+        const char *m_method = nullptr;
+        QVariantList m_args;
+        qint64 m_startNs = 0;
+        bool m_active = false;
+    };
+
+private:
+    ApiTraceRecorder() = default;
+    ~ApiTraceRecorder();
+
+    qint64 elapsedNs() const { return m_clock.nsecsElapsed(); }
+    void record(const char *method, const QVariantList &args, qint64 startNs, qint64 durationNs);
+
+    std::atomic<bool> m_enabled { false };
+    QMutex m_mutex;
+    QFile m_file;
+    QDataStream m_stream;
+    QElapsedTimer m_clock;
+    QHash<QByteArray, quint16> m_methodIds;
+};
+
+// First statement of a traced Database method, with the method's arguments
+#define API_TRACE(...) \
+    const ApiTraceRecorder::Scope apiTraceScope(__func__, [&]() { return QVariantList{ __VA_ARGS__ }; })
+
+#endif // APITRACERECORDER_H
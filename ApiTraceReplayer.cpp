@@ -0,0 +1,329 @@
+#include "ApiTraceReplayer.h"
+#include "ApiTraceRecorder.h"
+#include "Database.h"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMetaMethod>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QVarLengthArray>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr quint32 kSamplesMagic = 0x53475253;   // "SGRS"
+
+double percentileMs(const QVector<qint64> &sorted, double percentile)
+{
+    if (sorted.isEmpty()) {
+        return 0.0;
+    }
+    // Nearest rank
+    const qsizetype rank = qsizetype(std::ceil(percentile / 100.0 * sorted.size()));
+    return sorted.at(qBound<qsizetype>(0, rank - 1, sorted.size() - 1)) / 1000000.0;
+}
+
+int findMethod(const QByteArray &name, int argumentCount)
+{
+    // Methods with default arguments have one entry per argument count
+    const QMetaObject &meta = Database::staticMetaObject;
+    for (int i = meta.methodOffset(); i < meta.methodCount(); ++i) {
+        const QMetaMethod method = meta.method(i);
+        if (method.methodType() == QMetaMethod::Method && method.name() == name
+            && method.parameterCount() == argumentCount) {
+            return i;
+        }
+    }
+    return -1;
+}
+}
+
+// ============================================================================
+// Loading
+// ============================================================================
+
+bool ApiTraceReplayer::load(const QString &tracePath)
+{
+    m_methods.clear();
+    m_calls.clear();
+
+    QFile file(tracePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_error = QStringLiteral("Could not open %1: %2").arg(tracePath, file.errorString());
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint64 recordedAt = 0;
+    stream >> magic >> version >> recordedAt;
+    if (magic != ApiTraceRecorder::kMagic || version != ApiTraceRecorder::kFormatVersion) {
+        m_error = QStringLiteral("%1 is not a version %2 API trace")
+                      .arg(tracePath)
+                      .arg(ApiTraceRecorder::kFormatVersion);
+        return false;
+    }
+
+    while (!stream.atEnd()) {
+        quint8 kind = 0;
+        stream >> kind;
+        if (kind == ApiTraceRecorder::MethodRecord) {
+            quint16 id = 0;
+            QByteArray name;
+            stream >> id >> name;
+            if (id != m_methods.size()) {
+                break;
+            }
+            m_methods.append(name);
+        } else if (kind == ApiTraceRecorder::CallRecord) {
+            Call call;
+            stream >> call.method >> call.startNs >> call.durationNs >> call.args;
+            if (stream.status() != QDataStream::Ok || call.method >= m_methods.size()) {
+                break;
+            }
+            m_calls.append(call);
+        } else {
+            break;
+        }
+    }
+
+    // A trace cut off mid-record (the app was killed) still replays up to there
+    if (stream.status() != QDataStream::Ok || !stream.atEnd()) {
+        qWarning() << "ApiTraceReplayer: Trace truncated after" << m_calls.size() << "calls";
+    }
+    return true;
+}
+
+// ============================================================================
+// Replay
+// ============================================================================
+
+bool ApiTraceReplayer::replay(const QString &databasePath, const QString &connectionName, double speed,
+                              Samples &samples)
+{
+    Database database;
+    database.setDatabaseLocation(databasePath, connectionName);
+    if (!database.initDatabase()) {
+        m_error = QStringLiteral("Could not open %1").arg(databasePath);
+        return false;
+    }
+
+    QHash<QPair<quint16, int>, int> resolved;   // (trace method id, argument count) -> meta method
+    QElapsedTimer clock;
+    clock.start();
+
+    for (const Call &call : std::as_const(m_calls)) {
+        if (speed > 0) {
+            const qint64 due = qint64(call.startNs / speed);
+            for (qint64 wait = due - clock.nsecsElapsed(); wait > 0; wait = due - clock.nsecsElapsed()) {
+                QThread::usleep(qMin<qint64>(wait / 1000, 2000));
+                QCoreApplication::processEvents();
+            }
+        }
+
+        const QByteArray &name = m_methods.at(call.method);
+        const auto key = qMakePair(call.method, int(call.args.size()));
+        auto index = resolved.constFind(key);
+        if (index == resolved.constEnd()) {
+            index = resolved.insert(key, findMethod(name, call.args.size()));
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        bool ok = false;
+        if (name == "loginUser" && call.args.value(1).toString() == ApiTraceRecorder::redacted()) {
+            ok = replayLogin(database, call.args);
+        } else if (*index >= 0) {
+            ok = invoke(database, *index, call.args);
+        }
+        const qint64 elapsed = timer.nsecsElapsed();
+
+        if (!ok) {
+            ++samples.skipped;
+        } else {
+            samples.replayedNs[name].append(elapsed);
+            samples.recordedNs[name].append(call.durationNs);
+        }
+
+        // Deliver queued results (stock audit, recommender builds) as the
+        // app's event loop would between calls
+        QCoreApplication::processEvents();
+    }
+    samples.wallNs = qMax(samples.wallNs, clock.nsecsElapsed());
+
+    // Background jobs still hold clones of this session's connection
+    QThreadPool::globalInstance()->waitForDone();
+    QCoreApplication::processEvents();
+    return true;
+}
+
+bool ApiTraceReplayer::invoke(Database &database, int methodIndex, QVariantList args) const
+{
+    const QMetaMethod method = Database::staticMetaObject.method(methodIndex);
+
+    const bool returnsValue = method.returnMetaType() != QMetaType::fromType<void>();
+    QVariant result = returnsValue ? QVariant(method.returnMetaType()) : QVariant();
+
+    QVarLengthArray<void *, 10> argv;
+    argv.append(returnsValue ? result.data() : nullptr);
+    for (int i = 0; i < args.size(); ++i) {
+        if (!args[i].convert(method.parameterMetaType(i))) {
+            return false;
+        }
+        argv.append(args[i].data());
+    }
+
+    QMetaObject::metacall(&database, QMetaObject::InvokeMetaMethod, methodIndex, argv.data());
+    return true;
+}
+
+bool ApiTraceReplayer::replayLogin(Database &database, const QVariantList &args) const
+{
+    const QVariantMap user = database.getUserByUsername(args.value(0).toString().trimmed());
+    if (user.isEmpty()) {
+        return false;
+    }
+    database.startSession(user.value("id").toInt(), user.value("username").toString());
+    return true;
+}
+
+// ============================================================================
+// Samples and Report
+// ============================================================================
+
+void ApiTraceReplayer::Samples::merge(const Samples &other)
+{
+    // Sessions run side by side, so the slowest one bounds the wall time
+    wallNs = qMax(wallNs, other.wallNs);
+    skipped += other.skipped;
+    for (auto it = other.replayedNs.cbegin(); it != other.replayedNs.cend(); ++it) {
+        replayedNs[it.key()] += it.value();
+    }
+    for (auto it = other.recordedNs.cbegin(); it != other.recordedNs.cend(); ++it) {
+        recordedNs[it.key()] += it.value();
+    }
+}
+
+bool ApiTraceReplayer::writeSamples(const QString &filePath, const Samples &samples)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << kSamplesMagic << samples.wallNs << qint32(samples.skipped)
+           << samples.replayedNs << samples.recordedNs;
+    return stream.status() == QDataStream::Ok && file.commit();
+}
+
+bool ApiTraceReplayer::readSamples(const QString &filePath, Samples &samples)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    qint32 skipped = 0;
+    stream >> magic >> samples.wallNs >> skipped >> samples.replayedNs >> samples.recordedNs;
+    samples.skipped = skipped;
+    return magic == kSamplesMagic && stream.status() == QDataStream::Ok;
+}
+
+QVariantMap ApiTraceReplayer::report(const Samples &samples, int sessions)
+{
+    const double wallSeconds = qMax<qint64>(1, samples.wallNs) / 1e9;
+
+    struct Row {
+        QVariantMap map;
+        qint64 totalNs;
+    };
+    QVector<Row> rows;
+    qint64 calls = 0;
+
+    for (auto it = samples.replayedNs.cbegin(); it != samples.replayedNs.cend(); ++it) {
+        QVector<qint64> replayed = it.value();
+        QVector<qint64> recorded = samples.recordedNs.value(it.key());
+        std::sort(replayed.begin(), replayed.end());
+        std::sort(recorded.begin(), recorded.end());
+
+        qint64 totalNs = 0;
+        for (qint64 ns : std::as_const(replayed)) {
+            totalNs += ns;
+        }
+        calls += replayed.size();
+
+        QVariantMap map;
+        map.insert("method", QString::fromLatin1(it.key()));
+        map.insert("calls", replayed.size());
+        map.insert("callsPerSecond", replayed.size() / wallSeconds);
+        map.insert("p50Ms", percentileMs(replayed, 50));
+        map.insert("p95Ms", percentileMs(replayed, 95));
+        map.insert("p99Ms", percentileMs(replayed, 99));
+        map.insert("maxMs", percentileMs(replayed, 100));
+        map.insert("recordedP50Ms", percentileMs(recorded, 50));
+        rows.append({ map, totalNs });
+    }
+
+    // Methods that cost the most overall first
+    std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) { return a.totalNs > b.totalNs; });
+
+    QVariantList methods;
+    for (const Row &row : std::as_const(rows)) {
+        methods.append(row.map);
+    }
+
+    QVariantMap result;
+    result.insert("sessions", sessions);
+    result.insert("calls", calls);
+    result.insert("skipped", samples.skipped);
+    result.insert("wallMs", samples.wallNs / 1000000.0);
+    result.insert("callsPerSecond", calls / wallSeconds);
+    result.insert("methods", methods);
+    return result;
+}
+
+QString ApiTraceReplayer::formatReport(const QVariantMap &report)
+{
+    QString text = QStringLiteral("%1 calls in %2 ms over %3 session(s): %4 calls/s, %5 skipped\n\n")
+                       .arg(report.value("calls").toLongLong())
+                       .arg(report.value("wallMs").toDouble(), 0, 'f', 1)
+                       .arg(report.value("sessions").toInt())
+                       .arg(report.value("callsPerSecond").toDouble(), 0, 'f', 1)
+                       .arg(report.value("skipped").toInt());
+
+    text += QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                .arg(QStringLiteral("method"), -32)
+                .arg(QStringLiteral("calls"), 8)
+                .arg(QStringLiteral("calls/s"), 10)
+                .arg(QStringLiteral("p50 ms"), 9)
+                .arg(QStringLiteral("p95 ms"), 9)
+                .arg(QStringLiteral("p99 ms"), 9)
+                .arg(QStringLiteral("max ms"), 9)
+                .arg(QStringLiteral("rec p50"), 9);
+
+    const QVariantList methods = report.value("methods").toList();
+    for (const QVariant &entry : methods) {
+        const QVariantMap row = entry.toMap();
+        text += QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                    .arg(row.value("method").toString(), -32)
+                    .arg(row.value("calls").toLongLong(), 8)
+                    .arg(row.value("callsPerSecond").toDouble(), 10, 'f', 1)
+                    .arg(row.value("p50Ms").toDouble(), 9, 'f', 3)
+                    .arg(row.value("p95Ms").toDouble(), 9, 'f', 3)
+                    .arg(row.value("p99Ms").toDouble(), 9, 'f', 3)
+                    .arg(row.value("maxMs").toDouble(), 9, 'f', 3)
+                    .arg(row.value("recordedP50Ms").toDouble(), 9, 'f', 3);
+    }
+    return text;
+}
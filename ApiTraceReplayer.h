@@ -0,0 +1,65 @@
+#ifndef APITRACEREPLAYER_H
+#define APITRACEREPLAYER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+
+class Database;
+
+// Re-executes a trace written by ApiTraceRecorder against a Database opened
+// on a given file, through Database's meta-object (the same entry points
+// QML uses). Each replay() is one session: one Database instance, one
+// connection, calls in recorded order.
+// - speed 0 runs calls back to back; otherwise the recorded spacing is
+//   kept, divided by speed (1 = original pace).
+// - Traced logins carry a redacted password and are replayed by starting
+//   the session for that username directly, without password checks.
+class ApiTraceReplayer
+{
+public:
+    struct Call {
+        quint16 method = 0;
+        qint64 startNs = 0;
+        qint64 durationNs = 0;
+        QVariantList args;
+    };
+
+    // Raw latencies of one or more sessions, per method name
+    struct Samples {
+        qint64 wallNs = 0;
+        int skipped = 0;   // unknown methods or unconvertible arguments
+        QHash<QByteArray, QVector<qint64>> replayedNs;
+        QHash<QByteArray, QVector<qint64>> recordedNs;
+
+        void merge(const Samples &other);
+    };
+
+    bool load(const QString &tracePath);
+    QString errorString() const { return m_error; }
+    int callCount() const { return m_calls.size(); }
+
+    bool replay(const QString &databasePath, const QString &connectionName, double speed, Samples &samples);
+
+    // Worker processes hand their samples back through a file
+    static bool writeSamples(const QString &filePath, const Samples &samples);
+    static bool readSamples(const QString &filePath, Samples &samples);
+
+    // { sessions, calls, skipped, wallMs, callsPerSecond, methods: [{ method,
+    //   calls, callsPerSecond, p50Ms, p95Ms, p99Ms, maxMs, recordedP50Ms }] }
+    static QVariantMap report(const Samples &samples, int sessions);
+    static QString formatReport(const QVariantMap &report);
+
+private:
+    bool invoke(Database &database, int methodIndex, QVariantList args) const;
+    bool replayLogin(Database &database, const QVariantList &args) const;
+
+    QVector<QByteArray> m_methods;   // trace method id -> name
+    QVector<Call> m_calls;
+    QString m_error;
+};
+
+#endif // APITRACEREPLAYER_H
@@ -1,13 +1,37 @@
 #include "AppLogic.h"
 #include "Database.h"
 #include <QDebug>
+#include <QLoggingCategory>
+
+// Page switch timings and evictions, off by default (the same numbers
+// reach QML through pageSwitchMeasured and getPageCacheReport()):
+// QT_LOGGING_RULES="sigmaterial.pages.debug=true"
+Q_LOGGING_CATEGORY(lcPages, "sigmaterial.pages", QtInfoMsg)
+
+namespace {
+// Default live-page budget in QObjects; roughly all five pages at their
+// usual size, so eviction only starts once pages grow with their data
+constexpr int kDefaultPageBudget = 20000;
+// Quiet period after a switch before a likely next page is preloaded
+constexpr int kPreloadIdleMs = 750;
+}
 
 AppLogic::AppLogic(QObject *parent) 
     : QObject(parent)
     , m_loggedIn(false)
     , m_currentPage("dashboard")
     , m_database(nullptr)
+    , m_pageBudget(kDefaultPageBudget)
+    , m_switchWarm(false)
+    , m_lastSwitchMs(0.0)
+    , m_warmSwitches(0)
+    , m_coldSwitches(0)
+    , m_warmSwitchMsTotal(0.0)
+    , m_coldSwitchMsTotal(0.0)
 {
+    m_preloadTimer.setSingleShot(true);
+    m_preloadTimer.setInterval(kPreloadIdleMs);
+    connect(&m_preloadTimer, &QTimer::timeout, this, &AppLogic::preloadLikelyNext);
 }
 
 void AppLogic::setDatabase(Database *database)
@@ -40,24 +64,201 @@ void AppLogic::setCurrentPage(const QString &page) {
 bool AppLogic::navigateToPage(const QString &page) {
     if (!m_loggedIn) {
         return false;
-    }    QString qmlFile;
+    }
+    QString qmlFile;
     if (page == "dashboard") {
-        qmlFile = "qrc:/Dashboard.qml";
+        qmlFile = "qrc:/AppSigmaterial/Dashboard.qml";
     } else if (page == "stock") {
-        qmlFile = "qrc:/Stock.qml";
+        qmlFile = "qrc:/AppSigmaterial/Stock.qml";
     } else if (page == "managestore") {
-        qmlFile = "qrc:/ManageStore.qml";
+        qmlFile = "qrc:/AppSigmaterial/ManageStore.qml";
     } else if (page == "overview") {
-        qmlFile = "qrc:/Overview.qml";
+        qmlFile = "qrc:/AppSigmaterial/Overview.qml";
+    } else if (page == "settings") {
+        qmlFile = "qrc:/AppSigmaterial/Settings.qml";
     } else {
         return false;
     }
 
+    const QString previous = m_currentPage;
+    if (previous != page) {
+        m_transitions[previous][page]++;
+        emit pageSuspended(previous);
+    }
+
+    // Timed until the shell reports the page visible; a live page only
+    // needs to be shown, anything else is created first
+    m_switchTarget = page;
+    m_switchWarm = m_pages.contains(page);
+    m_switchTimer.start();
+    m_preloadTimer.stop();
+
+    m_recentPages.removeAll(page);
+    m_recentPages.prepend(page);
+
     setCurrentPage(page);
+    emit pageResumed(page);
     emit navigationRequested(qmlFile);
     return true;
 }
 
+// ============================================================================
+// Page Lifecycle
+// ============================================================================
+
+int AppLogic::pageBudget() const {
+    return m_pageBudget;
+}
+
+void AppLogic::setPageBudget(int budget) {
+    budget = qMax(0, budget);
+    if (m_pageBudget != budget) {
+        m_pageBudget = budget;
+        emit pageBudgetChanged();
+        enforceBudget();
+    }
+}
+
+double AppLogic::lastSwitchMs() const {
+    return m_lastSwitchMs;
+}
+
+void AppLogic::pageReady(const QString &page, QObject *item) {
+    PageState &state = m_pages[page];
+    state.item = item;
+    state.cost = countObjects(item);
+    enforceBudget();
+}
+
+void AppLogic::pageShown(const QString &page) {
+    if (page != m_switchTarget || !m_switchTimer.isValid()) {
+        return;
+    }
+
+    // Re-measure: a page grows with its data while it is in use
+    if (m_pages.contains(page)) {
+        m_pages[page].cost = countObjects(m_pages[page].item);
+    }
+
+    m_lastSwitchMs = m_switchTimer.nsecsElapsed() / 1000000.0;
+    m_switchTimer.invalidate();
+    if (m_switchWarm) {
+        ++m_warmSwitches;
+        m_warmSwitchMsTotal += m_lastSwitchMs;
+    } else {
+        ++m_coldSwitches;
+        m_coldSwitchMsTotal += m_lastSwitchMs;
+    }
+    qCDebug(lcPages) << "Page switch to" << page << "took" << m_lastSwitchMs << "ms"
+                     << (m_switchWarm ? "(kept alive)" : "(created)");
+    emit pageSwitchMeasured(page, m_lastSwitchMs, m_switchWarm);
+
+    enforceBudget();
+    m_preloadTimer.start();
+}
+
+bool AppLogic::isPageAlive(const QString &page) const {
+    return m_pages.contains(page);
+}
+
+bool AppLogic::fitsPageBudget() const {
+    return usedBudget() < m_pageBudget;
+}
+
+QVariantMap AppLogic::getPageCacheReport() const {
+    QVariantList alive;
+    for (auto it = m_pages.constBegin(); it != m_pages.constEnd(); ++it) {
+        QVariantMap entry;
+        entry.insert("page", it.key());
+        entry.insert("cost", it->cost);
+        alive.append(entry);
+    }
+
+    QVariantMap report;
+    report.insert("alive", alive);
+    report.insert("recent", m_recentPages);
+    report.insert("budget", m_pageBudget);
+    report.insert("used", usedBudget());
+    report.insert("switches", m_warmSwitches + m_coldSwitches);
+    report.insert("warmSwitches", m_warmSwitches);
+    report.insert("warmMeanMs", m_warmSwitches > 0 ? m_warmSwitchMsTotal / m_warmSwitches : 0.0);
+    report.insert("coldSwitches", m_coldSwitches);
+    report.insert("coldMeanMs", m_coldSwitches > 0 ? m_coldSwitchMsTotal / m_coldSwitches : 0.0);
+    report.insert("lastSwitchMs", m_lastSwitchMs);
+    return report;
+}
+
+void AppLogic::preloadLikelyNext() {
+    // Most frequent successor of the current page that is not alive yet
+    const QHash<QString, int> successors = m_transitions.value(m_currentPage);
+    QString best;
+    int bestCount = 0;
+    for (auto it = successors.constBegin(); it != successors.constEnd(); ++it) {
+        if (it.value() > bestCount && !m_pages.contains(it.key())) {
+            best = it.key();
+            bestCount = it.value();
+        }
+    }
+
+    if (!best.isEmpty() && fitsPageBudget()) {
+        emit preloadRequested(best);
+    }
+}
+
+int AppLogic::countObjects(const QObject *object) {
+    if (!object) {
+        return 0;
+    }
+    int count = 1;
+    for (const QObject *child : object->children()) {
+        count += countObjects(child);
+    }
+    return count;
+}
+
+int AppLogic::usedBudget() const {
+    int used = 0;
+    for (const PageState &state : m_pages) {
+        used += state.cost;
+    }
+    return used;
+}
+
+void AppLogic::enforceBudget() {
+    // Drop pages whose item went away on its own
+    for (auto it = m_pages.begin(); it != m_pages.end();) {
+        if (!it->item) {
+            it = m_pages.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    while (usedBudget() > m_pageBudget) {
+        // Never-shown (prewarmed or preloaded) pages are the oldest
+        QString victim;
+        for (auto it = m_pages.constBegin(); it != m_pages.constEnd(); ++it) {
+            if (it.key() != m_currentPage && !m_recentPages.contains(it.key())) {
+                victim = it.key();
+                break;
+            }
+        }
+        for (int i = m_recentPages.size() - 1; victim.isEmpty() && i >= 0; --i) {
+            const QString &page = m_recentPages.at(i);
+            if (page != m_currentPage && m_pages.contains(page)) {
+                victim = page;
+            }
+        }
+
+        if (victim.isEmpty()) {
+            break;  // Only the current page is left
+        }
+        m_pages.remove(victim);
+        qCDebug(lcPages) << "Evicting page" << victim << "to stay within the page budget";
+        emit pageEvicted(victim);
+    }
+}
+
 void AppLogic::login() {
     // Check if user is actually logged in via database
     if (m_database && m_database->isUserLoggedIn()) {
@@ -1,7 +1,13 @@
 #ifndef APPLOGIC_H
 #define APPLOGIC_H
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantMap>
 
 class Database;
 
@@ -10,6 +16,8 @@ class AppLogic : public QObject
     Q_OBJECT
     Q_PROPERTY(bool loggedIn READ loggedIn WRITE setLoggedIn NOTIFY loggedInChanged)
     Q_PROPERTY(QString currentPage READ currentPage WRITE setCurrentPage NOTIFY currentPageChanged)
+    Q_PROPERTY(int pageBudget READ pageBudget WRITE setPageBudget NOTIFY pageBudgetChanged)
+    Q_PROPERTY(double lastSwitchMs READ lastSwitchMs NOTIFY pageSwitchMeasured)
 
 public:
     explicit AppLogic(QObject *parent = nullptr);
@@ -22,20 +30,73 @@ public:
     QString currentPage() const;
     void setCurrentPage(const QString &page);
 
+    // ========== Page Lifecycle ==========
+    // Live pages are kept while their combined cost stays within the budget.
+    // A page's cost is the number of QObjects in its tree, a proxy for the
+    // memory it holds; the least recently shown hidden page goes first.
+    int pageBudget() const;
+    void setPageBudget(int budget);
+    double lastSwitchMs() const;
+
+    // Called by the shell when a page finished loading / became visible
+    Q_INVOKABLE void pageReady(const QString &page, QObject *item);
+    Q_INVOKABLE void pageShown(const QString &page);
+    Q_INVOKABLE bool isPageAlive(const QString &page) const;
+    Q_INVOKABLE bool fitsPageBudget() const;
+
+    // { alive: [{ page, cost }], recent, budget, used, switches, warmSwitches,
+    //   warmMeanMs, coldSwitches, coldMeanMs, lastSwitchMs }
+    Q_INVOKABLE QVariantMap getPageCacheReport() const;
+
 signals:
     void loggedInChanged();
     void currentPageChanged();
     void navigationRequested(const QString &qmlFile);
+    void pageBudgetChanged();
+
+    // Hidden pages should stop reacting to model signals until resumed
+    void pageSuspended(const QString &page);
+    void pageResumed(const QString &page);
+    void pageEvicted(const QString &page);
+    void preloadRequested(const QString &page);
+    void pageSwitchMeasured(const QString &page, double ms, bool warm);
 
 public slots:
     bool navigateToPage(const QString &page);
     void login();
     void logout();
 
+private slots:
+    void preloadLikelyNext();
+
 private:
+    static int countObjects(const QObject *object);
+    int usedBudget() const;
+    void enforceBudget();
+
     bool m_loggedIn;
     QString m_currentPage;
     Database *m_database;
+
+    // Page lifecycle
+    struct PageState {
+        QPointer<QObject> item;
+        int cost = 0;
+    };
+    QHash<QString, PageState> m_pages;                   // live pages
+    QStringList m_recentPages;                           // most recently shown first
+    QHash<QString, QHash<QString, int>> m_transitions;   // from -> to -> count
+    int m_pageBudget;
+    QTimer m_preloadTimer;
+
+    QElapsedTimer m_switchTimer;
+    QString m_switchTarget;
+    bool m_switchWarm;
+    double m_lastSwitchMs;
+    int m_warmSwitches;
+    int m_coldSwitches;
+    double m_warmSwitchMsTotal;
+    double m_coldSwitchMsTotal;
 };
 
 #endif // APPLOGIC_H
@@ -0,0 +1,59 @@
+#include "CatalogArena.h"
+#include <algorithm>
+
+QString CatalogArena::intern(QStringView text)
+{
+    if (text.isEmpty()) {
+        return QString();
+    }
+
+    QChar *target = allocate(text.size());
+    std::copy(text.begin(), text.end(), target);
+    m_usedBytes += text.size() * qint64(sizeof(QChar));
+    return QString::fromRawData(target, text.size());
+}
+
+void CatalogArena::retire(QStringView text)
+{
+    m_deadBytes += text.size() * qint64(sizeof(QChar));
+}
+
+QString CatalogArena::detach(const QString &text)
+{
+    // Copying a fromRawData string shares the raw pointer; this does not
+    return text.isEmpty() ? QString() : QString(text.constData(), text.size());
+}
+
+QChar *CatalogArena::allocate(qsizetype chars)
+{
+    // Large payloads get a block of their own instead of wasting the tail
+    // of the current one
+    if (chars > kBlockChars / 4) {
+        m_blocks.emplace_back(new QChar[chars]);
+        m_reservedBytes += chars * qint64(sizeof(QChar));
+        return m_blocks.back().get();
+    }
+
+    if (chars > m_remaining) {
+        m_blocks.emplace_back(new QChar[kBlockChars]);
+        m_reservedBytes += kBlockChars * qint64(sizeof(QChar));
+        m_cursor = m_blocks.back().get();
+        m_remaining = kBlockChars;
+    }
+
+    QChar *result = m_cursor;
+    m_cursor += chars;
+    m_remaining -= chars;
+    return result;
+}
+
+QVariantMap CatalogArena::report() const
+{
+    QVariantMap map;
+    map.insert("blocks", blockCount());
+    map.insert("reservedBytes", m_reservedBytes);
+    map.insert("usedBytes", m_usedBytes);
+    map.insert("deadBytes", m_deadBytes);
+    map.insert("slackBytes", m_reservedBytes - m_usedBytes);
+    return map;
+}
@@ -0,0 +1,55 @@
+#ifndef CATALOGARENA_H
+#define CATALOGARENA_H
+
+#include <QString>
+#include <QStringView>
+#include <QVariantMap>
+#include <memory>
+#include <vector>
+
+// Bump allocator for catalog string payloads.
+// intern() copies text into large contiguous blocks and returns a QString
+// that references it via QString::fromRawData, so a loaded catalog costs a
+// handful of block allocations instead of several per book. Nothing is
+// freed individually: the whole arena goes away on reload or logout.
+//
+// Interned strings are only valid while the arena lives. Holders that may
+// outlive it (QVariantMaps for QML, caches, other threads) must either keep
+// a shared_ptr to the arena or take an owning copy with detach().
+class CatalogArena
+{
+public:
+    static constexpr qsizetype kBlockChars = 128 * 1024;  // 256 KiB per block
+
+    CatalogArena() = default;
+    CatalogArena(const CatalogArena &) = delete;
+    CatalogArena &operator=(const CatalogArena &) = delete;
+
+    QString intern(QStringView text);
+
+    // Records that an interned string is no longer referenced by the
+    // catalog; its bytes stay allocated until the arena is released
+    void retire(QStringView text);
+
+    static QString detach(const QString &text);
+
+    qint64 usedBytes() const { return m_usedBytes; }
+    qint64 reservedBytes() const { return m_reservedBytes; }
+    qint64 deadBytes() const { return m_deadBytes; }
+    int blockCount() const { return int(m_blocks.size()); }
+
+    // { blocks, reservedBytes, usedBytes, deadBytes, slackBytes }
+    QVariantMap report() const;
+
+private:
+    QChar *allocate(qsizetype chars);
+
+    std::vector<std::unique_ptr<QChar[]>> m_blocks;
+    QChar *m_cursor = nullptr;
+    qsizetype m_remaining = 0;
+    qint64 m_usedBytes = 0;
+    qint64 m_reservedBytes = 0;
+    qint64 m_deadBytes = 0;
+};
+
+#endif // CATALOGARENA_H
@@ -0,0 +1,730 @@
+#include "CatalogExporter.h"
+#include "Database.h"
+#include <QHash>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QUrl>
+#include <QtEndian>
+#include <QDebug>
+
+namespace {
+constexpr qsizetype kFlushBytes = 256 * 1024;
+constexpr int kRowGroupRows = 64 * 1024;
+constexpr qint64 kProgressInterval = 8192;
+constexpr char kColumnarMagic[] = "SGC1";
+
+constexpr const char *kCountBooksSql = "SELECT COUNT(*) FROM books WHERE user_id = ?";
+constexpr const char *kExportBooksSql =
+    "SELECT id, title, author, genre, publisher, year, copies, image_path FROM books WHERE user_id = ? ORDER BY id";
+
+enum class Format { Csv, JsonLines, Columnar };
+
+// One reusable row; sources overwrite it in place
+struct ExportRow {
+    int id = 0;
+    int year = 0;
+    int copies = 0;
+    QString title;
+    QString author;
+    QString genre;
+    QString publisher;
+    QString imagePath;
+};
+
+// ============================================================================
+// Row Sources
+// ============================================================================
+
+class RowSource
+{
+public:
+    virtual ~RowSource() = default;
+    virtual bool next(ExportRow &row) = 0;
+    virtual qint64 total() const = 0;
+    virtual QString errorString() const { return QString(); }
+};
+
+// Walks a published catalog version. It never changes under the reader,
+// and holding it keeps the books' interned strings alive even if the
+// catalog is edited, reloaded or the user logs out mid-export.
+class SnapshotSource : public RowSource
+{
+public:
+    explicit SnapshotSource(std::shared_ptr<const CatalogSnapshot> snapshot)
+        : m_snapshot(std::move(snapshot))
+    {
+    }
+
+    bool next(ExportRow &row) override
+    {
+        const ChunkedVector<Database::Book> &books = m_snapshot->books;
+        while (m_chunk < books.chunkCount() && m_index >= books.chunk(m_chunk).size()) {
+            ++m_chunk;
+            m_index = 0;
+        }
+        if (m_chunk >= books.chunkCount())
+            return false;
+
+        const Database::Book &book = books.chunk(m_chunk).at(m_index++);
+        row.id = book.id;
+        row.year = book.year;
+        row.copies = book.copies;
+        row.title = book.title;
+        row.author = book.author;
+        row.genre = book.genre;
+        row.publisher = book.publisher;
+        row.imagePath = book.image_path;
+        return true;
+    }
+
+    qint64 total() const override { return m_snapshot->books.size(); }
+
+private:
+    const std::shared_ptr<const CatalogSnapshot> m_snapshot;
+    int m_chunk = 0;
+    qsizetype m_index = 0;
+};
+
+// Forward-only cursor: SQLite hands rows over one by one instead of the
+// driver caching the whole result set for random access.
+class QuerySource : public RowSource
+{
+public:
+    QuerySource(const QSqlDatabase &db, int userId)
+        : m_query(db)
+    {
+        QSqlQuery count(db);
+        count.prepare(kCountBooksSql);
+        count.addBindValue(userId);
+        if (count.exec() && count.next())
+            m_total = count.value(0).toLongLong();
+
+        m_query.setForwardOnly(true);
+        m_query.prepare(kExportBooksSql);
+        m_query.addBindValue(userId);
+        if (!m_query.exec())
+            m_error = m_query.lastError().text();
+    }
+
+    bool next(ExportRow &row) override
+    {
+        if (!m_error.isEmpty() || !m_query.next())
+            return false;
+
+        row.id = m_query.value(0).toInt();
+        row.title = m_query.value(1).toString();
+        row.author = m_query.value(2).toString();
+        row.genre = m_query.value(3).toString();
+        row.publisher = m_query.value(4).toString();
+        row.year = m_query.value(5).toInt();
+        row.copies = m_query.value(6).toInt();
+        row.imagePath = m_query.value(7).toString();
+        return true;
+    }
+
+    qint64 total() const override { return m_total; }
+    QString errorString() const override { return m_error; }
+
+private:
+    QSqlQuery m_query;
+    qint64 m_total = 0;
+    QString m_error;
+};
+
+// ============================================================================
+// Chunked Output
+// ============================================================================
+
+// Stages writes in one buffer and hands it to the file every kFlushBytes.
+// resize(0) keeps the capacity, so the buffer is allocated once per export.
+class ChunkedOutput
+{
+public:
+    explicit ChunkedOutput(const QString &filePath)
+        : m_file(filePath)
+    {
+        m_buffer.reserve(kFlushBytes + 4096);
+    }
+
+    bool open()
+    {
+        if (!m_file.open(QIODevice::WriteOnly)) {
+            m_error = m_file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    void append(const char *data, qsizetype size)
+    {
+        m_buffer.append(data, size);
+        if (m_buffer.size() >= kFlushBytes)
+            flush();
+    }
+
+    void append(const QByteArray &data) { append(data.constData(), data.size()); }
+    void append(char c) { append(&c, 1); }
+
+    template <typename T>
+    void appendLE(T value)
+    {
+        char bytes[sizeof(T)];
+        qToLittleEndian(value, bytes);
+        append(bytes, sizeof(T));
+    }
+
+    // Absolute file offset of the next byte appended
+    qint64 position() const { return m_written + m_buffer.size(); }
+
+    bool flush()
+    {
+        if (m_buffer.isEmpty() || !m_error.isEmpty())
+            return m_error.isEmpty();
+
+        if (m_file.write(m_buffer) != m_buffer.size())
+            m_error = m_file.errorString();
+
+        m_written += m_buffer.size();
+        m_buffer.resize(0);
+        return m_error.isEmpty();
+    }
+
+    bool commit()
+    {
+        if (!flush())
+            return false;
+        if (!m_file.commit()) {
+            m_error = m_file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    void discard() { m_file.cancelWriting(); }
+
+    bool hasError() const { return !m_error.isEmpty(); }
+    QString errorString() const { return m_error; }
+
+private:
+    QSaveFile m_file;
+    QByteArray m_buffer;
+    qint64 m_written = 0;
+    QString m_error;
+};
+
+// ============================================================================
+// Text Encodings
+// ============================================================================
+
+void appendCsvField(ChunkedOutput &out, const QString &value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    const bool needsQuotes = utf8.contains(',') || utf8.contains('"')
+                          || utf8.contains('\n') || utf8.contains('\r');
+    if (!needsQuotes) {
+        out.append(utf8);
+        return;
+    }
+
+    out.append('"');
+    for (const char c : utf8) {
+        if (c == '"')
+            out.append('"');
+        out.append(c);
+    }
+    out.append('"');
+}
+
+void appendJsonString(ChunkedOutput &out, const QString &value)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out.append('"');
+    const QByteArray utf8 = value.toUtf8();
+    for (const char c : utf8) {
+        const uchar u = static_cast<uchar>(c);
+        switch (c) {
+        case '"':  out.append("\\\"", 2); break;
+        case '\\': out.append("\\\\", 2); break;
+        case '\n': out.append("\\n", 2); break;
+        case '\r': out.append("\\r", 2); break;
+        case '\t': out.append("\\t", 2); break;
+        default:
+            if (u < 0x20) {
+                const char escaped[] = { '\\', 'u', '0', '0', hex[u >> 4], hex[u & 0xF] };
+                out.append(escaped, sizeof(escaped));
+            } else {
+                out.append(c);  // UTF-8 continuation bytes pass through
+            }
+        }
+    }
+    out.append('"');
+}
+
+void appendNumber(ChunkedOutput &out, int value)
+{
+    out.append(QByteArray::number(value));
+}
+
+// ============================================================================
+// Columnar Encoding
+// ============================================================================
+
+enum ColumnType : quint8 { Int32Column = 0, StringColumn = 1 };
+enum ColumnEncoding : quint8 { PlainEncoding = 0, DictionaryEncoding = 1 };
+
+struct ColumnSpec {
+    const char *name;
+    ColumnType type;
+    bool dictionaryCandidate;  // low-cardinality strings
+};
+
+constexpr ColumnSpec kColumns[] = {
+    { "id",         Int32Column,  false },
+    { "title",      StringColumn, false },
+    { "author",     StringColumn, true  },
+    { "genre",      StringColumn, true  },
+    { "publisher",  StringColumn, true  },
+    { "year",       Int32Column,  false },
+    { "copies",     Int32Column,  false },
+    { "image_path", StringColumn, false },
+};
+constexpr int kColumnCount = int(sizeof(kColumns) / sizeof(kColumns[0]));
+
+// Buffers one row group; capacity is reused across groups
+struct ColumnBuffer {
+    QVector<qint32> ints;
+    QVector<quint32> offsets;  // rows + 1 entries into bytes
+    QByteArray bytes;
+
+    void reset()
+    {
+        ints.resize(0);
+        offsets.resize(0);
+        offsets.append(0);
+        bytes.resize(0);
+    }
+
+    void appendString(const QString &value)
+    {
+        bytes.append(value.toUtf8());
+        offsets.append(quint32(bytes.size()));
+    }
+
+    QByteArrayView stringAt(qsizetype row) const
+    {
+        return QByteArrayView(bytes.constData() + offsets.at(row), offsets.at(row + 1) - offsets.at(row));
+    }
+};
+
+// ============================================================================
+// Export Job
+// ============================================================================
+
+class ExportJob : public QRunnable
+{
+public:
+    ExportJob(CatalogExporter *exporter, QAtomicInt *cancelled, Format format, const QString &filePath,
+              std::shared_ptr<const CatalogSnapshot> snapshot,
+              const QString &connectionName, int userId, bool fromDatabase)
+        : m_exporter(exporter)
+        , m_cancelled(cancelled)
+        , m_format(format)
+        , m_filePath(filePath)
+        , m_snapshot(std::move(snapshot))
+        , m_connectionName(connectionName)
+        , m_userId(userId)
+        , m_fromDatabase(fromDatabase)
+    {
+    }
+
+    void run() override
+    {
+        if (!m_fromDatabase) {
+            SnapshotSource source(std::move(m_snapshot));
+            exportFrom(source);
+            return;
+        }
+
+        // QSqlDatabase connections are per thread: clone the GUI connection
+        const QString connection = QStringLiteral("catalog-export-")
+                                 + QString::number(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+        {
+            QSqlDatabase db = QSqlDatabase::cloneDatabase(m_connectionName, connection);
+            if (!db.open()) {
+                finish(false, 0, db.lastError().text());
+            } else {
+                QuerySource source(db, m_userId);
+                exportFrom(source);
+            }
+        }
+        QSqlDatabase::removeDatabase(connection);
+    }
+
+private:
+    void exportFrom(RowSource &source)
+    {
+        ChunkedOutput out(m_filePath);
+        if (!out.open()) {
+            finish(false, 0, out.errorString());
+            return;
+        }
+
+        m_total = source.total();
+        m_rows = 0;
+
+        bool completed = false;
+        switch (m_format) {
+        case Format::Csv:       completed = writeCsv(source, out); break;
+        case Format::JsonLines: completed = writeJsonLines(source, out); break;
+        case Format::Columnar:  completed = writeColumnar(source, out); break;
+        }
+
+        if (!completed) {
+            out.discard();
+            QString error = out.errorString();
+            if (error.isEmpty())
+                error = source.errorString();
+            if (error.isEmpty())
+                error = QStringLiteral("Export cancelled");
+            finish(false, m_rows, error);
+            return;
+        }
+
+        if (!source.errorString().isEmpty()) {
+            out.discard();
+            finish(false, m_rows, source.errorString());
+            return;
+        }
+
+        if (!out.commit()) {
+            finish(false, m_rows, out.errorString());
+            return;
+        }
+
+        reportProgress();
+        finish(true, m_rows, QString());
+    }
+
+    // Called once per row: counts it, reports progress and checks for cancel
+    bool step(const ChunkedOutput &out)
+    {
+        ++m_rows;
+        if (m_rows % kProgressInterval == 0)
+            reportProgress();
+        return !out.hasError() && !m_cancelled->loadRelaxed();
+    }
+
+    bool writeCsv(RowSource &source, ChunkedOutput &out)
+    {
+        out.append(QByteArrayLiteral("id,title,author,genre,publisher,year,copies,image_path\r\n"));
+
+        ExportRow row;
+        while (source.next(row)) {
+            appendNumber(out, row.id);
+            out.append(',');
+            appendCsvField(out, row.title);
+            out.append(',');
+            appendCsvField(out, row.author);
+            out.append(',');
+            appendCsvField(out, row.genre);
+            out.append(',');
+            appendCsvField(out, row.publisher);
+            out.append(',');
+            appendNumber(out, row.year);
+            out.append(',');
+            appendNumber(out, row.copies);
+            out.append(',');
+            appendCsvField(out, row.imagePath);
+            out.append("\r\n", 2);
+
+            if (!step(out))
+                return false;
+        }
+        return !out.hasError();
+    }
+
+    bool writeJsonLines(RowSource &source, ChunkedOutput &out)
+    {
+        ExportRow row;
+        while (source.next(row)) {
+            out.append(QByteArrayLiteral("{\"id\":"));
+            appendNumber(out, row.id);
+            out.append(QByteArrayLiteral(",\"title\":"));
+            appendJsonString(out, row.title);
+            out.append(QByteArrayLiteral(",\"author\":"));
+            appendJsonString(out, row.author);
+            out.append(QByteArrayLiteral(",\"genre\":"));
+            appendJsonString(out, row.genre);
+            out.append(QByteArrayLiteral(",\"publisher\":"));
+            appendJsonString(out, row.publisher);
+            out.append(QByteArrayLiteral(",\"year\":"));
+            appendNumber(out, row.year);
+            out.append(QByteArrayLiteral(",\"copies\":"));
+            appendNumber(out, row.copies);
+            out.append(QByteArrayLiteral(",\"image_path\":"));
+            appendJsonString(out, row.imagePath);
+            out.append("}\n", 2);
+
+            if (!step(out))
+                return false;
+        }
+        return !out.hasError();
+    }
+
+    // Layout (all integers little-endian):
+    //   "SGC1" | row group* | footer | u32 footer length | "SGC1"
+    //   int32 chunk:  u8 encoding=0 | i32[rows]
+    //   string chunk: u8 encoding=0 | u32 offsets[rows + 1] | utf8 bytes
+    //             or  u8 encoding=1 | u32 count | u32 offsets[count + 1] | utf8 bytes | u16 indices[rows]
+    //   footer: u32 column count | per column: u8 type, u16 name length, name
+    //           u32 row group count | per group: u32 rows | per column: u64 offset, u64 length
+    // Only one row group is held in memory; the footer grows by one entry
+    // per kRowGroupRows rows.
+    bool writeColumnar(RowSource &source, ChunkedOutput &out)
+    {
+        out.append(kColumnarMagic, 4);
+
+        ColumnBuffer columns[kColumnCount];
+        for (ColumnBuffer &column : columns) {
+            column.ints.reserve(kRowGroupRows);
+            column.reset();
+        }
+
+        QByteArray footer;
+        quint32 groupCount = 0;
+        int groupRows = 0;
+
+        ExportRow row;
+        bool more = true;
+        while (more) {
+            more = source.next(row);
+            if (more) {
+                columns[0].ints.append(row.id);
+                columns[1].appendString(row.title);
+                columns[2].appendString(row.author);
+                columns[3].appendString(row.genre);
+                columns[4].appendString(row.publisher);
+                columns[5].ints.append(row.year);
+                columns[6].ints.append(row.copies);
+                columns[7].appendString(row.imagePath);
+                ++groupRows;
+
+                if (!step(out))
+                    return false;
+            }
+
+            if (groupRows == kRowGroupRows || (!more && groupRows > 0)) {
+                appendLE(footer, quint32(groupRows));
+                for (int c = 0; c < kColumnCount; ++c) {
+                    const qint64 start = out.position();
+                    writeColumnChunk(out, kColumns[c], columns[c], groupRows);
+                    appendLE(footer, quint64(start));
+                    appendLE(footer, quint64(out.position() - start));
+                    columns[c].reset();
+                }
+                ++groupCount;
+                groupRows = 0;
+            }
+        }
+
+        const qint64 footerStart = out.position();
+        out.appendLE(quint32(kColumnCount));
+        for (const ColumnSpec &spec : kColumns) {
+            const QByteArray name(spec.name);
+            out.appendLE(quint8(spec.type));
+            out.appendLE(quint16(name.size()));
+            out.append(name);
+        }
+        out.appendLE(groupCount);
+        out.append(footer);
+        out.appendLE(quint32(out.position() - footerStart));
+        out.append(kColumnarMagic, 4);
+
+        return !out.hasError();
+    }
+
+    static void writeColumnChunk(ChunkedOutput &out, const ColumnSpec &spec, const ColumnBuffer &column, int rows)
+    {
+        if (spec.type == Int32Column) {
+            out.appendLE(quint8(PlainEncoding));
+            for (const qint32 value : column.ints)
+                out.appendLE(value);
+            return;
+        }
+
+        if (spec.dictionaryCandidate && writeDictionaryChunk(out, column, rows))
+            return;
+
+        out.appendLE(quint8(PlainEncoding));
+        for (const quint32 offset : column.offsets)
+            out.appendLE(offset);
+        out.append(column.bytes);
+    }
+
+    // Writes the chunk dictionary-encoded if that is smaller than plain
+    static bool writeDictionaryChunk(ChunkedOutput &out, const ColumnBuffer &column, int rows)
+    {
+        QHash<QByteArrayView, quint16> lookup;
+        QVector<QByteArrayView> values;
+        qint64 dictionaryBytes = 0;
+
+        for (int i = 0; i < rows; ++i) {
+            const QByteArrayView value = column.stringAt(i);
+            if (lookup.contains(value))
+                continue;
+            if (values.size() == 0xFFFF)
+                return false;
+            lookup.insert(value, quint16(values.size()));
+            values.append(value);
+            dictionaryBytes += value.size();
+        }
+
+        const qint64 plainSize = qint64(column.offsets.size()) * 4 + column.bytes.size();
+        const qint64 dictionarySize = 4 + qint64(values.size() + 1) * 4 + dictionaryBytes + qint64(rows) * 2;
+        if (dictionarySize >= plainSize)
+            return false;
+
+        out.appendLE(quint8(DictionaryEncoding));
+        out.appendLE(quint32(values.size()));
+        quint32 offset = 0;
+        out.appendLE(offset);
+        for (const QByteArrayView value : values) {
+            offset += quint32(value.size());
+            out.appendLE(offset);
+        }
+        for (const QByteArrayView value : values)
+            out.append(value.data(), value.size());
+        for (int i = 0; i < rows; ++i)
+            out.appendLE(lookup.value(column.stringAt(i)));
+        return true;
+    }
+
+    template <typename T>
+    static void appendLE(QByteArray &target, T value)
+    {
+        char bytes[sizeof(T)];
+        qToLittleEndian(value, bytes);
+        target.append(bytes, sizeof(T));
+    }
+
+    void reportProgress()
+    {
+        QMetaObject::invokeMethod(m_exporter, "onJobProgress", Qt::QueuedConnection,
+                                  Q_ARG(qint64, m_rows),
+                                  Q_ARG(qint64, qMax(m_total, m_rows)));
+    }
+
+    void finish(bool success, qint64 rows, const QString &error)
+    {
+        QMetaObject::invokeMethod(m_exporter, "onJobFinished", Qt::QueuedConnection,
+                                  Q_ARG(bool, success),
+                                  Q_ARG(QString, m_filePath),
+                                  Q_ARG(qint64, rows),
+                                  Q_ARG(QString, error));
+    }
+
+    CatalogExporter *m_exporter;
+    QAtomicInt *m_cancelled;
+    Format m_format;
+    QString m_filePath;
+    std::shared_ptr<const CatalogSnapshot> m_snapshot;
+    QString m_connectionName;
+    int m_userId;
+    bool m_fromDatabase;
+    qint64 m_rows = 0;
+    qint64 m_total = 0;
+};
+}
+
+// ============================================================================
+// CatalogExporter
+// ============================================================================
+
+CatalogExporter::CatalogExporter(Database *database, QObject *parent)
+    : QObject(parent)
+    , m_database(database)
+    , m_running(false)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+CatalogExporter::~CatalogExporter()
+{
+    // The job posts back to this object, so it must end first
+    m_cancelled.storeRelaxed(1);
+    m_pool.waitForDone();
+}
+
+bool CatalogExporter::exportCatalog(const QString &filePath, const QString &format, const QString &source)
+{
+    if (m_running) {
+        qWarning() << "CatalogExporter: An export is already running";
+        return false;
+    }
+
+    if (!m_database || !m_database->isUserLoggedIn()) {
+        qWarning() << "CatalogExporter: No user logged in";
+        return false;
+    }
+
+    Format exportFormat;
+    const QString name = format.toLower();
+    if (name == QLatin1String("csv")) {
+        exportFormat = Format::Csv;
+    } else if (name == QLatin1String("jsonl")) {
+        exportFormat = Format::JsonLines;
+    } else if (name == QLatin1String("columnar")) {
+        exportFormat = Format::Columnar;
+    } else {
+        qWarning() << "CatalogExporter: Unknown format" << format;
+        return false;
+    }
+
+    const bool fromDatabase = source == QLatin1String("database");
+    if (!fromDatabase && source != QLatin1String("memory")) {
+        qWarning() << "CatalogExporter: Unknown source" << source;
+        return false;
+    }
+
+    // A QML FileDialog hands over a URL
+    const QString path = filePath.startsWith(QLatin1String("file:"))
+                       ? QUrl(filePath).toLocalFile()
+                       : filePath;
+
+    m_cancelled.storeRelaxed(0);
+    m_running = true;
+    emit runningChanged();
+
+    m_pool.start(new ExportJob(this, &m_cancelled, exportFormat, path,
+                               fromDatabase ? std::shared_ptr<const CatalogSnapshot>() : m_database->catalogSnapshot(),
+                               m_database->connectionName(),
+                               m_database->getCurrentUserId(),
+                               fromDatabase));
+    return true;
+}
+
+void CatalogExporter::cancel()
+{
+    if (m_running)
+        m_cancelled.storeRelaxed(1);
+}
+
+void CatalogExporter::onJobProgress(qint64 rowsWritten, qint64 totalRows)
+{
+    emit progress(rowsWritten, totalRows);
+}
+
+void CatalogExporter::onJobFinished(bool success, const QString &filePath, qint64 rowsWritten, const QString &errorString)
+{
+    if (!success)
+        qWarning() << "CatalogExporter: Export to" << filePath << "failed:" << errorString;
+
+    m_running = false;
+    emit runningChanged();
+    emit finished(success, filePath, rowsWritten, errorString);
+}
@@ -0,0 +1,51 @@
+#ifndef CATALOGEXPORTER_H
+#define CATALOGEXPORTER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QString>
+#include <QThreadPool>
+
+class Database;
+
+// Streams the current user's catalog to disk without materializing it.
+// - Source "memory" exports a shared snapshot of the in-memory catalog,
+//   source "database" walks a forward-only cursor on a cloned connection.
+// - Formats: "csv" (RFC 4180), "jsonl" (one object per line) and
+//   "columnar" (row groups of typed column chunks, see writeColumnar()).
+// - Output is staged in a fixed-size buffer and flushed in chunks to a
+//   QSaveFile, so the heap stays flat however many rows are written.
+class CatalogExporter : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+
+public:
+    explicit CatalogExporter(Database *database, QObject *parent = nullptr);
+    ~CatalogExporter();
+
+    // Starts an export in the background; false if one is already running
+    Q_INVOKABLE bool exportCatalog(const QString &filePath,
+                                   const QString &format,
+                                   const QString &source = QStringLiteral("memory"));
+    Q_INVOKABLE void cancel();
+
+    bool isRunning() const { return m_running; }
+
+signals:
+    void runningChanged();
+    void progress(qint64 rowsWritten, qint64 totalRows);
+    void finished(bool success, const QString &filePath, qint64 rowsWritten, const QString &errorString);
+
+private slots:
+    void onJobProgress(qint64 rowsWritten, qint64 totalRows);
+    void onJobFinished(bool success, const QString &filePath, qint64 rowsWritten, const QString &errorString);
+
+private:
+    Database *m_database;
+    QThreadPool m_pool;        // one worker; its destructor waits for a running job
+    QAtomicInt m_cancelled;
+    bool m_running;
+};
+
+#endif // CATALOGEXPORTER_H
@@ -0,0 +1,134 @@
+#ifndef CHUNKEDVECTOR_H
+#define CHUNKEDVECTOR_H
+
+#include <QVector>
+#include <algorithm>
+#include <memory>
+
+// Immutable sequence stored as a table of shared, immutable chunks.
+// Copies are cheap (the chunk table is implicitly shared), and the with*()
+// edits return a new vector that shares every chunk except the one they
+// touch: changing one record copies at most kChunkSize records plus the
+// chunk table, never the whole sequence. Safe to read from any thread once
+// built; nothing is ever modified in place.
+template <typename T>
+class ChunkedVector
+{
+public:
+    static constexpr int kChunkSize = 256;
+    using Chunk = QVector<T>;
+
+    ChunkedVector() = default;
+
+    static ChunkedVector fromVector(const QVector<T> &records)
+    {
+        ChunkedVector result;
+        result.m_chunks.reserve((records.size() + kChunkSize - 1) / kChunkSize);
+        for (qsizetype i = 0; i < records.size(); i += kChunkSize) {
+            result.m_chunks.append(std::make_shared<const Chunk>(records.mid(i, kChunkSize)));
+        }
+        result.m_size = records.size();
+        return result;
+    }
+
+    qsizetype size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    int chunkCount() const { return int(m_chunks.size()); }
+    const Chunk &chunk(int index) const { return *m_chunks.at(index); }
+
+    template <typename Function>
+    void forEach(Function function) const
+    {
+        for (const auto &chunk : m_chunks) {
+            for (const T &record : *chunk) {
+                function(record);
+            }
+        }
+    }
+
+    // First record the predicate accepts, or nullptr
+    template <typename Predicate>
+    const T *findIf(Predicate predicate) const
+    {
+        for (const auto &chunk : m_chunks) {
+            for (const T &record : *chunk) {
+                if (predicate(record)) {
+                    return &record;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    QVector<T> toVector() const
+    {
+        QVector<T> result;
+        result.reserve(m_size);
+        for (const auto &chunk : m_chunks) {
+            result.append(*chunk);
+        }
+        return result;
+    }
+
+    ChunkedVector withAppended(const T &record) const
+    {
+        ChunkedVector result = *this;
+        if (!result.m_chunks.isEmpty() && result.m_chunks.last()->size() < kChunkSize) {
+            Chunk tail = *result.m_chunks.last();
+            tail.append(record);
+            result.m_chunks.last() = std::make_shared<const Chunk>(std::move(tail));
+        } else {
+            result.m_chunks.append(std::make_shared<const Chunk>(Chunk{ record }));
+        }
+        ++result.m_size;
+        return result;
+    }
+
+    // Replaces the first record the predicate accepts; unchanged if none
+    template <typename Predicate>
+    ChunkedVector withReplaced(Predicate predicate, const T &record) const
+    {
+        ChunkedVector result = *this;
+        for (int c = 0; c < m_chunks.size(); ++c) {
+            const Chunk &source = *m_chunks.at(c);
+            const auto it = std::find_if(source.cbegin(), source.cend(), predicate);
+            if (it != source.cend()) {
+                Chunk copy = source;
+                copy[it - source.cbegin()] = record;
+                result.m_chunks[c] = std::make_shared<const Chunk>(std::move(copy));
+                break;
+            }
+        }
+        return result;
+    }
+
+    // Removes the first record the predicate accepts; unchanged if none.
+    // Chunks may shrink below kChunkSize; empty ones are dropped.
+    template <typename Predicate>
+    ChunkedVector withRemoved(Predicate predicate) const
+    {
+        ChunkedVector result = *this;
+        for (int c = 0; c < m_chunks.size(); ++c) {
+            const Chunk &source = *m_chunks.at(c);
+            const auto it = std::find_if(source.cbegin(), source.cend(), predicate);
+            if (it != source.cend()) {
+                Chunk copy = source;
+                copy.remove(it - source.cbegin());
+                if (copy.isEmpty()) {
+                    result.m_chunks.remove(c);
+                } else {
+                    result.m_chunks[c] = std::make_shared<const Chunk>(std::move(copy));
+                }
+                --result.m_size;
+                break;
+            }
+        }
+        return result;
+    }
+
+private:
+    QVector<std::shared_ptr<const Chunk>> m_chunks;
+    qsizetype m_size = 0;
+};
+
+#endif // CHUNKEDVECTOR_H
@@ -1,8 +1,8 @@
 #include "CircularImage.h"
-#include <QImageReader>
-#include <QPainterPath>
+#include "RemoteImageLoader.h"
+#include "ThumbnailCache.h"
+#include <QQuickWindow>
 #include <QFileInfo>
-#include <QNetworkRequest>
 #include <QDebug>
 
 CircularImage::CircularImage(QQuickItem *parent)
@@ -12,11 +12,20 @@ CircularImage::CircularImage(QQuickItem *parent)
     , m_borderWidth(0)
     , m_borderColor(Qt::transparent)
     , m_status(Null)
-    , m_networkManager(new QNetworkAccessManager(this))
 {
     setFlag(QQuickItem::ItemHasContents, true);
     setAntialiasing(true);
     setSmooth(true);
+
+    connect(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched,
+            this, &CircularImage::onNetworkReplyFinished);
+}
+
+CircularImage::~CircularImage()
+{
+    // Abort the download unless another item still waits for the same URL
+    if (RemoteImageLoader::isRemote(m_source))
+        RemoteImageLoader::instance()->cancel(m_source, this);
 }
 
 void CircularImage::setSource(const QUrl &source)
@@ -24,18 +33,22 @@ void CircularImage::setSource(const QUrl &source)
     if (m_source == source)
         return;
 
+    if (RemoteImageLoader::isRemote(m_source))
+        RemoteImageLoader::instance()->cancel(m_source, this);
+
     m_source = source;
+    m_remoteVersion.clear();
+    m_remoteData.clear();
     emit sourceChanged();
     
     if (source.isEmpty()) {
-        m_originalImage = QImage();
+        m_cacheKey.clear();
         m_circularImage = QImage();
         setStatus(Null);
         update();
         return;
     }
 
-    setStatus(Loading);
     loadImage();
 }
 
@@ -46,6 +59,10 @@ void CircularImage::setSmooth(bool smooth)
 
     m_smooth = smooth;
     emit smoothChanged();
+
+    // The rendered pixels depend on this property, so look up the matching entry
+    if (!m_source.isEmpty())
+        loadImage();
     update();
 }
 
@@ -56,6 +73,9 @@ void CircularImage::setAntialiasing(bool antialiasing)
 
     m_antialiasing = antialiasing;
     emit antialiasingChanged();
+
+    if (!m_source.isEmpty())
+        loadImage();
     update();
 }
 
@@ -66,6 +86,9 @@ void CircularImage::setBorderWidth(qreal width)
 
     m_borderWidth = width;
     emit borderWidthChanged();
+
+    if (!m_source.isEmpty())
+        loadImage();
     update();
 }
 
@@ -76,11 +99,19 @@ void CircularImage::setBorderColor(const QColor &color)
 
     m_borderColor = color;
     emit borderColorChanged();
+
+    if (!m_source.isEmpty())
+        loadImage();
     update();
 }
 
 void CircularImage::loadImage()
 {
+    if (RemoteImageLoader::isRemote(m_source)) {
+        loadRemoteImage();
+        return;
+    }
+
     QString localPath = urlToLocalPath(m_source);
     
     if (localPath.isEmpty()) {
@@ -89,107 +120,110 @@ void CircularImage::loadImage()
         return;
     }
 
-    QFileInfo fileInfo(localPath);
-    if (!fileInfo.exists()) {
+    if (!QFileInfo::exists(localPath)) {
         qWarning() << "CircularImage: File does not exist:" << localPath;
         setStatus(Error);
         return;
     }
 
-    QImageReader reader(localPath);
-    if (!reader.canRead()) {
-        qWarning() << "CircularImage: Cannot read image:" << localPath;
-        setStatus(Error);
+    CircularImageCache::Key key;
+    key.devicePixelRatio = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    key.size = qRound(targetSize() * key.devicePixelRatio);
+
+    // Decode the smallest pre-scaled thumbnail that covers the target size
+    const QFileInfo fileInfo(ThumbnailCache::instance()->resolve(localPath, key.size));
+    key.path = fileInfo.absoluteFilePath();
+    key.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    renderFromCache(key, QByteArray());
+}
+
+void CircularImage::loadRemoteImage()
+{
+    if (m_remoteVersion.isEmpty()) {
+        setStatus(Loading);
+        RemoteImageLoader::instance()->fetch(m_source, this);
         return;
     }
 
-    m_originalImage = reader.read();
-    if (m_originalImage.isNull()) {
-        qWarning() << "CircularImage: Failed to load image:" << reader.errorString();
-        setStatus(Error);
+    // Keyed by URL and version so a revalidated, changed image renders afresh
+    CircularImageCache::Key key;
+    key.devicePixelRatio = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    key.size = qRound(targetSize() * key.devicePixelRatio);
+    key.path = m_source.toString();
+    key.version = m_remoteVersion;
+
+    // Rendered before, at this size or by another item: no bytes needed
+    if (renderFromCache(key, m_remoteData)) {
         return;
     }
 
-    onImageLoaded();
+    if (m_remoteData.isEmpty()) {
+        // A new size after the bytes were dropped; the loader's disk cache
+        // answers without a download unless the entry went stale
+        RemoteImageLoader::instance()->fetch(m_source, this);
+        return;
+    }
+
+    // The render job holds its own reference to the bytes
+    m_remoteData.clear();
 }
 
-void CircularImage::onImageLoaded()
+bool CircularImage::renderFromCache(CircularImageCache::Key key, const QByteArray &encoded)
 {
-    if (m_originalImage.isNull()) {
-        setStatus(Error);
-        return;
+    key.borderWidth = m_borderWidth;
+    key.borderColor = m_borderColor.rgba();
+    key.smooth = m_smooth;
+    key.antialiasing = m_antialiasing;
+
+    m_cacheKey = key.toString();
+
+    // Shared cache: identical avatars decode and clip the file only once
+    CircularImageCache *cache = CircularImageCache::instance();
+    const QImage cached = cache->find(key);
+    if (!cached.isNull()) {
+        m_circularImage = cached;
+        setStatus(Ready);
+        update();
+        return true;
     }
 
-    // Get the target size based on the item's size
-    int targetSize = qMin(static_cast<int>(width()), static_cast<int>(height()));
-    if (targetSize <= 0) {
-        targetSize = 100; // Default size
+    setStatus(Loading);
+    if (!encoded.isEmpty() || !RemoteImageLoader::isRemote(m_source))
+        cache->request(key, this, encoded);
+    return false;
+}
+
+void CircularImage::onImageLoaded(const QString &key, const QImage &image)
+{
+    if (key != m_cacheKey)
+        return;
+
+    if (image.isNull()) {
+        setStatus(Error);
+        return;
     }
 
-    // Create circular image
-    m_circularImage = createCircularImage(m_originalImage, targetSize);
-    
+    m_circularImage = image;
     setStatus(Ready);
     update();
 }
 
-QImage CircularImage::createCircularImage(const QImage &sourceImage, int size)
+int CircularImage::targetSize() const
 {
-    if (sourceImage.isNull() || size <= 0)
-        return QImage();
-
-    // Create output image with alpha channel
-    QImage circularImage(size, size, QImage::Format_ARGB32_Premultiplied);
-    circularImage.fill(Qt::transparent);
-
-    QPainter painter(&circularImage);
-    
-    // Enable high quality rendering
-    if (m_antialiasing) {
-        painter.setRenderHint(QPainter::Antialiasing, true);
-        painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
-    }
-    
-    if (m_smooth) {
-        painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    // Get the target size based on the item's size
+    int size = qMin(static_cast<int>(width()), static_cast<int>(height()));
+    if (size <= 0) {
+        size = 100; // Default size
     }
+    return size;
+}
 
-    // Create circular clipping path
-    QPainterPath clipPath;
-    qreal radius = size / 2.0;
-    clipPath.addEllipse(0, 0, size, size);
-    
-    // Apply circular clipping
-    painter.setClipPath(clipPath);
-    
-    // Scale source image to fit the circle while maintaining aspect ratio
-    QImage scaledImage = sourceImage.scaled(size, size, Qt::KeepAspectRatioByExpanding, 
-                                          m_smooth ? Qt::SmoothTransformation : Qt::FastTransformation);
-    
-    // Center the scaled image
-    int offsetX = (scaledImage.width() - size) / 2;
-    int offsetY = (scaledImage.height() - size) / 2;
-    
-    // Draw the image
-    painter.drawImage(-offsetX, -offsetY, scaledImage);
-    
-    // Reset clipping for border
-    painter.setClipping(false);
-    
-    // Draw border if specified
-    if (m_borderWidth > 0 && m_borderColor.alpha() > 0) {
-        QPen borderPen(m_borderColor);
-        borderPen.setWidthF(m_borderWidth);
-        borderPen.setStyle(Qt::SolidLine);
-        painter.setPen(borderPen);
-        painter.setBrush(Qt::NoBrush);
-        
-        qreal borderRadius = radius - (m_borderWidth / 2.0);
-        painter.drawEllipse(QRectF(m_borderWidth / 2.0, m_borderWidth / 2.0, 
-                                  size - m_borderWidth, size - m_borderWidth));
-    }
+void CircularImage::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickPaintedItem::geometryChange(newGeometry, oldGeometry);
 
-    return circularImage;
+    if (!m_source.isEmpty() && newGeometry.size() != oldGeometry.size())
+        loadImage();
 }
 
 void CircularImage::paint(QPainter *painter)
@@ -238,7 +272,7 @@ QString CircularImage::urlToLocalPath(const QUrl &url)
         return path;
     }
     
-    // For other schemes, return empty (not supported for now)
+    // Remote schemes are routed through RemoteImageLoader in loadImage()
     return QString();
 }
 
@@ -251,12 +285,19 @@ void CircularImage::setStatus(Status status)
     emit statusChanged();
 }
 
-void CircularImage::onNetworkReplyFinished()
+void CircularImage::onNetworkReplyFinished(const QUrl &url, const QByteArray &data, const QString &version,
+                                           const QString &errorString)
 {
-    // This can be used for remote image loading in the future
-    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply)
+    if (url != m_source)
         return;
-        
-    reply->deleteLater();
+
+    if (data.isEmpty()) {
+        qWarning() << "CircularImage: Failed to download image:" << url << errorString;
+        setStatus(Error);
+        return;
+    }
+
+    m_remoteVersion = version;
+    m_remoteData = data;
+    loadImage();
 }
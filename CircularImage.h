@@ -4,10 +4,10 @@
 #include <QQuickPaintedItem>
 #include <QUrl>
 #include <QImage>
+#include <QByteArray>
 #include <QPainter>
 #include <QQuickItemGrabResult>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include "CircularImageCache.h"
 
 class CircularImage : public QQuickPaintedItem
 {
@@ -29,6 +29,7 @@ public:
     Q_ENUM(Status)
 
     explicit CircularImage(QQuickItem *parent = nullptr);
+    ~CircularImage() override;
 
     // Property getters
     QUrl source() const { return m_source; }
@@ -48,6 +49,9 @@ public:
     // QQuickPaintedItem interface
     void paint(QPainter *painter) override;
 
+protected:
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+
 signals:
     void sourceChanged();
     void smoothChanged();
@@ -57,24 +61,30 @@ signals:
     void statusChanged();
 
 private slots:
-    void onImageLoaded();
-    void onNetworkReplyFinished();
+    void onImageLoaded(const QString &key, const QImage &image);
+    void onNetworkReplyFinished(const QUrl &url, const QByteArray &data, const QString &version,
+                                const QString &errorString);
 
 private:
     void loadImage();
+    void loadRemoteImage();
+    // True on a cache hit; otherwise requests a render, for a remote source
+    // only when its bytes are at hand
+    bool renderFromCache(CircularImageCache::Key key, const QByteArray &encoded);
     void setStatus(Status status);
-    QImage createCircularImage(const QImage &sourceImage, int size);
+    int targetSize() const;
     QString urlToLocalPath(const QUrl &url);
 
     QUrl m_source;
-    QImage m_originalImage;
+    QString m_cacheKey;
+    QString m_remoteVersion;    // content version of an http(s) source, once fetched
+    QByteArray m_remoteData;    // its encoded bytes, held only until handed to the cache
     QImage m_circularImage;
     bool m_smooth;
     bool m_antialiasing;
     qreal m_borderWidth;
     QColor m_borderColor;
     Status m_status;
-    QNetworkAccessManager *m_networkManager;
 };
 
 #endif // CIRCULARIMAGE_H
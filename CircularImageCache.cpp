@@ -0,0 +1,232 @@
+#include "CircularImageCache.h"
+#include <QBuffer>
+#include <QImageReader>
+#include <QPainter>
+#include <QPainterPath>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QDebug>
+
+namespace {
+constexpr qint64 kDefaultMaxBytes = 32 * 1024 * 1024;
+
+// Center-crops to a square and decodes straight to at most `edge` pixels, so
+// large sources are never decoded at full size
+QImage readSquare(QImageReader &reader, int edge)
+{
+    reader.setAutoTransform(true);
+    const QSize size = reader.size();
+    if (size.isValid()) {
+        const int side = qMin(size.width(), size.height());
+        reader.setClipRect(QRect((size.width() - side) / 2, (size.height() - side) / 2, side, side));
+        const int scaled = qMin(side, edge);
+        reader.setScaledSize(QSize(scaled, scaled));
+    }
+
+    const QImage image = reader.read();
+    return image.isNull() ? image : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+// Decodes and clips one image off the GUI thread, then hands the result back
+// to the cache through a queued call.
+class RenderJob : public QRunnable
+{
+public:
+    RenderJob(CircularImageCache *cache, const CircularImageCache::Key &key, const QByteArray &encoded)
+        : m_cache(cache)
+        , m_key(key)
+        , m_encoded(encoded)
+    {
+    }
+
+    void run() override
+    {
+        QImage result;
+        QBuffer buffer(&m_encoded);
+        QImageReader reader;
+        if (m_encoded.isEmpty()) {
+            reader.setFileName(m_key.path);
+        } else {
+            reader.setDevice(&buffer);
+        }
+
+        if (m_key.shape == CircularImageCache::Shape::Square) {
+            result = readSquare(reader, m_key.size);
+        } else {
+            const QImage source = reader.read();
+            if (!source.isNull()) {
+                result = CircularImageCache::renderCircularImage(source, m_key.size,
+                                                                 m_key.borderWidth * m_key.devicePixelRatio,
+                                                                 QColor::fromRgba(m_key.borderColor),
+                                                                 m_key.smooth, m_key.antialiasing);
+                result.setDevicePixelRatio(m_key.devicePixelRatio);
+            }
+        }
+
+        if (result.isNull()) {
+            qWarning() << "CircularImageCache: Failed to load image:" << m_key.path << reader.errorString();
+        }
+
+        QMetaObject::invokeMethod(m_cache, "finishRequest", Qt::QueuedConnection,
+                                  Q_ARG(QString, m_key.toString()),
+                                  Q_ARG(QImage, result));
+    }
+
+private:
+    CircularImageCache *m_cache;
+    CircularImageCache::Key m_key;
+    QByteArray m_encoded;
+};
+}
+
+QString CircularImageCache::Key::toString() const
+{
+    return path + QLatin1Char('|') + QString::number(modified) + QLatin1Char('|') + version
+         + QLatin1Char('|') + QString::number(size)
+         + QLatin1Char('|') + QString::number(borderWidth)
+         + QLatin1Char('|') + QString::number(borderColor, 16)
+         + QLatin1Char('|') + QString::number(devicePixelRatio)
+         + QLatin1Char('|') + QLatin1Char(smooth ? 's' : '-') + QLatin1Char(antialiasing ? 'a' : '-')
+         + QLatin1Char(shape == Shape::Square ? 'q' : 'c');
+}
+
+CircularImageCache::CircularImageCache(QObject *parent)
+    : QObject(parent)
+    , m_hits(0)
+    , m_misses(0)
+{
+    m_cache.setMaxCost(kDefaultMaxBytes);
+}
+
+CircularImageCache *CircularImageCache::instance()
+{
+    static CircularImageCache cache;
+    return &cache;
+}
+
+QImage CircularImageCache::find(const Key &key)
+{
+    // QCache::object() also promotes the entry to most recently used
+    if (const QImage *image = m_cache.object(key.toString())) {
+        ++m_hits;
+        return *image;
+    }
+
+    ++m_misses;
+    return QImage();
+}
+
+void CircularImageCache::request(const Key &key, QObject *requester, const QByteArray &encoded)
+{
+    const QString cacheKey = key.toString();
+    auto waiting = m_waiters.find(cacheKey);
+    if (waiting != m_waiters.end()) {
+        if (!waiting->contains(requester)) {
+            waiting->append(requester);
+        }
+        return;
+    }
+
+    m_waiters.insert(cacheKey, { requester });
+    QThreadPool::globalInstance()->start(new RenderJob(this, key, encoded));
+}
+
+void CircularImageCache::finishRequest(const QString &key, const QImage &image)
+{
+    // Taken first: a requester may ask for the same key again while notified
+    const QList<QPointer<QObject>> waiters = m_waiters.take(key);
+
+    if (!image.isNull()) {
+        m_cache.insert(key, new QImage(image), qMax<qsizetype>(1, image.sizeInBytes()));
+    }
+
+    // Only the items that asked for this key; deleted ones are null
+    for (const QPointer<QObject> &waiter : waiters) {
+        if (waiter) {
+            QMetaObject::invokeMethod(waiter, "onImageLoaded", Qt::DirectConnection,
+                                      Q_ARG(QString, key),
+                                      Q_ARG(QImage, image));
+        }
+    }
+}
+
+void CircularImageCache::setMaxBytes(qint64 bytes)
+{
+    m_cache.setMaxCost(qMax<qint64>(0, bytes));
+}
+
+qint64 CircularImageCache::maxBytes() const
+{
+    return m_cache.maxCost();
+}
+
+qint64 CircularImageCache::totalBytes() const
+{
+    return m_cache.totalCost();
+}
+
+void CircularImageCache::clear()
+{
+    m_cache.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+QImage CircularImageCache::renderCircularImage(const QImage &sourceImage, int size,
+                                               qreal borderWidth, const QColor &borderColor,
+                                               bool smooth, bool antialiasing)
+{
+    if (sourceImage.isNull() || size <= 0)
+        return QImage();
+
+    // Create output image with alpha channel
+    QImage circularImage(size, size, QImage::Format_ARGB32_Premultiplied);
+    circularImage.fill(Qt::transparent);
+
+    QPainter painter(&circularImage);
+
+    // Enable high quality rendering
+    if (antialiasing) {
+        painter.setRenderHint(QPainter::Antialiasing, true);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    }
+
+    if (smooth) {
+        painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    }
+
+    // Create circular clipping path
+    QPainterPath clipPath;
+    clipPath.addEllipse(0, 0, size, size);
+
+    // Apply circular clipping
+    painter.setClipPath(clipPath);
+
+    // Scale source image to fit the circle while maintaining aspect ratio
+    QImage scaledImage = sourceImage.scaled(size, size, Qt::KeepAspectRatioByExpanding,
+                                            smooth ? Qt::SmoothTransformation : Qt::FastTransformation);
+
+    // Center the scaled image
+    int offsetX = (scaledImage.width() - size) / 2;
+    int offsetY = (scaledImage.height() - size) / 2;
+
+    // Draw the image
+    painter.drawImage(-offsetX, -offsetY, scaledImage);
+
+    // Reset clipping for border
+    painter.setClipping(false);
+
+    // Draw border if specified
+    if (borderWidth > 0 && borderColor.alpha() > 0) {
+        QPen borderPen(borderColor);
+        borderPen.setWidthF(borderWidth);
+        borderPen.setStyle(Qt::SolidLine);
+        painter.setPen(borderPen);
+        painter.setBrush(Qt::NoBrush);
+
+        painter.drawEllipse(QRectF(borderWidth / 2.0, borderWidth / 2.0,
+                                   size - borderWidth, size - borderWidth));
+    }
+
+    return circularImage;
+}
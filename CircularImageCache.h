@@ -0,0 +1,82 @@
+#ifndef CIRCULARIMAGECACHE_H
+#define CIRCULARIMAGECACHE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QCache>
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QPointer>
+#include <QString>
+
+// Process-wide cache of rendered circular images shared by every CircularImage
+// and CircularImageItem instance. Entries are keyed by everything that affects
+// the rendered pixels, so ten avatars showing the same file at the same size
+// decode and clip once.
+class CircularImageCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Shape {
+        Circle,   // clipped to a circle with the border drawn in (CircularImage)
+        Square    // center-cropped square, at most `size` pixels (CircularImageItem)
+    };
+
+    struct Key {
+        QString path;             // file path, or the URL of a remote source
+        qint64 modified = 0;      // file mtime in ms since epoch
+        QString version;          // remote content version (see RemoteImageLoader)
+        int size = 0;             // target edge length in device pixels
+        qreal borderWidth = 0;
+        QRgb borderColor = 0;
+        qreal devicePixelRatio = 1.0;
+        bool smooth = true;
+        bool antialiasing = true;
+        Shape shape = Shape::Circle;
+
+        QString toString() const;
+    };
+
+    static CircularImageCache *instance();
+
+    // Returns the cached image or a null QImage. Counts a hit or a miss.
+    QImage find(const Key &key);
+
+    // Schedules a background render for the key. Concurrent requests for the
+    // same key are coalesced into a single job. When it ends, only the
+    // requesters of that key still alive are called, through their
+    // onImageLoaded(QString key, QImage image) slot; a null image means the
+    // render failed. When `encoded` is given it is decoded instead of
+    // reading key.path.
+    void request(const Key &key, QObject *requester, const QByteArray &encoded = QByteArray());
+
+    // Memory budget in bytes (default 32 MiB). Least recently used entries
+    // are evicted once the budget is exceeded.
+    void setMaxBytes(qint64 bytes);
+    qint64 maxBytes() const;
+    qint64 totalBytes() const;
+
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+    void clear();
+
+    static QImage renderCircularImage(const QImage &sourceImage, int size,
+                                      qreal borderWidth, const QColor &borderColor,
+                                      bool smooth, bool antialiasing);
+
+private slots:
+    void finishRequest(const QString &key, const QImage &image);
+
+private:
+    explicit CircularImageCache(QObject *parent = nullptr);
+
+    QCache<QString, QImage> m_cache;
+    QHash<QString, QList<QPointer<QObject>>> m_waiters;   // key -> requesters of its running job
+    quint64 m_hits;
+    quint64 m_misses;
+};
+
+#endif // CIRCULARIMAGECACHE_H
@@ -0,0 +1,542 @@
+#include "CircularImageItem.h"
+#include "CircularImageCache.h"
+#include "ThumbnailCache.h"
+#include <QQuickWindow>
+#include <QSGGeometryNode>
+#include <QSGMaterial>
+#include <QSGMaterialShader>
+#include <QSGRenderNode>
+#include <QSGRendererInterface>
+#include <QSGTexture>
+#include <QSGVertexColorMaterial>
+#include <QPainter>
+#include <QFileInfo>
+#include <QDebug>
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr qreal kPi = 3.14159265358979323846;
+
+// ============================================================================
+// Hardware path: textured disc with a feathered rim
+// ============================================================================
+
+struct TexturedVertex {
+    float x;
+    float y;
+    float tx;
+    float ty;
+    float alpha;  // 1 inside the disc, fading to 0 across the outer pixel
+};
+
+const QSGGeometry::AttributeSet &texturedVertexAttributes()
+{
+    static const QSGGeometry::Attribute attributes[] = {
+        QSGGeometry::Attribute::createWithAttributeType(0, 2, QSGGeometry::FloatType, QSGGeometry::PositionAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(1, 2, QSGGeometry::FloatType, QSGGeometry::TexCoordAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(2, 1, QSGGeometry::FloatType, QSGGeometry::UnknownAttribute)
+    };
+    static const QSGGeometry::AttributeSet set = { 3, sizeof(TexturedVertex), attributes };
+    return set;
+}
+
+class CircularTextureMaterial : public QSGMaterial
+{
+public:
+    CircularTextureMaterial()
+    {
+        setFlag(Blending, true);
+    }
+
+    QSGMaterialType *type() const override
+    {
+        static QSGMaterialType type;
+        return &type;
+    }
+
+    QSGMaterialShader *createShader(QSGRendererInterface::RenderMode) const override;
+
+    int compare(const QSGMaterial *other) const override
+    {
+        const auto *o = static_cast<const CircularTextureMaterial *>(other);
+        const qint64 a = texture ? texture->comparisonKey() : 0;
+        const qint64 b = o->texture ? o->texture->comparisonKey() : 0;
+        return a == b ? 0 : (a < b ? -1 : 1);
+    }
+
+    QSGTexture *texture = nullptr;  // owned by CircleNode
+};
+
+class CircularTextureShader : public QSGMaterialShader
+{
+public:
+    CircularTextureShader()
+    {
+        setShaderFileName(VertexStage, QStringLiteral(":/shaders/circularimage.vert.qsb"));
+        setShaderFileName(FragmentStage, QStringLiteral(":/shaders/circularimage.frag.qsb"));
+    }
+
+    bool updateUniformData(RenderState &state, QSGMaterial *, QSGMaterial *) override
+    {
+        QByteArray *buffer = state.uniformData();
+        bool changed = false;
+
+        if (state.isMatrixDirty()) {
+            const QMatrix4x4 matrix = state.combinedMatrix();
+            std::memcpy(buffer->data(), matrix.constData(), 64);
+            changed = true;
+        }
+
+        if (state.isOpacityDirty()) {
+            const float opacity = state.opacity();
+            std::memcpy(buffer->data() + 64, &opacity, 4);
+            changed = true;
+        }
+
+        return changed;
+    }
+
+    void updateSampledImage(RenderState &state, int binding, QSGTexture **texture,
+                            QSGMaterial *newMaterial, QSGMaterial *) override
+    {
+        if (binding != 1)
+            return;
+
+        auto *material = static_cast<CircularTextureMaterial *>(newMaterial);
+        if (material->texture)
+            material->texture->commitTextureOperations(state.rhi(), state.resourceUpdateBatch());
+        *texture = material->texture;
+    }
+};
+
+QSGMaterialShader *CircularTextureMaterial::createShader(QSGRendererInterface::RenderMode) const
+{
+    return new CircularTextureShader;
+}
+
+int segmentCount(qreal radius)
+{
+    // Keep chords around 4px long so the silhouette stays round at any size
+    return qBound(24, static_cast<int>(std::ceil(2.0 * kPi * radius / 4.0)), 256);
+}
+
+// Fills a disc: a triangle fan for the interior plus a one pixel rim whose
+// vertex alpha drops to zero at the edge, which antialiases the silhouette.
+void tessellateDisc(QSGGeometry *geometry, const QPointF &center, qreal radius, const QRectF &texRect)
+{
+    const int n = segmentCount(radius);
+    geometry->allocate(1 + 2 * n, 9 * n);
+
+    auto *v = static_cast<TexturedVertex *>(geometry->vertexData());
+    quint16 *index = geometry->indexDataAsUShort();
+
+    const qreal inner = qMax<qreal>(0.0, radius - 1.0);
+    auto texX = [&](qreal dx) { return float(texRect.x() + (0.5 + dx / (2.0 * radius)) * texRect.width()); };
+    auto texY = [&](qreal dy) { return float(texRect.y() + (0.5 + dy / (2.0 * radius)) * texRect.height()); };
+
+    v[0] = { float(center.x()), float(center.y()), texX(0), texY(0), 1.0f };
+    for (int i = 0; i < n; ++i) {
+        const qreal angle = 2.0 * kPi * i / n;
+        const qreal c = std::cos(angle);
+        const qreal s = std::sin(angle);
+        v[1 + i] = { float(center.x() + c * inner), float(center.y() + s * inner),
+                     texX(c * inner), texY(s * inner), 1.0f };
+        v[1 + n + i] = { float(center.x() + c * radius), float(center.y() + s * radius),
+                         texX(c * radius), texY(s * radius), 0.0f };
+    }
+
+    for (int i = 0; i < n; ++i) {
+        const quint16 a = quint16(1 + i);
+        const quint16 b = quint16(1 + (i + 1) % n);
+        const quint16 outerA = quint16(a + n);
+        const quint16 outerB = quint16(b + n);
+
+        *index++ = 0;
+        *index++ = a;
+        *index++ = b;
+
+        *index++ = a;
+        *index++ = outerA;
+        *index++ = b;
+        *index++ = b;
+        *index++ = outerA;
+        *index++ = outerB;
+    }
+
+    geometry->markVertexDataDirty();
+    geometry->markIndexDataDirty();
+}
+
+// Fills an annulus for the border. The inner and outer pixel fade to
+// transparent so the ring is antialiased on both sides.
+void tessellateRing(QSGGeometry *geometry, const QPointF &center, qreal radius,
+                    qreal width, const QColor &color)
+{
+    const int n = segmentCount(radius);
+    const qreal feather = qMin<qreal>(1.0, width / 2.0);
+    const qreal radii[4] = { radius, radius - feather, radius - width + feather, radius - width };
+    const qreal alphas[4] = { 0.0, 1.0, 1.0, 0.0 };
+
+    geometry->allocate(4 * n, 3 * 6 * n);
+    QSGGeometry::ColoredPoint2D *v = geometry->vertexDataAsColoredPoint2D();
+    quint16 *index = geometry->indexDataAsUShort();
+
+    for (int ring = 0; ring < 4; ++ring) {
+        const qreal a = color.alphaF() * alphas[ring];
+        const auto r = uchar(qRound(color.redF() * a * 255));
+        const auto g = uchar(qRound(color.greenF() * a * 255));
+        const auto b = uchar(qRound(color.blueF() * a * 255));
+        const auto alpha = uchar(qRound(a * 255));
+        for (int i = 0; i < n; ++i) {
+            const qreal angle = 2.0 * kPi * i / n;
+            v[ring * n + i].set(float(center.x() + std::cos(angle) * radii[ring]),
+                                float(center.y() + std::sin(angle) * radii[ring]),
+                                r, g, b, alpha);
+        }
+    }
+
+    for (int band = 0; band < 3; ++band) {
+        for (int i = 0; i < n; ++i) {
+            const quint16 a = quint16(band * n + i);
+            const quint16 b = quint16(band * n + (i + 1) % n);
+            const quint16 c = quint16(a + n);
+            const quint16 d = quint16(b + n);
+            *index++ = a;
+            *index++ = c;
+            *index++ = b;
+            *index++ = b;
+            *index++ = c;
+            *index++ = d;
+        }
+    }
+
+    geometry->markVertexDataDirty();
+    geometry->markIndexDataDirty();
+}
+
+class CircleNode : public QSGNode
+{
+public:
+    CircleNode()
+        : disc(new QSGGeometryNode)
+        , border(new QSGGeometryNode)
+    {
+        auto *discGeometry = new QSGGeometry(texturedVertexAttributes(), 0, 0);
+        discGeometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        disc->setGeometry(discGeometry);
+        disc->setFlag(QSGNode::OwnsGeometry);
+        disc->setMaterial(new CircularTextureMaterial);
+        disc->setFlag(QSGNode::OwnsMaterial);
+        appendChildNode(disc);
+
+        auto *borderGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0, 0);
+        borderGeometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        border->setGeometry(borderGeometry);
+        border->setFlag(QSGNode::OwnsGeometry);
+        border->setMaterial(new QSGVertexColorMaterial);
+        border->setFlag(QSGNode::OwnsMaterial);
+        appendChildNode(border);
+    }
+
+    ~CircleNode() override
+    {
+        delete texture;
+    }
+
+    void setTexture(QSGTexture *newTexture)
+    {
+        delete texture;
+        texture = newTexture;
+        static_cast<CircularTextureMaterial *>(disc->material())->texture = texture;
+        disc->markDirty(QSGNode::DirtyMaterial);
+    }
+
+    QSGGeometryNode *disc;
+    QSGGeometryNode *border;
+    QSGTexture *texture = nullptr;
+};
+
+// ============================================================================
+// Software path: paint directly with the backend's QPainter
+// ============================================================================
+
+class SoftwareCircleNode : public QSGRenderNode
+{
+public:
+    explicit SoftwareCircleNode(QQuickWindow *window)
+        : m_window(window)
+    {
+    }
+
+    void render(const RenderState *state) override
+    {
+        QSGRendererInterface *rif = m_window->rendererInterface();
+        auto *painter = static_cast<QPainter *>(
+            rif->getResource(m_window, QSGRendererInterface::PainterResource));
+        if (!painter || image.isNull())
+            return;
+
+        painter->setTransform(matrix()->toTransform());
+        painter->setOpacity(inheritedOpacity());
+        const QRegion *clipRegion = state->clipRegion();
+        if (clipRegion && !clipRegion->isEmpty())
+            painter->setClipRegion(*clipRegion, Qt::ReplaceClip);
+
+        painter->setRenderHint(QPainter::Antialiasing, true);
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+
+        // The image brush is mapped onto the circle's bounds, so a resize only
+        // changes the transform and never re-rasterizes the source
+        QBrush brush(image);
+        QTransform transform;
+        transform.translate(circle.x(), circle.y());
+        transform.scale(circle.width() / image.width(), circle.height() / image.height());
+        brush.setTransform(transform);
+
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(brush);
+        painter->drawEllipse(circle);
+
+        if (borderWidth > 0 && borderColor.alpha() > 0) {
+            QPen pen(borderColor);
+            pen.setWidthF(borderWidth);
+            painter->setPen(pen);
+            painter->setBrush(Qt::NoBrush);
+            const qreal inset = borderWidth / 2.0;
+            painter->drawEllipse(circle.adjusted(inset, inset, -inset, -inset));
+        }
+    }
+
+    StateFlags changedStates() const override { return {}; }
+    RenderingFlags flags() const override { return BoundedRectRendering; }
+    QRectF rect() const override { return circle; }
+
+    QRectF circle;
+    QImage image;
+    qreal borderWidth = 0;
+    QColor borderColor;
+
+private:
+    QQuickWindow *m_window;
+};
+
+constexpr int kMinTextureBucket = 32;
+constexpr int kMaxTextureBucket = 1024;
+}
+
+// ============================================================================
+// CircularImageItem
+// ============================================================================
+
+CircularImageItem::CircularImageItem(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_requestedBucket(0)
+    , m_imageBucket(0)
+    , m_imageDirty(false)
+    , m_borderWidth(0)
+    , m_borderColor(Qt::transparent)
+    , m_status(Null)
+{
+    setFlag(QQuickItem::ItemHasContents, true);
+}
+
+void CircularImageItem::setSource(const QUrl &source)
+{
+    if (m_source == source)
+        return;
+
+    m_source = source;
+    emit sourceChanged();
+
+    // The previous source's texture must not stand in for this one
+    m_cacheKey.clear();
+    m_image = QImage();
+    m_imageBucket = 0;
+    m_requestedBucket = 0;
+    m_imageDirty = true;
+    update();
+
+    if (source.isEmpty()) {
+        setStatus(Null);
+        return;
+    }
+
+    loadImage();
+}
+
+void CircularImageItem::setBorderWidth(qreal width)
+{
+    if (qFuzzyCompare(m_borderWidth, width))
+        return;
+
+    m_borderWidth = width;
+    emit borderWidthChanged();
+    update();
+}
+
+void CircularImageItem::setBorderColor(const QColor &color)
+{
+    if (m_borderColor == color)
+        return;
+
+    m_borderColor = color;
+    emit borderColorChanged();
+    update();
+}
+
+void CircularImageItem::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+
+    // Only decode again when the item outgrows the uploaded texture
+    if (!m_source.isEmpty() && textureBucket() > qMax(m_imageBucket, m_requestedBucket))
+        loadImage();
+
+    update();
+}
+
+int CircularImageItem::textureBucket() const
+{
+    const qreal dpr = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    const int needed = static_cast<int>(std::ceil(qMin(width(), height()) * dpr));
+
+    int bucket = kMinTextureBucket;
+    while (bucket < needed && bucket < kMaxTextureBucket)
+        bucket *= 2;
+    return bucket;
+}
+
+void CircularImageItem::loadImage()
+{
+    QString path = m_source.isLocalFile() ? m_source.toLocalFile() : QString();
+    if (m_source.scheme() == QLatin1String("qrc"))
+        path = QLatin1Char(':') + m_source.path();
+    else if (m_source.scheme().isEmpty())
+        path = m_source.toString();
+
+    if (path.isEmpty() || !QFileInfo::exists(path)) {
+        qWarning() << "CircularImageItem: Invalid source path:" << m_source;
+        m_cacheKey.clear();
+        setStatus(Error);
+        return;
+    }
+
+    // Decode the smallest pre-scaled thumbnail that covers the bucket;
+    // resources are never thumbnailed
+    const int bucket = textureBucket();
+    if (!path.startsWith(QLatin1Char(':')))
+        path = ThumbnailCache::instance()->resolve(path, bucket);
+
+    const QFileInfo fileInfo(path);
+    CircularImageCache::Key key;
+    key.path = fileInfo.absoluteFilePath();
+    key.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    key.size = bucket;
+    key.shape = CircularImageCache::Shape::Square;
+
+    m_cacheKey = key.toString();
+    m_requestedBucket = bucket;
+
+    CircularImageCache *cache = CircularImageCache::instance();
+    const QImage cached = cache->find(key);
+    if (!cached.isNull()) {
+        onImageLoaded(m_cacheKey, cached);
+        return;
+    }
+
+    // A smaller texture keeps showing until the larger one arrives
+    if (m_image.isNull())
+        setStatus(Loading);
+    cache->request(key, this);
+}
+
+void CircularImageItem::onImageLoaded(const QString &key, const QImage &image)
+{
+    if (key != m_cacheKey)
+        return;
+
+    if (image.isNull()) {
+        setStatus(Error);
+        return;
+    }
+
+    m_image = image;
+    m_imageBucket = m_requestedBucket;
+    m_imageDirty = true;
+    setStatus(Ready);
+    update();
+}
+
+QSGNode *CircularImageItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    const QRectF bounds = boundingRect();
+    const qreal diameter = qMin(bounds.width(), bounds.height());
+
+    if (m_image.isNull() || diameter <= 0) {
+        delete oldNode;
+        return nullptr;
+    }
+
+    const QRectF circle(bounds.center().x() - diameter / 2.0,
+                        bounds.center().y() - diameter / 2.0,
+                        diameter, diameter);
+
+    if (window()->rendererInterface()->graphicsApi() == QSGRendererInterface::Software) {
+        auto *node = static_cast<SoftwareCircleNode *>(oldNode);
+        if (!node) {
+            node = new SoftwareCircleNode(window());
+            m_imageDirty = true;
+        }
+
+        if (m_imageDirty) {
+            node->image = m_image;
+            m_imageDirty = false;
+        }
+        node->circle = circle;
+        node->borderWidth = m_borderWidth;
+        node->borderColor = m_borderColor;
+        node->markDirty(QSGNode::DirtyMaterial);
+        return node;
+    }
+
+    auto *node = static_cast<CircleNode *>(oldNode);
+    if (!node) {
+        node = new CircleNode;
+        m_imageDirty = true;
+    }
+
+    if (m_imageDirty) {
+        QSGTexture *texture = window()->createTextureFromImage(m_image, QQuickWindow::TextureHasAlphaChannel);
+        texture->setFiltering(QSGTexture::Linear);
+        node->setTexture(texture);
+        m_imageDirty = false;
+    }
+
+    const bool hasBorder = m_borderWidth > 0 && m_borderColor.alpha() > 0;
+    const qreal radius = diameter / 2.0;
+
+    // Tuck the image half a pixel under the border so no seam shows through
+    const qreal discRadius = hasBorder ? qMax<qreal>(1.0, radius - m_borderWidth + 0.5) : radius;
+    tessellateDisc(node->disc->geometry(), circle.center(), discRadius, node->texture->normalizedTextureSubRect());
+    node->disc->markDirty(QSGNode::DirtyGeometry);
+
+    if (hasBorder) {
+        tessellateRing(node->border->geometry(), circle.center(), radius,
+                       qMin(m_borderWidth, radius), m_borderColor);
+    } else {
+        node->border->geometry()->allocate(0, 0);
+    }
+    node->border->markDirty(QSGNode::DirtyGeometry);
+
+    return node;
+}
+
+void CircularImageItem::setStatus(Status status)
+{
+    if (m_status == status)
+        return;
+
+    m_status = status;
+    emit statusChanged();
+}
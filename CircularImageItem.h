@@ -0,0 +1,75 @@
+#ifndef CIRCULARIMAGEITEM_H
+#define CIRCULARIMAGEITEM_H
+
+#include <QQuickItem>
+#include <QUrl>
+#include <QImage>
+#include <QColor>
+
+// Scene-graph native variant of CircularImage. The image is uploaded once as a
+// texture and drawn on tessellated circle geometry; the border is geometry too.
+// Resizing or restyling only rebuilds vertices, nothing is re-rasterized.
+// Sources are decoded off the GUI thread through CircularImageCache, as square
+// crops at power-of-two texture sizes, so avatars of one file share a decode.
+// With the software backend (QT_QUICK_BACKEND=software) the item falls back to
+// a render node that paints straight into the window's backing store.
+class CircularImageItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(qreal borderWidth READ borderWidth WRITE setBorderWidth NOTIFY borderWidthChanged)
+    Q_PROPERTY(QColor borderColor READ borderColor WRITE setBorderColor NOTIFY borderColorChanged)
+    Q_PROPERTY(Status status READ status NOTIFY statusChanged)
+
+public:
+    enum Status {
+        Null = 0,
+        Ready,
+        Loading,
+        Error
+    };
+    Q_ENUM(Status)
+
+    explicit CircularImageItem(QQuickItem *parent = nullptr);
+
+    // Property getters
+    QUrl source() const { return m_source; }
+    qreal borderWidth() const { return m_borderWidth; }
+    QColor borderColor() const { return m_borderColor; }
+    Status status() const { return m_status; }
+
+    // Property setters
+    void setSource(const QUrl &source);
+    void setBorderWidth(qreal width);
+    void setBorderColor(const QColor &color);
+
+signals:
+    void sourceChanged();
+    void borderWidthChanged();
+    void borderColorChanged();
+    void statusChanged();
+
+private slots:
+    void onImageLoaded(const QString &key, const QImage &image);
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+
+private:
+    void loadImage();
+    void setStatus(Status status);
+    int textureBucket() const;
+
+    QUrl m_source;
+    QString m_cacheKey;         // request the item waits for
+    int m_requestedBucket;
+    QImage m_image;             // center-cropped square, uploaded on next sync
+    int m_imageBucket;
+    bool m_imageDirty;
+    qreal m_borderWidth;
+    QColor m_borderColor;
+    Status m_status;
+};
+
+#endif // CIRCULARIMAGEITEM_H
@@ -0,0 +1,236 @@
+#include "Circulation.h"
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QTimeZone>
+#include <QVariantMap>
+
+namespace {
+constexpr const char *kSqlTimeFormat = "yyyy-MM-dd HH:mm:ss";
+
+// The availability guard lives in the WHERE clause: the row only changes
+// while a copy is on the shelf, however many connections race for it
+constexpr const char *kTakeCopySql =
+    "UPDATE books SET available = available - 1"
+    " WHERE id = ? AND user_id = ? AND available > 0 RETURNING available";
+constexpr const char *kReturnCopySql =
+    "UPDATE books SET available = available + 1 WHERE id = ? AND user_id = ? RETURNING available";
+constexpr const char *kInsertLoanSql =
+    "INSERT INTO loans (user_id, book_id, borrower, due_at) VALUES (?, ?, ?, ?)";
+constexpr const char *kCloseLoanSql =
+    "UPDATE loans SET returned_at = CURRENT_TIMESTAMP"
+    " WHERE id = ? AND user_id = ? AND returned_at IS NULL RETURNING book_id";
+constexpr const char *kRenewLoanSql =
+    "UPDATE loans SET due_at = ?, renewals = renewals + 1"
+    " WHERE id = ? AND user_id = ? AND returned_at IS NULL AND renewals < ? RETURNING book_id";
+// One statement per partial index; an "either" filter would use neither
+constexpr const char *kSelectOpenLoansSql =
+    "SELECT id, book_id, borrower, checked_out_at, due_at, renewals FROM loans"
+    " WHERE user_id = ? AND returned_at IS NULL ORDER BY due_at";
+constexpr const char *kSelectOpenBookLoansSql =
+    "SELECT id, book_id, borrower, checked_out_at, due_at, renewals FROM loans"
+    " WHERE user_id = ? AND book_id = ? AND returned_at IS NULL ORDER BY id";
+}
+
+const QStringList &Circulation::hotStatements()
+{
+    static const QStringList statements = {
+        kTakeCopySql,
+        kReturnCopySql,
+        kCloseLoanSql,
+        kRenewLoanSql,
+        kSelectOpenLoansSql,
+        kSelectOpenBookLoansSql,
+    };
+    return statements;
+}
+
+// ============================================================================
+// Schema
+// ============================================================================
+
+bool Circulation::migrate(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+
+    bool hasAvailable = false;
+    if (query.exec("PRAGMA table_info(books)")) {
+        while (query.next()) {
+            if (query.value("name").toString() == QLatin1String("available")) {
+                hasAvailable = true;
+            }
+        }
+    }
+
+    const QStringList statements = {
+        hasAvailable ? QString()
+                     : QStringLiteral("ALTER TABLE books ADD COLUMN available INTEGER NOT NULL DEFAULT 0"),
+        // No loans exist yet, so every copy is on the shelf
+        hasAvailable ? QString() : QStringLiteral("UPDATE books SET available = COALESCE(copies, 0)"),
+        R"(CREATE TABLE IF NOT EXISTS loans (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            user_id INTEGER NOT NULL,
+            book_id INTEGER NOT NULL,
+            borrower TEXT NOT NULL,
+            checked_out_at DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
+            due_at DATETIME NOT NULL,
+            returned_at DATETIME,
+            renewals INTEGER NOT NULL DEFAULT 0,
+            FOREIGN KEY (book_id) REFERENCES books (id)
+        ))",
+        "CREATE INDEX IF NOT EXISTS idx_loans_open_book ON loans (user_id, book_id) WHERE returned_at IS NULL",
+        "CREATE INDEX IF NOT EXISTS idx_loans_open_due ON loans (user_id, due_at) WHERE returned_at IS NULL",
+    };
+
+    for (const QString &statement : statements) {
+        if (statement.isEmpty()) {
+            continue;
+        }
+        if (!query.exec(statement)) {
+            qWarning() << "Circulation: Migration failed:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Loans
+// ============================================================================
+
+Circulation::Result Circulation::checkout(QSqlDatabase &db, int userId, int bookId, const QString &borrower,
+                                          const QDateTime &dueAt)
+{
+    Result result;
+    QSqlQuery query(db);
+
+    query.prepare(kTakeCopySql);
+    query.addBindValue(bookId);
+    query.addBindValue(userId);
+    if (!query.exec()) {
+        qWarning() << "Circulation: Failed to take a copy:" << query.lastError().text();
+        return result;
+    }
+    if (!query.next()) {
+        return result;   // unknown book or none on the shelf
+    }
+    const int available = query.value(0).toInt();
+    query.finish();
+
+    query.prepare(kInsertLoanSql);
+    query.addBindValue(userId);
+    query.addBindValue(bookId);
+    query.addBindValue(borrower);
+    query.addBindValue(toSqlTime(dueAt));
+    if (!query.exec()) {
+        qWarning() << "Circulation: Failed to record loan:" << query.lastError().text();
+        return result;
+    }
+
+    result.loanId = query.lastInsertId().toInt();
+    result.bookId = bookId;
+    result.available = available;
+    result.dueAt = dueAt.toUTC();
+    return result;
+}
+
+Circulation::Result Circulation::checkin(QSqlDatabase &db, int userId, int loanId)
+{
+    Result result;
+    QSqlQuery query(db);
+
+    query.prepare(kCloseLoanSql);
+    query.addBindValue(loanId);
+    query.addBindValue(userId);
+    if (!query.exec()) {
+        qWarning() << "Circulation: Failed to close loan:" << query.lastError().text();
+        return result;
+    }
+    if (!query.next()) {
+        return result;   // unknown or already returned
+    }
+    const int bookId = query.value(0).toInt();
+    query.finish();
+
+    query.prepare(kReturnCopySql);
+    query.addBindValue(bookId);
+    query.addBindValue(userId);
+    if (!query.exec()) {
+        qWarning() << "Circulation: Failed to return copy:" << query.lastError().text();
+        return result;
+    }
+
+    result.loanId = loanId;
+    result.bookId = bookId;
+    // The book may have been deleted while on loan; the loan still closes
+    result.available = query.next() ? query.value(0).toInt() : -1;
+    return result;
+}
+
+Circulation::Result Circulation::renew(QSqlDatabase &db, int userId, int loanId, const QDateTime &dueAt)
+{
+    Result result;
+    QSqlQuery query(db);
+
+    query.prepare(kRenewLoanSql);
+    query.addBindValue(toSqlTime(dueAt));
+    query.addBindValue(loanId);
+    query.addBindValue(userId);
+    query.addBindValue(kMaxRenewals);
+    if (!query.exec()) {
+        qWarning() << "Circulation: Failed to renew loan:" << query.lastError().text();
+        return result;
+    }
+    if (!query.next()) {
+        return result;
+    }
+
+    result.loanId = loanId;
+    result.bookId = query.value(0).toInt();
+    result.dueAt = dueAt.toUTC();
+    return result;
+}
+
+QVariantList Circulation::openLoans(const QSqlDatabase &db, int userId, int bookId)
+{
+    QVariantList loans;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (bookId > 0) {
+        query.prepare(kSelectOpenBookLoansSql);
+        query.addBindValue(userId);
+        query.addBindValue(bookId);
+    } else {
+        query.prepare(kSelectOpenLoansSql);
+        query.addBindValue(userId);
+    }
+    if (!query.exec()) {
+        qWarning() << "Circulation: Failed to list loans:" << query.lastError().text();
+        return loans;
+    }
+
+    while (query.next()) {
+        QVariantMap loan;
+        loan.insert("id", query.value(0).toInt());
+        loan.insert("bookId", query.value(1).toInt());
+        loan.insert("borrower", query.value(2).toString());
+        loan.insert("checkedOutAt", fromSqlTime(query.value(3).toString()));
+        loan.insert("dueAt", fromSqlTime(query.value(4).toString()));
+        loan.insert("renewals", query.value(5).toInt());
+        loans.append(loan);
+    }
+    return loans;
+}
+
+QString Circulation::toSqlTime(const QDateTime &time)
+{
+    return time.toUTC().toString(QLatin1String(kSqlTimeFormat));
+}
+
+QDateTime Circulation::fromSqlTime(const QString &text)
+{
+    QDateTime time = QDateTime::fromString(text, QLatin1String(kSqlTimeFormat));
+    time.setTimeZone(QTimeZone::UTC);
+    return time;
+}
@@ -0,0 +1,59 @@
+#ifndef CIRCULATION_H
+#define CIRCULATION_H
+
+#include <QDateTime>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+
+// Loan circulation over the loans table.
+// - books.available is the materialized count of copies on the shelf
+//   (copies minus open loans). checkout() and checkin() change it with a
+//   single conditional UPDATE each, so concurrent desks, even on separate
+//   connections, can never lend the last copy twice.
+// - A loan is open while returned_at is NULL. checkin() and renew() only
+//   match open loans, so a repeated return cannot put a copy back twice.
+// - Times are UTC "yyyy-MM-dd HH:mm:ss", like CURRENT_TIMESTAMP.
+class Circulation
+{
+public:
+    static constexpr int kMaxRenewals = 2;
+
+    struct Result {
+        int loanId = -1;
+        int bookId = -1;
+        int available = -1;   // copies on the shelf afterwards; -1 if untouched
+        QDateTime dueAt;
+
+        bool isValid() const { return loanId > 0; }
+    };
+
+    // Adds books.available (seeded from copies) and the loans table.
+    // Runs inside the migration transaction.
+    static bool migrate(QSqlDatabase &db);
+
+    // Invalid result when the book is unknown or has no copy left.
+    // The caller owns the transaction.
+    static Result checkout(QSqlDatabase &db, int userId, int bookId, const QString &borrower,
+                           const QDateTime &dueAt);
+
+    // Invalid result when the loan is unknown or already returned
+    static Result checkin(QSqlDatabase &db, int userId, int loanId);
+
+    // Invalid result when the loan is closed or out of renewals
+    static Result renew(QSqlDatabase &db, int userId, int loanId, const QDateTime &dueAt);
+
+    // Open loans: [{ id, bookId, borrower, checkedOutAt, dueAt, renewals }].
+    // One book's loans come oldest first; bookId 0 lists every book's,
+    // soonest due first.
+    static QVariantList openLoans(const QSqlDatabase &db, int userId, int bookId);
+
+    // Statements for Database::verifyQueryPlans()
+    static const QStringList &hotStatements();
+
+    static QString toSqlTime(const QDateTime &time);
+    static QDateTime fromSqlTime(const QString &text);
+};
+
+#endif // CIRCULATION_H
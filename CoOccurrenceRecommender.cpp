@@ -0,0 +1,499 @@
+#include "CoOccurrenceRecommender.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <utility>
+
+namespace {
+constexpr const char *kSelectPurchasesSql =
+    "SELECT id, customer_name, product_id FROM purchases WHERE user_id = ? ORDER BY id";
+
+// Rough per-entry cost of a QHash node holding small keys and values
+constexpr qint64 kHashEntryBytes = 32;
+
+QString customerKey(const QString &customerName)
+{
+    return customerName.simplified().toCaseFolded();
+}
+}
+
+// ============================================================================
+// Matrix
+// ============================================================================
+
+struct CoOccurrenceRecommender::Matrix {
+    QHash<QString, QHash<int, int>> baskets;    // customer -> product -> purchases
+    QHash<int, QHash<int, int>> cooccurrence;   // product -> product -> shared customers
+    QHash<int, int> customersPerItem;
+    QHash<int, QVector<Neighbor>> topK;         // pruned rows served to callers
+    QSet<int> dirty;                            // rows whose topK is out of date
+    qint64 transactions = 0;
+    int maxPurchaseId = 0;
+    qint64 buildMs = 0;
+
+    void bump(int x, int y, int delta)
+    {
+        for (int pass = 0; pass < 2; ++pass) {
+            QHash<int, int> &row = cooccurrence[x];
+            int &count = row[y];
+            count += delta;
+            if (count <= 0) {
+                row.remove(y);
+                if (row.isEmpty()) {
+                    cooccurrence.remove(x);
+                }
+            }
+            dirty.insert(x);
+            std::swap(x, y);
+        }
+    }
+
+    void bumpAllPairs(const QHash<int, int> &basket, int delta)
+    {
+        const QList<int> items = basket.keys();
+        for (int i = 0; i < items.size(); ++i) {
+            for (int j = i + 1; j < items.size(); ++j) {
+                bump(items.at(i), items.at(j), delta);
+            }
+        }
+    }
+
+    // customersPerItem[x] feeds every score in x's neighbours' rows
+    void markDirty(int x)
+    {
+        dirty.insert(x);
+        const QHash<int, int> row = cooccurrence.value(x);
+        for (auto it = row.constBegin(); it != row.constEnd(); ++it) {
+            dirty.insert(it.key());
+        }
+    }
+
+    void add(const QString &customer, int productId)
+    {
+        ++transactions;
+        QHash<int, int> &basket = baskets[customer];
+        if (++basket[productId] > 1) {
+            return;  // Repeat purchase: the customer already counts for this item
+        }
+
+        ++customersPerItem[productId];
+        markDirty(productId);
+
+        const int size = basket.size();
+        if (size <= kMaxBasketItems) {
+            for (auto it = basket.constBegin(); it != basket.constEnd(); ++it) {
+                if (it.key() != productId) {
+                    bump(productId, it.key(), 1);
+                }
+            }
+        } else if (size == kMaxBasketItems + 1) {
+            // The basket just became too large: withdraw the pairs it gave
+            QHash<int, int> previous = basket;
+            previous.remove(productId);
+            bumpAllPairs(previous, -1);
+        }
+    }
+
+    void remove(const QString &customer, int productId)
+    {
+        auto basket = baskets.find(customer);
+        if (basket == baskets.end()) {
+            return;
+        }
+        auto item = basket->find(productId);
+        if (item == basket->end()) {
+            return;
+        }
+
+        --transactions;
+        if (--item.value() > 0) {
+            return;
+        }
+
+        const int sizeBefore = basket->size();
+        basket->erase(item);
+        markDirty(productId);
+        if (--customersPerItem[productId] <= 0) {
+            customersPerItem.remove(productId);
+        }
+
+        if (sizeBefore <= kMaxBasketItems) {
+            for (auto it = basket->constBegin(); it != basket->constEnd(); ++it) {
+                bump(productId, it.key(), -1);
+            }
+        } else if (sizeBefore == kMaxBasketItems + 1) {
+            // Back under the limit: the remaining basket contributes again
+            bumpAllPairs(*basket, 1);
+        }
+
+        if (basket->isEmpty()) {
+            baskets.erase(basket);
+        }
+    }
+
+    const QVector<Neighbor> &row(int productId)
+    {
+        static const QVector<Neighbor> empty;
+
+        if (!dirty.contains(productId)) {
+            auto cached = topK.constFind(productId);
+            return cached != topK.constEnd() ? *cached : empty;
+        }
+        dirty.remove(productId);
+
+        const auto source = cooccurrence.constFind(productId);
+        if (source == cooccurrence.constEnd()) {
+            topK.remove(productId);
+            return empty;
+        }
+
+        const double customers = customersPerItem.value(productId);
+        QVector<Neighbor> neighbors;
+        neighbors.reserve(source->size());
+        for (auto it = source->constBegin(); it != source->constEnd(); ++it) {
+            Neighbor neighbor;
+            neighbor.productId = it.key();
+            neighbor.sharedCustomers = it.value();
+            neighbor.score = float(it.value() / std::sqrt(customers * customersPerItem.value(it.key())));
+            neighbors.append(neighbor);
+        }
+
+        const auto better = [](const Neighbor &a, const Neighbor &b) {
+            if (a.score != b.score)
+                return a.score > b.score;
+            if (a.sharedCustomers != b.sharedCustomers)
+                return a.sharedCustomers > b.sharedCustomers;
+            return a.productId < b.productId;
+        };
+        const int keep = qMin<int>(kTopK, neighbors.size());
+        std::partial_sort(neighbors.begin(), neighbors.begin() + keep, neighbors.end(), better);
+        neighbors.resize(keep);
+        neighbors.squeeze();
+
+        auto stored = topK.insert(productId, neighbors);
+        return *stored;
+    }
+
+    void pruneAll()
+    {
+        dirty.clear();
+        for (auto it = cooccurrence.constBegin(); it != cooccurrence.constEnd(); ++it) {
+            dirty.insert(it.key());
+        }
+        const QList<int> items = dirty.values();
+        for (int item : items) {
+            row(item);
+        }
+    }
+
+    qint64 pairCount() const
+    {
+        qint64 pairs = 0;
+        for (const QHash<int, int> &row : cooccurrence) {
+            pairs += row.size();
+        }
+        return pairs;
+    }
+
+    qint64 estimatedBytes() const
+    {
+        qint64 bytes = 0;
+        for (auto it = baskets.constBegin(); it != baskets.constEnd(); ++it) {
+            bytes += kHashEntryBytes + it.key().size() * qint64(sizeof(QChar)) + it->size() * kHashEntryBytes;
+        }
+        bytes += (cooccurrence.size() + pairCount()) * kHashEntryBytes;
+        bytes += customersPerItem.size() * kHashEntryBytes;
+        for (const QVector<Neighbor> &neighbors : topK) {
+            bytes += kHashEntryBytes + neighbors.capacity() * qint64(sizeof(Neighbor));
+        }
+        return bytes;
+    }
+};
+
+// ============================================================================
+// Build Job
+// ============================================================================
+
+namespace {
+using Matrix = CoOccurrenceRecommender::Matrix;
+
+// Abandoned builds stop within this many purchases
+constexpr int kCancelCheckInterval = 4096;
+
+std::unique_ptr<Matrix> buildMatrix(const QSqlDatabase &db, int userId, const std::function<bool()> &cancelled)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto matrix = std::make_unique<Matrix>();
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(kSelectPurchasesSql);
+    query.addBindValue(userId);
+    if (!query.exec()) {
+        qWarning() << "CoOccurrenceRecommender: Could not read purchases:" << query.lastError().text();
+        return nullptr;
+    }
+
+    while (query.next()) {
+        if (matrix->transactions % kCancelCheckInterval == 0 && cancelled()) {
+            return nullptr;
+        }
+        matrix->maxPurchaseId = query.value(0).toInt();
+        ++matrix->baskets[customerKey(query.value(1).toString())][query.value(2).toInt()];
+        ++matrix->transactions;
+    }
+
+    // One pass over whole baskets instead of replaying purchases one by one
+    if (cancelled()) {
+        return nullptr;
+    }
+    for (const QHash<int, int> &basket : std::as_const(matrix->baskets)) {
+        for (auto it = basket.constBegin(); it != basket.constEnd(); ++it) {
+            ++matrix->customersPerItem[it.key()];
+        }
+        if (basket.size() <= CoOccurrenceRecommender::kMaxBasketItems) {
+            matrix->bumpAllPairs(basket, 1);
+        }
+    }
+
+    matrix->pruneAll();
+    matrix->buildMs = timer.elapsed();
+    return matrix;
+}
+
+// Reads the user's purchases on its own connection and hands the finished
+// matrix to `deliver` on the worker thread
+class BuildJob : public QRunnable
+{
+public:
+    BuildJob(std::function<void(std::unique_ptr<Matrix>)> deliver, std::function<bool()> cancelled,
+             const QString &connectionName, int userId)
+        : m_deliver(std::move(deliver))
+        , m_cancelled(std::move(cancelled))
+        , m_connectionName(connectionName)
+        , m_userId(userId)
+    {
+    }
+
+    void run() override
+    {
+        if (m_cancelled()) {
+            return;
+        }
+
+        std::unique_ptr<Matrix> matrix;
+        const QString connection = QStringLiteral("recommender-")
+                                 + QString::number(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+        {
+            QSqlDatabase db = QSqlDatabase::cloneDatabase(m_connectionName, connection);
+            if (db.open()) {
+                matrix = buildMatrix(db, m_userId, m_cancelled);
+            } else {
+                qWarning() << "CoOccurrenceRecommender: Could not open connection:" << db.lastError().text();
+            }
+        }
+        QSqlDatabase::removeDatabase(connection);
+
+        if (!m_cancelled()) {
+            m_deliver(std::move(matrix));
+        }
+    }
+
+private:
+    std::function<void(std::unique_ptr<Matrix>)> m_deliver;
+    std::function<bool()> m_cancelled;
+    QString m_connectionName;
+    int m_userId;
+};
+}
+
+// ============================================================================
+// Recommender
+// ============================================================================
+
+CoOccurrenceRecommender::CoOccurrenceRecommender(QObject *parent)
+    : QObject(parent)
+    , m_ready(false)
+    , m_generation(0)
+    , m_building(false)
+    , m_rebuildAfterAdopt(false)
+    , m_userId(-1)
+    , m_handoff(std::make_shared<Handoff>())
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+CoOccurrenceRecommender::~CoOccurrenceRecommender()
+{
+    // The build posts back to this object, so it must end first
+    clear();
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void CoOccurrenceRecommender::rebuild(const QString &connectionName, int userId)
+{
+    m_connectionName = connectionName;
+    m_userId = userId;
+    m_building = true;
+    m_rebuildAfterAdopt = false;
+    m_pendingEvents.clear();
+
+    const int generation = ++m_generation;
+    m_handoff->wanted.storeRelaxed(generation);
+    const std::shared_ptr<Handoff> handoff = m_handoff;
+    QObject *receiver = this;
+    const auto deliver = [handoff, receiver, generation](std::unique_ptr<Matrix> matrix) {
+        {
+            QMutexLocker locker(&handoff->mutex);
+            if (generation < handoff->generation) {
+                return;  // A newer build already finished
+            }
+            handoff->matrix = std::move(matrix);
+            handoff->generation = generation;
+        }
+        QMetaObject::invokeMethod(receiver, "adoptBuild", Qt::QueuedConnection, Q_ARG(int, generation));
+    };
+
+    const auto cancelled = [handoff, generation]() { return handoff->wanted.loadRelaxed() != generation; };
+
+    m_pool.start(new BuildJob(deliver, cancelled, connectionName, userId));
+}
+
+void CoOccurrenceRecommender::clear()
+{
+    // Whatever is still building belongs to the previous user
+    m_handoff->wanted.storeRelaxed(++m_generation);
+    m_matrix.reset();
+    m_ready = false;
+    m_building = false;
+    m_rebuildAfterAdopt = false;
+    m_pendingEvents.clear();
+}
+
+void CoOccurrenceRecommender::adoptBuild(int generation)
+{
+    std::unique_ptr<Matrix> built;
+    {
+        QMutexLocker locker(&m_handoff->mutex);
+        if (m_handoff->generation != generation) {
+            return;
+        }
+        built = std::move(m_handoff->matrix);
+    }
+
+    if (generation != m_generation) {
+        return;  // Superseded by clear() or a newer rebuild
+    }
+    m_building = false;
+
+    if (!built) {
+        m_pendingEvents.clear();
+        return;  // Keep serving the previous matrix, if any
+    }
+
+    // Purchases recorded after the build's snapshot
+    for (const PendingEvent &event : std::as_const(m_pendingEvents)) {
+        if (event.purchaseId > built->maxPurchaseId) {
+            built->add(event.customer, event.productId);
+        }
+    }
+    m_pendingEvents.clear();
+
+    m_matrix = std::move(built);
+    m_ready = true;
+    qDebug() << "Co-occurrence recommendations built:" << m_matrix->customersPerItem.size() << "items,"
+             << m_matrix->transactions << "purchases in" << m_matrix->buildMs << "ms";
+    emit rebuilt(stats());
+
+    // A removal raced the build; the snapshot may or may not include it
+    if (m_rebuildAfterAdopt) {
+        rebuild(m_connectionName, m_userId);
+    }
+}
+
+void CoOccurrenceRecommender::recordPurchase(int purchaseId, const QString &customerName, int productId)
+{
+    const QString customer = customerKey(customerName);
+    if (customer.isEmpty() || productId <= 0) {
+        return;
+    }
+
+    if (m_matrix) {
+        m_matrix->add(customer, productId);
+    }
+    if (m_building) {
+        m_pendingEvents.append({ purchaseId, customer, productId });
+    }
+}
+
+void CoOccurrenceRecommender::removePurchase(const QString &customerName, int productId)
+{
+    const QString customer = customerKey(customerName);
+    if (customer.isEmpty() || productId <= 0) {
+        return;
+    }
+
+    if (m_matrix) {
+        m_matrix->remove(customer, productId);
+    }
+    if (m_building) {
+        m_rebuildAfterAdopt = true;
+    }
+}
+
+QVector<CoOccurrenceRecommender::Neighbor> CoOccurrenceRecommender::related(int productId, int limit)
+{
+    if (!m_matrix || limit <= 0) {
+        return {};
+    }
+
+    const QVector<Neighbor> &row = m_matrix->row(productId);
+    return row.mid(0, qMin<int>(limit, row.size()));
+}
+
+int CoOccurrenceRecommender::customerCount(int productId) const
+{
+    return m_matrix ? m_matrix->customersPerItem.value(productId) : 0;
+}
+
+int CoOccurrenceRecommender::sharedCustomers(int productId, int otherId) const
+{
+    return m_matrix ? m_matrix->cooccurrence.value(productId).value(otherId) : 0;
+}
+
+QVariantMap CoOccurrenceRecommender::stats() const
+{
+    QVariantMap map;
+    map.insert("ready", m_ready);
+    map.insert("building", m_building);
+    if (!m_matrix) {
+        return map;
+    }
+
+    qint64 pruned = 0;
+    for (const QVector<Neighbor> &neighbors : m_matrix->topK) {
+        pruned += neighbors.size();
+    }
+
+    map.insert("items", m_matrix->customersPerItem.size());
+    map.insert("customers", m_matrix->baskets.size());
+    map.insert("pairs", m_matrix->pairCount());
+    map.insert("prunedEntries", pruned);
+    map.insert("estimatedBytes", m_matrix->estimatedBytes());
+    map.insert("buildMs", m_matrix->buildMs);
+    map.insert("transactions", m_matrix->transactions);
+    return map;
+}
@@ -0,0 +1,101 @@
+#ifndef COOCCURRENCERECOMMENDER_H
+#define COOCCURRENCERECOMMENDER_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+#include <memory>
+
+// "Customers who took X also took Y" over the purchases table.
+// - Items are products; a customer's basket is every product bought under
+//   the same (trimmed, case-folded) customer name.
+// - cooccurrence[x][y] counts customers who took both; similarity is the
+//   cosine cooccurrence / sqrt(customers(x) * customers(y)).
+// - Only the top kTopK neighbours per item are kept for serving. Rows are
+//   re-pruned lazily after incremental updates touch them.
+// - Baskets above kMaxBasketItems distinct items (walk-in or catch-all
+//   names) count towards item popularity but contribute no pairs.
+class CoOccurrenceRecommender : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kTopK = 20;
+    static constexpr int kMaxBasketItems = 200;
+
+    struct Neighbor {
+        int productId = 0;
+        float score = 0.0f;
+        int sharedCustomers = 0;
+    };
+
+    explicit CoOccurrenceRecommender(QObject *parent = nullptr);
+    ~CoOccurrenceRecommender();
+
+    // Rebuilds from the purchases of userId on a worker thread with its
+    // own connection; updates recorded meanwhile are replayed on adoption.
+    // clear(), a newer rebuild and the destructor abandon a running build.
+    void rebuild(const QString &connectionName, int userId);
+    void clear();
+
+    void recordPurchase(int purchaseId, const QString &customerName, int productId);
+    void removePurchase(const QString &customerName, int productId);
+
+    // Best neighbours of productId by descending score
+    QVector<Neighbor> related(int productId, int limit);
+
+    // The counts behind the scores: customers who took productId, and
+    // those of them who also took otherId
+    int customerCount(int productId) const;
+    int sharedCustomers(int productId, int otherId) const;
+
+    bool isReady() const { return m_ready; }
+
+    // { ready, building, items, customers, pairs, prunedEntries,
+    //   estimatedBytes, buildMs, transactions }
+    QVariantMap stats() const;
+
+    struct Matrix;
+
+signals:
+    void rebuilt(const QVariantMap &stats);
+
+private slots:
+    void adoptBuild(int generation);
+
+private:
+    struct PendingEvent {
+        int purchaseId;
+        QString customer;
+        int productId;
+    };
+
+    std::unique_ptr<Matrix> m_matrix;
+    bool m_ready;
+    int m_generation;
+    bool m_building;
+    QVector<PendingEvent> m_pendingEvents;   // arrived while a build runs
+    bool m_rebuildAfterAdopt;
+    QString m_connectionName;
+    int m_userId;
+
+    // Result slot shared with the build job; a matrix from an older
+    // generation (superseded by clear() or a newer rebuild) is dropped
+    struct Handoff {
+        QMutex mutex;
+        std::unique_ptr<Matrix> matrix;
+        int generation = 0;
+        QAtomicInt wanted;   // the only generation worth finishing
+    };
+    std::shared_ptr<Handoff> m_handoff;
+
+    // Builds post back to this object, so the destructor drains the pool
+    QThreadPool m_pool;
+};
+
+#endif // COOCCURRENCERECOMMENDER_H
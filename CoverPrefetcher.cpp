@@ -0,0 +1,359 @@
+#include "CoverPrefetcher.h"
+#include "ThumbnailCache.h"
+#include <QCache>
+#include <QDebug>
+#include <QImageReader>
+#include <QMutex>
+#include <QQuickImageProvider>
+#include <QRunnable>
+#include <algorithm>
+
+namespace {
+// Also the image provider id, with the path percent-encoded
+QString coverKey(int size, const QString &filePath)
+{
+    return QString::number(size) + QLatin1Char('/') + filePath;
+}
+
+QImage decodeCover(const QString &filePath, int size)
+{
+    QImageReader reader(filePath);
+    reader.setAutoTransform(true);
+
+    // The grid crops covers to fill the tile, so the shorter side is the
+    // one that has to reach `size`
+    const QSize original = reader.size();
+    if (size > 0 && original.isValid() && qMin(original.width(), original.height()) > size) {
+        reader.setScaledSize(original.scaled(size, size, Qt::KeepAspectRatioByExpanding));
+    }
+
+    const QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "CoverPrefetcher: Could not decode" << filePath << reader.errorString();
+    }
+    return image;
+}
+}
+
+// ============================================================================
+// Shared Cover Cache
+// ============================================================================
+
+// Filled by the prefetcher on the GUI thread, read by the image provider on
+// QML's image loader threads
+struct CoverPrefetcher::Cache {
+    QMutex mutex;
+    QCache<QString, QImage> images { CoverPrefetcher::kCacheBytes };   // cost in bytes
+    int hits = 0;
+    int misses = 0;
+
+    bool contains(const QString &key)
+    {
+        QMutexLocker locker(&mutex);
+        return images.contains(key);
+    }
+
+    QImage find(const QString &key)
+    {
+        QMutexLocker locker(&mutex);
+        if (const QImage *image = images.object(key)) {
+            ++hits;
+            return *image;
+        }
+        ++misses;
+        return QImage();
+    }
+
+    void insert(const QString &key, const QImage &image)
+    {
+        QMutexLocker locker(&mutex);
+        images.insert(key, new QImage(image), qMax<qsizetype>(1, image.sizeInBytes()));
+    }
+};
+
+namespace {
+class CoverImageProvider : public QQuickImageProvider
+{
+public:
+    explicit CoverImageProvider(std::shared_ptr<CoverPrefetcher::Cache> cache)
+        : QQuickImageProvider(QQuickImageProvider::Image)
+        , m_cache(std::move(cache))
+    {
+    }
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override
+    {
+        Q_UNUSED(requestedSize)
+
+        // "<size>/<percent-encoded file path>", see CoverPrefetcher::coverUrl()
+        const qsizetype slash = id.indexOf(QLatin1Char('/'));
+        const int coverSize = id.left(slash).toInt();
+        const QString filePath = QUrl::fromPercentEncoding(id.mid(slash + 1).toUtf8());
+        const QString key = coverKey(coverSize, filePath);
+
+        QImage image = m_cache->find(key);
+        if (image.isNull()) {
+            image = decodeCover(filePath, coverSize);
+            if (!image.isNull()) {
+                m_cache->insert(key, image);
+            }
+        }
+
+        if (size) {
+            *size = image.size();
+        }
+        return image;
+    }
+
+private:
+    const std::shared_ptr<CoverPrefetcher::Cache> m_cache;
+};
+
+class CoverDecodeJob : public QRunnable
+{
+public:
+    CoverDecodeJob(CoverPrefetcher *prefetcher, std::shared_ptr<QAtomicInt> cancelled,
+                   const QString &key, const QString &filePath, int size)
+        : m_prefetcher(prefetcher)
+        , m_cancelled(std::move(cancelled))
+        , m_key(key)
+        , m_filePath(filePath)
+        , m_size(size)
+    {
+    }
+
+    void run() override
+    {
+        // Left the window while queued on the pool
+        QImage image;
+        const bool skipped = m_cancelled->loadRelaxed();
+        if (!skipped) {
+            image = decodeCover(m_filePath, m_size);
+        }
+        QMetaObject::invokeMethod(m_prefetcher, "finishDecode", Qt::QueuedConnection,
+                                  Q_ARG(QString, m_key),
+                                  Q_ARG(QImage, image),
+                                  Q_ARG(bool, skipped));
+    }
+
+private:
+    CoverPrefetcher *m_prefetcher;
+    std::shared_ptr<QAtomicInt> m_cancelled;
+    QString m_key;
+    QString m_filePath;
+    int m_size;
+};
+}
+
+// ============================================================================
+// Constructor & Destructor
+// ============================================================================
+
+CoverPrefetcher::CoverPrefetcher(QObject *parent)
+    : QObject(parent)
+    , m_cache(std::make_shared<Cache>())
+    , m_firstVisible(-1)
+    , m_lastVisible(-1)
+    , m_velocity(0.0)
+    , m_coverSize(0)
+    , m_decoded(0)
+    , m_cancelled(0)
+{
+    m_pool.setMaxThreadCount(kMaxInFlight);
+
+    // A thumbnail generated since resolving is smaller than what was resolved
+    connect(ThumbnailCache::instance(), &ThumbnailCache::thumbnailsReady,
+            this, &CoverPrefetcher::onThumbnailsReady);
+}
+
+CoverPrefetcher::~CoverPrefetcher()
+{
+    // Jobs post back to this object, so they must end first
+    cancelAll();
+    m_pool.waitForDone();
+}
+
+QQuickImageProvider *CoverPrefetcher::createImageProvider() const
+{
+    return new CoverImageProvider(m_cache);
+}
+
+// ============================================================================
+// Viewport
+// ============================================================================
+
+QUrl CoverPrefetcher::coverUrl(const QString &imagePath, int size)
+{
+    const QString filePath = resolvedPath(imagePath, size);
+    if (filePath.isEmpty()) {
+        return QUrl();
+    }
+    return QUrl(QStringLiteral("image://covers/") + QString::number(size) + QLatin1Char('/')
+                + QString::fromLatin1(QUrl::toPercentEncoding(filePath)));
+}
+
+void CoverPrefetcher::setImagePaths(const QStringList &imagePaths)
+{
+    m_imagePaths = imagePaths;
+    schedule();
+}
+
+void CoverPrefetcher::updateViewport(int firstVisible, int lastVisible, double velocity, int coverSize)
+{
+    if (coverSize != m_coverSize) {
+        m_resolved.clear();
+        m_coverSize = coverSize;
+    }
+    m_firstVisible = firstVisible;
+    m_lastVisible = lastVisible;
+    m_velocity = velocity;
+    schedule();
+}
+
+void CoverPrefetcher::cancelAll()
+{
+    m_firstVisible = -1;
+    m_lastVisible = -1;
+    m_queue.clear();
+    m_windowKeys.clear();
+    for (const auto &cancelled : std::as_const(m_inFlight)) {
+        cancelled->storeRelaxed(1);
+    }
+}
+
+QString CoverPrefetcher::resolvedPath(const QString &imagePath, int size)
+{
+    if (imagePath.isEmpty()) {
+        return QString();
+    }
+    if (size != m_coverSize) {
+        return ThumbnailCache::instance()->resolve(imagePath, size);
+    }
+
+    auto it = m_resolved.constFind(imagePath);
+    if (it == m_resolved.constEnd()) {
+        it = m_resolved.insert(imagePath, ThumbnailCache::instance()->resolve(imagePath, size));
+    }
+    return *it;
+}
+
+void CoverPrefetcher::onThumbnailsReady()
+{
+    m_resolved.clear();
+}
+
+void CoverPrefetcher::schedule()
+{
+    m_queue.clear();
+    m_windowKeys.clear();
+
+    const int count = int(m_imagePaths.size());
+    if (count > 0 && m_firstVisible >= 0 && m_coverSize > 0) {
+        const int first = qBound(0, m_firstVisible, count - 1);
+        const int last = qBound(first, m_lastVisible, count - 1);
+        const int visible = last - first + 1;
+
+        // Reach further ahead the faster the grid moves, capped at a few screens
+        const int ahead = qMin(visible * kMaxScreensAhead,
+                               visible + int(qAbs(m_velocity) * kLookaheadSeconds));
+        const int behind = visible / 2;
+        const bool forward = m_velocity >= 0;
+        const int begin = qMax(0, first - (forward ? behind : ahead));
+        const int end = qMin(count - 1, last + (forward ? ahead : behind));
+
+        struct Ranked {
+            int distance;
+            int index;
+        };
+        QVector<Ranked> ranked;
+        ranked.reserve(end - begin + 1);
+        for (int i = begin; i <= end; ++i) {
+            if (!m_imagePaths.at(i).isEmpty()) {
+                ranked.append({ i < first ? first - i : (i > last ? i - last : 0), i });
+            }
+        }
+
+        // Visible covers top to bottom, then outwards by distance; at equal
+        // distance the side the grid is moving towards comes first
+        std::sort(ranked.begin(), ranked.end(), [forward](const Ranked &a, const Ranked &b) {
+            if (a.distance != b.distance) {
+                return a.distance < b.distance;
+            }
+            if (a.distance == 0) {
+                return a.index < b.index;
+            }
+            return forward ? a.index > b.index : a.index < b.index;
+        });
+
+        for (const Ranked &entry : std::as_const(ranked)) {
+            const QString filePath = resolvedPath(m_imagePaths.at(entry.index), m_coverSize);
+            const QString key = coverKey(m_coverSize, filePath);
+            // Books sharing a cover are decoded once
+            if (m_windowKeys.contains(key)) {
+                continue;
+            }
+            m_windowKeys.insert(key);
+            if (!m_inFlight.contains(key) && !m_cache->contains(key)) {
+                m_queue.append({ key, filePath, m_coverSize });
+            }
+        }
+    }
+
+    // Running decodes for covers outside the window are not waited for;
+    // covers scrolled back into it before their job started run after all
+    for (auto it = m_inFlight.cbegin(); it != m_inFlight.cend(); ++it) {
+        it.value()->storeRelaxed(m_windowKeys.contains(it.key()) ? 0 : 1);
+    }
+
+    pump();
+}
+
+void CoverPrefetcher::pump()
+{
+    // Cancelled decodes still hold their slot until they return
+    while (m_inFlight.size() < kMaxInFlight && !m_queue.isEmpty()) {
+        const Request request = m_queue.takeFirst();
+        auto cancelled = std::make_shared<QAtomicInt>(0);
+        m_inFlight.insert(request.key, cancelled);
+        m_pool.start(new CoverDecodeJob(this, cancelled, request.key, request.filePath, request.size));
+    }
+}
+
+void CoverPrefetcher::finishDecode(const QString &key, const QImage &image, bool skipped)
+{
+    const std::shared_ptr<QAtomicInt> cancelled = m_inFlight.take(key);
+    if (cancelled && cancelled->loadRelaxed()) {
+        ++m_cancelled;
+    }
+
+    // Skipped, but back in the window by the time the job returned;
+    // rescheduling queues it again now that it is no longer in flight
+    if (skipped && m_windowKeys.contains(key) && !m_cache->contains(key)) {
+        schedule();
+        return;
+    }
+
+    // Kept even when cancelled after decoding; scrolling back then hits
+    if (!image.isNull()) {
+        m_cache->insert(key, image);
+        ++m_decoded;
+    }
+    pump();
+}
+
+QVariantMap CoverPrefetcher::stats() const
+{
+    QVariantMap map;
+    {
+        QMutexLocker locker(&m_cache->mutex);
+        map.insert("cachedCovers", m_cache->images.count());
+        map.insert("cacheBytes", m_cache->images.totalCost());
+        map.insert("providerHits", m_cache->hits);
+        map.insert("providerMisses", m_cache->misses);
+    }
+    map.insert("queued", m_queue.size());
+    map.insert("inFlight", m_inFlight.size());
+    map.insert("decoded", m_decoded);
+    map.insert("cancelled", m_cancelled);
+    return map;
+}
@@ -0,0 +1,96 @@
+#ifndef COVERPREFETCHER_H
+#define COVERPREFETCHER_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QUrl>
+#include <QVariantMap>
+#include <QVector>
+#include <memory>
+
+class QQuickImageProvider;
+
+// Decodes book covers ahead of the Stock grid's viewport.
+// - The grid reports its image paths (setImagePaths) and, while scrolling,
+//   its visible index range and velocity (updateViewport).
+// - The prefetch window reaches further ahead the faster the grid moves and
+//   half a screen behind. Covers in it are decoded nearest-to-viewport
+//   first, at most kMaxInFlight at a time on a private pool.
+// - Queued covers that leave the window are dropped; decodes already
+//   running for them are marked cancelled.
+// - Decoded covers go into a byte-bounded cache served to QML through the
+//   "covers" image provider (coverUrl); a miss decodes on QML's image
+//   loader thread as before.
+class CoverPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kMaxInFlight = 4;
+    static constexpr qint64 kCacheBytes = 96LL * 1024 * 1024;
+    static constexpr double kLookaheadSeconds = 0.6;
+    static constexpr int kMaxScreensAhead = 4;
+
+    explicit CoverPrefetcher(QObject *parent = nullptr);
+    ~CoverPrefetcher();
+
+    // Provider for engine.addImageProvider("covers", ...); the engine owns it
+    QQuickImageProvider *createImageProvider() const;
+
+    // image://covers URL for a cover displayed at `size` device pixels
+    Q_INVOKABLE QUrl coverUrl(const QString &imagePath, int size);
+
+    // Image path per grid index ("" for books without a cover)
+    Q_INVOKABLE void setImagePaths(const QStringList &imagePaths);
+
+    // firstVisible..lastVisible are grid indexes; velocity is in items per
+    // second, positive when scrolling towards higher indexes
+    Q_INVOKABLE void updateViewport(int firstVisible, int lastVisible, double velocity, int coverSize);
+
+    // Drops everything queued, e.g. while the page is hidden
+    Q_INVOKABLE void cancelAll();
+
+    // { cachedCovers, cacheBytes, queued, inFlight, decoded, cancelled,
+    //   providerHits, providerMisses }
+    Q_INVOKABLE QVariantMap stats() const;
+
+    struct Cache;
+
+private slots:
+    void finishDecode(const QString &key, const QImage &image, bool skipped);
+    void onThumbnailsReady();
+
+private:
+    struct Request {
+        QString key;
+        QString filePath;
+        int size;
+    };
+
+    // File the cover is decoded from: its thumbnail once generated
+    QString resolvedPath(const QString &imagePath, int size);
+    void schedule();
+    void pump();
+
+    std::shared_ptr<Cache> m_cache;
+    QThreadPool m_pool;
+    QStringList m_imagePaths;
+    int m_firstVisible;
+    int m_lastVisible;
+    double m_velocity;
+    int m_coverSize;
+    QHash<QString, QString> m_resolved;   // image path -> file, at m_coverSize
+
+    QVector<Request> m_queue;                                  // nearest first
+    QHash<QString, std::shared_ptr<QAtomicInt>> m_inFlight;    // key -> cancelled flag
+    QSet<QString> m_windowKeys;                                // keys in the current window
+    int m_decoded;
+    int m_cancelled;
+};
+
+#endif // COVERPREFETCHER_H
@@ -1,14 +1,123 @@
 #include "Database.h"
+#include "ApiTraceRecorder.h"
+#include "Circulation.h"
+#include "UserCatalogCache.h"
+#include "LedgerAnalytics.h"
+#include "StockLedger.h"
+#include "SubstringScanner.h"
+#include "ThumbnailCache.h"
 
 #include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QSqlDriver>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QSqlRecord>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
 #include <algorithm>
 
+#ifdef SIGMATERIAL_SQLITE_DIRECT
+#include <sqlite3.h>
+#endif
+
+// Catalog load timings, off by default:
+// QT_LOGGING_RULES="sigmaterial.catalog.load.debug=true"
+Q_LOGGING_CATEGORY(lcCatalogLoad, "sigmaterial.catalog.load", QtInfoMsg)
+
 namespace {
 constexpr const char *kDatabaseName = "perpustakaan.db";
+constexpr QChar kSearchKeySeparator = QChar(0x1F);
+
+// Statements on the interactive path; verifyQueryPlans() checks each of them
+constexpr const char *kSelectBooksSql =
+    "SELECT id, title, author, genre, publisher, year, copies, image_path, available FROM books WHERE user_id = ?";
+constexpr const char *kCountBooksSql = "SELECT COUNT(*) FROM books WHERE user_id = ?";
+// Copies on loan stay on loan; the count cannot drop below them
+constexpr const char *kUpdateBookSql =
+    "UPDATE books SET title = ?, author = ?, genre = ?, publisher = ?, year = ?,"
+    " available = available + (? - copies), copies = ?, image_path = ?"
+    " WHERE id = ? AND user_id = ? AND copies - available <= ? RETURNING available";
+// A book stays while any copy is out, so no open loan loses its book
+constexpr const char *kDeleteBookSql =
+    "DELETE FROM books WHERE id = ? AND user_id = ? AND NOT EXISTS"
+    " (SELECT 1 FROM loans WHERE loans.user_id = books.user_id AND loans.book_id = books.id"
+    " AND loans.returned_at IS NULL)";
+constexpr const char *kSelectUserSql =
+    "SELECT id, username, password_hash, full_name FROM users WHERE username = ?";
+constexpr const char *kUpdatePasswordSql = "UPDATE users SET password_hash = ? WHERE id = ?";
+constexpr const char *kSelectCatalogRevisionSql = "SELECT revision FROM catalog_revisions WHERE user_id = ?";
+
+const QStringList &hotStatements()
+{
+    static const QStringList statements = QStringList {
+        kSelectBooksSql,
+        kCountBooksSql,
+        kUpdateBookSql,
+        kDeleteBookSql,
+        kSelectUserSql,
+        kUpdatePasswordSql,
+        kSelectCatalogRevisionSql,
+        OverdueTracker::selectOpenLoansSql(),
+    } + Circulation::hotStatements();
+    return statements;
+}
+
+// Covers are shared across users, so every book counts, not just m_books
+constexpr const char *kSelectCoverPathsSql =
+    "SELECT DISTINCT image_path FROM books WHERE image_path IS NOT NULL AND image_path != ''";
+// Quiet period after the last deletion before thumbnails are collected
+constexpr int kThumbnailGcDelayMs = 3000;
+
+// Reads the live cover paths on its own connection and hands them to the
+// thumbnail cache on its thread
+class CoverPathsJob : public QRunnable
+{
+public:
+    CoverPathsJob(const QString &connectionName, ThumbnailCache *cache)
+        : m_connectionName(connectionName)
+        , m_cache(cache)
+    {
+    }
+
+    void run() override
+    {
+        QStringList livePaths;
+        bool ok = false;
+        const QString connection = QStringLiteral("thumbnail-gc-")
+                                 + QString::number(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+        {
+            QSqlDatabase db = QSqlDatabase::cloneDatabase(m_connectionName, connection);
+            if (db.open()) {
+                QSqlQuery query(db);
+                ok = query.exec(kSelectCoverPathsSql);
+                while (ok && query.next()) {
+                    livePaths.append(query.value(0).toString());
+                }
+                if (!ok) {
+                    qDebug() << "Error collecting cover paths:" << query.lastError().text();
+                }
+            } else {
+                qDebug() << "Error collecting cover paths:" << db.lastError().text();
+            }
+        }
+        QSqlDatabase::removeDatabase(connection);
+
+        // A partial list would delete live thumbnails
+        if (ok) {
+            QMetaObject::invokeMethod(m_cache, "collectGarbage", Qt::QueuedConnection,
+                                      Q_ARG(QStringList, livePaths));
+        }
+    }
+
+private:
+    QString m_connectionName;
+    ThumbnailCache *m_cache;
+};
 }
 
 // ============================================================================
@@ -18,18 +127,45 @@ constexpr const char *kDatabaseName = "perpustakaan.db";
 Database::Database(QObject *parent)
     : QObject(parent)
     , currentUserId(-1)
+    , m_databasePath(QString::fromLatin1(kDatabaseName))
+    , m_connectionName(QString::fromLatin1(QSqlDatabase::defaultConnection))
     , m_sortedByTitle(false)
     , m_sortedByYear(false)
+    , m_batchActive(false)
+    , m_batchSortedByTitle(false)
+    , m_batchSortedByYear(false)
 {
+    m_userCatalogs = std::make_unique<UserCatalogCache>();
+    publishCatalog();
+
+    m_stockAuditPool.setMaxThreadCount(1);
+
+    m_thumbnailGcTimer.setSingleShot(true);
+    m_thumbnailGcTimer.setInterval(kThumbnailGcDelayMs);
+    connect(&m_thumbnailGcTimer, &QTimer::timeout, this, &Database::startThumbnailGarbageCollection);
+
+    connect(&m_overdue, &OverdueTracker::loanDueSoon, this, &Database::loanDueSoon);
+    connect(&m_overdue, &OverdueTracker::loanOverdue, this, &Database::loanOverdue);
+    connect(&m_overdue, &OverdueTracker::countsChanged, this, &Database::loanCountsChanged);
 }
 
 Database::~Database()
 {
+    // The stock audit posts back to this object, so it must end first
+    m_stockAuditPool.clear();
+    m_stockAuditPool.waitForDone();
+
     if (db.isOpen()) {
         db.close();
     }
     m_books.clear();
     m_genreGraph.clear();
+
+    // Named connections belong to this instance (trace replay sessions)
+    if (m_connectionName != QLatin1String(QSqlDatabase::defaultConnection)) {
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(m_connectionName);
+    }
 }
 
 // ============================================================================
@@ -38,23 +174,171 @@ Database::~Database()
 
 bool Database::initDatabase()
 {
-    if (!QSqlDatabase::contains(QSqlDatabase::defaultConnection)) {
-        db = QSqlDatabase::addDatabase("QSQLITE");
+    API_TRACE();
+    if (!QSqlDatabase::contains(m_connectionName)) {
+        db = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
     } else {
-        db = QSqlDatabase::database(QSqlDatabase::defaultConnection);
+        db = QSqlDatabase::database(m_connectionName);
     }
 
-    db.setDatabaseName(kDatabaseName);
+    db.setDatabaseName(m_databasePath);
 
     if (!db.open()) {
         qDebug() << "Error: Failed to connect to database" << db.lastError().text();
         return false;
     }
 
-    return createTables();
+    if (!migrateSchema()) {
+        return false;
+    }
+
+    // Test mode: refuse to start when a hot statement would scan a table
+    if (qEnvironmentVariableIsSet("SIGMATERIAL_VERIFY_QUERY_PLANS") && !verifyQueryPlans()) {
+        return false;
+    }
+
+    return true;
+}
+
+void Database::setDatabaseLocation(const QString &filePath, const QString &connectionName)
+{
+    if (db.isOpen()) {
+        qWarning() << "Database: Location must be set before initDatabase()";
+        return;
+    }
+    m_databasePath = filePath;
+    m_connectionName = connectionName;
+}
+
+// ============================================================================
+// Schema Migrations
+// ============================================================================
+
+bool Database::migrateSchema()
+{
+    // Each step runs in its own transaction and bumps PRAGMA user_version,
+    // so an interrupted upgrade resumes at the first missing step
+    static const Migration migrations[] = {
+        { 1, "users and books tables", &Database::migrateToV1 },
+        { 2, "books lookup indexes", &Database::migrateToV2 },
+        { 3, "store schema from sigmaterial.db", &Database::migrateToV3 },
+        { 4, "ledger minor units and revenue rollups", &Database::migrateToV4 },
+        { 5, "stock snapshots", &Database::migrateToV5 },
+        { 6, "purchases by product index", &Database::migrateToV6 },
+        { 7, "loans and available copies", &Database::migrateToV7 },
+        { 8, "catalog revisions", &Database::migrateToV8 },
+    };
+
+    const int current = schemaVersion();
+    if (current < 0) {
+        return false;
+    }
+
+    for (const Migration &migration : migrations) {
+        if (migration.version <= current) {
+            continue;
+        }
+
+        if (!db.transaction()) {
+            qDebug() << "Error starting migration:" << db.lastError().text();
+            return false;
+        }
+
+        QSqlQuery query(db);
+        if (!(this->*migration.apply)()
+            || !query.exec(QStringLiteral("PRAGMA user_version = %1").arg(migration.version))) {
+            qDebug() << "Error: Migration to version" << migration.version
+                     << "(" << migration.description << ") failed" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+
+        if (!db.commit()) {
+            qDebug() << "Error committing migration:" << db.lastError().text();
+            return false;
+        }
+
+        qDebug() << "Database migrated to version" << migration.version << "-" << migration.description;
+    }
+
+    return true;
+}
+
+int Database::schemaVersion() const
+{
+    API_TRACE();
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA user_version") || !query.next()) {
+        qDebug() << "Error reading schema version:" << query.lastError().text();
+        return -1;
+    }
+    return query.value(0).toInt();
+}
+
+bool Database::columnExists(const QString &table, const QString &column) const
+{
+    QSqlQuery query(db);
+    if (!query.exec(QStringLiteral("PRAGMA table_info(%1)").arg(table))) {
+        return false;
+    }
+
+    while (query.next()) {
+        if (query.value("name").toString().compare(column, Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Database::execStatements(const QStringList &statements)
+{
+    QSqlQuery query(db);
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) {
+            qDebug() << "Error executing migration statement:" << query.lastError().text() << statement;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Database::verifyQueryPlans()
+{
+    API_TRACE();
+    bool ok = true;
+
+    for (const QString &statement : hotStatements()) {
+        QSqlQuery query(db);
+        if (!query.prepare(QStringLiteral("EXPLAIN QUERY PLAN ") + statement)) {
+            qDebug() << "Error preparing query plan:" << query.lastError().text() << statement;
+            ok = false;
+            continue;
+        }
+
+        // Plan shape does not depend on the bound values
+        for (int i = 0; i < statement.count(QLatin1Char('?')); ++i) {
+            query.addBindValue(0);
+        }
+
+        if (!query.exec()) {
+            qDebug() << "Error running query plan:" << query.lastError().text() << statement;
+            ok = false;
+            continue;
+        }
+
+        while (query.next()) {
+            const QString detail = query.value("detail").toString();
+            if (detail.startsWith(QLatin1String("SCAN")) && !detail.contains(QLatin1String("CONSTANT ROW"))) {
+                qDebug() << "Error: Full scan in hot statement:" << detail << "-" << statement;
+                ok = false;
+            }
+        }
+    }
+
+    return ok;
 }
 
-bool Database::createTables()
+bool Database::migrateToV1()
 {
     QSqlQuery query(db);
 
@@ -98,12 +382,178 @@ bool Database::createTables()
     return true;
 }
 
+bool Database::migrateToV2()
+{
+    // loadBooks filters on user_id; title lookups are case-insensitive
+    return execStatements({
+        "CREATE INDEX IF NOT EXISTS idx_books_user_id ON books (user_id, id)",
+        "CREATE INDEX IF NOT EXISTS idx_books_user_title ON books (user_id, title COLLATE NOCASE)",
+    });
+}
+
+bool Database::migrateToV3()
+{
+    // Bring in the store tables that sigmaterial.db already carries. Every
+    // statement is idempotent because such files report user_version 0.
+    if (!columnExists("users", "recovery_key")
+        && !execStatements({ "ALTER TABLE users ADD COLUMN recovery_key TEXT" })) {
+        return false;
+    }
+
+    if (!columnExists("users", "profile_photo")
+        && !execStatements({ "ALTER TABLE users ADD COLUMN profile_photo TEXT" })) {
+        return false;
+    }
+
+    return execStatements({
+        R"(CREATE TABLE IF NOT EXISTS products (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            user_id INTEGER NOT NULL,
+            name TEXT NOT NULL,
+            category TEXT NOT NULL,
+            stock INTEGER NOT NULL,
+            price REAL NOT NULL,
+            image_path TEXT,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (user_id) REFERENCES users (id)
+        ))",
+        R"(CREATE TABLE IF NOT EXISTS pemasukan (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            user_id INTEGER NOT NULL,
+            nominal TEXT,
+            keterangan TEXT,
+            tanggal TEXT,
+            jam TEXT,
+            purchase_id INTEGER,
+            FOREIGN KEY (user_id) REFERENCES users (id),
+            FOREIGN KEY (purchase_id) REFERENCES purchases (id)
+        ))",
+        R"(CREATE TABLE IF NOT EXISTS pengeluaran (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            user_id INTEGER NOT NULL,
+            nominal TEXT,
+            keterangan TEXT,
+            tanggal TEXT,
+            jam TEXT,
+            FOREIGN KEY (user_id) REFERENCES users (id)
+        ))",
+        R"(CREATE TABLE IF NOT EXISTS purchases (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            user_id INTEGER NOT NULL,
+            product_id INTEGER NOT NULL,
+            customer_name TEXT NOT NULL,
+            quantity INTEGER NOT NULL,
+            total_price REAL NOT NULL,
+            notes TEXT,
+            income_id INTEGER,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (user_id) REFERENCES users (id),
+            FOREIGN KEY (product_id) REFERENCES products (id),
+            FOREIGN KEY (income_id) REFERENCES pemasukan (id)
+        ))",
+        R"(CREATE TABLE IF NOT EXISTS stock_movements (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            user_id INTEGER NOT NULL,
+            product_id INTEGER NOT NULL,
+            quantity_added INTEGER NOT NULL,
+            movement_type TEXT NOT NULL,
+            description TEXT,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY (user_id) REFERENCES users(id),
+            FOREIGN KEY (product_id) REFERENCES products(id)
+        ))",
+        "CREATE INDEX IF NOT EXISTS idx_products_user_id ON products (user_id, id)",
+        "CREATE INDEX IF NOT EXISTS idx_pemasukan_user_id ON pemasukan (user_id, id)",
+        "CREATE INDEX IF NOT EXISTS idx_pengeluaran_user_id ON pengeluaran (user_id, id)",
+        "CREATE INDEX IF NOT EXISTS idx_purchases_user_id ON purchases (user_id, id)",
+        "CREATE INDEX IF NOT EXISTS idx_stock_movements_product ON stock_movements (user_id, product_id, id)",
+    });
+}
+
+bool Database::migrateToV4()
+{
+    // Integer amounts and ISO dates next to the display TEXT columns, plus
+    // per-day and per-week rollups kept in step by insertLedgerEntry()
+    for (const char *table : { "pemasukan", "pengeluaran" }) {
+        if (!columnExists(table, "amount_minor")
+            && !execStatements({ QStringLiteral("ALTER TABLE %1 ADD COLUMN amount_minor INTEGER").arg(QLatin1String(table)) })) {
+            return false;
+        }
+        if (!columnExists(table, "entry_date")
+            && !execStatements({ QStringLiteral("ALTER TABLE %1 ADD COLUMN entry_date TEXT").arg(QLatin1String(table)) })) {
+            return false;
+        }
+    }
+
+    return execStatements({
+        R"(CREATE TABLE IF NOT EXISTS ledger_daily (
+            user_id INTEGER NOT NULL,
+            kind TEXT NOT NULL,
+            day TEXT NOT NULL,
+            amount_minor INTEGER NOT NULL DEFAULT 0,
+            entry_count INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY (user_id, kind, day)
+        ) WITHOUT ROWID)",
+        R"(CREATE TABLE IF NOT EXISTS ledger_weekly (
+            user_id INTEGER NOT NULL,
+            kind TEXT NOT NULL,
+            week_start TEXT NOT NULL,
+            amount_minor INTEGER NOT NULL DEFAULT 0,
+            entry_count INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY (user_id, kind, week_start)
+        ) WITHOUT ROWID)",
+        "CREATE INDEX IF NOT EXISTS idx_pemasukan_user_date ON pemasukan (user_id, entry_date)",
+        "CREATE INDEX IF NOT EXISTS idx_pengeluaran_user_date ON pengeluaran (user_id, entry_date)",
+    }) && LedgerAnalytics::backfill(db);
+}
+
+bool Database::migrateToV5()
+{
+    return StockLedger::migrate(db)
+        && execStatements({
+               "CREATE INDEX IF NOT EXISTS idx_stock_movements_time ON stock_movements (user_id, product_id, created_at)",
+           });
+}
+
+bool Database::migrateToV6()
+{
+    // PurchaseListModel pages one product's purchases newest first
+    return execStatements({
+        "CREATE INDEX IF NOT EXISTS idx_purchases_user_product ON purchases (user_id, product_id, id)",
+    });
+}
+
+bool Database::migrateToV7()
+{
+    return Circulation::migrate(db);
+}
+
+bool Database::migrateToV8()
+{
+    // Every write to a user's books bumps their revision, whichever
+    // connection makes it; a cached catalog is valid while it matches
+    return execStatements({
+        "CREATE TABLE IF NOT EXISTS catalog_revisions ("
+        " user_id INTEGER PRIMARY KEY, revision INTEGER NOT NULL DEFAULT 0)",
+        "CREATE TRIGGER IF NOT EXISTS trg_books_revision_insert AFTER INSERT ON books BEGIN"
+        " INSERT INTO catalog_revisions (user_id, revision) VALUES (NEW.user_id, 1)"
+        " ON CONFLICT (user_id) DO UPDATE SET revision = revision + 1; END",
+        "CREATE TRIGGER IF NOT EXISTS trg_books_revision_update AFTER UPDATE ON books BEGIN"
+        " INSERT INTO catalog_revisions (user_id, revision) VALUES (NEW.user_id, 1)"
+        " ON CONFLICT (user_id) DO UPDATE SET revision = revision + 1; END",
+        "CREATE TRIGGER IF NOT EXISTS trg_books_revision_delete AFTER DELETE ON books BEGIN"
+        " INSERT INTO catalog_revisions (user_id, revision) VALUES (OLD.user_id, 1)"
+        " ON CONFLICT (user_id) DO UPDATE SET revision = revision + 1; END",
+    });
+}
+
 // ============================================================================
 // User Management
 // ============================================================================
 
 bool Database::createUser(const QString &username, const QString &password, const QString &fullName)
 {
+    API_TRACE(username, ApiTraceRecorder::redacted(), fullName);
     const QString trimmedUsername = username.trimmed();
     const QString trimmedName = fullName.trimmed();
 
@@ -134,6 +584,7 @@ bool Database::createUser(const QString &username, const QString &password, cons
 
 bool Database::loginUser(const QString &username, const QString &password)
 {
+    API_TRACE(username, ApiTraceRecorder::redacted());
     const QString trimmedUsername = username.trimmed();
 
     if (trimmedUsername.isEmpty() || password.isEmpty()) {
@@ -153,43 +604,83 @@ bool Database::loginUser(const QString &username, const QString &password)
         return false;
     }
 
-    currentUserId = user.value("id").toInt();
-    currentUsername = user.value("username").toString();
+    startSession(user.value("id").toInt(), user.value("username").toString());
+    return true;
+}
 
-    // Load books after successful login
-    loadBooks();
+void Database::startSession(int userId, const QString &username)
+{
+    currentUserId = userId;
+    currentUsername = username;
 
-    return true;
+    // Load books after successful login, unless this terminal still holds
+    // an unchanged copy from the user's last session
+    if (!restoreCatalog()) {
+        loadBooks();
+    }
+
+    // Audit the stock ledger once per session, off the GUI thread
+    checkStockConsistency();
+
+    // Purchase co-occurrence recommendations, also built in the background
+    m_recommender.rebuild(db.connectionName(), currentUserId);
+
+    // Open loan deadlines, straight off the due_at index
+    m_overdue.rebuild(db, currentUserId);
+
+    emit purchasesReset();
 }
 
 void Database::logoutUser()
 {
+    API_TRACE();
+    if (m_batchActive) {
+        rollbackBatch();
+    }
+
+    stashCatalog();
+
     currentUserId = -1;
     currentUsername.clear();
     m_books.clear();
     m_genreGraph.clear();
+    m_arena = std::make_shared<CatalogArena>();
+    m_catalogPeakBytes = 0;
+    m_duplicates.clear();
+    m_duplicatesStale = true;
+    m_recommender.clear();
+    m_overdue.clear();
+    m_bookIndex.clear();
+    m_catalogRevision = -1;
+    resetQueryResults();
     m_sortedByTitle = false;
     m_sortedByYear = false;
+    publishCatalog();
     emit booksChanged();
+    emit purchasesReset();
 }
 
 bool Database::isUserLoggedIn() const
 {
+    API_TRACE();
     return currentUserId > 0;
 }
 
 int Database::getCurrentUserId() const
 {
+    API_TRACE();
     return currentUserId;
 }
 
 QString Database::getCurrentUsername() const
 {
+    API_TRACE();
     return currentUsername;
 }
 
 bool Database::changePassword(const QString &currentPassword, const QString &newPassword)
 {
+    API_TRACE(ApiTraceRecorder::redacted(), ApiTraceRecorder::redacted());
     if (!isUserLoggedIn()) {
         qDebug() << "Error: No user logged in";
         return false;
@@ -204,7 +695,7 @@ bool Database::changePassword(const QString &currentPassword, const QString &new
     }
 
     QSqlQuery query(db);
-    query.prepare("UPDATE users SET password_hash = ? WHERE id = ?");
+    query.prepare(kUpdatePasswordSql);
     query.addBindValue(hashPassword(newPassword));
     query.addBindValue(currentUserId);
 
@@ -216,51 +707,261 @@ bool Database::changePassword(const QString &currentPassword, const QString &new
     return true;
 }
 
+// ============================================================================
+// Per-User Catalog Cache
+// ============================================================================
+
+void Database::setCatalogCacheLimits(int budgetMegabytes, int idleMinutes)
+{
+    API_TRACE(budgetMegabytes, idleMinutes);
+    m_userCatalogs->setLimits(qint64(qMax(0, budgetMegabytes)) * 1024 * 1024, qMax(0, idleMinutes) * 60);
+}
+
+QVariantMap Database::getCatalogCacheStats() const
+{
+    API_TRACE();
+    return m_userCatalogs->stats();
+}
+
+qint64 Database::catalogRevision()
+{
+    QSqlQuery query(db);
+    query.prepare(kSelectCatalogRevisionSql);
+    query.addBindValue(currentUserId);
+
+    if (!query.exec()) {
+        qDebug() << "Error reading catalog revision:" << query.lastError().text();
+        return -1;
+    }
+    // No row until the user's first book is written
+    return query.next() ? query.value(0).toLongLong() : 0;
+}
+
+void Database::stashCatalog()
+{
+    if (!isUserLoggedIn() || m_catalogRevision < 0) {
+        return;
+    }
+
+    // Moved out whole; the arena keeps the books' strings alive
+    auto entry = std::make_unique<UserCatalogCache::Entry>();
+    entry->books = std::move(m_books);
+    entry->arena = m_arena;
+    entry->genreGraph = std::move(m_genreGraph);
+    entry->duplicates = std::move(m_duplicates);
+    entry->duplicatesStale = m_duplicatesStale;
+    entry->sortedByTitle = m_sortedByTitle;
+    entry->sortedByYear = m_sortedByYear;
+    entry->catalogPeakBytes = m_catalogPeakBytes;
+    entry->revision = m_catalogRevision;
+    m_userCatalogs->store(currentUserId, std::move(entry));
+}
+
+bool Database::restoreCatalog()
+{
+    std::unique_ptr<UserCatalogCache::Entry> entry = m_userCatalogs->take(currentUserId, catalogRevision());
+    if (!entry) {
+        return false;
+    }
+
+    m_books = std::move(entry->books);
+    m_arena = std::move(entry->arena);
+    m_genreGraph = std::move(entry->genreGraph);
+    m_duplicates = std::move(entry->duplicates);
+    m_duplicatesStale = entry->duplicatesStale;
+    m_sortedByTitle = entry->sortedByTitle;
+    m_sortedByYear = entry->sortedByYear;
+    m_catalogPeakBytes = entry->catalogPeakBytes;
+    m_catalogRevision = entry->revision;
+    m_bookIndex.clear();
+    resetQueryResults();
+
+    qCDebug(lcCatalogLoad) << "Restored" << m_books.size() << "books from the catalog cache";
+
+    publishCatalog();
+    emit booksChanged();
+    emit sortStatusChanged();
+    return true;
+}
+
 // ============================================================================
 // Core Book Management (with SQL Sync)
 // ============================================================================
 
 void Database::loadBooks()
 {
+    API_TRACE();
     if (!isUserLoggedIn()) {
         qDebug() << "Error: No user logged in";
         return;
     }
 
     m_books.clear();
+    m_genreGraph.clear();
     m_sortedByTitle = false;
     m_sortedByYear = false;
+    resetQueryResults();
+
+    // Nothing references the old catalog's strings any more (a batch
+    // snapshot keeps its own reference to the arena it was taken from)
+    m_arena = std::make_shared<CatalogArena>();
+    m_catalogPeakBytes = 0;
+
+    // Rebuilt on the next addBook or duplicate query
+    m_duplicates.clear();
+    m_duplicatesStale = true;
+
+    // Read before the rows: a write landing in between leaves the revision
+    // behind the catalog, which only costs a reload later
+    m_catalogRevision = catalogRevision();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    m_books.reserve(countBooks());
+
+    bool decoded = false;
+#ifdef SIGMATERIAL_SQLITE_DIRECT
+    decoded = decodeBooksDirect(m_books);
+#endif
+    if (!decoded && !decodeBooks(m_books)) {
+        publishCatalog();
+        return;
+    }
+
+    if (lcCatalogLoad().isDebugEnabled()) {
+        const qint64 elapsed = qMax<qint64>(1, timer.nsecsElapsed());
+        qCDebug(lcCatalogLoad) << "Loaded" << m_books.size() << "books in" << elapsed / 1000000.0 << "ms"
+                               << "(" << qRound64(m_books.size() * 1e9 / elapsed) << "rows/s )";
+    }
 
+    // Regenerate missing or stale cover thumbnails in the background
+    for (const Book &book : m_books) {
+        ThumbnailCache::instance()->submit(CatalogArena::detach(book.image_path));
+    }
+    updateCatalogPeak();
+
+    // Build graph after loading
+    buildGraph();
+    publishCatalog();
+    emit booksChanged();
+    emit sortStatusChanged();
+}
+
+qsizetype Database::countBooks()
+{
+    QSqlQuery query(db);
+    query.prepare(kCountBooksSql);
+    query.addBindValue(currentUserId);
+
+    if (!query.exec() || !query.next()) {
+        return 0;  // Only a capacity hint; the cursor still reads every row
+    }
+    return query.value(0).toLongLong();
+}
+
+bool Database::decodeBooks(QVector<Book> &books)
+{
     QSqlQuery query(db);
-    query.prepare("SELECT id, title, author, genre, publisher, year, copies, image_path FROM books WHERE user_id = ?");
+    // Rows are read once in order, so skip the driver's random-access cache
+    query.setForwardOnly(true);
+    query.prepare(kSelectBooksSql);
     query.addBindValue(currentUserId);
 
     if (!query.exec()) {
         qDebug() << "Error loading books:" << query.lastError().text();
-        return;
+        return false;
     }
 
+    // Resolve field positions once instead of by name on every row
+    const QSqlRecord record = query.record();
+    const int idColumn = record.indexOf("id");
+    const int titleColumn = record.indexOf("title");
+    const int authorColumn = record.indexOf("author");
+    const int genreColumn = record.indexOf("genre");
+    const int publisherColumn = record.indexOf("publisher");
+    const int yearColumn = record.indexOf("year");
+    const int copiesColumn = record.indexOf("copies");
+    const int imagePathColumn = record.indexOf("image_path");
+    const int availableColumn = record.indexOf("available");
+
     while (query.next()) {
         Book book;
-        book.id = query.value("id").toInt();
-        book.title = query.value("title").toString();
-        book.author = query.value("author").toString();
-        book.genre = query.value("genre").toString();
-        book.publisher = query.value("publisher").toString();
-        book.year = query.value("year").toInt();
-        book.copies = query.value("copies").toInt();
-        book.image_path = query.value("image_path").toString();
-        m_books.append(book);
+        book.id = query.value(idColumn).toInt();
+        book.year = query.value(yearColumn).toInt();
+        book.copies = query.value(copiesColumn).toInt();
+        book.available = query.value(availableColumn).toInt();
+        assignBookStrings(book,
+                          query.value(titleColumn).toString(),
+                          query.value(authorColumn).toString(),
+                          query.value(genreColumn).toString(),
+                          query.value(publisherColumn).toString(),
+                          query.value(imagePathColumn).toString());
+        books.append(std::move(book));
     }
 
-    // Build graph after loading
-    buildGraph();
-    emit booksChanged();
-    emit sortStatusChanged();
+    return true;
+}
+
+#ifdef SIGMATERIAL_SQLITE_DIRECT
+// Steps the statement on the QSQLITE connection's own handle, decoding
+// UTF-16 text straight into the catalog arena without the QVariant round
+// trip or a temporary QString per column.
+// Only valid when Qt's SQLite plugin links the same libsqlite3 as this
+// target (Qt configured with -system-sqlite); otherwise returns false and
+// loadBooks() falls back to decodeBooks().
+bool Database::decodeBooksDirect(QVector<Book> &books)
+{
+    const QVariant handle = db.driver()->handle();
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*") != 0) {
+        return false;
+    }
+
+    sqlite3 *connection = *static_cast<sqlite3 *const *>(handle.data());
+    if (!connection) {
+        return false;
+    }
+
+    sqlite3_stmt *statement = nullptr;
+    if (sqlite3_prepare_v2(connection, kSelectBooksSql, -1, &statement, nullptr) != SQLITE_OK) {
+        qWarning() << "Database: Direct load prepare failed:" << sqlite3_errmsg(connection);
+        return false;
+    }
+    sqlite3_bind_int(statement, 1, currentUserId);
+
+    // Views into SQLite's buffer stay valid until the next step
+    const auto text = [statement](int column) {
+        const void *data = sqlite3_column_text16(statement, column);
+        const int bytes = sqlite3_column_bytes16(statement, column);
+        return data ? QStringView(static_cast<const QChar *>(data), bytes / int(sizeof(QChar))) : QStringView();
+    };
+
+    int rc;
+    while ((rc = sqlite3_step(statement)) == SQLITE_ROW) {
+        Book book;
+        book.id = sqlite3_column_int(statement, 0);
+        book.year = sqlite3_column_int(statement, 5);
+        book.copies = sqlite3_column_int(statement, 6);
+        book.available = sqlite3_column_int(statement, 8);
+        assignBookStrings(book, text(1), text(2), text(3), text(4), text(7));
+        books.append(std::move(book));
+    }
+
+    if (rc != SQLITE_DONE) {
+        qWarning() << "Database: Direct load failed:" << sqlite3_errmsg(connection);
+        books.clear();
+        sqlite3_finalize(statement);
+        return false;
+    }
+
+    sqlite3_finalize(statement);
+    return true;
 }
+#endif
 
 QVariantList Database::getAllBooks()
 {
+    API_TRACE();
     return booksToVariantList(m_books);
 }
 
@@ -272,6 +973,7 @@ bool Database::addBook(const QString &title,
                        int copies,
                        const QString &image_path)
 {
+    API_TRACE(title, author, genre, publisher, year, copies, image_path);
     if (!isUserLoggedIn()) {
         qDebug() << "Error: No user logged in";
         return false;
@@ -285,8 +987,8 @@ bool Database::addBook(const QString &title,
     // Insert into SQL database
     QSqlQuery query(db);
     query.prepare(
-        "INSERT INTO books (user_id, title, author, genre, publisher, year, copies, image_path)"
-        " VALUES (?, ?, ?, ?, ?, ?, ?, ?)"
+        "INSERT INTO books (user_id, title, author, genre, publisher, year, copies, available, image_path)"
+        " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)"
     );
     query.addBindValue(currentUserId);
     query.addBindValue(title.trimmed());
@@ -295,6 +997,7 @@ bool Database::addBook(const QString &title,
     query.addBindValue(publisher.trimmed());
     query.addBindValue(year);
     query.addBindValue(copies);
+    query.addBindValue(copies);
     query.addBindValue(image_path.trimmed());
 
     if (!query.exec()) {
@@ -305,24 +1008,44 @@ bool Database::addBook(const QString &title,
     // Add to in-memory cache
     Book book;
     book.id = query.lastInsertId().toInt();
-    book.title = title.trimmed();
-    book.author = author.trimmed();
-    book.genre = genre.trimmed();
-    book.publisher = publisher.trimmed();
     book.year = year;
     book.copies = copies;
-    book.image_path = image_path.trimmed();
+    book.available = copies;
+    assignBookStrings(book, QStringView(title).trimmed(), QStringView(author).trimmed(),
+                      QStringView(genre).trimmed(), QStringView(publisher).trimmed(),
+                      QStringView(image_path).trimmed());
+
+    // Near-duplicate check: only books sharing an LSH bucket are compared
+    ensureDuplicateIndex();
+    const DuplicateDetector::Signature signature = bookSignature(book);
+    const QVector<DuplicateDetector::Candidate> duplicates = m_duplicates.candidates(signature, book.id);
+    m_duplicates.insert(book.id, signature);
 
     m_books.append(book);
+    invalidateQueryResults(nullptr, &book);
+    updateCatalogPeak();
+
+    // Generate cover thumbnails in the background
+    ThumbnailCache::instance()->submit(image_path.trimmed());
     
     // Reset sorting flags since new book is added
     m_sortedByTitle = false;
     m_sortedByYear = false;
 
-    // Rebuild graph
-    buildGraph();
-    emit booksChanged();
-    emit sortStatusChanged();
+    // Rebuild graph (deferred while a batch is open)
+    applyBookChange(BookChange::Added, book.id);
+
+    if (!duplicates.isEmpty()) {
+        const QVariantList candidates = duplicateCandidatesToVariantList(duplicates);
+        if (m_batchActive) {
+            QVariantMap entry;
+            entry.insert("id", book.id);
+            entry.insert("candidates", candidates);
+            m_batchDuplicates.append(entry);
+        } else {
+            emit possibleDuplicatesFound(book.id, candidates);
+        }
+    }
 
     return true;
 }
@@ -336,6 +1059,7 @@ bool Database::updateBook(int id,
                           int copies,
                           const QString &image_path)
 {
+    API_TRACE(id, title, author, genre, publisher, year, copies, image_path);
     if (!isUserLoggedIn()) {
         qDebug() << "Error: No user logged in";
         return false;
@@ -348,35 +1072,47 @@ bool Database::updateBook(int id,
 
     // Update SQL database
     QSqlQuery query(db);
-    query.prepare(
-        "UPDATE books SET title = ?, author = ?, genre = ?, publisher = ?, year = ?, copies = ?, image_path = ?"
-        " WHERE id = ? AND user_id = ?"
-    );
+    query.prepare(kUpdateBookSql);
     query.addBindValue(title.trimmed());
     query.addBindValue(author.trimmed());
     query.addBindValue(genre.trimmed());
     query.addBindValue(publisher.trimmed());
     query.addBindValue(year);
     query.addBindValue(copies);
+    query.addBindValue(copies);
     query.addBindValue(image_path.trimmed());
     query.addBindValue(id);
     query.addBindValue(currentUserId);
+    query.addBindValue(copies);
 
     if (!query.exec()) {
         qDebug() << "Error updating book:" << query.lastError().text();
         return false;
     }
+    if (!query.next()) {
+        qDebug() << "Error: Book" << id << "not found or has more than" << copies << "copies on loan";
+        return false;
+    }
+    const int available = query.value(0).toInt();
+    query.finish();
 
     // Update in-memory cache
     for (Book &book : m_books) {
         if (book.id == id) {
-            book.title = title.trimmed();
-            book.author = author.trimmed();
-            book.genre = genre.trimmed();
-            book.publisher = publisher.trimmed();
+            const Book before = book;
+            retireBookStrings(book);
             book.year = year;
+            book.available = available;
             book.copies = copies;
-            book.image_path = image_path.trimmed();
+            assignBookStrings(book, QStringView(title).trimmed(), QStringView(author).trimmed(),
+                              QStringView(genre).trimmed(), QStringView(publisher).trimmed(),
+                              QStringView(image_path).trimmed());
+            invalidateQueryResults(&before, &book);
+            updateCatalogPeak();
+            if (!m_duplicatesStale) {
+                m_duplicates.insert(id, bookSignature(book));
+            }
+            ThumbnailCache::instance()->submit(image_path.trimmed());
             
             // Reset sorting flags since book is updated
             m_sortedByTitle = false;
@@ -385,16 +1121,15 @@ bool Database::updateBook(int id,
         }
     }
 
-    // Rebuild graph
-    buildGraph();
-    emit booksChanged();
-    emit sortStatusChanged();
+    // Rebuild graph (deferred while a batch is open)
+    applyBookChange(BookChange::Updated, id);
 
     return true;
 }
 
 bool Database::deleteBook(int id)
 {
+    API_TRACE(id);
     if (!isUserLoggedIn()) {
         qDebug() << "Error: No user logged in";
         return false;
@@ -407,7 +1142,7 @@ bool Database::deleteBook(int id)
 
     // Delete from SQL database
     QSqlQuery query(db);
-    query.prepare("DELETE FROM books WHERE id = ? AND user_id = ?");
+    query.prepare(kDeleteBookSql);
     query.addBindValue(id);
     query.addBindValue(currentUserId);
 
@@ -415,10 +1150,17 @@ bool Database::deleteBook(int id)
         qDebug() << "Error deleting book:" << query.lastError().text();
         return false;
     }
+    if (query.numRowsAffected() == 0) {
+        qDebug() << "Error: Book" << id << "not found or still has copies on loan";
+        return false;
+    }
 
     // Remove from in-memory cache
     for (int i = 0; i < m_books.size(); ++i) {
-        if (m_books[i].id == id) {
+        if (m_books.at(i).id == id) {
+            invalidateQueryResults(&m_books.at(i), nullptr);
+            retireBookStrings(m_books.at(i));
+            m_duplicates.remove(id);
             m_books.remove(i);
             
             // Reset sorting flags since book is removed
@@ -428,20 +1170,273 @@ bool Database::deleteBook(int id)
         }
     }
 
-    // Rebuild graph
+    // Rebuild graph (deferred while a batch is open)
+    applyBookChange(BookChange::Removed, id);
+
+    return true;
+}
+
+void Database::applyBookChange(BookChange change, int bookId)
+{
+    if (!m_batchActive) {
+        if (change == BookChange::Removed) {
+            // Drop thumbnails no book refers to anymore
+            collectThumbnailGarbage();
+        }
+        buildGraph();
+        publishCatalogChange(change, bookId);
+        emit booksChanged();
+        emit sortStatusChanged();
+        return;
+    }
+
+    // Fold the change into the pending change set
+    switch (change) {
+    case BookChange::Added:
+        m_batchAdded.insert(bookId);
+        break;
+    case BookChange::Updated:
+        if (!m_batchAdded.contains(bookId)) {
+            m_batchUpdated.insert(bookId);
+        }
+        break;
+    case BookChange::Removed:
+        m_batchUpdated.remove(bookId);
+        if (!m_batchAdded.remove(bookId)) {
+            m_batchRemoved.insert(bookId);
+        }
+        break;
+    }
+}
+
+// ============================================================================
+// Batch Sessions
+// ============================================================================
+
+bool Database::beginBatch()
+{
+    API_TRACE();
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return false;
+    }
+
+    if (m_batchActive) {
+        qDebug() << "Error: A batch is already open";
+        return false;
+    }
+
+    if (!db.transaction()) {
+        qDebug() << "Error starting batch:" << db.lastError().text();
+        return false;
+    }
+
+    // QVector is implicitly shared, so this snapshot is free until the
+    // first mutation detaches m_books
+    m_batchBooksSnapshot = m_books;
+    m_batchArena = m_arena;
+    m_batchSortedByTitle = m_sortedByTitle;
+    m_batchSortedByYear = m_sortedByYear;
+    m_batchAdded.clear();
+    m_batchUpdated.clear();
+    m_batchRemoved.clear();
+    m_batchDuplicates.clear();
+    m_batchPurchasesChanged = false;
+    m_batchActive = true;
+
+    return true;
+}
+
+bool Database::commitBatch()
+{
+    API_TRACE();
+    if (!m_batchActive) {
+        qDebug() << "Error: No batch is open";
+        return false;
+    }
+
+    if (!db.commit()) {
+        qDebug() << "Error committing batch:" << db.lastError().text();
+        rollbackBatch();
+        return false;
+    }
+
+    m_batchActive = false;
+    m_batchBooksSnapshot.clear();
+    m_batchArena.reset();
+
+    const bool changed = !m_batchAdded.isEmpty() || !m_batchUpdated.isEmpty() || !m_batchRemoved.isEmpty();
+
+    QVariantList added;
+    QVariantList updated;
+    QVariantList removed;
+    for (int id : std::as_const(m_batchAdded)) {
+        added.append(id);
+    }
+    for (int id : std::as_const(m_batchUpdated)) {
+        updated.append(id);
+    }
+    for (int id : std::as_const(m_batchRemoved)) {
+        removed.append(id);
+    }
+    const bool hadRemovals = !m_batchRemoved.isEmpty();
+    const QVariantList duplicates = m_batchDuplicates;
+
+    m_batchAdded.clear();
+    m_batchUpdated.clear();
+    m_batchRemoved.clear();
+    m_batchDuplicates.clear();
+    m_batchPurchasesChanged = false;
+
+    if (!changed) {
+        return true;
+    }
+
+    // Apply the deferred index work once for the whole batch
+    if (hadRemovals) {
+        collectThumbnailGarbage();
+    }
     buildGraph();
+    publishCatalog();
+    m_catalogRevision = catalogRevision();
+
+    QVariantMap changes;
+    changes.insert("added", added);
+    changes.insert("updated", updated);
+    changes.insert("removed", removed);
+    changes.insert("duplicates", duplicates);
+
+    emit booksBatchCommitted(changes);
     emit booksChanged();
     emit sortStatusChanged();
 
     return true;
 }
 
+bool Database::rollbackBatch()
+{
+    API_TRACE();
+    if (!m_batchActive) {
+        qDebug() << "Error: No batch is open";
+        return false;
+    }
+
+    if (!db.rollback()) {
+        qDebug() << "Error rolling back batch:" << db.lastError().text();
+    }
+
+    // Book changes were never announced during the batch, so restoring
+    // the catalog is silent
+    m_books = m_batchBooksSnapshot;
+    m_arena = m_batchArena;
+    resetQueryResults();
+    m_sortedByTitle = m_batchSortedByTitle;
+    m_sortedByYear = m_batchSortedByYear;
+    m_batchBooksSnapshot.clear();
+    m_batchArena.reset();
+    m_batchAdded.clear();
+    m_batchUpdated.clear();
+    m_batchRemoved.clear();
+    m_batchDuplicates.clear();
+    m_batchActive = false;
+
+    // Purchases were announced and fed to the recommender as they happened
+    if (m_batchPurchasesChanged) {
+        m_batchPurchasesChanged = false;
+        m_recommender.rebuild(db.connectionName(), currentUserId);
+        emit purchasesReset();
+    }
+
+    // The duplicate index saw the batch's books; rebuild it when next needed
+    m_duplicates.clear();
+    m_duplicatesStale = true;
+
+    // Loans taken or returned inside the batch were rolled back too
+    m_overdue.rebuild(db, currentUserId);
+
+    // The graph was never rebuilt during the batch, so it still matches
+    return true;
+}
+
+bool Database::isBatchActive() const
+{
+    API_TRACE();
+    return m_batchActive;
+}
+
+// ============================================================================
+// Published Catalog Versions
+// ============================================================================
+
+std::shared_ptr<const CatalogSnapshot> Database::catalogSnapshot() const
+{
+    if (QThread::currentThread() == thread() && m_snapshotOrderStale) {
+        publishCatalog();
+    }
+    return std::atomic_load_explicit(&m_snapshot, std::memory_order_acquire);
+}
+
+void Database::publishCatalog() const
+{
+    m_snapshotOrderStale = false;
+
+    auto next = std::make_shared<CatalogSnapshot>();
+    next->version = ++m_snapshotVersion;
+    next->books = ChunkedVector<Book>::fromVector(m_books);
+    next->genreGraph = m_genreGraph;
+    next->arena = m_arena;
+
+    std::atomic_store_explicit(&m_snapshot, std::shared_ptr<const CatalogSnapshot>(std::move(next)),
+                               std::memory_order_release);
+}
+
+void Database::publishCatalogChange(BookChange change, int bookId)
+{
+    // Only called once a write outside a batch has committed
+    m_catalogRevision = catalogRevision();
+
+    // Only the GUI thread publishes, so reading m_snapshot here needs no
+    // atomic load. Edits find their record by id, so a stale order is
+    // carried over as it is.
+    if (!m_snapshot) {
+        publishCatalog();
+        return;
+    }
+
+    const auto matches = [bookId](const Book &book) { return book.id == bookId; };
+    const auto current = std::find_if(m_books.cbegin(), m_books.cend(), matches);
+
+    // Unchanged chunks and the genre map's nodes are shared with the
+    // previous version; only the touched chunk is copied
+    auto next = std::make_shared<CatalogSnapshot>();
+    next->version = ++m_snapshotVersion;
+    next->genreGraph = m_genreGraph;
+    next->arena = m_arena;
+
+    switch (change) {
+    case BookChange::Added:
+        next->books = current != m_books.cend() ? m_snapshot->books.withAppended(*current) : m_snapshot->books;
+        break;
+    case BookChange::Updated:
+        next->books = current != m_books.cend() ? m_snapshot->books.withReplaced(matches, *current)
+                                                : m_snapshot->books;
+        break;
+    case BookChange::Removed:
+        next->books = m_snapshot->books.withRemoved(matches);
+        break;
+    }
+
+    std::atomic_store_explicit(&m_snapshot, std::shared_ptr<const CatalogSnapshot>(std::move(next)),
+                               std::memory_order_release);
+}
+
 // ============================================================================
 // ALGORITHM 1: MERGE SORT (Manual Implementation) - FIXED
 // ============================================================================
 
 void Database::sortBooks(const QString &criteria)
 {
+    API_TRACE(criteria);
     if (m_books.isEmpty()) {
         return;
     }
@@ -457,6 +1452,14 @@ void Database::sortBooks(const QString &criteria)
     // Reset sorting flags
     m_sortedByTitle = false;
     m_sortedByYear = false;
+
+    // Cached results list books in catalog order. Re-sorting by the same
+    // criterion is stable, so only switching criteria reorders them.
+    const QString criterion = byTitle ? QStringLiteral("title") : QStringLiteral("year");
+    if (m_orderCriterion != criterion) {
+        m_orderCriterion = criterion;
+        ++m_catalogVersion;
+    }
     
     // Sort using merge sort
     mergeSort(m_books, 0, m_books.size() - 1, byTitle);
@@ -467,18 +1470,22 @@ void Database::sortBooks(const QString &criteria)
     } else {
         m_sortedByYear = true;
     }
-    
+
+    // Same books in a new order; republished when next asked for
+    m_snapshotOrderStale = true;
     emit booksChanged();
     emit sortStatusChanged();
 }
 
 bool Database::isSortedByTitle() const
 {
+    API_TRACE();
     return m_sortedByTitle;
 }
 
 bool Database::isSortedByYear() const
 {
+    API_TRACE();
     return m_sortedByYear;
 }
 
@@ -522,8 +1529,8 @@ void Database::merge(QVector<Book>& list, int left, int mid, int right, bool byT
         bool leftIsLess = false;
         
         if (byTitle) {
-            // Case-insensitive string comparison
-            leftIsLess = leftVec[i].title.compare(rightVec[j].title, Qt::CaseInsensitive) <= 0;
+            // Locale-aware comparison of the normalized title keys
+            leftIsLess = compareKeys(leftVec[i].titleKey(), rightVec[j].titleKey()) <= 0;
         } else {
             // Numeric comparison for year
             leftIsLess = leftVec[i].year <= rightVec[j].year;
@@ -565,7 +1572,7 @@ void Database::ensureSortedForSearch()
     }
 }
 
-int Database::binarySearch(const QString &title)
+int Database::binarySearch(const QString &titleKey)
 {
     if (m_books.isEmpty()) {
         return -1;
@@ -573,17 +1580,18 @@ int Database::binarySearch(const QString &title)
 
     ensureSortedForSearch();
 
-    QString searchTitle = title.trimmed().toLower();
     int left = 0;
     int right = m_books.size() - 1;
 
     while (left <= right) {
         int mid = left + (right - left) / 2;
-        QString midTitle = m_books[mid].title.trimmed().toLower();
 
-        if (midTitle == searchTitle) {
+        // Same collator and keys as mergeSort, so the probe order matches
+        const int order = compareKeys(m_books.at(mid).titleKey(), titleKey);
+
+        if (order == 0) {
             return mid;  // Found exact match
-        } else if (midTitle < searchTitle) {
+        } else if (order < 0) {
             left = mid + 1;
         } else {
             right = mid - 1;
@@ -593,7 +1601,7 @@ int Database::binarySearch(const QString &title)
     return -1;  // Not found
 }
 
-QVariantList Database::searchBook(const QString &query)
+QVariantList Database::computeSearchResults(const QString &query)
 {
     QVariantList results;
 
@@ -602,10 +1610,14 @@ QVariantList Database::searchBook(const QString &query)
         return getAllBooks();
     }
 
-    QString searchQuery = query.trimmed().toLower();
+    // Normalize the query once; book keys were normalized at load time
+    const QString searchQuery = normalizeKey(query);
+    if (searchQuery.isEmpty()) {
+        return getAllBooks();
+    }
 
     // First, try binary search for exact title match
-    int exactIndex = binarySearch(query);
+    int exactIndex = binarySearch(searchQuery);
     
     if (exactIndex != -1) {
         // Found exact match, return it
@@ -613,13 +1625,13 @@ QVariantList Database::searchBook(const QString &query)
         
         // Check for adjacent matches (in case of multiple exact matches)
         int left = exactIndex - 1;
-        while (left >= 0 && m_books[left].title.trimmed().compare(query.trimmed(), Qt::CaseInsensitive) == 0) {
+        while (left >= 0 && compareKeys(m_books.at(left).titleKey(), searchQuery) == 0) {
             results.prepend(bookToVariantMap(m_books[left]));
             left--;
         }
         
         int right = exactIndex + 1;
-        while (right < m_books.size() && m_books[right].title.trimmed().compare(query.trimmed(), Qt::CaseInsensitive) == 0) {
+        while (right < m_books.size() && compareKeys(m_books.at(right).titleKey(), searchQuery) == 0) {
             results.append(bookToVariantMap(m_books[right]));
             right++;
         }
@@ -628,29 +1640,81 @@ QVariantList Database::searchBook(const QString &query)
         return results;
     }
 
-    // If not found by binary search, do linear search for partial matches
-    for (const Book &book : m_books) {
-        if (book.title.trimmed().toLower().contains(searchQuery) ||
-            book.author.trimmed().toLower().contains(searchQuery) ||
-            book.genre.trimmed().toLower().contains(searchQuery) ||
-            book.publisher.trimmed().toLower().contains(searchQuery)) {
-            
-            // Check if book is already in results
-            bool alreadyExists = false;
-            for (const QVariant &result : results) {
-                QVariantMap map = result.toMap();
-                if (map["id"].toInt() == book.id) {
-                    alreadyExists = true;
-                    break;
-                }
-            }
-            
-            if (!alreadyExists) {
-                results.append(bookToVariantMap(book));
+    // If not found by binary search, scan for partial matches. One pass
+    // over the packed keys covers title, author, genre and publisher; the
+    // separator never occurs in a normalized query, so matches cannot
+    // straddle two fields.
+    const QVector<int> matches = scanSearchKeys(searchQuery);
+    results.reserve(matches.size());
+    for (int index : matches) {
+        results.append(bookToVariantMap(m_books.at(index)));
+    }
+
+    return results;
+}
+
+QVector<int> Database::scanSearchKeys(const QString &needle)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Each shard collects its own hits; shards are consecutive ranges, so
+    // appending them in shard order gives catalog order
+    const int shards = SubstringScanner::shardCount(m_books.size());
+    QVector<QVector<int>> hits(shards);
+    const Book *books = m_books.constData();
+    SubstringScanner::forEachShard(m_books.size(), [&](int shard, qsizetype begin, qsizetype end) {
+        QVector<int> &out = hits[shard];
+        for (qsizetype i = begin; i < end; ++i) {
+            if (SubstringScanner::contains(books[i].searchKeys, needle)) {
+                out.append(int(i));
             }
         }
+    });
+
+    QVector<int> matches;
+    for (const QVector<int> &shardHits : hits) {
+        matches += shardHits;
     }
 
+    m_lastScan.shards = shards;
+    m_lastScan.scanned = m_books.size();
+    m_lastScan.matches = matches.size();
+    m_lastScan.nsecs = timer.nsecsElapsed();
+    return matches;
+}
+
+QVariantMap Database::getSearchScanStats() const
+{
+    API_TRACE();
+    QVariantMap stats;
+    stats.insert("kernel", QString::fromLatin1(SubstringScanner::kernelName()));
+    stats.insert("threads", QThreadPool::globalInstance()->maxThreadCount());
+    stats.insert("lastShards", m_lastScan.shards);
+    stats.insert("lastScanned", m_lastScan.scanned);
+    stats.insert("lastMatches", m_lastScan.matches);
+    stats.insert("lastScanMs", m_lastScan.nsecs / 1000000.0);
+    return stats;
+}
+
+QVariantList Database::searchBook(const QString &query)
+{
+    API_TRACE(query);
+    const QString searchQuery = normalizeKey(query);
+    if (searchQuery.isEmpty()) {
+        return getAllBooks();
+    }
+
+    // May sort, which bumps the catalog version, so do it before the lookup
+    ensureSortedForSearch();
+
+    const QString key = QStringLiteral("s:") + searchQuery;
+    if (const QueryResultCache::Entry *entry = m_queryCache.find(key, m_catalogVersion)) {
+        return entry->result;
+    }
+
+    const QVariantList results = computeSearchResults(query);
+    m_queryCache.insert(key, results, m_catalogVersion);
     return results;
 }
 
@@ -664,7 +1728,7 @@ void Database::buildGraph()
 
     // Build adjacency list: Genre -> List of Book IDs
     for (const Book &book : m_books) {
-        QString genre = book.genre.trimmed().toLower();
+        const QString genre = book.genreKey().toString();
         if (!genre.isEmpty()) {
             if (!m_genreGraph.contains(genre)) {
                 m_genreGraph[genre] = QVector<int>();
@@ -676,7 +1740,7 @@ void Database::buildGraph()
     // Also build connections by author for better recommendations
     QMap<QString, QVector<int>> authorGraph;
     for (const Book &book : m_books) {
-        QString author = book.author.trimmed().toLower();
+        const QString author = book.authorKey().toString();
         if (!author.isEmpty()) {
             authorGraph[author].append(book.id);
         }
@@ -686,7 +1750,7 @@ void Database::buildGraph()
     // You can use this for more diverse recommendations
 }
 
-QVariantList Database::getRelatedBooks(int bookId)
+QVariantList Database::computeRelatedBooks(int bookId)
 {
     QVariantList recommendations;
 
@@ -700,8 +1764,8 @@ QVariantList Database::getRelatedBooks(int bookId)
     
     for (const Book &book : m_books) {
         if (book.id == bookId) {
-            bookGenre = book.genre.trimmed().toLower();
-            bookAuthor = book.author.trimmed().toLower();
+            bookGenre = book.genreKey().toString();
+            bookAuthor = book.authorKey().toString();
             break;
         }
     }
@@ -723,7 +1787,7 @@ QVariantList Database::getRelatedBooks(int bookId)
             for (const Book &book : m_books) {
                 if (book.id == id) {
                     // Prioritize books with same author for better recommendations
-                    bool sameAuthor = book.author.trimmed().compare(bookAuthor, Qt::CaseInsensitive) == 0;
+                    bool sameAuthor = book.authorKey() == bookAuthor;
                     QVariantMap bookMap = bookToVariantMap(book);
                     bookMap.insert("sameAuthor", sameAuthor);
                     recommendations.append(bookMap);
@@ -741,91 +1805,1107 @@ QVariantList Database::getRelatedBooks(int bookId)
     return recommendations;
 }
 
+QVariantList Database::getRelatedBooks(int bookId)
+{
+    API_TRACE(bookId);
+    // Inside a batch the graph is stale until commit, so bypass the cache
+    if (m_batchActive) {
+        return computeRelatedBooks(bookId);
+    }
+
+    const QString key = QStringLiteral("r:") + QString::number(bookId);
+    if (const QueryResultCache::Entry *entry = m_queryCache.find(key, m_catalogVersion)) {
+        return entry->result;
+    }
+
+    QString genre;
+    for (const Book &book : m_books) {
+        if (book.id == bookId) {
+            genre = book.genreKey().toString();
+            break;
+        }
+    }
+
+    const QVariantList results = computeRelatedBooks(bookId);
+    m_queryCache.insert(key, results, m_catalogVersion, genre);
+    return results;
+}
+
 // ============================================================================
-// Helper Methods
+// Ledger (pemasukan / pengeluaran)
 // ============================================================================
 
-QVariantMap Database::getUserByUsername(const QString &username)
+int Database::insertPemasukanWithReturn(const QString &nominal,
+                                        const QString &keterangan,
+                                        const QString &tanggal,
+                                        const QString &jam,
+                                        int purchaseId)
 {
-    QVariantMap user;
+    API_TRACE(nominal, keterangan, tanggal, jam, purchaseId);
+    return insertLedgerEntry("pemasukan", nominal, keterangan, tanggal, jam, purchaseId);
+}
+
+int Database::insertPengeluaranWithReturn(const QString &nominal,
+                                          const QString &keterangan,
+                                          const QString &tanggal,
+                                          const QString &jam)
+{
+    API_TRACE(nominal, keterangan, tanggal, jam);
+    return insertLedgerEntry("pengeluaran", nominal, keterangan, tanggal, jam, 0);
+}
+
+int Database::insertLedgerEntry(const QString &kind,
+                                const QString &nominal,
+                                const QString &keterangan,
+                                const QString &tanggal,
+                                const QString &jam,
+                                int purchaseId)
+{
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return -1;
+    }
+
+    const qint64 amountMinor = LedgerAnalytics::parseAmountMinor(nominal);
+    const QDate entryDate = LedgerAnalytics::parseDate(tanggal);
+
+    // The row and its rollups commit together; an open batch already
+    // provides the transaction
+    const bool ownTransaction = !m_batchActive;
+    if (ownTransaction && !db.transaction()) {
+        qDebug() << "Error starting ledger transaction:" << db.lastError().text();
+        return -1;
+    }
 
     QSqlQuery query(db);
-    query.prepare("SELECT id, username, password_hash, full_name FROM users WHERE username = ?");
-    query.addBindValue(username);
+    if (kind == QLatin1String("pemasukan")) {
+        query.prepare("INSERT INTO pemasukan (user_id, nominal, keterangan, tanggal, jam, purchase_id, amount_minor, entry_date)"
+                      " VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    } else {
+        query.prepare("INSERT INTO pengeluaran (user_id, nominal, keterangan, tanggal, jam, amount_minor, entry_date)"
+                      " VALUES (?, ?, ?, ?, ?, ?, ?)");
+    }
+    query.addBindValue(currentUserId);
+    query.addBindValue(nominal);
+    query.addBindValue(keterangan);
+    query.addBindValue(tanggal);
+    query.addBindValue(jam);
+    if (kind == QLatin1String("pemasukan")) {
+        query.addBindValue(purchaseId > 0 ? QVariant(purchaseId) : QVariant());
+    }
+    query.addBindValue(amountMinor);
+    query.addBindValue(entryDate.isValid() ? QVariant(entryDate.toString(Qt::ISODate)) : QVariant());
 
-    if (query.exec() && query.next()) {
-        user.insert("id", query.value("id"));
-        user.insert("username", query.value("username"));
-        user.insert("password_hash", query.value("password_hash"));
-        user.insert("full_name", query.value("full_name"));
+    if (!query.exec() || !LedgerAnalytics::recordEntry(db, currentUserId, kind, amountMinor, entryDate)) {
+        qDebug() << "Error inserting" << kind << "entry:" << query.lastError().text();
+        if (ownTransaction) {
+            db.rollback();
+        }
+        return -1;
     }
 
-    return user;
+    const int id = query.lastInsertId().toInt();
+
+    if (ownTransaction && !db.commit()) {
+        qDebug() << "Error committing" << kind << "entry:" << db.lastError().text();
+        db.rollback();
+        return -1;
+    }
+
+    return id;
 }
 
-QString Database::hashPassword(const QString &password)
+double Database::getTotalPemasukan()
 {
-    return QString(QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha256).toHex());
+    API_TRACE();
+    if (!isUserLoggedIn()) {
+        return 0.0;
+    }
+    return LedgerAnalytics::total(db, currentUserId, "pemasukan") / 100.0;
 }
 
-bool Database::verifyPassword(const QString &password, const QString &hashedPassword)
+double Database::getTotalPengeluaran()
 {
-    return hashPassword(password) == hashedPassword;
+    API_TRACE();
+    if (!isUserLoggedIn()) {
+        return 0.0;
+    }
+    return LedgerAnalytics::total(db, currentUserId, "pengeluaran") / 100.0;
 }
 
-QVariantMap Database::bookToVariantMap(const Book &book) const
+QString Database::calculateRevenueChange()
 {
-    QVariantMap map;
-    map.insert("id", book.id);
-    map.insert("title", book.title);
-    map.insert("author", book.author);
-    map.insert("genre", book.genre);
-    map.insert("publisher", book.publisher);
-    map.insert("year", book.year);
-    map.insert("copies", book.copies);
-    map.insert("image_path", book.image_path);
-    return map;
+    API_TRACE();
+    return weeklyChange("pemasukan");
 }
 
-QVariantList Database::booksToVariantList(const QVector<Book> &list) const
+QString Database::calculateExpenseChange()
 {
-    QVariantList result;
-    for (const Book &book : list) {
-        result.append(bookToVariantMap(book));
+    API_TRACE();
+    return weeklyChange("pengeluaran");
+}
+
+QString Database::weeklyChange(const QString &kind)
+{
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return "0%";
+    }
+
+    // Last seven days against the seven before them
+    const QDate today = QDate::currentDate();
+    const qint64 current = LedgerAnalytics::sumBetween(db, currentUserId, kind, today.addDays(-7), today);
+    const qint64 previous = LedgerAnalytics::sumBetween(db, currentUserId, kind, today.addDays(-14), today.addDays(-8));
+
+    return LedgerAnalytics::formatChange(current, previous);
+}
+
+QVariantMap Database::comparePeriods(const QString &kind,
+                                     const QString &currentFrom,
+                                     const QString &currentTo,
+                                     const QString &previousFrom,
+                                     const QString &previousTo)
+{
+    API_TRACE(kind, currentFrom, currentTo, previousFrom, previousTo);
+    QVariantMap result;
+    if (!isUserLoggedIn() || !LedgerAnalytics::isValidKind(kind)) {
+        qDebug() << "Error: Invalid ledger comparison for" << kind;
+        return result;
     }
+
+    const qint64 current = LedgerAnalytics::sumBetween(db, currentUserId, kind,
+                                                       LedgerAnalytics::parseDate(currentFrom),
+                                                       LedgerAnalytics::parseDate(currentTo));
+    const qint64 previous = LedgerAnalytics::sumBetween(db, currentUserId, kind,
+                                                        LedgerAnalytics::parseDate(previousFrom),
+                                                        LedgerAnalytics::parseDate(previousTo));
+
+    result.insert("current", current / 100.0);
+    result.insert("previous", previous / 100.0);
+    result.insert("change", LedgerAnalytics::formatChange(current, previous));
     return result;
 }
 
-Database::Book Database::variantMapToBook(const QVariantMap &map) const
+QVariantList Database::getLedgerTrend(const QString &kind,
+                                      const QString &granularity,
+                                      const QString &from,
+                                      const QString &to)
 {
-    Book book;
-    book.id = map.value("id").toInt();
-    book.title = map.value("title").toString();
-    book.author = map.value("author").toString();
-    book.genre = map.value("genre").toString();
-    book.publisher = map.value("publisher").toString();
-    book.year = map.value("year").toInt();
-    book.copies = map.value("copies").toInt();
-    book.image_path = map.value("image_path").toString();
-    return book;
+    API_TRACE(kind, granularity, from, to);
+    if (!isUserLoggedIn() || !LedgerAnalytics::isValidKind(kind)) {
+        qDebug() << "Error: Invalid ledger trend request for" << kind;
+        return QVariantList();
+    }
+
+    return LedgerAnalytics::series(db, currentUserId, kind, granularity,
+                                   LedgerAnalytics::parseDate(from),
+                                   LedgerAnalytics::parseDate(to));
 }
 
 // ============================================================================
-// Statistics Methods
+// Stock
 // ============================================================================
 
-QString Database::getTopGenre()
+int Database::recordStockMovement(int productId, int quantity, const QString &movementType, const QString &description)
 {
-    if (m_books.isEmpty()) {
-        return "-";
+    API_TRACE(productId, quantity, movementType, description);
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return -1;
     }
-    
-    // Count books per genre
-    QMap<QString, int> genreCount;
-    for (const Book &book : m_books) {
-        QString genre = book.genre.trimmed();
-        if (!genre.isEmpty()) {
-            genreCount[genre]++;
+
+    if (quantity == 0) {
+        return StockLedger::currentLevel(db, currentUserId, productId);
+    }
+
+    // Level and ledger row commit together; an open batch already
+    // provides the transaction
+    const bool ownTransaction = !m_batchActive;
+    if (ownTransaction && !db.transaction()) {
+        qDebug() << "Error starting stock transaction:" << db.lastError().text();
+        return -1;
+    }
+
+    const int level = StockLedger::recordMovement(db, currentUserId, productId, quantity, movementType, description);
+    if (level < 0) {
+        if (ownTransaction) {
+            db.rollback();
+        }
+        return -1;
+    }
+
+    if (ownTransaction && !db.commit()) {
+        qDebug() << "Error committing stock movement:" << db.lastError().text();
+        db.rollback();
+        return -1;
+    }
+
+    return level;
+}
+
+bool Database::updateProductStock(int productId, int newStock)
+{
+    API_TRACE(productId, newStock);
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return false;
+    }
+
+    if (newStock < 0) {
+        qDebug() << "Error: Stock cannot be negative";
+        return false;
+    }
+
+    const int current = StockLedger::currentLevel(db, currentUserId, productId);
+    if (current < 0) {
+        qDebug() << "Error: Product not found";
+        return false;
+    }
+
+    // Absolute updates become adjustment movements so history stays replayable
+    return recordStockMovement(productId, newStock - current, "adjustment", QString()) == newStock;
+}
+
+int Database::getStockAt(int productId, const QString &timestamp)
+{
+    API_TRACE(productId, timestamp);
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return -1;
+    }
+
+    QDateTime at = QDateTime::fromString(timestamp, Qt::ISODate);
+    if (!at.isValid()) {
+        at = QDateTime::fromString(timestamp, "yyyy-MM-dd HH:mm:ss");
+    }
+    if (!at.isValid()) {
+        qDebug() << "Error: Invalid timestamp" << timestamp;
+        return -1;
+    }
+
+    return StockLedger::levelAt(db, currentUserId, productId, at);
+}
+
+void Database::checkStockConsistency()
+{
+    API_TRACE();
+    if (!isUserLoggedIn()) {
+        return;
+    }
+
+    StockLedger::startConsistencyCheck(m_stockAuditPool, db.connectionName(), currentUserId,
+                                       this, "onStockConsistencyChecked");
+}
+
+void Database::onStockConsistencyChecked(const QVariantMap &report)
+{
+    if (report.contains("error")) {
+        qWarning() << "Database: Stock consistency check failed:" << report.value("error").toString();
+    } else if (!report.value("mismatches").toList().isEmpty()) {
+        qWarning() << "Database: Stock ledger mismatches:" << report.value("mismatches");
+    }
+
+    emit stockConsistencyChecked(report);
+}
+
+// ============================================================================
+// Purchases
+// ============================================================================
+
+int Database::addPurchaseWithReturn(int productId,
+                                    const QString &customerName,
+                                    int quantity,
+                                    double totalPrice,
+                                    const QString &notes)
+{
+    API_TRACE(productId, customerName, quantity, totalPrice, notes);
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return -1;
+    }
+
+    if (customerName.trimmed().isEmpty() || quantity <= 0) {
+        qDebug() << "Error: Purchase needs a customer name and a positive quantity";
+        return -1;
+    }
+
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO purchases (user_id, product_id, customer_name, quantity, total_price, notes)"
+                  " VALUES (?, ?, ?, ?, ?, ?)");
+    query.addBindValue(currentUserId);
+    query.addBindValue(productId);
+    query.addBindValue(customerName.trimmed());
+    query.addBindValue(quantity);
+    query.addBindValue(totalPrice);
+    query.addBindValue(notes.trimmed());
+
+    if (!query.exec()) {
+        qDebug() << "Error adding purchase:" << query.lastError().text();
+        return -1;
+    }
+
+    const int purchaseId = query.lastInsertId().toInt();
+    if (m_batchActive) {
+        m_batchPurchasesChanged = true;
+    }
+    m_recommender.recordPurchase(purchaseId, customerName, productId);
+    emit purchaseAdded(purchaseId);
+    return purchaseId;
+}
+
+bool Database::updatePurchase(int purchaseId,
+                              const QString &customerName,
+                              int quantity,
+                              double totalPrice,
+                              const QString &notes)
+{
+    API_TRACE(purchaseId, customerName, quantity, totalPrice, notes);
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return false;
+    }
+
+    const QVariantMap before = getPurchase(purchaseId);
+    if (before.isEmpty()) {
+        qDebug() << "Error: Purchase not found";
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.prepare("UPDATE purchases SET customer_name = ?, quantity = ?, total_price = ?, notes = ?"
+                  " WHERE id = ? AND user_id = ?");
+    query.addBindValue(customerName.trimmed());
+    query.addBindValue(quantity);
+    query.addBindValue(totalPrice);
+    query.addBindValue(notes.trimmed());
+    query.addBindValue(purchaseId);
+    query.addBindValue(currentUserId);
+
+    if (!query.exec()) {
+        qDebug() << "Error updating purchase:" << query.lastError().text();
+        return false;
+    }
+
+    if (m_batchActive) {
+        m_batchPurchasesChanged = true;
+    }
+
+    // A changed customer moves the purchase to another basket
+    if (customerName.trimmed() != before.value("customer_name").toString()) {
+        const int productId = before.value("product_id").toInt();
+        m_recommender.removePurchase(before.value("customer_name").toString(), productId);
+        m_recommender.recordPurchase(purchaseId, customerName, productId);
+    }
+
+    emit purchaseUpdated(before, getPurchase(purchaseId));
+    return true;
+}
+
+bool Database::deletePurchase(int purchaseId)
+{
+    API_TRACE(purchaseId);
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return false;
+    }
+
+    const QVariantMap before = getPurchase(purchaseId);
+    if (before.isEmpty()) {
+        qDebug() << "Error: Purchase not found";
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM purchases WHERE id = ? AND user_id = ?");
+    query.addBindValue(purchaseId);
+    query.addBindValue(currentUserId);
+
+    if (!query.exec()) {
+        qDebug() << "Error deleting purchase:" << query.lastError().text();
+        return false;
+    }
+
+    if (m_batchActive) {
+        m_batchPurchasesChanged = true;
+    }
+    m_recommender.removePurchase(before.value("customer_name").toString(), before.value("product_id").toInt());
+    emit purchaseRemoved(before);
+    return true;
+}
+
+bool Database::linkPurchaseToIncome(int purchaseId, int incomeId)
+{
+    API_TRACE(purchaseId, incomeId);
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return false;
+    }
+
+    const QVariantMap before = getPurchase(purchaseId);
+    if (before.isEmpty()) {
+        qDebug() << "Error: Purchase not found";
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.prepare("UPDATE purchases SET income_id = ? WHERE id = ? AND user_id = ?");
+    query.addBindValue(incomeId);
+    query.addBindValue(purchaseId);
+    query.addBindValue(currentUserId);
+
+    if (!query.exec()) {
+        qDebug() << "Error linking purchase to income:" << query.lastError().text();
+        return false;
+    }
+
+    if (m_batchActive) {
+        m_batchPurchasesChanged = true;
+    }
+    emit purchaseUpdated(before, getPurchase(purchaseId));
+    return true;
+}
+
+QVariantMap Database::getPurchase(int purchaseId)
+{
+    API_TRACE(purchaseId);
+    QVariantMap purchase;
+    if (!isUserLoggedIn()) {
+        return purchase;
+    }
+
+    QSqlQuery query(db);
+    query.prepare("SELECT pu.id, pu.product_id, p.name, pu.customer_name, pu.quantity, pu.total_price, pu.notes,"
+                  " pu.income_id, pu.created_at"
+                  " FROM purchases pu LEFT JOIN products p ON p.id = pu.product_id"
+                  " WHERE pu.id = ? AND pu.user_id = ?");
+    query.addBindValue(purchaseId);
+    query.addBindValue(currentUserId);
+
+    if (!query.exec() || !query.next()) {
+        return purchase;
+    }
+
+    purchase.insert("id", query.value(0).toInt());
+    purchase.insert("product_id", query.value(1).toInt());
+    purchase.insert("product_name", query.value(2).toString());
+    purchase.insert("customer_name", query.value(3).toString());
+    purchase.insert("quantity", query.value(4).toInt());
+    purchase.insert("total_price", query.value(5).toDouble());
+    purchase.insert("notes", query.value(6).toString());
+    purchase.insert("income_id", query.value(7));
+    purchase.insert("created_at", query.value(8).toString());
+    return purchase;
+}
+
+QVariantList Database::getRelatedProducts(int productId, int limit)
+{
+    API_TRACE(productId, limit);
+    QVariantList recommendations;
+    if (!isUserLoggedIn() || productId <= 0) {
+        return recommendations;
+    }
+
+    const QVector<CoOccurrenceRecommender::Neighbor> neighbors = m_recommender.related(productId, limit);
+    if (neighbors.isEmpty()) {
+        return recommendations;
+    }
+
+    // One lookup for all neighbours; products deleted since are skipped
+    QString placeholders;
+    for (int i = 0; i < neighbors.size(); ++i) {
+        placeholders += i == 0 ? QStringLiteral("?") : QStringLiteral(", ?");
+    }
+
+    QSqlQuery query(db);
+    query.prepare("SELECT id, name, category, price, stock, image_path FROM products"
+                  " WHERE user_id = ? AND id IN (" + placeholders + ")");
+    query.addBindValue(currentUserId);
+    for (const CoOccurrenceRecommender::Neighbor &neighbor : neighbors) {
+        query.addBindValue(neighbor.productId);
+    }
+
+    if (!query.exec()) {
+        qDebug() << "Error loading related products:" << query.lastError().text();
+        return recommendations;
+    }
+
+    QHash<int, QVariantMap> products;
+    while (query.next()) {
+        QVariantMap product;
+        product.insert("id", query.value(0).toInt());
+        product.insert("name", query.value(1).toString());
+        product.insert("category", query.value(2).toString());
+        product.insert("price", query.value(3).toDouble());
+        product.insert("stock", query.value(4).toInt());
+        product.insert("image_path", query.value(5).toString());
+        products.insert(query.value(0).toInt(), product);
+    }
+
+    for (const CoOccurrenceRecommender::Neighbor &neighbor : neighbors) {
+        auto product = products.constFind(neighbor.productId);
+        if (product == products.constEnd()) {
+            continue;
+        }
+        QVariantMap entry = *product;
+        entry.insert("score", double(neighbor.score));
+        entry.insert("sharedCustomers", neighbor.sharedCustomers);
+        recommendations.append(entry);
+    }
+
+    return recommendations;
+}
+
+QVariantMap Database::getRecommenderStats() const
+{
+    API_TRACE();
+    return m_recommender.stats();
+}
+
+// ============================================================================
+// Circulation
+// ============================================================================
+
+int Database::checkoutBook(int bookId, const QString &borrower, int loanDays)
+{
+    API_TRACE(bookId, borrower, loanDays);
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return -1;
+    }
+
+    const QString name = borrower.trimmed();
+    if (name.isEmpty() || loanDays <= 0) {
+        qDebug() << "Error: A loan needs a borrower and a positive loan period";
+        return -1;
+    }
+
+    // Copy count and loan row commit together; an open batch already
+    // provides the transaction
+    const bool ownTransaction = !m_batchActive;
+    if (ownTransaction && !db.transaction()) {
+        qDebug() << "Error starting checkout:" << db.lastError().text();
+        return -1;
+    }
+
+    const Circulation::Result loan = Circulation::checkout(db, currentUserId, bookId, name,
+                                                           QDateTime::currentDateTimeUtc().addDays(loanDays));
+    if (!loan.isValid()) {
+        if (ownTransaction) {
+            db.rollback();
+        }
+        qDebug() << "Error: No copy of book" << bookId << "is available";
+        return -1;
+    }
+
+    if (ownTransaction && !db.commit()) {
+        qDebug() << "Error committing checkout:" << db.lastError().text();
+        db.rollback();
+        return -1;
+    }
+
+    setAvailable(bookId, loan.available);
+    m_overdue.add(loan.loanId, bookId, loan.dueAt);
+    return loan.loanId;
+}
+
+bool Database::checkinBook(int loanId)
+{
+    API_TRACE(loanId);
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return false;
+    }
+
+    const bool ownTransaction = !m_batchActive;
+    if (ownTransaction && !db.transaction()) {
+        qDebug() << "Error starting checkin:" << db.lastError().text();
+        return false;
+    }
+
+    const Circulation::Result loan = Circulation::checkin(db, currentUserId, loanId);
+    if (!loan.isValid()) {
+        if (ownTransaction) {
+            db.rollback();
+        }
+        qDebug() << "Error: Loan" << loanId << "is not open";
+        return false;
+    }
+
+    if (ownTransaction && !db.commit()) {
+        qDebug() << "Error committing checkin:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    if (loan.available >= 0) {
+        setAvailable(loan.bookId, loan.available);
+    }
+    m_overdue.remove(loanId);
+    return true;
+}
+
+bool Database::renewLoan(int loanId, int loanDays)
+{
+    API_TRACE(loanId, loanDays);
+    if (!isUserLoggedIn()) {
+        qDebug() << "Error: No user logged in";
+        return false;
+    }
+
+    if (loanDays <= 0) {
+        qDebug() << "Error: Invalid loan period";
+        return false;
+    }
+
+    // One statement, so it needs no transaction of its own
+    const Circulation::Result loan = Circulation::renew(db, currentUserId, loanId,
+                                                        QDateTime::currentDateTimeUtc().addDays(loanDays));
+    if (!loan.isValid()) {
+        qDebug() << "Error: Loan" << loanId << "is closed or has no renewals left";
+        return false;
+    }
+
+    m_overdue.renew(loanId, loan.dueAt);
+    return true;
+}
+
+QVariantList Database::getOpenLoans(int bookId)
+{
+    API_TRACE(bookId);
+    if (!isUserLoggedIn()) {
+        return QVariantList();
+    }
+    return Circulation::openLoans(db, currentUserId, bookId);
+}
+
+int Database::getAvailableCopies(int bookId)
+{
+    API_TRACE(bookId);
+    const int index = indexOfBook(bookId);
+    return index >= 0 ? m_books.at(index).available : -1;
+}
+
+QVariantMap Database::getLoanCounts() const
+{
+    API_TRACE();
+    return m_overdue.counts();
+}
+
+QVariantList Database::getOverdueLoans()
+{
+    API_TRACE();
+    if (!isUserLoggedIn()) {
+        return QVariantList();
+    }
+
+    const QVector<int> overdue = m_overdue.loansIn(OverdueTracker::State::Overdue);
+    if (overdue.isEmpty()) {
+        return QVariantList();
+    }
+
+    QHash<int, QVariant> loansById;
+    for (const QVariant &loan : Circulation::openLoans(db, currentUserId, 0)) {
+        loansById.insert(loan.toMap().value("id").toInt(), loan);
+    }
+
+    QVariantList loans;
+    loans.reserve(overdue.size());
+    for (int loanId : overdue) {
+        const QVariant loan = loansById.value(loanId);
+        if (loan.isValid()) {
+            loans.append(loan);
+        }
+    }
+    return loans;
+}
+
+int Database::indexOfBook(int bookId)
+{
+    // Positions move on sort, insert and delete; a stale entry is caught by
+    // its id check and the whole map is rebuilt once
+    const int cached = m_bookIndex.value(bookId, -1);
+    if (cached >= 0 && cached < m_books.size() && m_books.at(cached).id == bookId) {
+        return cached;
+    }
+
+    m_bookIndex.clear();
+    m_bookIndex.reserve(m_books.size());
+    for (int i = 0; i < m_books.size(); ++i) {
+        m_bookIndex.insert(m_books.at(i).id, i);
+    }
+    return m_bookIndex.value(bookId, -1);
+}
+
+void Database::setAvailable(int bookId, int available)
+{
+    const int index = indexOfBook(bookId);
+    if (index < 0) {
+        return;
+    }
+
+    // Availability feeds no sort key, genre edge or duplicate signature, so
+    // the book is patched in place instead of going through applyBookChange()
+    Book &book = m_books[index];
+    book.available = available;
+    invalidateQueryResults(&book, &book);
+
+    // Inside a batch the book is published and reported with the commit,
+    // or restored silently by a rollback
+    if (m_batchActive) {
+        if (!m_batchAdded.contains(bookId)) {
+            m_batchUpdated.insert(bookId);
+        }
+        return;
+    }
+    publishCatalogChange(BookChange::Updated, bookId);
+    emit availabilityChanged(bookId, available);
+}
+
+// ============================================================================
+// Duplicate Detection
+// ============================================================================
+
+DuplicateDetector::Signature Database::bookSignature(const Book &book)
+{
+    return DuplicateDetector::signature(book.titleKey(), book.authorKey(), book.publisherKey());
+}
+
+void Database::ensureDuplicateIndex()
+{
+    if (!m_duplicatesStale) {
+        return;
+    }
+
+    m_duplicates.clear();
+    for (const Book &book : std::as_const(m_books)) {
+        m_duplicates.insert(book.id, bookSignature(book));
+    }
+    m_duplicatesStale = false;
+}
+
+QVariantList Database::duplicateCandidatesToVariantList(const QVector<DuplicateDetector::Candidate> &candidates) const
+{
+    QVariantList result;
+    for (const DuplicateDetector::Candidate &candidate : candidates) {
+        for (const Book &book : m_books) {
+            if (book.id == candidate.id) {
+                QVariantMap bookMap = bookToVariantMap(book);
+                bookMap.insert("similarity", candidate.similarity);
+                result.append(bookMap);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+QVariantList Database::findPossibleDuplicates(const QString &title, const QString &author, const QString &publisher)
+{
+    API_TRACE(title, author, publisher);
+    if (!isUserLoggedIn() || title.trimmed().isEmpty()) {
+        return QVariantList();
+    }
+
+    ensureDuplicateIndex();
+    const DuplicateDetector::Signature signature = DuplicateDetector::signature(
+        normalizeKey(title), normalizeKey(author), normalizeKey(publisher));
+    return duplicateCandidatesToVariantList(m_duplicates.candidates(signature));
+}
+
+QVariantList Database::findDuplicateClusters()
+{
+    API_TRACE();
+    QVariantList clusters;
+    if (!isUserLoggedIn()) {
+        return clusters;
+    }
+
+    ensureDuplicateIndex();
+    const QVector<QVector<int>> groups = m_duplicates.clusters();
+    if (groups.isEmpty()) {
+        return clusters;
+    }
+
+    QHash<int, const Book *> byId;
+    byId.reserve(m_books.size());
+    for (const Book &book : std::as_const(m_books)) {
+        byId.insert(book.id, &book);
+    }
+
+    for (const QVector<int> &group : groups) {
+        QVariantList members;
+        for (int id : group) {
+            if (const Book *book = byId.value(id)) {
+                members.append(bookToVariantMap(*book));
+            }
+        }
+        if (members.size() > 1) {
+            clusters.append(QVariant(members));
+        }
+    }
+    return clusters;
+}
+
+// ============================================================================
+// Query Result Cache
+// ============================================================================
+
+void Database::invalidateQueryResults(const Book *before, const Book *after)
+{
+    const QString beforeGenre = before ? before->genreKey().toString() : QString();
+    const QString afterGenre = after ? after->genreKey().toString() : QString();
+    const int bookId = before ? before->id : (after ? after->id : 0);
+    const QString relatedKey = QStringLiteral("r:") + QString::number(bookId);
+
+    // A search result changes only if the book matched the query before or
+    // after the change; related lists change only for the genres involved
+    m_queryCache.removeIf([&](const QString &key, const QueryResultCache::Entry &entry) {
+        if (key.startsWith(QLatin1String("s:"))) {
+            const QStringView query = QStringView(key).mid(2);
+            return (before && SubstringScanner::contains(before->searchKeys, query))
+                || (after && SubstringScanner::contains(after->searchKeys, query));
+        }
+
+        return key == relatedKey
+            || (!entry.tag.isEmpty() && (entry.tag == beforeGenre || entry.tag == afterGenre));
+    });
+}
+
+void Database::resetQueryResults()
+{
+    ++m_catalogVersion;
+    m_queryCache.clear();
+}
+
+QVariantMap Database::getQueryCacheStats() const
+{
+    API_TRACE();
+    QVariantMap stats = m_queryCache.stats();
+    stats.insert("catalogVersion", m_catalogVersion);
+    return stats;
+}
+
+// ============================================================================
+// Search Key Normalization
+// ============================================================================
+
+QString Database::normalizeKey(const QString &text)
+{
+    // Decompose so accents become separate combining marks, drop the marks,
+    // collapse whitespace runs and case-fold: "  Café  Müller" -> "cafe muller"
+    const QString decomposed = text.normalized(QString::NormalizationForm_KD);
+
+    QString key;
+    key.reserve(decomposed.size());
+    bool pendingSpace = false;
+
+    for (const QChar ch : decomposed) {
+        if (ch.category() == QChar::Mark_NonSpacing) {
+            continue;
+        }
+        if (ch.isSpace() || ch == kSearchKeySeparator) {
+            pendingSpace = !key.isEmpty();
+            continue;
+        }
+        if (pendingSpace) {
+            key.append(QLatin1Char(' '));
+            pendingSpace = false;
+        }
+        key.append(ch);
+    }
+
+    return key.toCaseFolded();
+}
+
+void Database::updateSearchKeys(Book &book, CatalogArena &arena)
+{
+    const QString fields[4] = {
+        normalizeKey(book.title).left(Book::kMaxKeyLength),
+        normalizeKey(book.author).left(Book::kMaxKeyLength),
+        normalizeKey(book.genre).left(Book::kMaxKeyLength),
+        normalizeKey(book.publisher).left(Book::kMaxKeyLength)
+    };
+
+    // Packed as title␟author␟genre␟publisher in a reused scratch buffer,
+    // then copied once into the arena
+    thread_local QString packed;
+    packed.resize(0);
+    for (int i = 0; i < 4; ++i) {
+        if (i > 0) {
+            packed.append(kSearchKeySeparator);
+        }
+        packed.append(fields[i]);
+        book.keyEnds[i] = static_cast<quint16>(packed.size());
+    }
+    book.searchKeys = arena.intern(packed);
+}
+
+void Database::assignBookStrings(Book &book, QStringView title, QStringView author,
+                                 QStringView genre, QStringView publisher, QStringView imagePath)
+{
+    CatalogArena &arena = *m_arena;
+    book.title = arena.intern(title);
+    book.author = arena.intern(author);
+    book.genre = arena.intern(genre);
+    book.publisher = arena.intern(publisher);
+    book.image_path = arena.intern(imagePath);
+    updateSearchKeys(book, arena);
+}
+
+void Database::retireBookStrings(const Book &book)
+{
+    m_arena->retire(book.title);
+    m_arena->retire(book.author);
+    m_arena->retire(book.genre);
+    m_arena->retire(book.publisher);
+    m_arena->retire(book.image_path);
+    m_arena->retire(book.searchKeys);
+}
+
+void Database::updateCatalogPeak()
+{
+    const qint64 bytes = qint64(m_books.capacity()) * qint64(sizeof(Book)) + m_arena->reservedBytes();
+    m_catalogPeakBytes = qMax(m_catalogPeakBytes, bytes);
+}
+
+QVariantMap Database::getMemoryReport() const
+{
+    API_TRACE();
+    const qint64 books = m_books.size();
+    const qint64 recordBytes = qint64(m_books.capacity()) * qint64(sizeof(Book));
+    const qint64 recordSlack = qint64(m_books.capacity() - m_books.size()) * qint64(sizeof(Book));
+    const qint64 totalBytes = recordBytes + m_arena->reservedBytes();
+    const qint64 wasted = recordSlack + (m_arena->reservedBytes() - m_arena->usedBytes())
+        + m_arena->deadBytes();
+
+    QVariantMap report = m_arena->report();
+    report.insert("books", books);
+    report.insert("recordBytes", recordBytes);
+    report.insert("recordSlackBytes", recordSlack);
+    report.insert("totalBytes", totalBytes);
+    report.insert("bytesPerBook", books > 0 ? double(totalBytes) / books : 0.0);
+    report.insert("fragmentation", totalBytes > 0 ? double(wasted) / totalBytes : 0.0);
+    report.insert("peakBytes", qMax(m_catalogPeakBytes, totalBytes));
+    return report;
+}
+
+int Database::compareKeys(QStringView left, QStringView right) const
+{
+    return m_collator.compare(left, right);
+}
+
+// ============================================================================
+// Helper Methods
+// ============================================================================
+
+QVariantMap Database::getUserByUsername(const QString &username)
+{
+    QVariantMap user;
+
+    QSqlQuery query(db);
+    query.prepare(kSelectUserSql);
+    query.addBindValue(username);
+
+    if (query.exec() && query.next()) {
+        user.insert("id", query.value("id"));
+        user.insert("username", query.value("username"));
+        user.insert("password_hash", query.value("password_hash"));
+        user.insert("full_name", query.value("full_name"));
+    }
+
+    return user;
+}
+
+void Database::collectThumbnailGarbage()
+{
+    // Restarted on every deletion, so a run of deletes collects once
+    m_thumbnailGcTimer.start();
+}
+
+void Database::startThumbnailGarbageCollection()
+{
+    if (!db.isOpen()) {
+        return;
+    }
+    // The worker's connection cannot see covers of uncommitted additions
+    if (m_batchActive) {
+        m_thumbnailGcTimer.start();
+        return;
+    }
+    QThreadPool::globalInstance()->start(new CoverPathsJob(m_connectionName, ThumbnailCache::instance()));
+}
+
+QString Database::hashPassword(const QString &password)
+{
+    return QString(QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha256).toHex());
+}
+
+bool Database::verifyPassword(const QString &password, const QString &hashedPassword)
+{
+    return hashPassword(password) == hashedPassword;
+}
+
+QVariantMap Database::bookToVariantMap(const Book &book) const
+{
+    // Maps outlive the catalog arena (QML, query cache), so they own their text
+    QVariantMap map;
+    map.insert("id", book.id);
+    map.insert("title", CatalogArena::detach(book.title));
+    map.insert("author", CatalogArena::detach(book.author));
+    map.insert("genre", CatalogArena::detach(book.genre));
+    map.insert("publisher", CatalogArena::detach(book.publisher));
+    map.insert("year", book.year);
+    map.insert("copies", book.copies);
+    map.insert("available", book.available);
+    map.insert("image_path", CatalogArena::detach(book.image_path));
+    return map;
+}
+
+QVariantList Database::booksToVariantList(const QVector<Book> &list) const
+{
+    QVariantList result;
+    for (const Book &book : list) {
+        result.append(bookToVariantMap(book));
+    }
+    return result;
+}
+
+Database::Book Database::variantMapToBook(const QVariantMap &map) const
+{
+    Book book;
+    book.id = map.value("id").toInt();
+    book.title = map.value("title").toString();
+    book.author = map.value("author").toString();
+    book.genre = map.value("genre").toString();
+    book.publisher = map.value("publisher").toString();
+    book.year = map.value("year").toInt();
+    book.copies = map.value("copies").toInt();
+    book.available = map.value("available", book.copies).toInt();
+    book.image_path = map.value("image_path").toString();
+    return book;
+}
+
+// ============================================================================
+// Statistics Methods
+// ============================================================================
+
+QString Database::getTopGenre()
+{
+    API_TRACE();
+    if (m_books.isEmpty()) {
+        return "-";
+    }
+    
+    // Count books per normalized genre, remembering the first spelling seen
+    QMap<QString, int> genreCount;
+    QMap<QString, QString> genreLabel;
+    for (const Book &book : m_books) {
+        const QString genre = book.genreKey().toString();
+        if (!genre.isEmpty()) {
+            genreCount[genre]++;
+            if (!genreLabel.contains(genre)) {
+                genreLabel.insert(genre, CatalogArena::detach(book.genre.trimmed()));
+            }
         }
     }
     
@@ -839,7 +2919,7 @@ QString Database::getTopGenre()
     for (auto it = genreCount.constBegin(); it != genreCount.constEnd(); ++it) {
         if (it.value() > maxCount) {
             maxCount = it.value();
-            topGenre = it.key();
+            topGenre = genreLabel.value(it.key());
         }
     }
     
@@ -848,6 +2928,7 @@ QString Database::getTopGenre()
 
 QString Database::getLastAddedTitle()
 {
+    API_TRACE();
     if (m_books.isEmpty()) {
         return "-";
     }
@@ -858,7 +2939,7 @@ QString Database::getLastAddedTitle()
     for (const Book &book : m_books) {
         if (book.id > maxId) {
             maxId = book.id;
-            lastTitle = book.title;
+            lastTitle = CatalogArena::detach(book.title);
         }
     }
     
@@ -2,6 +2,7 @@
 #define DATABASE_H
 
 #include <QObject>
+#include <QCollator>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
@@ -10,8 +11,22 @@
 #include <QVariantMap>
 #include <QVector>
 #include <QMap>
+#include <QSet>
 #include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
 #include <algorithm>
+#include <memory>
+#include "CatalogArena.h"
+#include "ChunkedVector.h"
+#include "CoOccurrenceRecommender.h"
+#include "DuplicateDetector.h"
+#include "OverdueTracker.h"
+#include "QueryResultCache.h"
+
+struct CatalogSnapshot;
+class UserCatalogCache;
 
 class Database : public QObject
 {
@@ -22,6 +37,8 @@ public:
     ~Database();
 
     // ========== Data Structure ==========
+    // Text fields of books in m_books are interned in the catalog arena and
+    // only valid while it lives; see CatalogArena.
     struct Book {
         int id = 0;
         QString title;
@@ -30,14 +47,40 @@ public:
         QString publisher;
         int year = 0;
         int copies = 0;
+        int available = 0;   // copies minus open loans
         QString image_path;
-        
-        // For graph connections
-        QVector<int> relatedBooks;
+
+        // Normalized search keys (trimmed, case-folded, diacritics stripped),
+        // packed into one buffer as title␟author␟genre␟publisher.
+        // keyEnds[i] is the end offset of field i inside searchKeys.
+        static constexpr int kMaxKeyLength = 4096;
+        QString searchKeys;
+        quint16 keyEnds[4] = { 0, 0, 0, 0 };
+
+        QStringView titleKey() const { return keyField(0); }
+        QStringView authorKey() const { return keyField(1); }
+        QStringView genreKey() const { return keyField(2); }
+        QStringView publisherKey() const { return keyField(3); }
+
+        QStringView keyField(int i) const
+        {
+            const int begin = i == 0 ? 0 : keyEnds[i - 1] + 1;
+            return QStringView(searchKeys).mid(begin, qMax(0, keyEnds[i] - begin));
+        }
     };
 
     // ========== Initialization ==========
     Q_INVOKABLE bool initDatabase();
+    Q_INVOKABLE int schemaVersion() const;
+
+    // Database file and connection name for initDatabase(); defaults to
+    // perpustakaan.db on the default connection. A named connection is
+    // removed again when this instance is destroyed.
+    void setDatabaseLocation(const QString &filePath, const QString &connectionName);
+
+    // Runs EXPLAIN QUERY PLAN on every hot statement and fails on a full
+    // table scan. Also enforced at startup when SIGMATERIAL_VERIFY_QUERY_PLANS is set.
+    Q_INVOKABLE bool verifyQueryPlans();
 
     // ========== User Management ==========
     Q_INVOKABLE bool createUser(const QString &username, const QString &password, const QString &fullName = QString());
@@ -48,6 +91,12 @@ public:
     Q_INVOKABLE QString getCurrentUsername() const;
     Q_INVOKABLE bool changePassword(const QString &currentPassword, const QString &newPassword);
 
+    // Catalogs of logged-out users are kept for fast account switching,
+    // within a memory budget and until idle for idleMinutes (0 disables)
+    Q_INVOKABLE void setCatalogCacheLimits(int budgetMegabytes, int idleMinutes);
+    // { users, bytes, budgetBytes, idleSeconds, hits, misses, stale, purged }
+    Q_INVOKABLE QVariantMap getCatalogCacheStats() const;
+
     // ========== Core Book Management (with SQL sync) ==========
     Q_INVOKABLE void loadBooks();
     Q_INVOKABLE QVariantList getAllBooks();
@@ -68,10 +117,40 @@ public:
                                 const QString &image_path);
     Q_INVOKABLE bool deleteBook(int id);
 
+    // ========== Batch Sessions ==========
+    // Mutations between beginBatch() and commitBatch() share one SQL
+    // transaction; the graph rebuild and change signals happen once at commit.
+    Q_INVOKABLE bool beginBatch();
+    Q_INVOKABLE bool commitBatch();
+    Q_INVOKABLE bool rollbackBatch();
+    Q_INVOKABLE bool isBatchActive() const;
+
     // ========== Algorithms (In-Memory) ==========
     Q_INVOKABLE void sortBooks(const QString &criteria);
     Q_INVOKABLE QVariantList searchBook(const QString &query);
     Q_INVOKABLE QVariantList getRelatedBooks(int bookId);
+
+    // { entries, bytes, hits, misses, hitRate, catalogVersion } of the
+    // searchBook / getRelatedBooks result cache
+    Q_INVOKABLE QVariantMap getQueryCacheStats() const;
+
+    // { kernel, threads, lastShards, lastScanned, lastMatches, lastScanMs }
+    // of the substring scan behind searchBook's partial matches
+    Q_INVOKABLE QVariantMap getSearchScanStats() const;
+
+    // ========== Duplicate Detection ==========
+    // Existing books that look like the given one (MinHash/LSH over the
+    // title, confirmed by author and publisher), most similar first, each
+    // with "similarity" 0..1
+    Q_INVOKABLE QVariantList findPossibleDuplicates(const QString &title, const QString &author,
+                                                    const QString &publisher);
+    // Groups of likely duplicates across the catalog, each a list of books
+    Q_INVOKABLE QVariantList findDuplicateClusters();
+
+    // { books, recordBytes, recordSlackBytes, blocks, reservedBytes,
+    //   usedBytes, deadBytes, slackBytes, totalBytes, bytesPerBook,
+    //   fragmentation, peakBytes } of the in-memory catalog
+    Q_INVOKABLE QVariantMap getMemoryReport() const;
     
     // ========== Statistics ==========
     Q_INVOKABLE QString getTopGenre();
@@ -81,18 +160,155 @@ public:
     Q_INVOKABLE bool isSortedByTitle() const;
     Q_INVOKABLE bool isSortedByYear() const;
 
+    // ========== Ledger ==========
+    // Inserts return the new row id, or -1 on failure
+    Q_INVOKABLE int insertPemasukanWithReturn(const QString &nominal,
+                                              const QString &keterangan,
+                                              const QString &tanggal,
+                                              const QString &jam,
+                                              int purchaseId = 0);
+    Q_INVOKABLE int insertPengeluaranWithReturn(const QString &nominal,
+                                                const QString &keterangan,
+                                                const QString &tanggal,
+                                                const QString &jam);
+    Q_INVOKABLE double getTotalPemasukan();
+    Q_INVOKABLE double getTotalPengeluaran();
+    Q_INVOKABLE QString calculateRevenueChange();
+    Q_INVOKABLE QString calculateExpenseChange();
+
+    // kind is "pemasukan" or "pengeluaran"; dates in any format tanggal uses
+    Q_INVOKABLE QVariantMap comparePeriods(const QString &kind,
+                                           const QString &currentFrom,
+                                           const QString &currentTo,
+                                           const QString &previousFrom,
+                                           const QString &previousTo);
+    // granularity is "day" or "week"
+    Q_INVOKABLE QVariantList getLedgerTrend(const QString &kind,
+                                            const QString &granularity,
+                                            const QString &from,
+                                            const QString &to);
+
+    // ========== Stock ==========
+    // Returns the new level, or -1 if the product is unknown or the
+    // movement would take it below zero
+    Q_INVOKABLE int recordStockMovement(int productId,
+                                        int quantity,
+                                        const QString &movementType,
+                                        const QString &description = QString());
+    Q_INVOKABLE bool updateProductStock(int productId, int newStock);
+    // Level as of an ISO timestamp, replayed from the nearest snapshot
+    Q_INVOKABLE int getStockAt(int productId, const QString &timestamp);
+    // Runs in the background; the result arrives as stockConsistencyChecked
+    Q_INVOKABLE void checkStockConsistency();
+
+    // ========== Purchases ==========
+    // Changes are announced through purchaseAdded / purchaseUpdated /
+    // purchaseRemoved so PurchaseListModel can patch single rows;
+    // purchasesReset means every earlier announcement may be void (login,
+    // logout, or a rolled-back batch that contained purchase changes)
+    Q_INVOKABLE int addPurchaseWithReturn(int productId,
+                                          const QString &customerName,
+                                          int quantity,
+                                          double totalPrice,
+                                          const QString &notes = QString());
+    Q_INVOKABLE bool updatePurchase(int purchaseId,
+                                    const QString &customerName,
+                                    int quantity,
+                                    double totalPrice,
+                                    const QString &notes = QString());
+    Q_INVOKABLE bool deletePurchase(int purchaseId);
+    Q_INVOKABLE bool linkPurchaseToIncome(int purchaseId, int incomeId);
+    Q_INVOKABLE QVariantMap getPurchase(int purchaseId);
+
+    // Products that customers who took productId also took, best first:
+    // { id, name, category, price, stock, image_path, score, sharedCustomers }
+    Q_INVOKABLE QVariantList getRelatedProducts(int productId, int limit = 5);
+
+    // { ready, building, items, customers, pairs, prunedEntries,
+    //   estimatedBytes, buildMs, transactions }
+    Q_INVOKABLE QVariantMap getRecommenderStats() const;
+
+    // ========== Circulation ==========
+    // Checkout takes a copy off the shelf and returns the loan id, or -1
+    // when none is left; checkin puts it back. Availability is patched in
+    // memory without a catalog rebuild (see availabilityChanged). A book
+    // with copies on loan cannot be deleted or shrunk below them.
+    Q_INVOKABLE int checkoutBook(int bookId, const QString &borrower, int loanDays = 14);
+    Q_INVOKABLE bool checkinBook(int loanId);
+    Q_INVOKABLE bool renewLoan(int loanId, int loanDays = 14);
+
+    // [{ id, bookId, borrower, checkedOutAt, dueAt, renewals }]; one book's
+    // oldest first, or with 0 every book's soonest due first
+    Q_INVOKABLE QVariantList getOpenLoans(int bookId = 0);
+    Q_INVOKABLE int getAvailableCopies(int bookId);
+
+    // Live loan counts, updated as deadlines pass (see loanCountsChanged):
+    // { open, dueSoon, overdue, nextEventAt }
+    Q_INVOKABLE QVariantMap getLoanCounts() const;
+    // Open loans past their due date, most overdue first
+    Q_INVOKABLE QVariantList getOverdueLoans();
+
+    // ========== Published Catalog Versions ==========
+    // Latest published catalog version, for readers on any thread. A
+    // snapshot never changes once published and keeps its strings alive for
+    // as long as it is held; edits publish a new version instead. Readers
+    // off the GUI thread may see the books in their order before the last
+    // sortBooks.
+    std::shared_ptr<const CatalogSnapshot> catalogSnapshot() const;
+    QString connectionName() const { return db.connectionName(); }
+
 signals:
     void booksChanged();
     void sortStatusChanged();
+    void booksBatchCommitted(const QVariantMap &changes);  // { added, updated, removed } book ids, duplicates
+    // After addBook outside a batch; inside one they are reported under
+    // "duplicates" ([{ id, candidates }]) in booksBatchCommitted
+    void possibleDuplicatesFound(int bookId, const QVariantList &candidates);
+    void stockConsistencyChecked(const QVariantMap &report);
+    void purchaseAdded(int purchaseId);
+    void purchaseUpdated(const QVariantMap &before, const QVariantMap &after);
+    void purchaseRemoved(const QVariantMap &before);
+    void purchasesReset();
+    // After a checkout or checkin outside a batch; inside one the book is
+    // listed under "updated" in booksBatchCommitted
+    void availabilityChanged(int bookId, int available);
+    void loanDueSoon(int loanId, int bookId);
+    void loanOverdue(int loanId, int bookId);
+    void loanCountsChanged(const QVariantMap &counts);
+
+private slots:
+    void onStockConsistencyChecked(const QVariantMap &report);
 
 private:
+    // Replays traced logins without the (redacted) password
+    friend class ApiTraceReplayer;
+
     // Database
     QSqlDatabase db;
     int currentUserId;
     QString currentUsername;
+    QString m_databasePath;
+    QString m_connectionName;
+
+    // Session setup after a successful login
+    void startSession(int userId, const QString &username);
+
+    // ========== Per-User Catalog Cache ==========
+    // Revision of the user's books as bumped by the books triggers, as of
+    // the loaded catalog; -1 when unknown
+    std::unique_ptr<UserCatalogCache> m_userCatalogs;
+    qint64 m_catalogRevision = -1;
+    qint64 catalogRevision();
+    void stashCatalog();
+    bool restoreCatalog();
 
     // ========== In-Memory Cache ==========
     QVector<Book> m_books;
+    QHash<int, int> m_bookIndex;   // book id -> position in m_books, see indexOfBook()
+    int indexOfBook(int bookId);
+    void setAvailable(int bookId, int available);
+    std::shared_ptr<CatalogArena> m_arena = std::make_shared<CatalogArena>();
+    qint64 m_catalogPeakBytes = 0;
     
     // ========== Sorting State ==========
     bool m_sortedByTitle = false;
@@ -101,8 +317,67 @@ private:
     // ========== Graph for Recommendations ==========
     QMap<QString, QVector<int>> m_genreGraph;  // genre -> list of bookIds
 
+    // ========== Batch Session State ==========
+    enum class BookChange { Added, Updated, Removed };
+    bool m_batchActive = false;
+    QVector<Book> m_batchBooksSnapshot;
+    std::shared_ptr<CatalogArena> m_batchArena;
+    bool m_batchSortedByTitle = false;
+    bool m_batchSortedByYear = false;
+    QSet<int> m_batchAdded;
+    QSet<int> m_batchUpdated;
+    QSet<int> m_batchRemoved;
+    QVariantList m_batchDuplicates;
+    // Purchases are announced and fed to the recommender as they happen,
+    // so a rollback has to undo them
+    bool m_batchPurchasesChanged = false;
+
+    // ========== Published Catalog Versions ==========
+    // Written only by the GUI thread, swapped atomically; batches publish
+    // once on commit. A re-sort only marks the order stale: the reordered
+    // copy is published when the GUI thread next asks for a snapshot, so
+    // edit -> search -> edit never copies the whole catalog.
+    mutable std::shared_ptr<const CatalogSnapshot> m_snapshot;
+    mutable quint64 m_snapshotVersion = 0;
+    mutable bool m_snapshotOrderStale = false;
+    void publishCatalog() const;
+    void publishCatalogChange(BookChange change, int bookId);
+
+    // ========== Schema Migrations ==========
+    struct Migration {
+        int version;
+        const char *description;
+        bool (Database::*apply)();
+    };
+    bool migrateSchema();
+    bool migrateToV1();
+    bool migrateToV2();
+    bool migrateToV3();
+    bool migrateToV4();
+    bool migrateToV5();
+    bool migrateToV6();
+    bool migrateToV7();
+    bool migrateToV8();
+    bool columnExists(const QString &table, const QString &column) const;
+    bool execStatements(const QStringList &statements);
+
+    // ========== Ledger ==========
+    int insertLedgerEntry(const QString &kind,
+                          const QString &nominal,
+                          const QString &keterangan,
+                          const QString &tanggal,
+                          const QString &jam,
+                          int purchaseId);
+    QString weeklyChange(const QString &kind);
+
+    // ========== Catalog Loading ==========
+    qsizetype countBooks();
+    bool decodeBooks(QVector<Book> &books);
+#ifdef SIGMATERIAL_SQLITE_DIRECT
+    bool decodeBooksDirect(QVector<Book> &books);
+#endif
+
     // Helper methods
-    bool createTables();
     QVariantMap getUserByUsername(const QString &username);
     QString hashPassword(const QString &password);
     bool verifyPassword(const QString &password, const QString &hashedPassword);
@@ -112,8 +387,8 @@ private:
     void mergeSort(QVector<Book>& list, int left, int right, bool byTitle);
     void merge(QVector<Book>& list, int left, int mid, int right, bool byTitle);
 
-    // Binary Search
-    int binarySearch(const QString &title);
+    // Binary Search (expects a normalized title key)
+    int binarySearch(const QString &titleKey);
     
     // Ensure list is sorted for binary search
     void ensureSortedForSearch();
@@ -121,14 +396,85 @@ private:
     // Linear search fallback
     QVector<Book> linearSearch(const QString &query);
 
+    // Uncached query implementations behind searchBook / getRelatedBooks
+    QVariantList computeSearchResults(const QString &query);
+    QVariantList computeRelatedBooks(int bookId);
+
+    // Indexes of books whose packed search keys contain needle (already
+    // normalized), in catalog order; sharded across the global thread pool
+    QVector<int> scanSearchKeys(const QString &needle);
+    struct ScanStats {
+        int shards = 0;
+        qsizetype scanned = 0;
+        qsizetype matches = 0;
+        qint64 nsecs = 0;
+    };
+    ScanStats m_lastScan;
+
+    // ========== Query Result Cache ==========
+    // Entries are dropped precisely on mutation; the version only moves on
+    // whole-catalog events (reload, logout, rollback, change of sort order)
+    void invalidateQueryResults(const Book *before, const Book *after);
+    void resetQueryResults();
+    QueryResultCache m_queryCache;
+    quint64 m_catalogVersion = 0;
+    QString m_orderCriterion;
+
+    // ========== Duplicate Detection ==========
+    // Built lazily on first use after a (re)load, then kept current per change
+    DuplicateDetector m_duplicates;
+    bool m_duplicatesStale = true;
+    void ensureDuplicateIndex();
+    static DuplicateDetector::Signature bookSignature(const Book &book);
+    QVariantList duplicateCandidatesToVariantList(const QVector<DuplicateDetector::Candidate> &candidates) const;
+
+    // ========== Thumbnail Garbage ==========
+    // Deletions only arm the timer; when it fires, the cover paths of every
+    // user are read on a worker's connection and handed to ThumbnailCache
+    void collectThumbnailGarbage();
+    void startThumbnailGarbageCollection();
+    QTimer m_thumbnailGcTimer;
+
+    // ========== Stock Audit ==========
+    // The audit posts back to this object, so ~Database drains the pool
+    QThreadPool m_stockAuditPool;
+
+    // ========== Purchase Co-occurrence ==========
+    CoOccurrenceRecommender m_recommender;
+
+    // ========== Loan Deadlines ==========
+    OverdueTracker m_overdue;
+
     // Graph
+    void applyBookChange(BookChange change, int bookId);
     void buildGraph();
     void addGraphConnection(int book1Id, int book2Id);
 
+    // Search keys: one normalization and one ordering for search, sort and graph
+    static QString normalizeKey(const QString &text);
+    static void updateSearchKeys(Book &book, CatalogArena &arena);
+
+    // Catalog arena bookkeeping for m_books
+    void assignBookStrings(Book &book, QStringView title, QStringView author,
+                           QStringView genre, QStringView publisher, QStringView imagePath);
+    void retireBookStrings(const Book &book);
+    void updateCatalogPeak();
+    int compareKeys(QStringView left, QStringView right) const;
+    QCollator m_collator;
+
     // Conversion helpers
     QVariantMap bookToVariantMap(const Book &book) const;
     QVariantList booksToVariantList(const QVector<Book> &list) const;
     Book variantMapToBook(const QVariantMap &map) const;
 };
 
+// One immutable version of the logged-in user's catalog, published by
+// Database after every committed change (see Database::catalogSnapshot)
+struct CatalogSnapshot {
+    quint64 version = 0;
+    ChunkedVector<Database::Book> books;
+    QMap<QString, QVector<int>> genreGraph;   // genre key -> book ids
+    std::shared_ptr<const CatalogArena> arena;
+};
+
 #endif // DATABASE_H
\ No newline at end of file
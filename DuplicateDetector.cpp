@@ -0,0 +1,300 @@
+#include "DuplicateDetector.h"
+#include <QSet>
+#include <algorithm>
+
+namespace {
+constexpr int kShingleLength = 3;
+
+quint64 splitMix64(quint64 x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+quint64 hashShingle(int field, QStringView shingle)
+{
+    // FNV-1a over the field tag and the UTF-16 units
+    quint64 hash = 0xCBF29CE484222325ULL ^ quint64(field);
+    hash *= 0x100000001B3ULL;
+    for (const QChar ch : shingle) {
+        hash ^= ch.unicode();
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Letters and digits only, single spaces between words: punctuation and
+// spacing differences should not make two spellings look different
+QString shingleText(QStringView text)
+{
+    QString result;
+    result.reserve(text.size());
+    bool pendingSpace = false;
+    for (const QChar ch : text) {
+        if (!ch.isLetterOrNumber()) {
+            pendingSpace = !result.isEmpty();
+            continue;
+        }
+        if (pendingSpace) {
+            result.append(QLatin1Char(' '));
+            pendingSpace = false;
+        }
+        result.append(ch);
+    }
+    return result;
+}
+
+// Returns false when the text has no letters or digits to shingle
+template <std::size_t N>
+bool addShingles(std::array<quint32, N> &signature, int field, QStringView text)
+{
+    const QString cleaned = shingleText(text);
+    if (cleaned.isEmpty()) {
+        return false;
+    }
+
+    const auto add = [&signature, field](QStringView shingle) {
+        const quint64 base = hashShingle(field, shingle);
+        for (std::size_t i = 0; i < N; ++i) {
+            const quint32 value = quint32(splitMix64(base ^ (quint64(i + 1) * 0xD6E8FEB86659FD93ULL)));
+            signature[i] = std::min(signature[i], value);
+        }
+    };
+
+    if (cleaned.size() <= kShingleLength) {
+        add(cleaned);
+        return true;
+    }
+    for (qsizetype i = 0; i + kShingleLength <= cleaned.size(); ++i) {
+        add(QStringView(cleaned).mid(i, kShingleLength));
+    }
+    return true;
+}
+
+// Hash of the digit runs in order ("Jilid 2", "1984"), 0 when there are none
+quint32 numbersHash(QStringView text)
+{
+    quint64 hash = 0xCBF29CE484222325ULL;
+    bool found = false;
+    bool inRun = false;
+    for (const QChar ch : text) {
+        if (ch.isDigit()) {
+            hash ^= quint64(ch.digitValue() + 1);
+            hash *= 0x100000001B3ULL;
+            found = true;
+            inRun = true;
+        } else if (inRun) {
+            hash ^= 0xFF;
+            hash *= 0x100000001B3ULL;
+            inRun = false;
+        }
+    }
+    return found ? std::max<quint32>(1, quint32(splitMix64(hash))) : 0;
+}
+
+template <std::size_t N>
+double agreement(const std::array<quint32, N> &a, const std::array<quint32, N> &b)
+{
+    int equal = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+        equal += a[i] == b[i] ? 1 : 0;
+    }
+    return double(equal) / double(N);
+}
+}
+
+DuplicateDetector::Signature DuplicateDetector::signature(QStringView title, QStringView author,
+                                                          QStringView publisher)
+{
+    Signature result;
+    result.title.fill(0xFFFFFFFFu);
+    result.context.fill(0xFFFFFFFFu);
+    result.hasTitle = addShingles(result.title, 0, title);
+    const bool hasAuthor = addShingles(result.context, 1, author);
+    const bool hasPublisher = addShingles(result.context, 2, publisher);
+    result.hasContext = hasAuthor || hasPublisher;
+    result.numbers = numbersHash(title);
+    return result;
+}
+
+double DuplicateDetector::similarity(const Signature &a, const Signature &b)
+{
+    // Empty signatures are all 0xFFFFFFFF and would agree completely
+    if (!a.hasTitle || !b.hasTitle || a.numbers != b.numbers) {
+        return 0.0;
+    }
+
+    const double title = agreement(a.title, b.title);
+    if (title < kThreshold) {
+        return 0.0;
+    }
+
+    // A missing author or publisher on either side neither confirms nor vetoes
+    if (!a.hasContext || !b.hasContext) {
+        return title;
+    }
+    const double context = agreement(a.context, b.context);
+    if (context < kContextThreshold) {
+        return 0.0;
+    }
+    return kTitleWeight * title + (1.0 - kTitleWeight) * context;
+}
+
+quint64 DuplicateDetector::bandKey(const Signature &signature, int band)
+{
+    quint64 key = splitMix64(quint64(band));
+    for (int row = 0; row < kRows; ++row) {
+        key = splitMix64(key ^ signature.title[band * kRows + row]);
+    }
+    return key;
+}
+
+void DuplicateDetector::insert(int id, const Signature &signature)
+{
+    if (m_signatures.contains(id)) {
+        remove(id);
+    }
+
+    m_signatures.insert(id, signature);
+    if (!signature.hasTitle) {
+        return;
+    }
+    for (int band = 0; band < kBands; ++band) {
+        m_buckets[bandKey(signature, band)].append(id);
+    }
+}
+
+void DuplicateDetector::remove(int id)
+{
+    const auto found = m_signatures.constFind(id);
+    if (found == m_signatures.constEnd()) {
+        return;
+    }
+
+    for (int band = 0; found->hasTitle && band < kBands; ++band) {
+        const quint64 key = bandKey(*found, band);
+        auto bucket = m_buckets.find(key);
+        if (bucket == m_buckets.end()) {
+            continue;
+        }
+        bucket->removeOne(id);
+        if (bucket->isEmpty()) {
+            m_buckets.erase(bucket);
+        }
+    }
+    m_signatures.erase(found);
+}
+
+void DuplicateDetector::clear()
+{
+    m_signatures.clear();
+    m_buckets.clear();
+}
+
+QVector<DuplicateDetector::Candidate> DuplicateDetector::candidates(const Signature &signature,
+                                                                    int excludeId, int limit) const
+{
+    QSet<int> seen;
+    QVector<Candidate> result;
+    if (!signature.hasTitle) {
+        return result;
+    }
+
+    for (int band = 0; band < kBands; ++band) {
+        const auto bucket = m_buckets.constFind(bandKey(signature, band));
+        if (bucket == m_buckets.constEnd()) {
+            continue;
+        }
+        for (int id : *bucket) {
+            if (id == excludeId || seen.contains(id)) {
+                continue;
+            }
+            seen.insert(id);
+
+            const double score = similarity(signature, m_signatures.value(id));
+            if (score > 0.0) {
+                result.append({ id, score });
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const Candidate &a, const Candidate &b) {
+        return a.similarity != b.similarity ? a.similarity > b.similarity : a.id < b.id;
+    });
+    if (limit > 0 && result.size() > limit) {
+        result.resize(limit);
+    }
+    return result;
+}
+
+QVector<QVector<int>> DuplicateDetector::clusters() const
+{
+    // Union-find over confirmed pairs from shared buckets
+    QHash<int, int> parent;
+    const auto find = [&parent](int id) {
+        int root = id;
+        while (parent.value(root, root) != root) {
+            root = parent.value(root);
+        }
+        while (id != root) {
+            const int next = parent.value(id, id);
+            parent.insert(id, root);
+            id = next;
+        }
+        return root;
+    };
+
+    for (const QVector<int> &bucket : m_buckets) {
+        for (int i = 0; i < bucket.size(); ++i) {
+            const Signature left = m_signatures.value(bucket.at(i));
+            for (int j = i + 1; j < bucket.size(); ++j) {
+                const int a = find(bucket.at(i));
+                const int b = find(bucket.at(j));
+                if (a != b && similarity(left, m_signatures.value(bucket.at(j))) > 0.0) {
+                    parent.insert(std::max(a, b), std::min(a, b));
+                }
+            }
+        }
+    }
+
+    // find() compresses paths, so walk a copy of the keys
+    QHash<int, QVector<int>> groups;
+    const QList<int> nodes = parent.keys();
+    for (int node : nodes) {
+        groups[find(node)].append(node);
+    }
+
+    QVector<QVector<int>> result;
+    for (auto it = groups.begin(); it != groups.end(); ++it) {
+        QVector<int> &members = it.value();
+        if (!members.contains(it.key())) {
+            members.append(it.key());
+        }
+        if (members.size() < 2) {
+            continue;
+        }
+        std::sort(members.begin(), members.end());
+        result.append(members);
+    }
+
+    std::sort(result.begin(), result.end(), [](const QVector<int> &a, const QVector<int> &b) {
+        return a.first() < b.first();
+    });
+    return result;
+}
+
+QVariantMap DuplicateDetector::stats() const
+{
+    int largest = 0;
+    for (const QVector<int> &bucket : m_buckets) {
+        largest = std::max(largest, int(bucket.size()));
+    }
+
+    QVariantMap map;
+    map.insert("books", m_signatures.size());
+    map.insert("buckets", m_buckets.size());
+    map.insert("largestBucket", largest);
+    return map;
+}
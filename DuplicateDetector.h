@@ -0,0 +1,79 @@
+#ifndef DUPLICATEDETECTOR_H
+#define DUPLICATEDETECTOR_H
+
+#include <QHash>
+#include <QStringView>
+#include <QVariantMap>
+#include <QVector>
+#include <array>
+
+// Near-duplicate index for books.
+// Each book gets a MinHash signature over character 3-gram shingles of its
+// normalized title, and a smaller one over its author and publisher.
+// Title signatures are split into kBands bands of kRows values; books
+// sharing a band land in the same LSH bucket, so an insert only compares
+// against the few books in its buckets instead of the whole catalog.
+// A candidate is confirmed when
+// - the title signatures agree on at least kThreshold (the estimated
+//   Jaccard similarity of the titles),
+// - the numbers in both titles are the same, so volumes of a series stay
+//   apart, and
+// - where both books have an author or publisher, those agree on at least
+//   kContextThreshold.
+// Author and publisher only ever confirm or veto a title match: books by
+// the same author from the same publisher are not duplicates by themselves.
+class DuplicateDetector
+{
+public:
+    static constexpr int kBands = 16;
+    static constexpr int kRows = 4;
+    static constexpr int kHashes = kBands * kRows;
+    static constexpr int kContextHashes = 16;
+    // Near the LSH curve's midpoint, (1 / kBands)^(1 / kRows) ~ 0.5
+    static constexpr double kThreshold = 0.5;
+    static constexpr double kContextThreshold = 0.25;
+    // Share of the title in the reported similarity
+    static constexpr double kTitleWeight = 0.75;
+
+    struct Signature {
+        std::array<quint32, kHashes> title;
+        std::array<quint32, kContextHashes> context;   // author and publisher
+        quint32 numbers = 0;                           // digits in the title, 0 if none
+        bool hasTitle = false;
+        bool hasContext = false;
+    };
+
+    struct Candidate {
+        int id = 0;
+        double similarity = 0.0;
+    };
+
+    static Signature signature(QStringView title, QStringView author, QStringView publisher);
+
+    // Weighted title and context agreement when the pair is confirmed,
+    // otherwise 0. A signature without title shingles matches nothing.
+    static double similarity(const Signature &a, const Signature &b);
+
+    void insert(int id, const Signature &signature);
+    void remove(int id);
+    void clear();
+
+    // Confirmed candidates, most similar first
+    QVector<Candidate> candidates(const Signature &signature, int excludeId = 0, int limit = 5) const;
+
+    // Groups of two or more books connected by confirmed candidate pairs
+    QVector<QVector<int>> clusters() const;
+
+    int size() const { return m_signatures.size(); }
+
+    // { books, buckets, largestBucket }
+    QVariantMap stats() const;
+
+private:
+    static quint64 bandKey(const Signature &signature, int band);
+
+    QHash<int, Signature> m_signatures;
+    QHash<quint64, QVector<int>> m_buckets;   // band key -> book ids
+};
+
+#endif // DUPLICATEDETECTOR_H
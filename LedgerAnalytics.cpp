@@ -0,0 +1,342 @@
+#include "LedgerAnalytics.h"
+#include <QHash>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+#include <QDebug>
+
+namespace {
+constexpr const char *kIncomeKind = "pemasukan";
+constexpr const char *kExpenseKind = "pengeluaran";
+
+constexpr const char *kUpsertDailySql =
+    "INSERT INTO ledger_daily (user_id, kind, day, amount_minor, entry_count) VALUES (?, ?, ?, ?, 1)"
+    " ON CONFLICT (user_id, kind, day) DO UPDATE SET"
+    " amount_minor = amount_minor + excluded.amount_minor, entry_count = entry_count + 1";
+constexpr const char *kUpsertWeeklySql =
+    "INSERT INTO ledger_weekly (user_id, kind, week_start, amount_minor, entry_count) VALUES (?, ?, ?, ?, 1)"
+    " ON CONFLICT (user_id, kind, week_start) DO UPDATE SET"
+    " amount_minor = amount_minor + excluded.amount_minor, entry_count = entry_count + 1";
+constexpr const char *kSumDailySql =
+    "SELECT COALESCE(SUM(amount_minor), 0) FROM ledger_daily"
+    " WHERE user_id = ? AND kind = ? AND day BETWEEN ? AND ?";
+constexpr const char *kSumWeeklySql =
+    "SELECT COALESCE(SUM(amount_minor), 0) FROM ledger_weekly"
+    " WHERE user_id = ? AND kind = ? AND week_start BETWEEN ? AND ?";
+constexpr const char *kTotalSql =
+    "SELECT COALESCE(SUM(amount_minor), 0) FROM ledger_weekly WHERE user_id = ? AND kind = ?";
+
+// SQLite's %w is 0 for Sunday; shift so weeks start on Monday like weekStart()
+constexpr const char *kWeekStartSql =
+    "date(entry_date, '-' || ((CAST(strftime('%w', entry_date) AS INTEGER) + 6) % 7) || ' days')";
+
+QString isoDate(const QDate &date)
+{
+    return date.toString(Qt::ISODate);
+}
+
+qint64 sumRollup(const QSqlDatabase &db, const char *sql, int userId, const QString &kind,
+                 const QDate &from, const QDate &to)
+{
+    if (from > to) {
+        return 0;
+    }
+
+    QSqlQuery query(db);
+    query.prepare(sql);
+    query.addBindValue(userId);
+    query.addBindValue(kind);
+    query.addBindValue(isoDate(from));
+    query.addBindValue(isoDate(to));
+
+    if (!query.exec() || !query.next()) {
+        qWarning() << "LedgerAnalytics: Failed to read rollup:" << query.lastError().text();
+        return 0;
+    }
+    return query.value(0).toLongLong();
+}
+}
+
+// ============================================================================
+// Parsing
+// ============================================================================
+
+qint64 LedgerAnalytics::parseAmountMinor(const QString &nominal)
+{
+    QString text = nominal.trimmed();
+    text.remove(QLatin1String("Rp"), Qt::CaseInsensitive);
+    text.remove(QLatin1Char(' '));
+
+    bool negative = false;
+    if (text.startsWith(QLatin1Char('-'))) {
+        negative = true;
+        text.remove(0, 1);
+    }
+
+    // Indonesian notation: '.' groups thousands, ',' starts the decimals
+    QString whole = text;
+    QString fraction;
+    const int comma = text.lastIndexOf(QLatin1Char(','));
+    if (comma >= 0) {
+        whole = text.left(comma);
+        fraction = text.mid(comma + 1).left(2);
+    }
+    whole.remove(QLatin1Char('.'));
+    while (fraction.size() < 2) {
+        fraction.append(QLatin1Char('0'));
+    }
+
+    bool wholeOk = false;
+    bool fractionOk = false;
+    const qint64 units = whole.isEmpty() ? 0 : whole.toLongLong(&wholeOk);
+    const qint64 cents = fraction.toLongLong(&fractionOk);
+    if ((!whole.isEmpty() && !wholeOk) || !fractionOk) {
+        return 0;
+    }
+
+    const qint64 minor = units * 100 + cents;
+    return negative ? -minor : minor;
+}
+
+QDate LedgerAnalytics::parseDate(const QString &text)
+{
+    const QString trimmed = text.trimmed();
+
+    // DD MMM YYYY with Indonesian month abbreviations, e.g. "18 Des 2024"
+    if (trimmed.contains(QLatin1Char(' '))) {
+        static const QStringList monthNames = { "Jan", "Feb", "Mar", "Apr", "Mei", "Jun",
+                                                "Jul", "Agu", "Sep", "Okt", "Nov", "Des" };
+        const QStringList parts = trimmed.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        if (parts.size() == 3) {
+            const int month = monthNames.indexOf(parts[1].left(3)) + 1;
+            if (month > 0) {
+                return QDate(parts[2].toInt(), month, parts[0].toInt());
+            }
+        }
+        return QDate();
+    }
+
+    if (trimmed.contains(QLatin1Char('-'))) {
+        return QDate::fromString(trimmed.left(10), Qt::ISODate);
+    }
+
+    if (trimmed.contains(QLatin1Char('/'))) {
+        return QDate::fromString(trimmed, QStringLiteral("d/M/yyyy"));
+    }
+
+    return QDate();
+}
+
+QDate LedgerAnalytics::weekStart(const QDate &date)
+{
+    return date.addDays(1 - date.dayOfWeek());
+}
+
+bool LedgerAnalytics::isValidKind(const QString &kind)
+{
+    return kind == QLatin1String(kIncomeKind) || kind == QLatin1String(kExpenseKind);
+}
+
+// ============================================================================
+// Maintenance
+// ============================================================================
+
+bool LedgerAnalytics::backfill(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+
+    for (const char *table : { kIncomeKind, kExpenseKind }) {
+        const QString name = QString::fromLatin1(table);
+
+        // Collect first: updating the table while stepping over it is unsafe
+        struct Row { qint64 id; qint64 amountMinor; QString entryDate; };
+        QVector<Row> rows;
+        if (!query.exec(QStringLiteral("SELECT id, nominal, tanggal FROM ") + name)) {
+            qWarning() << "LedgerAnalytics: Failed to read" << name << query.lastError().text();
+            return false;
+        }
+        while (query.next()) {
+            const QDate date = parseDate(query.value(2).toString());
+            rows.append({ query.value(0).toLongLong(),
+                          parseAmountMinor(query.value(1).toString()),
+                          date.isValid() ? isoDate(date) : QString() });
+        }
+
+        QSqlQuery update(db);
+        update.prepare(QStringLiteral("UPDATE ") + name + QStringLiteral(" SET amount_minor = ?, entry_date = ? WHERE id = ?"));
+        for (const Row &row : rows) {
+            update.addBindValue(row.amountMinor);
+            update.addBindValue(row.entryDate.isEmpty() ? QVariant() : QVariant(row.entryDate));
+            update.addBindValue(row.id);
+            if (!update.exec()) {
+                qWarning() << "LedgerAnalytics: Failed to backfill" << name << update.lastError().text();
+                return false;
+            }
+        }
+    }
+
+    // Rows whose tanggal cannot be parsed stay out of the rollups, as the
+    // old per-call scans skipped them too
+    const QStringList statements = {
+        "DELETE FROM ledger_daily",
+        "DELETE FROM ledger_weekly",
+        QStringLiteral("INSERT INTO ledger_daily (user_id, kind, day, amount_minor, entry_count)"
+                       " SELECT user_id, '%1', entry_date, SUM(amount_minor), COUNT(*) FROM %1"
+                       " WHERE entry_date IS NOT NULL GROUP BY user_id, entry_date").arg(QLatin1String(kIncomeKind)),
+        QStringLiteral("INSERT INTO ledger_daily (user_id, kind, day, amount_minor, entry_count)"
+                       " SELECT user_id, '%1', entry_date, SUM(amount_minor), COUNT(*) FROM %1"
+                       " WHERE entry_date IS NOT NULL GROUP BY user_id, entry_date").arg(QLatin1String(kExpenseKind)),
+        QStringLiteral("INSERT INTO ledger_weekly (user_id, kind, week_start, amount_minor, entry_count)"
+                       " SELECT user_id, '%1', %2, SUM(amount_minor), COUNT(*) FROM %1"
+                       " WHERE entry_date IS NOT NULL GROUP BY user_id, %2").arg(QLatin1String(kIncomeKind), QLatin1String(kWeekStartSql)),
+        QStringLiteral("INSERT INTO ledger_weekly (user_id, kind, week_start, amount_minor, entry_count)"
+                       " SELECT user_id, '%1', %2, SUM(amount_minor), COUNT(*) FROM %1"
+                       " WHERE entry_date IS NOT NULL GROUP BY user_id, %2").arg(QLatin1String(kExpenseKind), QLatin1String(kWeekStartSql)),
+    };
+
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) {
+            qWarning() << "LedgerAnalytics: Failed to rebuild rollups:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LedgerAnalytics::recordEntry(QSqlDatabase &db, int userId, const QString &kind, qint64 amountMinor, const QDate &date)
+{
+    if (!date.isValid()) {
+        return true;  // Undated rows are kept out of the rollups
+    }
+
+    QSqlQuery query(db);
+
+    query.prepare(kUpsertDailySql);
+    query.addBindValue(userId);
+    query.addBindValue(kind);
+    query.addBindValue(isoDate(date));
+    query.addBindValue(amountMinor);
+    if (!query.exec()) {
+        qWarning() << "LedgerAnalytics: Failed to update daily rollup:" << query.lastError().text();
+        return false;
+    }
+
+    query.prepare(kUpsertWeeklySql);
+    query.addBindValue(userId);
+    query.addBindValue(kind);
+    query.addBindValue(isoDate(weekStart(date)));
+    query.addBindValue(amountMinor);
+    if (!query.exec()) {
+        qWarning() << "LedgerAnalytics: Failed to update weekly rollup:" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+qint64 LedgerAnalytics::sumBetween(const QSqlDatabase &db, int userId, const QString &kind,
+                                   const QDate &from, const QDate &to)
+{
+    if (!from.isValid() || !to.isValid() || from > to) {
+        return 0;
+    }
+
+    // Whole weeks [firstWeek, endWeek) come from ledger_weekly
+    QDate firstWeek = weekStart(from);
+    if (firstWeek < from) {
+        firstWeek = firstWeek.addDays(7);
+    }
+    const QDate endWeek = weekStart(to.addDays(1));
+
+    if (firstWeek >= endWeek) {
+        return sumRollup(db, kSumDailySql, userId, kind, from, to);
+    }
+
+    return sumRollup(db, kSumDailySql, userId, kind, from, firstWeek.addDays(-1))
+         + sumRollup(db, kSumWeeklySql, userId, kind, firstWeek, endWeek.addDays(-7))
+         + sumRollup(db, kSumDailySql, userId, kind, endWeek, to);
+}
+
+qint64 LedgerAnalytics::total(const QSqlDatabase &db, int userId, const QString &kind)
+{
+    QSqlQuery query(db);
+    query.prepare(kTotalSql);
+    query.addBindValue(userId);
+    query.addBindValue(kind);
+
+    if (!query.exec() || !query.next()) {
+        qWarning() << "LedgerAnalytics: Failed to read total:" << query.lastError().text();
+        return 0;
+    }
+    return query.value(0).toLongLong();
+}
+
+QVariantList LedgerAnalytics::series(const QSqlDatabase &db, int userId, const QString &kind,
+                                     const QString &granularity, const QDate &from, const QDate &to)
+{
+    QVariantList result;
+    if (!from.isValid() || !to.isValid() || from > to) {
+        return result;
+    }
+
+    const bool weekly = granularity == QLatin1String("week");
+    const QDate first = weekly ? weekStart(from) : from;
+    const QDate last = weekly ? weekStart(to) : to;
+    const int step = weekly ? 7 : 1;
+
+    QSqlQuery query(db);
+    query.prepare(weekly
+        ? QStringLiteral("SELECT week_start, amount_minor, entry_count FROM ledger_weekly"
+                         " WHERE user_id = ? AND kind = ? AND week_start BETWEEN ? AND ?")
+        : QStringLiteral("SELECT day, amount_minor, entry_count FROM ledger_daily"
+                         " WHERE user_id = ? AND kind = ? AND day BETWEEN ? AND ?"));
+    query.addBindValue(userId);
+    query.addBindValue(kind);
+    query.addBindValue(isoDate(first));
+    query.addBindValue(isoDate(last));
+
+    if (!query.exec()) {
+        qWarning() << "LedgerAnalytics: Failed to read series:" << query.lastError().text();
+        return result;
+    }
+
+    QHash<QString, QPair<qint64, int>> rows;
+    while (query.next()) {
+        rows.insert(query.value(0).toString(), { query.value(1).toLongLong(), query.value(2).toInt() });
+    }
+
+    for (QDate period = first; period <= last; period = period.addDays(step)) {
+        const QString key = isoDate(period);
+        const QPair<qint64, int> row = rows.value(key, { 0, 0 });
+
+        QVariantMap point;
+        point.insert("period", key);
+        point.insert("amount", row.first / 100.0);
+        point.insert("amountMinor", row.first);
+        point.insert("count", row.second);
+        result.append(point);
+    }
+
+    return result;
+}
+
+QString LedgerAnalytics::formatChange(qint64 current, qint64 previous)
+{
+    if (previous == 0 && current == 0) {
+        return "0%";
+    } else if (previous == 0) {
+        return "Baru";  // New data this period
+    } else if (current == 0) {
+        return "-100%";
+    }
+
+    const double changePercent = double(current - previous) / double(previous) * 100.0;
+    const QString sign = changePercent >= 0 ? "+" : "";
+    return sign + QString::number(changePercent, 'f', 0) + "%";
+}
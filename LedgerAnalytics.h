@@ -0,0 +1,46 @@
+#ifndef LEDGERANALYTICS_H
+#define LEDGERANALYTICS_H
+
+#include <QDate>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVariantList>
+
+// Rollup-backed analytics for the pemasukan / pengeluaran ledgers.
+// Ledger rows carry amount_minor (integer sen) and entry_date (ISO date)
+// next to the legacy TEXT nominal/tanggal. Every insert also adds to
+// ledger_daily and ledger_weekly inside the caller's transaction, so sums
+// and series read one rollup row per period instead of every ledger row.
+class LedgerAnalytics
+{
+public:
+    // "Rp 15.000" / "15.000,50" / "-2500" -> minor units (1/100 rupiah)
+    static qint64 parseAmountMinor(const QString &nominal);
+    // "18 Des 2024", "2024-12-18" or "18/12/2024"
+    static QDate parseDate(const QString &text);
+    // Monday of the ISO week containing date
+    static QDate weekStart(const QDate &date);
+
+    static bool isValidKind(const QString &kind);
+
+    // Fills amount_minor / entry_date for existing rows and rebuilds both
+    // rollup tables. Runs inside the migration transaction.
+    static bool backfill(QSqlDatabase &db);
+
+    // Adds one ledger entry to its day and week rollup rows
+    static bool recordEntry(QSqlDatabase &db, int userId, const QString &kind, qint64 amountMinor, const QDate &date);
+
+    // Sum over [from, to] inclusive: whole weeks from ledger_weekly, the
+    // ragged ends from ledger_daily
+    static qint64 sumBetween(const QSqlDatabase &db, int userId, const QString &kind, const QDate &from, const QDate &to);
+    static qint64 total(const QSqlDatabase &db, int userId, const QString &kind);
+
+    // [{ period, amount, count }] for every day or week in range, zeros included
+    static QVariantList series(const QSqlDatabase &db, int userId, const QString &kind,
+                               const QString &granularity, const QDate &from, const QDate &to);
+
+    // Percentage label used by the dashboard cards: "+12%", "-100%", "Baru", "0%"
+    static QString formatChange(qint64 current, qint64 previous);
+};
+
+#endif // LEDGERANALYTICS_H
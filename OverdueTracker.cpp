@@ -0,0 +1,331 @@
+#include "OverdueTracker.h"
+#include "Circulation.h"
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTimeZone>
+#include <algorithm>
+
+namespace {
+// Served by idx_loans_open_due, already in due order
+constexpr const char *kSelectOpenLoansSql =
+    "SELECT id, book_id, due_at FROM loans WHERE user_id = ? AND returned_at IS NULL ORDER BY due_at";
+}
+
+// ============================================================================
+// Constructor
+// ============================================================================
+
+OverdueTracker::OverdueTracker(QObject *parent)
+    : QObject(parent)
+    , m_dueSoon(0)
+    , m_overdue(0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &OverdueTracker::onTimeout);
+}
+
+const char *OverdueTracker::selectOpenLoansSql()
+{
+    return kSelectOpenLoansSql;
+}
+
+// ============================================================================
+// Loans
+// ============================================================================
+
+bool OverdueTracker::rebuild(const QSqlDatabase &db, int userId)
+{
+    m_loans.clear();
+    m_heap.clear();
+    m_heapIndex.clear();
+    m_dueSoon = 0;
+    m_overdue = 0;
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(kSelectOpenLoansSql);
+    query.addBindValue(userId);
+    if (!query.exec()) {
+        qWarning() << "OverdueTracker: Failed to load open loans:" << query.lastError().text();
+        arm();
+        emit countsChanged(counts());
+        return false;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while (query.next()) {
+        const int loanId = query.value(0).toInt();
+        Loan loan;
+        loan.bookId = query.value(1).toInt();
+        loan.dueAt = Circulation::fromSqlTime(query.value(2).toString()).toMSecsSinceEpoch();
+        loan.state = stateAt(loan.dueAt, now);
+        if (loan.state == State::DueSoon) {
+            ++m_dueSoon;
+        } else if (loan.state == State::Overdue) {
+            ++m_overdue;
+        }
+        if (loan.state != State::Overdue) {
+            m_heapIndex.insert(loanId, int(m_heap.size()));
+            m_heap.append({ nextEventAt(loan), loanId });
+        }
+        m_loans.insert(loanId, loan);
+    }
+
+    // Bottom-up heapify, O(n)
+    for (int i = int(m_heap.size()) / 2 - 1; i >= 0; --i) {
+        siftDown(i);
+    }
+
+    arm();
+    emit countsChanged(counts());
+    return true;
+}
+
+void OverdueTracker::clear()
+{
+    m_loans.clear();
+    m_heap.clear();
+    m_heapIndex.clear();
+    m_dueSoon = 0;
+    m_overdue = 0;
+    m_timer.stop();
+    emit countsChanged(counts());
+}
+
+void OverdueTracker::add(int loanId, int bookId, const QDateTime &dueAt)
+{
+    if (m_loans.contains(loanId)) {
+        renew(loanId, dueAt);
+        return;
+    }
+
+    Loan &loan = m_loans[loanId];
+    loan.bookId = bookId;
+    loan.dueAt = dueAt.toMSecsSinceEpoch();
+    place(loanId, loan, QDateTime::currentMSecsSinceEpoch());
+    arm();
+    emit countsChanged(counts());
+}
+
+void OverdueTracker::renew(int loanId, const QDateTime &dueAt)
+{
+    auto it = m_loans.find(loanId);
+    if (it == m_loans.end()) {
+        return;
+    }
+
+    it->dueAt = dueAt.toMSecsSinceEpoch();
+    place(loanId, *it, QDateTime::currentMSecsSinceEpoch());
+    arm();
+    emit countsChanged(counts());
+}
+
+void OverdueTracker::remove(int loanId)
+{
+    const auto it = m_loans.constFind(loanId);
+    if (it == m_loans.constEnd()) {
+        return;
+    }
+
+    if (it->state == State::DueSoon) {
+        --m_dueSoon;
+    } else if (it->state == State::Overdue) {
+        --m_overdue;
+    }
+    heapRemove(loanId);
+    m_loans.erase(it);
+    arm();
+    emit countsChanged(counts());
+}
+
+QVector<int> OverdueTracker::loansIn(State state) const
+{
+    QVector<int> loanIds;
+    for (auto it = m_loans.cbegin(); it != m_loans.cend(); ++it) {
+        if (it->state == state) {
+            loanIds.append(it.key());
+        }
+    }
+    std::sort(loanIds.begin(), loanIds.end(), [this](int a, int b) {
+        return m_loans.value(a).dueAt < m_loans.value(b).dueAt;
+    });
+    return loanIds;
+}
+
+QVariantMap OverdueTracker::counts() const
+{
+    QVariantMap map;
+    map.insert("open", openCount());
+    map.insert("dueSoon", m_dueSoon);
+    map.insert("overdue", m_overdue);
+    map.insert("nextEventAt", m_heap.isEmpty() ? QDateTime()
+                                               : QDateTime::fromMSecsSinceEpoch(m_heap.first().fireAt, QTimeZone::UTC));
+    return map;
+}
+
+// ============================================================================
+// Transitions
+// ============================================================================
+
+OverdueTracker::State OverdueTracker::stateAt(qint64 dueAt, qint64 now)
+{
+    if (dueAt <= now) {
+        return State::Overdue;
+    }
+    return dueAt - kDueSoonMs <= now ? State::DueSoon : State::Open;
+}
+
+qint64 OverdueTracker::nextEventAt(const Loan &loan)
+{
+    return loan.state == State::Open ? loan.dueAt - kDueSoonMs : loan.dueAt;
+}
+
+void OverdueTracker::place(int loanId, Loan &loan, qint64 now)
+{
+    // A new loan starts out Open, which no counter tracks
+    const State state = stateAt(loan.dueAt, now);
+    m_dueSoon += int(state == State::DueSoon) - int(loan.state == State::DueSoon);
+    m_overdue += int(state == State::Overdue) - int(loan.state == State::Overdue);
+    loan.state = state;
+
+    // Overdue is final until a renewal moves the deadline again
+    if (state == State::Overdue) {
+        heapRemove(loanId);
+    } else if (m_heapIndex.contains(loanId)) {
+        heapUpdate(loanId, nextEventAt(loan));
+    } else {
+        heapPush(loanId, nextEventAt(loan));
+    }
+}
+
+void OverdueTracker::onTimeout()
+{
+    struct Event {
+        int loanId;
+        int bookId;
+        State state;
+    };
+    QVector<Event> events;
+
+    // Every due entry moves strictly into the future or leaves the heap,
+    // so this always terminates
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while (!m_heap.isEmpty() && m_heap.first().fireAt <= now) {
+        const int loanId = m_heap.first().loanId;
+        Loan &loan = m_loans[loanId];
+        place(loanId, loan, now);
+        events.append({ loanId, loan.bookId, loan.state });
+    }
+
+    arm();
+
+    // Emitted last: a slot may check a loan in and reshape the heap
+    for (const Event &event : std::as_const(events)) {
+        if (event.state == State::Overdue) {
+            emit loanOverdue(event.loanId, event.bookId);
+        } else if (event.state == State::DueSoon) {
+            emit loanDueSoon(event.loanId, event.bookId);
+        }
+    }
+    if (!events.isEmpty()) {
+        emit countsChanged(counts());
+    }
+}
+
+void OverdueTracker::arm()
+{
+    if (m_heap.isEmpty()) {
+        m_timer.stop();
+        return;
+    }
+
+    const qint64 delay = m_heap.first().fireAt - QDateTime::currentMSecsSinceEpoch();
+    m_timer.start(int(qBound<qint64>(0, delay, kMaxTimerMs)));
+}
+
+// ============================================================================
+// Indexed Heap
+// ============================================================================
+
+void OverdueTracker::heapPush(int loanId, qint64 fireAt)
+{
+    m_heapIndex.insert(loanId, int(m_heap.size()));
+    m_heap.append({ fireAt, loanId });
+    siftUp(int(m_heap.size()) - 1);
+}
+
+void OverdueTracker::heapUpdate(int loanId, qint64 fireAt)
+{
+    const int i = m_heapIndex.value(loanId);
+    const qint64 previous = m_heap[i].fireAt;
+    m_heap[i].fireAt = fireAt;
+    if (fireAt < previous) {
+        siftUp(i);
+    } else {
+        siftDown(i);
+    }
+}
+
+void OverdueTracker::heapRemove(int loanId)
+{
+    const auto it = m_heapIndex.constFind(loanId);
+    if (it == m_heapIndex.constEnd()) {
+        return;
+    }
+
+    const int i = *it;
+    const int last = int(m_heap.size()) - 1;
+    if (i != last) {
+        heapSwap(i, last);
+    }
+    m_heap.removeLast();
+    m_heapIndex.remove(loanId);
+
+    // The moved entry can belong either above or below its new slot
+    if (i < m_heap.size()) {
+        siftUp(i);
+        siftDown(i);
+    }
+}
+
+void OverdueTracker::heapSwap(int a, int b)
+{
+    std::swap(m_heap[a], m_heap[b]);
+    m_heapIndex[m_heap[a].loanId] = a;
+    m_heapIndex[m_heap[b].loanId] = b;
+}
+
+void OverdueTracker::siftUp(int i)
+{
+    while (i > 0) {
+        const int parent = (i - 1) / 2;
+        if (m_heap[parent].fireAt <= m_heap[i].fireAt) {
+            break;
+        }
+        heapSwap(i, parent);
+        i = parent;
+    }
+}
+
+void OverdueTracker::siftDown(int i)
+{
+    const int count = int(m_heap.size());
+    for (;;) {
+        const int left = 2 * i + 1;
+        const int right = left + 1;
+        int smallest = i;
+        if (left < count && m_heap[left].fireAt < m_heap[smallest].fireAt) {
+            smallest = left;
+        }
+        if (right < count && m_heap[right].fireAt < m_heap[smallest].fireAt) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        heapSwap(i, smallest);
+        i = smallest;
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef OVERDUETRACKER_H
+#define OVERDUETRACKER_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+
+// Live due-soon and overdue state of open loans.
+// - Each loan waits in an indexed min-heap keyed by its next transition:
+//   due_at - kDueSoonMs (becomes due soon), then due_at (becomes overdue).
+//   Overdue loans leave the heap and are only counted.
+// - One precise single-shot timer is armed for the heap's top, so events
+//   fire when a loan crosses its deadline, not on a polling interval.
+// - The heap keeps each loan's position, so renew() and remove() re-sift
+//   in place in O(log n) instead of searching.
+// - rebuild() reloads open loans through the partial due_at index.
+class OverdueTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 kDueSoonMs = 2LL * 24 * 60 * 60 * 1000;
+    // QTimer intervals are int milliseconds; far deadlines re-arm hourly
+    static constexpr int kMaxTimerMs = 60 * 60 * 1000;
+
+    enum class State { Open, DueSoon, Overdue };
+
+    explicit OverdueTracker(QObject *parent = nullptr);
+
+    // Open loans of userId, soonest due first; also a hot statement
+    static const char *selectOpenLoansSql();
+
+    bool rebuild(const QSqlDatabase &db, int userId);
+    void clear();
+
+    void add(int loanId, int bookId, const QDateTime &dueAt);
+    void renew(int loanId, const QDateTime &dueAt);
+    void remove(int loanId);
+
+    int openCount() const { return m_loans.size(); }
+    int dueSoonCount() const { return m_dueSoon; }
+    int overdueCount() const { return m_overdue; }
+
+    // Loan ids in the given state, soonest due first
+    QVector<int> loansIn(State state) const;
+
+    // { open, dueSoon, overdue, nextEventAt }
+    QVariantMap counts() const;
+
+signals:
+    void loanDueSoon(int loanId, int bookId);
+    void loanOverdue(int loanId, int bookId);
+    void countsChanged(const QVariantMap &counts);
+
+private slots:
+    void onTimeout();
+
+private:
+    struct Loan {
+        int bookId = 0;
+        qint64 dueAt = 0;   // ms since epoch, UTC
+        State state = State::Open;
+    };
+
+    struct HeapEntry {
+        qint64 fireAt;
+        int loanId;
+    };
+
+    static State stateAt(qint64 dueAt, qint64 now);
+    static qint64 nextEventAt(const Loan &loan);
+
+    // Re-evaluates the loan at `now`: updates the counts, then re-keys its
+    // heap entry or drops it once overdue
+    void place(int loanId, Loan &loan, qint64 now);
+
+    void heapPush(int loanId, qint64 fireAt);
+    void heapUpdate(int loanId, qint64 fireAt);
+    void heapRemove(int loanId);
+    void heapSwap(int a, int b);
+    void siftUp(int i);
+    void siftDown(int i);
+
+    void arm();
+
+    QHash<int, Loan> m_loans;          // every open loan
+    QVector<HeapEntry> m_heap;         // loans not yet overdue
+    QHash<int, int> m_heapIndex;       // loan id -> position in m_heap
+    int m_dueSoon;
+    int m_overdue;
+    QTimer m_timer;
+};
+
+#endif // OVERDUETRACKER_H
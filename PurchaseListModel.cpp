@@ -0,0 +1,396 @@
+#include "PurchaseListModel.h"
+#include "Database.h"
+#include <QSqlError>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+constexpr const char *kSelectPurchasesSql =
+    "SELECT pu.id, pu.product_id, p.name, pu.customer_name, pu.quantity, pu.total_price, pu.notes,"
+    " pu.income_id, pu.created_at"
+    " FROM purchases pu LEFT JOIN products p ON p.id = pu.product_id";
+constexpr const char *kSelectTotalsSql =
+    "SELECT COUNT(*), COALESCE(SUM(pu.quantity), 0), COALESCE(SUM(pu.total_price), 0)"
+    " FROM purchases pu LEFT JOIN products p ON p.id = pu.product_id";
+
+// SQLite's LIKE folds ASCII letters only; fold the same way so
+// matches() agrees with the SQL filter
+QString foldAscii(const QString &text)
+{
+    QString folded = text;
+    for (QChar &c : folded) {
+        if (c >= QLatin1Char('A') && c <= QLatin1Char('Z')) {
+            c = QChar(c.unicode() + ('a' - 'A'));
+        }
+    }
+    return folded;
+}
+
+QString likePattern(const QString &text)
+{
+    QString escaped = text;
+    escaped.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+    escaped.replace(QLatin1Char('%'), QLatin1String("\\%"));
+    escaped.replace(QLatin1Char('_'), QLatin1String("\\_"));
+    return QLatin1Char('%') + escaped + QLatin1Char('%');
+}
+}
+
+PurchaseListModel::PurchaseListModel(Database *database, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_database(database)
+    , m_productId(0)
+    , m_loadedUserId(-1)
+    , m_exhausted(true)
+    , m_totalCount(0)
+    , m_totalQuantity(0)
+    , m_totalRevenue(0.0)
+{
+    connect(m_database, &Database::purchaseAdded, this, &PurchaseListModel::onPurchaseAdded);
+    connect(m_database, &Database::purchaseUpdated, this, &PurchaseListModel::onPurchaseUpdated);
+    connect(m_database, &Database::purchaseRemoved, this, &PurchaseListModel::onPurchaseRemoved);
+    connect(m_database, &Database::purchasesReset, this, &PurchaseListModel::refresh);
+}
+
+// ============================================================================
+// QAbstractListModel
+// ============================================================================
+
+int PurchaseListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_rows.size());
+}
+
+QVariant PurchaseListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_rows.size())
+        return QVariant();
+
+    const Row &row = m_rows.at(index.row());
+    switch (role) {
+    case IdRole:           return row.id;
+    case ProductIdRole:    return row.productId;
+    case ProductNameRole:  return row.productName;
+    case CustomerNameRole: return row.customerName;
+    case QuantityRole:     return row.quantity;
+    case TotalPriceRole:   return row.totalPrice;
+    case NotesRole:        return row.notes;
+    case IncomeIdRole:     return row.incomeId;
+    case CreatedAtRole:    return row.createdAt;
+    default:               return QVariant();
+    }
+}
+
+QHash<int, QByteArray> PurchaseListModel::roleNames() const
+{
+    // Same names as the QVariantMaps Database hands out
+    return {
+        { IdRole, "id" },
+        { ProductIdRole, "product_id" },
+        { ProductNameRole, "product_name" },
+        { CustomerNameRole, "customer_name" },
+        { QuantityRole, "quantity" },
+        { TotalPriceRole, "total_price" },
+        { NotesRole, "notes" },
+        { IncomeIdRole, "income_id" },
+        { CreatedAtRole, "created_at" },
+    };
+}
+
+bool PurchaseListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !m_exhausted;
+}
+
+void PurchaseListModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || m_exhausted)
+        return;
+
+    // Keyset paging: continue below the oldest loaded id, never OFFSET
+    const int beforeId = m_rows.isEmpty() ? 0 : m_rows.last().id;
+    const QVector<Row> page = selectRows(beforeId, kPageSize);
+    m_exhausted = page.size() < kPageSize;
+
+    if (!page.isEmpty()) {
+        beginInsertRows(QModelIndex(), int(m_rows.size()), int(m_rows.size() + page.size() - 1));
+        m_rows.append(page);
+        endInsertRows();
+        emit countChanged();
+    }
+}
+
+// ============================================================================
+// Filtering
+// ============================================================================
+
+void PurchaseListModel::setFilter(int productId, const QString &searchText)
+{
+    const QString text = searchText.trimmed();
+    if (productId == m_productId && text == m_searchText && m_loadedUserId == m_database->getCurrentUserId())
+        return;
+
+    m_productId = productId;
+    m_searchText = text;
+    refresh();
+}
+
+void PurchaseListModel::refresh()
+{
+    beginResetModel();
+    m_rows.clear();
+    m_loadedUserId = m_database->getCurrentUserId();
+    m_exhausted = !m_database->isUserLoggedIn() || m_productId < 0;
+    endResetModel();
+
+    loadTotals();
+    fetchMore(QModelIndex());
+    emit countChanged();
+}
+
+QVariantMap PurchaseListModel::get(int row) const
+{
+    if (row < 0 || row >= m_rows.size())
+        return QVariantMap();
+    return rowToMap(m_rows.at(row));
+}
+
+QString PurchaseListModel::whereClause() const
+{
+    QString where = QStringLiteral(" WHERE pu.user_id = ?");
+    if (m_productId > 0)
+        where += QStringLiteral(" AND pu.product_id = ?");
+    if (!m_searchText.isEmpty()) {
+        where += QStringLiteral(" AND (p.name LIKE ? ESCAPE '\\' OR pu.customer_name LIKE ? ESCAPE '\\'"
+                                " OR pu.notes LIKE ? ESCAPE '\\' OR pu.created_at LIKE ? ESCAPE '\\')");
+    }
+    return where;
+}
+
+void PurchaseListModel::bindFilter(QSqlQuery &query) const
+{
+    query.addBindValue(m_database->getCurrentUserId());
+    if (m_productId > 0)
+        query.addBindValue(m_productId);
+    if (!m_searchText.isEmpty()) {
+        const QString pattern = likePattern(m_searchText);
+        for (int i = 0; i < 4; ++i)
+            query.addBindValue(pattern);
+    }
+}
+
+QVector<PurchaseListModel::Row> PurchaseListModel::selectRows(int beforeId, int limit, int onlyId) const
+{
+    QVector<Row> rows;
+
+    QString sql = QLatin1String(kSelectPurchasesSql) + whereClause();
+    if (beforeId > 0)
+        sql += QStringLiteral(" AND pu.id < ?");
+    if (onlyId > 0)
+        sql += QStringLiteral(" AND pu.id = ?");
+    sql += QStringLiteral(" ORDER BY pu.id DESC LIMIT ?");
+
+    QSqlQuery query(QSqlDatabase::database(m_database->connectionName()));
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    bindFilter(query);
+    if (beforeId > 0)
+        query.addBindValue(beforeId);
+    if (onlyId > 0)
+        query.addBindValue(onlyId);
+    query.addBindValue(limit);
+
+    if (!query.exec()) {
+        qWarning() << "PurchaseListModel: Failed to load purchases:" << query.lastError().text();
+        return rows;
+    }
+
+    rows.reserve(limit);
+    while (query.next())
+        rows.append(rowFromQuery(query));
+    return rows;
+}
+
+void PurchaseListModel::loadTotals()
+{
+    m_totalCount = 0;
+    m_totalQuantity = 0;
+    m_totalRevenue = 0.0;
+
+    if (m_database->isUserLoggedIn() && m_productId >= 0) {
+        QSqlQuery query(QSqlDatabase::database(m_database->connectionName()));
+        query.prepare(QLatin1String(kSelectTotalsSql) + whereClause());
+        bindFilter(query);
+
+        if (query.exec() && query.next()) {
+            m_totalCount = query.value(0).toInt();
+            m_totalQuantity = query.value(1).toLongLong();
+            m_totalRevenue = query.value(2).toDouble();
+        } else {
+            qWarning() << "PurchaseListModel: Failed to load totals:" << query.lastError().text();
+        }
+    }
+
+    emit totalsChanged();
+}
+
+bool PurchaseListModel::matches(const QVariantMap &purchase) const
+{
+    if (purchase.isEmpty() || m_productId < 0)
+        return false;
+    if (m_productId > 0 && purchase.value("product_id").toInt() != m_productId)
+        return false;
+    if (m_searchText.isEmpty())
+        return true;
+
+    const QString needle = foldAscii(m_searchText);
+    for (const char *field : { "product_name", "customer_name", "notes", "created_at" }) {
+        if (foldAscii(purchase.value(field).toString()).contains(needle))
+            return true;
+    }
+    return false;
+}
+
+// ============================================================================
+// Incremental Updates
+// ============================================================================
+
+int PurchaseListModel::rowOf(int purchaseId) const
+{
+    // Rows are sorted by id descending
+    const auto it = std::lower_bound(m_rows.cbegin(), m_rows.cend(), purchaseId,
+                                     [](const Row &row, int id) { return row.id > id; });
+    return (it != m_rows.cend() && it->id == purchaseId) ? int(it - m_rows.cbegin()) : -1;
+}
+
+int PurchaseListModel::insertPosition(int purchaseId) const
+{
+    const auto it = std::lower_bound(m_rows.cbegin(), m_rows.cend(), purchaseId,
+                                     [](const Row &row, int id) { return row.id > id; });
+    // Past the loaded tail the row arrives with a later fetchMore()
+    if (it == m_rows.cend() && !m_exhausted)
+        return -1;
+    return int(it - m_rows.cbegin());
+}
+
+void PurchaseListModel::adjustTotals(const QVariantMap &purchase, int sign)
+{
+    m_totalCount += sign;
+    m_totalQuantity += sign * purchase.value("quantity").toLongLong();
+    m_totalRevenue += sign * purchase.value("total_price").toDouble();
+}
+
+void PurchaseListModel::onPurchaseAdded(int purchaseId)
+{
+    if (m_productId < 0 || !m_database->isUserLoggedIn())
+        return;
+
+    const QVector<Row> rows = selectRows(0, 1, purchaseId);
+    if (rows.isEmpty())
+        return;  // Outside the current filter
+
+    const Row &row = rows.first();
+    adjustTotals(rowToMap(row), +1);
+    emit totalsChanged();
+
+    const int position = insertPosition(row.id);
+    if (position < 0)
+        return;
+
+    beginInsertRows(QModelIndex(), position, position);
+    m_rows.insert(position, row);
+    endInsertRows();
+    emit countChanged();
+}
+
+void PurchaseListModel::onPurchaseUpdated(const QVariantMap &before, const QVariantMap &after)
+{
+    const bool matchedBefore = matches(before);
+    const bool matchesNow = matches(after);
+    if (!matchedBefore && !matchesNow)
+        return;
+
+    if (matchedBefore)
+        adjustTotals(before, -1);
+    if (matchesNow)
+        adjustTotals(after, +1);
+    emit totalsChanged();
+
+    const int purchaseId = after.value("id").toInt();
+    const int row = rowOf(purchaseId);
+
+    if (row >= 0 && matchesNow) {
+        const QVector<Row> rows = selectRows(0, 1, purchaseId);
+        if (!rows.isEmpty()) {
+            m_rows[row] = rows.first();
+            const QModelIndex changed = index(row);
+            emit dataChanged(changed, changed);
+        }
+    } else if (row >= 0) {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_rows.remove(row);
+        endRemoveRows();
+        emit countChanged();
+    } else if (matchesNow) {
+        const int position = insertPosition(purchaseId);
+        const QVector<Row> rows = position >= 0 ? selectRows(0, 1, purchaseId) : QVector<Row>();
+        if (!rows.isEmpty()) {
+            beginInsertRows(QModelIndex(), position, position);
+            m_rows.insert(position, rows.first());
+            endInsertRows();
+            emit countChanged();
+        }
+    }
+}
+
+void PurchaseListModel::onPurchaseRemoved(const QVariantMap &before)
+{
+    if (!matches(before))
+        return;
+
+    adjustTotals(before, -1);
+    emit totalsChanged();
+
+    const int row = rowOf(before.value("id").toInt());
+    if (row < 0)
+        return;
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.remove(row);
+    endRemoveRows();
+    emit countChanged();
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+PurchaseListModel::Row PurchaseListModel::rowFromQuery(const QSqlQuery &query)
+{
+    Row row;
+    row.id = query.value(0).toInt();
+    row.productId = query.value(1).toInt();
+    row.productName = query.value(2).toString();
+    row.customerName = query.value(3).toString();
+    row.quantity = query.value(4).toInt();
+    row.totalPrice = query.value(5).toDouble();
+    row.notes = query.value(6).toString();
+    row.incomeId = query.value(7);
+    row.createdAt = query.value(8).toString();
+    return row;
+}
+
+QVariantMap PurchaseListModel::rowToMap(const Row &row)
+{
+    QVariantMap map;
+    map.insert("id", row.id);
+    map.insert("product_id", row.productId);
+    map.insert("product_name", row.productName);
+    map.insert("customer_name", row.customerName);
+    map.insert("quantity", row.quantity);
+    map.insert("total_price", row.totalPrice);
+    map.insert("notes", row.notes);
+    map.insert("income_id", row.incomeId);
+    map.insert("created_at", row.createdAt);
+    return map;
+}
@@ -0,0 +1,106 @@
+#ifndef PURCHASELISTMODEL_H
+#define PURCHASELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QSqlQuery>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+class Database;
+
+// Purchases for Overview.qml, newest first.
+// - Filtering (product, and text over product name, customer, notes and
+//   date) runs in SQL; rows arrive in keyset-paged chunks via fetchMore().
+// - Database's purchaseAdded / purchaseUpdated / purchaseRemoved signals
+//   become single-row inserts, changes and removals instead of a reset;
+//   purchasesReset (login, logout, rolled-back batch) reloads everything.
+// - totalCount / totalQuantity / totalRevenue cover the whole filtered set,
+//   not just the loaded rows, and are adjusted per change.
+class PurchaseListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+    Q_PROPERTY(int totalCount READ totalCount NOTIFY totalsChanged)
+    Q_PROPERTY(qint64 totalQuantity READ totalQuantity NOTIFY totalsChanged)
+    Q_PROPERTY(double totalRevenue READ totalRevenue NOTIFY totalsChanged)
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1,
+        ProductIdRole,
+        ProductNameRole,
+        CustomerNameRole,
+        QuantityRole,
+        TotalPriceRole,
+        NotesRole,
+        IncomeIdRole,
+        CreatedAtRole
+    };
+
+    explicit PurchaseListModel(Database *database, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // productId 0 means every product of the current user, negative means none
+    Q_INVOKABLE void setFilter(int productId, const QString &searchText);
+    Q_INVOKABLE void refresh();
+    Q_INVOKABLE QVariantMap get(int row) const;
+
+    int totalCount() const { return m_totalCount; }
+    qint64 totalQuantity() const { return m_totalQuantity; }
+    double totalRevenue() const { return m_totalRevenue; }
+
+signals:
+    void countChanged();
+    void totalsChanged();
+
+private slots:
+    void onPurchaseAdded(int purchaseId);
+    void onPurchaseUpdated(const QVariantMap &before, const QVariantMap &after);
+    void onPurchaseRemoved(const QVariantMap &before);
+
+private:
+    struct Row {
+        int id = 0;
+        int productId = 0;
+        QString productName;
+        QString customerName;
+        int quantity = 0;
+        double totalPrice = 0.0;
+        QString notes;
+        QVariant incomeId;
+        QString createdAt;
+    };
+
+    static constexpr int kPageSize = 200;
+
+    QString whereClause() const;
+    void bindFilter(QSqlQuery &query) const;
+    QVector<Row> selectRows(int beforeId, int limit, int onlyId = 0) const;
+    void loadTotals();
+    bool matches(const QVariantMap &purchase) const;
+    int rowOf(int purchaseId) const;
+    int insertPosition(int purchaseId) const;
+    void adjustTotals(const QVariantMap &purchase, int sign);
+
+    static Row rowFromQuery(const QSqlQuery &query);
+    static QVariantMap rowToMap(const Row &row);
+
+    Database *m_database;
+    int m_productId;
+    QString m_searchText;
+    int m_loadedUserId;   // whose purchases m_rows and the totals hold
+    QVector<Row> m_rows;
+    bool m_exhausted;
+
+    int m_totalCount;
+    qint64 m_totalQuantity;
+    double m_totalRevenue;
+};
+
+#endif // PURCHASELISTMODEL_H
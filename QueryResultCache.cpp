@@ -0,0 +1,141 @@
+#include "QueryResultCache.h"
+
+QueryResultCache::QueryResultCache(int maxEntries, qint64 maxBytes)
+    : m_maxEntries(maxEntries)
+    , m_maxBytes(maxBytes)
+    , m_bytes(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+const QueryResultCache::Entry *QueryResultCache::find(const QString &key, quint64 version)
+{
+    auto it = m_entries.find(key);
+    if (it == m_entries.end() || it->entry.version != version) {
+        if (it != m_entries.end()) {
+            // Computed against an older catalog: drop it now
+            m_bytes -= it->entry.bytes;
+            m_order.erase(it->position);
+            m_entries.erase(it);
+        }
+        ++m_misses;
+        return nullptr;
+    }
+
+    // Promote to most recently used
+    m_order.splice(m_order.begin(), m_order, it->position);
+    ++m_hits;
+    return &it->entry;
+}
+
+void QueryResultCache::insert(const QString &key, const QVariantList &result, quint64 version, const QString &tag)
+{
+    remove(key);
+
+    Node node;
+    node.entry.result = result;
+    node.entry.version = version;
+    node.entry.tag = tag;
+    node.entry.bytes = estimateBytes(result) + key.size() * qint64(sizeof(QChar));
+
+    // Larger than the whole budget: not worth caching
+    if (node.entry.bytes > m_maxBytes) {
+        return;
+    }
+
+    m_order.push_front(key);
+    node.position = m_order.begin();
+    m_bytes += node.entry.bytes;
+    m_entries.insert(key, node);
+
+    evict();
+}
+
+int QueryResultCache::removeIf(const std::function<bool(const QString &, const Entry &)> &predicate)
+{
+    int removed = 0;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (predicate(it.key(), it->entry)) {
+            m_bytes -= it->entry.bytes;
+            m_order.erase(it->position);
+            it = m_entries.erase(it);
+            ++removed;
+        } else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
+void QueryResultCache::remove(const QString &key)
+{
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    m_bytes -= it->entry.bytes;
+    m_order.erase(it->position);
+    m_entries.erase(it);
+}
+
+void QueryResultCache::clear()
+{
+    m_entries.clear();
+    m_order.clear();
+    m_bytes = 0;
+}
+
+void QueryResultCache::setLimits(int maxEntries, qint64 maxBytes)
+{
+    m_maxEntries = qMax(0, maxEntries);
+    m_maxBytes = qMax<qint64>(0, maxBytes);
+    evict();
+}
+
+void QueryResultCache::evict()
+{
+    while (!m_order.empty() && (m_entries.size() > m_maxEntries || m_bytes > m_maxBytes)) {
+        const QString key = m_order.back();
+        remove(key);
+    }
+}
+
+double QueryResultCache::hitRate() const
+{
+    const quint64 total = m_hits + m_misses;
+    return total == 0 ? 0.0 : double(m_hits) / double(total);
+}
+
+QVariantMap QueryResultCache::stats() const
+{
+    QVariantMap map;
+    map.insert("entries", m_entries.size());
+    map.insert("bytes", m_bytes);
+    map.insert("maxEntries", m_maxEntries);
+    map.insert("maxBytes", m_maxBytes);
+    map.insert("hits", m_hits);
+    map.insert("misses", m_misses);
+    map.insert("hitRate", hitRate());
+    return map;
+}
+
+qint64 QueryResultCache::estimateBytes(const QVariantList &result)
+{
+    // Rough but stable: variant and map node overhead plus string payloads
+    constexpr qint64 kVariantOverhead = 32;
+    constexpr qint64 kMapNodeOverhead = 48;
+
+    qint64 bytes = result.size() * kVariantOverhead;
+    for (const QVariant &value : result) {
+        const QVariantMap map = value.toMap();
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            bytes += kMapNodeOverhead + it.key().size() * qint64(sizeof(QChar));
+            if (it.value().typeId() == QMetaType::QString) {
+                bytes += it.value().toString().size() * qint64(sizeof(QChar));
+            }
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,64 @@
+#ifndef QUERYRESULTCACHE_H
+#define QUERYRESULTCACHE_H
+
+#include <QHash>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <functional>
+#include <list>
+
+// Small LRU cache for in-memory query results (searchBook, getRelatedBooks).
+// Bounded by entry count and by an estimate of the bytes the cached
+// QVariantLists hold. Entries carry the catalog version they were computed
+// against plus a tag the owner uses for targeted invalidation.
+class QueryResultCache
+{
+public:
+    struct Entry {
+        QVariantList result;
+        quint64 version = 0;
+        QString tag;
+        qint64 bytes = 0;
+    };
+
+    QueryResultCache(int maxEntries = 256, qint64 maxBytes = 4 * 1024 * 1024);
+
+    // Returns the entry if present and computed against `version`
+    const Entry *find(const QString &key, quint64 version);
+    void insert(const QString &key, const QVariantList &result, quint64 version, const QString &tag = QString());
+
+    // Removes every entry the predicate accepts; returns how many were removed
+    int removeIf(const std::function<bool(const QString &key, const Entry &entry)> &predicate);
+    void remove(const QString &key);
+    void clear();
+
+    void setLimits(int maxEntries, qint64 maxBytes);
+
+    int size() const { return m_entries.size(); }
+    qint64 bytes() const { return m_bytes; }
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+    double hitRate() const;
+    QVariantMap stats() const;
+
+    static qint64 estimateBytes(const QVariantList &result);
+
+private:
+    struct Node {
+        Entry entry;
+        std::list<QString>::iterator position;
+    };
+
+    void evict();
+
+    QHash<QString, Node> m_entries;
+    std::list<QString> m_order;  // front = most recently used
+    int m_maxEntries;
+    qint64 m_maxBytes;
+    qint64 m_bytes;
+    quint64 m_hits;
+    quint64 m_misses;
+};
+
+#endif // QUERYRESULTCACHE_H
@@ -0,0 +1,186 @@
+#include "RemoteImageLoader.h"
+#include <QCoreApplication>
+#include <QNetworkAccessManager>
+#include <QNetworkDiskCache>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QDebug>
+#include <utility>
+
+namespace {
+constexpr qint64 kDiskCacheBytes = 64 * 1024 * 1024;
+constexpr int kDefaultRequestsPerHost = 4;
+
+// Replies served from the disk cache carry the stored validators too
+QString contentVersion(const QNetworkReply *reply, const QByteArray &data)
+{
+    const QByteArray etag = reply->rawHeader("ETag");
+    if (!etag.isEmpty()) {
+        return QString::fromLatin1(etag);
+    }
+    const QByteArray lastModified = reply->rawHeader("Last-Modified");
+    if (!lastModified.isEmpty()) {
+        return QString::fromLatin1(lastModified);
+    }
+    return QString::number(qHash(data), 16);
+}
+}
+
+RemoteImageLoader::RemoteImageLoader(QObject *parent)
+    : QObject(parent)
+    , m_manager(new QNetworkAccessManager(this))
+    , m_maxRequestsPerHost(kDefaultRequestsPerHost)
+{
+    auto *cache = new QNetworkDiskCache(m_manager);
+    cache->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+                             + QStringLiteral("/network"));
+    cache->setMaximumCacheSize(kDiskCacheBytes);
+    m_manager->setCache(cache);
+
+    // Static instances outlive QGuiApplication; the manager must not
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        connect(app, &QCoreApplication::aboutToQuit, this, &RemoteImageLoader::shutdown);
+    }
+}
+
+RemoteImageLoader *RemoteImageLoader::instance()
+{
+    static RemoteImageLoader loader;
+    return &loader;
+}
+
+bool RemoteImageLoader::isRemote(const QUrl &url)
+{
+    return url.scheme() == QLatin1String("http") || url.scheme() == QLatin1String("https");
+}
+
+void RemoteImageLoader::setMaxRequestsPerHost(int count)
+{
+    m_maxRequestsPerHost = qMax(1, count);
+}
+
+void RemoteImageLoader::fetch(const QUrl &url, QObject *requester)
+{
+    if (!m_manager) {
+        emit imageFetched(url, QByteArray(), QString(), QStringLiteral("Network access has been shut down"));
+        return;
+    }
+
+    auto it = m_requests.find(url);
+    if (it != m_requests.end()) {
+        // Coalesce with the request already queued or in flight
+        if (!it->requesters.contains(requester)) {
+            it->requesters.append(requester);
+        }
+        return;
+    }
+
+    Request request;
+    request.requesters.append(requester);
+    m_requests.insert(url, request);
+
+    m_queued[url.host()].enqueue(url);
+    startNext(url.host());
+}
+
+void RemoteImageLoader::cancel(const QUrl &url, QObject *requester)
+{
+    auto it = m_requests.find(url);
+    if (it == m_requests.end()) {
+        return;
+    }
+
+    it->requesters.removeAll(requester);
+    it->requesters.removeAll(nullptr);
+    if (!it->requesters.isEmpty()) {
+        return;
+    }
+
+    // Nobody is waiting anymore: drop it from the queue or abort the transfer
+    QNetworkReply *reply = it->reply;
+    m_requests.erase(it);
+
+    if (reply) {
+        reply->abort();
+    } else {
+        m_queued[url.host()].removeAll(url);
+    }
+}
+
+void RemoteImageLoader::shutdown()
+{
+    if (!m_manager) {
+        return;
+    }
+
+    // Nobody is told about aborted requests; the application is going away
+    const QHash<QUrl, Request> requests = std::exchange(m_requests, {});
+    for (const Request &request : requests) {
+        if (request.reply) {
+            request.reply->disconnect(this);
+            request.reply->abort();
+        }
+    }
+    m_queued.clear();
+    m_active.clear();
+
+    delete m_manager;
+    m_manager = nullptr;
+}
+
+void RemoteImageLoader::startNext(const QString &host)
+{
+    QQueue<QUrl> &queue = m_queued[host];
+    while (!queue.isEmpty() && m_active.value(host) < m_maxRequestsPerHost) {
+        start(queue.dequeue());
+    }
+}
+
+void RemoteImageLoader::start(const QUrl &url)
+{
+    QNetworkRequest request(url);
+
+    // PreferNetwork makes QNetworkAccessManager serve fresh disk entries
+    // directly and revalidate stale ones with If-None-Match/If-Modified-Since
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+    request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, true);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+
+    QNetworkReply *reply = m_manager->get(request);
+    reply->setProperty("imageUrl", url);
+    m_requests[url].reply = reply;
+    m_active[url.host()] += 1;
+
+    connect(reply, &QNetworkReply::finished, this, &RemoteImageLoader::onReplyFinished);
+}
+
+void RemoteImageLoader::onReplyFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply)
+        return;
+
+    reply->deleteLater();
+
+    const QUrl url = reply->property("imageUrl").toUrl();
+    const QString host = url.host();
+    m_active[host] = qMax(0, m_active.value(host) - 1);
+
+    // A cancelled request was already removed from m_requests
+    const auto it = m_requests.constFind(url);
+    const bool stillWanted = it != m_requests.constEnd() && it->reply == reply;
+    if (stillWanted) {
+        m_requests.remove(url);
+
+        if (reply->error() == QNetworkReply::NoError) {
+            const QByteArray data = reply->readAll();
+            emit imageFetched(url, data, contentVersion(reply, data), QString());
+        } else {
+            qWarning() << "RemoteImageLoader: Failed to fetch" << url << reply->errorString();
+            emit imageFetched(url, QByteArray(), QString(), reply->errorString());
+        }
+    }
+
+    startNext(host);
+}
@@ -0,0 +1,70 @@
+#ifndef REMOTEIMAGELOADER_H
+#define REMOTEIMAGELOADER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QQueue>
+#include <QUrl>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+// Shared HTTP(S) fetcher for remote cover and avatar images.
+// - Responses go through a QNetworkDiskCache; stale entries are revalidated
+//   with ETag / If-Modified-Since and a 304 is served from disk.
+// - Identical URLs requested by several items share one network request.
+// - At most maxRequestsPerHost() requests run per host, the rest queue.
+// - A request is aborted once every item that asked for it cancelled.
+// - The network stack is torn down on QCoreApplication::aboutToQuit, while
+//   the application still exists, rather than with this static instance.
+class RemoteImageLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    static RemoteImageLoader *instance();
+
+    void fetch(const QUrl &url, QObject *requester);
+    void cancel(const QUrl &url, QObject *requester);
+
+    int maxRequestsPerHost() const { return m_maxRequestsPerHost; }
+    void setMaxRequestsPerHost(int count);
+
+    static bool isRemote(const QUrl &url);
+
+    // Aborts everything and deletes the network access manager; later
+    // fetches fail right away. Runs on aboutToQuit.
+    void shutdown();
+
+signals:
+    // Broadcast to every requester; receivers filter on url. `version`
+    // names this content of the URL: its ETag, else Last-Modified, else a
+    // hash of the bytes.
+    void imageFetched(const QUrl &url, const QByteArray &data, const QString &version,
+                      const QString &errorString);
+
+private slots:
+    void onReplyFinished();
+
+private:
+    explicit RemoteImageLoader(QObject *parent = nullptr);
+
+    struct Request {
+        QList<QPointer<QObject>> requesters;
+        QNetworkReply *reply = nullptr;
+    };
+
+    void startNext(const QString &host);
+    void start(const QUrl &url);
+
+    QNetworkAccessManager *m_manager;
+    QHash<QUrl, Request> m_requests;
+    QHash<QString, QQueue<QUrl>> m_queued;  // host -> waiting urls
+    QHash<QString, int> m_active;           // host -> running requests
+    int m_maxRequestsPerHost;
+};
+
+#endif // REMOTEIMAGELOADER_H
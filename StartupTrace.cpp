@@ -0,0 +1,149 @@
+#include "StartupTrace.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQuickWindow>
+#include <QSaveFile>
+#include <QTimer>
+
+namespace {
+// Started during static initialization, before main() runs; the closest
+// portable stand-in for the process start time
+const QElapsedTimer g_processClock = [] {
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}();
+
+constexpr const char *kTraceFileVariable = "SIGMATERIAL_STARTUP_TRACE";
+constexpr const char *kTraceExitVariable = "SIGMATERIAL_STARTUP_TRACE_EXIT";
+}
+
+StartupTrace::StartupTrace(QObject *parent)
+    : QObject(parent)
+{
+    m_marks.append(qMakePair(QStringLiteral("processStart"), qint64(0)));
+}
+
+StartupTrace *StartupTrace::instance()
+{
+    static StartupTrace trace;
+    return &trace;
+}
+
+void StartupTrace::attach(QQuickWindow *window)
+{
+    if (!window) {
+        qWarning() << "StartupTrace: No window to attach to";
+        return;
+    }
+
+    // frameSwapped comes from the render thread; the queued connection
+    // brings it back to the GUI thread
+    connect(window, &QQuickWindow::frameSwapped, this, [this]() {
+        mark(QStringLiteral("firstFrame"));
+        QTimer::singleShot(0, this, [this]() {
+            mark(QStringLiteral("interactive"));
+            emit interactive();
+        });
+    }, static_cast<Qt::ConnectionType>(Qt::QueuedConnection | Qt::SingleShotConnection));
+}
+
+void StartupTrace::mark(const QString &name)
+{
+    if (m_finished) {
+        return;
+    }
+    m_marks.append(qMakePair(name, g_processClock.nsecsElapsed()));
+}
+
+void StartupTrace::finish()
+{
+    if (m_finished) {
+        return;
+    }
+    mark(QStringLiteral("traceFinished"));
+    m_finished = true;
+
+    for (const auto &entry : m_marks) {
+        qDebug() << "Startup:" << qPrintable(entry.first) << entry.second / 1000000.0 << "ms";
+    }
+
+    const QString filePath = qEnvironmentVariable(kTraceFileVariable);
+    if (!filePath.isEmpty() && !writeTrace(filePath)) {
+        qWarning() << "StartupTrace: Could not write" << filePath;
+    }
+
+    if (qEnvironmentVariableIntValue(kTraceExitVariable) == 1) {
+        QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+    }
+}
+
+QVariantList StartupTrace::timeline() const
+{
+    QVariantList result;
+    for (const auto &entry : m_marks) {
+        QVariantMap item;
+        item.insert("name", entry.first);
+        item.insert("ms", entry.second / 1000000.0);
+        result.append(item);
+    }
+    return result;
+}
+
+bool StartupTrace::writeTrace(const QString &filePath) const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+
+    // Instant events for every mark ...
+    qint64 firstFrame = -1;
+    qint64 interactiveAt = -1;
+    for (const auto &entry : m_marks) {
+        QJsonObject event;
+        event.insert("name", entry.first);
+        event.insert("ph", "i");
+        event.insert("s", "g");
+        event.insert("ts", double(entry.second) / 1000.0);
+        event.insert("pid", pid);
+        event.insert("tid", 0);
+        events.append(event);
+
+        if (entry.first == QLatin1String("firstFrame")) {
+            firstFrame = entry.second;
+        } else if (entry.first == QLatin1String("interactive")) {
+            interactiveAt = entry.second;
+        }
+    }
+
+    // ... and the two phases CI tracks as complete events
+    const auto phase = [&](const char *name, qint64 from, qint64 to) {
+        if (from < 0 || to < from) {
+            return;
+        }
+        QJsonObject event;
+        event.insert("name", name);
+        event.insert("ph", "X");
+        event.insert("ts", double(from) / 1000.0);
+        event.insert("dur", double(to - from) / 1000.0);
+        event.insert("pid", pid);
+        event.insert("tid", 0);
+        events.append(event);
+    };
+    phase("startToFirstFrame", 0, firstFrame);
+    phase("firstFrameToInteractive", firstFrame, interactiveAt);
+
+    QJsonObject root;
+    root.insert("traceEvents", events);
+    root.insert("displayTimeUnit", "ms");
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
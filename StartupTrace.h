@@ -0,0 +1,49 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QVariantList>
+#include <QVector>
+
+class QQuickWindow;
+
+// Cold-start timeline: process start -> first frame -> interactive, plus
+// any marks QML adds (page loads, prewarm). Times are milliseconds since
+// the executable's static initialization.
+//
+// With SIGMATERIAL_STARTUP_TRACE=<file> set, finish() writes the timeline
+// in Chrome trace event format (chrome://tracing, Perfetto). With
+// SIGMATERIAL_STARTUP_TRACE_EXIT=1 the application quits once the trace
+// is written, so CI can record a startup run unattended.
+class StartupTrace : public QObject
+{
+    Q_OBJECT
+
+public:
+    static StartupTrace *instance();
+
+    // Marks "firstFrame" when the window first presents and "interactive"
+    // once the event loop has drained the work queued behind that frame
+    void attach(QQuickWindow *window);
+
+    Q_INVOKABLE void mark(const QString &name);
+    Q_INVOKABLE void finish();
+
+    // [{ name, ms }] in recording order
+    Q_INVOKABLE QVariantList timeline() const;
+
+signals:
+    void interactive();
+
+private:
+    explicit StartupTrace(QObject *parent = nullptr);
+
+    bool writeTrace(const QString &filePath) const;
+
+    QVector<QPair<QString, qint64>> m_marks;  // name -> nanoseconds since process start
+    bool m_finished = false;
+};
+
+#endif // STARTUPTRACE_H
@@ -0,0 +1,337 @@
+#include "StockLedger.h"
+#include <QObject>
+#include <QRunnable>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QVariantList>
+#include <QDebug>
+#include <limits>
+
+namespace {
+constexpr const char *kApplyMovementSql =
+    "UPDATE products SET stock = stock + ?, movements_since_snapshot = movements_since_snapshot + 1"
+    " WHERE id = ? AND user_id = ? AND stock + ? >= 0";
+constexpr const char *kInsertMovementSql =
+    "INSERT INTO stock_movements (user_id, product_id, quantity_added, movement_type, description)"
+    " VALUES (?, ?, ?, ?, ?)";
+constexpr const char *kSelectLevelSql =
+    "SELECT stock, movements_since_snapshot FROM products WHERE id = ? AND user_id = ?";
+constexpr const char *kInsertSnapshotSql =
+    "INSERT OR REPLACE INTO stock_snapshots (product_id, movement_id, stock, taken_at)"
+    " SELECT p.id, m.id, p.stock, m.created_at FROM products p JOIN stock_movements m ON m.id = ?"
+    " WHERE p.id = ?";
+constexpr const char *kResetSnapshotCounterSql =
+    "UPDATE products SET movements_since_snapshot = 0 WHERE id = ?";
+constexpr const char *kSnapshotBeforeSql =
+    "SELECT movement_id, stock FROM stock_snapshots WHERE product_id = ? AND taken_at <= ?"
+    " ORDER BY taken_at DESC, movement_id DESC LIMIT 1";
+constexpr const char *kNextSnapshotSql =
+    "SELECT MIN(movement_id) FROM stock_snapshots WHERE product_id = ? AND movement_id > ?";
+constexpr const char *kReplaySql =
+    "SELECT COALESCE(SUM(quantity_added), 0) FROM stock_movements"
+    " WHERE user_id = ? AND product_id = ? AND id > ? AND id <= ? AND created_at <= ?";
+
+// Materialized level vs. latest snapshot plus the movements after it
+constexpr const char *kCheckLevelsSql = R"(
+    SELECT p.id, p.stock,
+           COALESCE(s.stock, 0) + (SELECT COALESCE(SUM(m.quantity_added), 0) FROM stock_movements m
+                                   WHERE m.user_id = p.user_id AND m.product_id = p.id
+                                     AND m.id > COALESCE(s.movement_id, 0))
+    FROM products p
+    LEFT JOIN stock_snapshots s ON s.product_id = p.id
+         AND s.movement_id = (SELECT MAX(movement_id) FROM stock_snapshots WHERE product_id = p.id)
+    WHERE p.user_id = ?)";
+
+// Consecutive snapshots must differ by exactly the movements between them
+constexpr const char *kCheckChainSql = R"(
+    WITH chain AS (
+        SELECT s.product_id, s.movement_id, s.stock,
+               LAG(s.movement_id) OVER w AS prev_id,
+               LAG(s.stock) OVER w AS prev_stock
+        FROM stock_snapshots s JOIN products p ON p.id = s.product_id
+        WHERE p.user_id = ?
+        WINDOW w AS (PARTITION BY s.product_id ORDER BY s.movement_id))
+    SELECT c.product_id, c.movement_id, c.stock - c.prev_stock,
+           (SELECT COALESCE(SUM(m.quantity_added), 0) FROM stock_movements m
+            WHERE m.user_id = ? AND m.product_id = c.product_id
+              AND m.id > c.prev_id AND m.id <= c.movement_id)
+    FROM chain c WHERE c.prev_id IS NOT NULL)";
+
+// created_at is CURRENT_TIMESTAMP, i.e. UTC "yyyy-MM-dd HH:mm:ss"
+QString sqlTimestamp(const QDateTime &at)
+{
+    return at.toUTC().toString(QStringLiteral("yyyy-MM-dd HH:mm:ss"));
+}
+
+// Runs the audit off the GUI thread on a cloned connection
+class ConsistencyJob : public QRunnable
+{
+public:
+    ConsistencyJob(const QString &connectionName, int userId, QObject *receiver, const char *slot)
+        : m_connectionName(connectionName)
+        , m_userId(userId)
+        , m_receiver(receiver)
+        , m_slot(slot)
+    {
+    }
+
+    void run() override
+    {
+        QVariantMap report;
+        const QString connection = QStringLiteral("stock-check-")
+                                 + QString::number(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+        {
+            QSqlDatabase db = QSqlDatabase::cloneDatabase(m_connectionName, connection);
+            if (db.open()) {
+                report = StockLedger::checkConsistency(db, m_userId);
+            } else {
+                report.insert("error", db.lastError().text());
+            }
+        }
+        QSqlDatabase::removeDatabase(connection);
+
+        QMetaObject::invokeMethod(m_receiver, m_slot, Qt::QueuedConnection, Q_ARG(QVariantMap, report));
+    }
+
+private:
+    QString m_connectionName;
+    int m_userId;
+    QObject *m_receiver;
+    const char *m_slot;
+};
+}
+
+// ============================================================================
+// Schema
+// ============================================================================
+
+bool StockLedger::migrate(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+
+    bool hasCounter = false;
+    if (query.exec("PRAGMA table_info(products)")) {
+        while (query.next()) {
+            if (query.value("name").toString() == QLatin1String("movements_since_snapshot")) {
+                hasCounter = true;
+            }
+        }
+    }
+
+    const QStringList statements = {
+        hasCounter ? QString()
+                   : QStringLiteral("ALTER TABLE products ADD COLUMN movements_since_snapshot INTEGER NOT NULL DEFAULT 0"),
+        R"(CREATE TABLE IF NOT EXISTS stock_snapshots (
+            product_id INTEGER NOT NULL,
+            movement_id INTEGER NOT NULL,
+            stock INTEGER NOT NULL,
+            taken_at DATETIME NOT NULL,
+            PRIMARY KEY (product_id, movement_id),
+            FOREIGN KEY (product_id) REFERENCES products (id)
+        ) WITHOUT ROWID)",
+        "CREATE INDEX IF NOT EXISTS idx_stock_snapshots_time ON stock_snapshots (product_id, taken_at, movement_id)",
+        // Existing levels become the baseline; history before it replays from zero
+        R"(INSERT OR IGNORE INTO stock_snapshots (product_id, movement_id, stock, taken_at)
+           SELECT p.id,
+                  COALESCE((SELECT MAX(m.id) FROM stock_movements m WHERE m.product_id = p.id), 0),
+                  p.stock, CURRENT_TIMESTAMP
+           FROM products p)",
+    };
+
+    for (const QString &statement : statements) {
+        if (statement.isEmpty()) {
+            continue;
+        }
+        if (!query.exec(statement)) {
+            qWarning() << "StockLedger: Migration failed:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Movements
+// ============================================================================
+
+int StockLedger::recordMovement(QSqlDatabase &db, int userId, int productId, int quantity,
+                                const QString &movementType, const QString &description)
+{
+    QSqlQuery query(db);
+
+    // Conditional update: never lets the level drop below zero
+    query.prepare(kApplyMovementSql);
+    query.addBindValue(quantity);
+    query.addBindValue(productId);
+    query.addBindValue(userId);
+    query.addBindValue(quantity);
+    if (!query.exec()) {
+        qWarning() << "StockLedger: Failed to apply movement:" << query.lastError().text();
+        return -1;
+    }
+    if (query.numRowsAffected() != 1) {
+        qWarning() << "StockLedger: Product" << productId << "not found or stock would go negative";
+        return -1;
+    }
+
+    query.prepare(kInsertMovementSql);
+    query.addBindValue(userId);
+    query.addBindValue(productId);
+    query.addBindValue(quantity);
+    query.addBindValue(movementType);
+    query.addBindValue(description);
+    if (!query.exec()) {
+        qWarning() << "StockLedger: Failed to append movement:" << query.lastError().text();
+        return -1;
+    }
+    const qint64 movementId = query.lastInsertId().toLongLong();
+
+    query.prepare(kSelectLevelSql);
+    query.addBindValue(productId);
+    query.addBindValue(userId);
+    if (!query.exec() || !query.next()) {
+        qWarning() << "StockLedger: Failed to read level:" << query.lastError().text();
+        return -1;
+    }
+    const int level = query.value(0).toInt();
+    const int sinceSnapshot = query.value(1).toInt();
+
+    if (sinceSnapshot >= kSnapshotInterval) {
+        query.prepare(kInsertSnapshotSql);
+        query.addBindValue(movementId);
+        query.addBindValue(productId);
+        if (!query.exec()) {
+            qWarning() << "StockLedger: Failed to write snapshot:" << query.lastError().text();
+            return -1;
+        }
+
+        query.prepare(kResetSnapshotCounterSql);
+        query.addBindValue(productId);
+        if (!query.exec()) {
+            qWarning() << "StockLedger: Failed to reset snapshot counter:" << query.lastError().text();
+            return -1;
+        }
+    }
+
+    return level;
+}
+
+int StockLedger::currentLevel(const QSqlDatabase &db, int userId, int productId)
+{
+    QSqlQuery query(db);
+    query.prepare(kSelectLevelSql);
+    query.addBindValue(productId);
+    query.addBindValue(userId);
+    if (!query.exec() || !query.next()) {
+        return -1;
+    }
+    return query.value(0).toInt();
+}
+
+int StockLedger::levelAt(const QSqlDatabase &db, int userId, int productId, const QDateTime &at)
+{
+    if (!at.isValid()) {
+        return -1;
+    }
+
+    const QString timestamp = sqlTimestamp(at);
+    QSqlQuery query(db);
+
+    // Nearest snapshot at or before `at`; none means replay from the start
+    qint64 fromMovement = 0;
+    int level = 0;
+    query.prepare(kSnapshotBeforeSql);
+    query.addBindValue(productId);
+    query.addBindValue(timestamp);
+    if (query.exec() && query.next()) {
+        fromMovement = query.value(0).toLongLong();
+        level = query.value(1).toInt();
+    }
+
+    // The following snapshot bounds the replay to one interval
+    qint64 toMovement = std::numeric_limits<qint64>::max();
+    query.prepare(kNextSnapshotSql);
+    query.addBindValue(productId);
+    query.addBindValue(fromMovement);
+    if (query.exec() && query.next() && !query.value(0).isNull()) {
+        toMovement = query.value(0).toLongLong();
+    }
+
+    query.prepare(kReplaySql);
+    query.addBindValue(userId);
+    query.addBindValue(productId);
+    query.addBindValue(fromMovement);
+    query.addBindValue(toMovement);
+    query.addBindValue(timestamp);
+    if (!query.exec() || !query.next()) {
+        qWarning() << "StockLedger: Failed to replay movements:" << query.lastError().text();
+        return -1;
+    }
+
+    return level + query.value(0).toInt();
+}
+
+// ============================================================================
+// Consistency Checking
+// ============================================================================
+
+void StockLedger::startConsistencyCheck(QThreadPool &pool, const QString &connectionName, int userId,
+                                        QObject *receiver, const char *slot)
+{
+    pool.start(new ConsistencyJob(connectionName, userId, receiver, slot));
+}
+
+QVariantMap StockLedger::checkConsistency(const QSqlDatabase &db, int userId)
+{
+    QVariantMap report;
+    QVariantList mismatches;
+    int checkedProducts = 0;
+    int checkedSnapshots = 0;
+
+    QSqlQuery query(db);
+    query.prepare(kCheckLevelsSql);
+    query.addBindValue(userId);
+    if (!query.exec()) {
+        report.insert("error", query.lastError().text());
+        return report;
+    }
+    while (query.next()) {
+        ++checkedProducts;
+        if (query.value(1).toLongLong() != query.value(2).toLongLong()) {
+            QVariantMap mismatch;
+            mismatch.insert("productId", query.value(0).toInt());
+            mismatch.insert("kind", "level");
+            mismatch.insert("expected", query.value(2).toLongLong());
+            mismatch.insert("actual", query.value(1).toLongLong());
+            mismatches.append(mismatch);
+        }
+    }
+
+    query.prepare(kCheckChainSql);
+    query.addBindValue(userId);
+    query.addBindValue(userId);
+    if (!query.exec()) {
+        report.insert("error", query.lastError().text());
+        return report;
+    }
+    while (query.next()) {
+        ++checkedSnapshots;
+        if (query.value(2).toLongLong() != query.value(3).toLongLong()) {
+            QVariantMap mismatch;
+            mismatch.insert("productId", query.value(0).toInt());
+            mismatch.insert("kind", "snapshot");
+            mismatch.insert("movementId", query.value(1).toLongLong());
+            mismatch.insert("expected", query.value(3).toLongLong());
+            mismatch.insert("actual", query.value(2).toLongLong());
+            mismatches.append(mismatch);
+        }
+    }
+
+    report.insert("checkedProducts", checkedProducts);
+    report.insert("checkedSnapshots", checkedSnapshots);
+    report.insert("mismatches", mismatches);
+    return report;
+}
@@ -0,0 +1,49 @@
+#ifndef STOCKLEDGER_H
+#define STOCKLEDGER_H
+
+#include <QDateTime>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVariantMap>
+
+class QObject;
+class QThreadPool;
+
+// Stock engine over the append-only stock_movements ledger.
+// - products.stock is the materialized level; recordMovement() changes it
+//   and appends the movement in one transaction.
+// - Every kSnapshotInterval movements of a product a row in
+//   stock_snapshots pins its level, so levelAt() replays at most one
+//   interval of movements instead of the product's whole history.
+// - startConsistencyCheck() audits levels and the snapshot chain on a
+//   worker thread with its own connection.
+class StockLedger
+{
+public:
+    static constexpr int kSnapshotInterval = 256;
+
+    // Creates the snapshot table and a baseline snapshot per product.
+    // Runs inside the migration transaction.
+    static bool migrate(QSqlDatabase &db);
+
+    // Applies quantity (negative for outgoing stock) and returns the new
+    // level, or -1 if the product is unknown or would go below zero.
+    // The caller owns the transaction.
+    static int recordMovement(QSqlDatabase &db, int userId, int productId, int quantity,
+                              const QString &movementType, const QString &description);
+
+    static int currentLevel(const QSqlDatabase &db, int userId, int productId);
+
+    // Level after every movement recorded at or before `at`
+    static int levelAt(const QSqlDatabase &db, int userId, int productId, const QDateTime &at);
+
+    // Runs on `pool` and posts a QVariantMap report to receiver's `slot` (queued):
+    // { checkedProducts, checkedSnapshots, mismatches: [{ productId, kind, expected, actual }] }
+    // The receiver must drain `pool` before it is destroyed.
+    static void startConsistencyCheck(QThreadPool &pool, const QString &connectionName, int userId,
+                                      QObject *receiver, const char *slot);
+
+    static QVariantMap checkConsistency(const QSqlDatabase &db, int userId);
+};
+
+#endif // STOCKLEDGER_H
@@ -0,0 +1,213 @@
+#include "SubstringScanner.h"
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SUBSTRING_SCANNER_SSE2
+#include <immintrin.h>
+#if defined(__GNUC__)
+// GCC and Clang build the AVX2 kernel with a per-function target and check
+// the CPU at runtime, so the rest of the binary keeps its baseline ISA
+#define SUBSTRING_SCANNER_AVX2
+#endif
+#endif
+
+namespace {
+using Kernel = qsizetype (*)(const char16_t *haystack, qsizetype haystackSize,
+                             const char16_t *needle, qsizetype needleSize);
+
+// First and last units already matched
+inline bool middleMatches(const char16_t *at, const char16_t *needle, qsizetype needleSize)
+{
+    return needleSize <= 2
+        || std::memcmp(at + 1, needle + 1, size_t(needleSize - 2) * sizeof(char16_t)) == 0;
+}
+
+#ifdef SUBSTRING_SCANNER_SSE2
+qsizetype findTail(const char16_t *haystack, qsizetype haystackSize,
+                   const char16_t *needle, qsizetype needleSize, qsizetype from)
+{
+    const char16_t first = needle[0];
+    const char16_t last = needle[needleSize - 1];
+    for (qsizetype i = from; i + needleSize <= haystackSize; ++i) {
+        if (haystack[i] == first && haystack[i + needleSize - 1] == last
+            && middleMatches(haystack + i, needle, needleSize)) {
+            return i;
+        }
+    }
+    return -1;
+}
+#endif
+
+qsizetype findScalar(const char16_t *haystack, qsizetype haystackSize,
+                     const char16_t *needle, qsizetype needleSize)
+{
+    return QStringView(haystack, haystackSize).indexOf(QStringView(needle, needleSize));
+}
+
+#ifdef SUBSTRING_SCANNER_SSE2
+qsizetype findSse2(const char16_t *haystack, qsizetype haystackSize,
+                   const char16_t *needle, qsizetype needleSize)
+{
+    const __m128i first = _mm_set1_epi16(short(needle[0]));
+    const __m128i last = _mm_set1_epi16(short(needle[needleSize - 1]));
+
+    qsizetype i = 0;
+    for (; i + 8 + needleSize - 1 <= haystackSize; i += 8) {
+        const __m128i atFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        const __m128i atLast = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(haystack + i + needleSize - 1));
+        const __m128i both = _mm_and_si128(_mm_cmpeq_epi16(atFirst, first), _mm_cmpeq_epi16(atLast, last));
+
+        // movemask yields two bits per 16-bit lane; keep the low one
+        quint32 mask = quint32(_mm_movemask_epi8(both)) & 0x5555u;
+        while (mask) {
+            const qsizetype lane = qCountTrailingZeroBits(mask) / 2;
+            if (middleMatches(haystack + i + lane, needle, needleSize)) {
+                return i + lane;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findTail(haystack, haystackSize, needle, needleSize, i);
+}
+#endif
+
+#ifdef SUBSTRING_SCANNER_AVX2
+__attribute__((target("avx2")))
+qsizetype findAvx2(const char16_t *haystack, qsizetype haystackSize,
+                   const char16_t *needle, qsizetype needleSize)
+{
+    const __m256i first = _mm256_set1_epi16(short(needle[0]));
+    const __m256i last = _mm256_set1_epi16(short(needle[needleSize - 1]));
+
+    qsizetype i = 0;
+    for (; i + 16 + needleSize - 1 <= haystackSize; i += 16) {
+        const __m256i atFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+        const __m256i atLast = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(haystack + i + needleSize - 1));
+        const __m256i both = _mm256_and_si256(_mm256_cmpeq_epi16(atFirst, first),
+                                              _mm256_cmpeq_epi16(atLast, last));
+
+        quint32 mask = quint32(_mm256_movemask_epi8(both)) & 0x55555555u;
+        while (mask) {
+            const qsizetype lane = qCountTrailingZeroBits(mask) / 2;
+            if (middleMatches(haystack + i + lane, needle, needleSize)) {
+                return i + lane;
+            }
+            mask &= mask - 1;
+        }
+    }
+    // Short keys (most titles) never reach the vector loop; SSE2 covers them
+    const qsizetype rest = findSse2(haystack + i, haystackSize - i, needle, needleSize);
+    return rest >= 0 ? i + rest : -1;
+}
+#endif
+
+struct KernelChoice {
+    Kernel find;
+    const char *name;
+};
+
+// Every kernel this build and CPU can run, fastest first
+QVector<KernelChoice> availableKernelChoices()
+{
+    QVector<KernelChoice> kernels;
+#ifdef SUBSTRING_SCANNER_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.append({ findAvx2, "avx2" });
+    }
+#endif
+#ifdef SUBSTRING_SCANNER_SSE2
+    kernels.append({ findSse2, "sse2" });
+#endif
+    kernels.append({ findScalar, "scalar" });
+    return kernels;
+}
+
+KernelChoice &kernel()
+{
+    static KernelChoice choice = availableKernelChoices().constFirst();
+    return choice;
+}
+}
+
+qsizetype SubstringScanner::find(QStringView haystack, QStringView needle)
+{
+    if (needle.isEmpty()) {
+        return 0;
+    }
+    if (needle.size() > haystack.size()) {
+        return -1;
+    }
+    return kernel().find(haystack.utf16(), haystack.size(), needle.utf16(), needle.size());
+}
+
+const char *SubstringScanner::kernelName()
+{
+    return kernel().name;
+}
+
+QStringList SubstringScanner::availableKernels()
+{
+    QStringList names;
+    for (const KernelChoice &choice : availableKernelChoices()) {
+        names.append(QString::fromLatin1(choice.name));
+    }
+    return names;
+}
+
+bool SubstringScanner::setKernel(const QString &name)
+{
+    for (const KernelChoice &choice : availableKernelChoices()) {
+        if (name == QLatin1String(choice.name)) {
+            kernel() = choice;
+            return true;
+        }
+    }
+    return false;
+}
+
+int SubstringScanner::shardCount(qsizetype count)
+{
+    const qsizetype byWork = count / kMinShardSize;
+    return int(qBound<qsizetype>(1, byWork, qMax(1, QThread::idealThreadCount())));
+}
+
+void SubstringScanner::forEachShard(qsizetype count, const std::function<void(int, qsizetype, qsizetype)> &work)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    const int shards = shardCount(count);
+    const auto boundary = [count, shards](int shard) { return count * shard / shards; };
+    if (shards == 1) {
+        work(0, 0, count);
+        return;
+    }
+
+    QSemaphore finished;
+    QThreadPool *pool = QThreadPool::globalInstance();
+    for (int shard = 1; shard < shards; ++shard) {
+        const qsizetype begin = boundary(shard);
+        const qsizetype end = boundary(shard + 1);
+        std::function<void()> task = [&work, &finished, shard, begin, end]() {
+            work(shard, begin, end);
+            finished.release();
+        };
+        // Never queue behind long-running jobs (exports, rebuilds): if no
+        // thread is free right now the caller does the shard itself
+        if (!pool->tryStart(task)) {
+            task();
+        }
+    }
+
+    work(0, 0, boundary(1));
+    finished.acquire(shards - 1);
+}
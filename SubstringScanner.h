@@ -0,0 +1,45 @@
+#ifndef SUBSTRINGSCANNER_H
+#define SUBSTRINGSCANNER_H
+
+#include <QStringList>
+#include <QStringView>
+#include <functional>
+
+// Brute-force substring matching for queries no index can answer.
+// - find() compares UTF-16 code units exactly; callers pass text that was
+//   already normalized and case-folded on both sides (Book::searchKeys).
+// - The kernel is picked once at startup: AVX2 (16 positions per step) when
+//   the CPU has it, SSE2 (8) on other x86, Qt's indexOf ("scalar")
+//   elsewhere. The vector kernels test the needle's first and last unit at
+//   every position and only compare the middle where both match.
+// - forEachShard() splits a scan across the global thread pool; the calling
+//   thread takes the first shard and waits for the rest.
+class SubstringScanner
+{
+public:
+    // Below this many records per shard, thread handoff costs more than it saves
+    static constexpr qsizetype kMinShardSize = 16384;
+
+    // Offset of needle in haystack, or -1. An empty needle matches at 0.
+    static qsizetype find(QStringView haystack, QStringView needle);
+    static bool contains(QStringView haystack, QStringView needle) { return find(haystack, needle) >= 0; }
+
+    // "avx2", "sse2" or "scalar"
+    static const char *kernelName();
+
+    // Kernels this build and CPU can run, fastest (the default) first
+    static QStringList availableKernels();
+
+    // Makes later find() calls use `name`; false if it cannot run here.
+    // For tests and benchmarks; never call while a scan is running.
+    static bool setKernel(const QString &name);
+
+    static int shardCount(qsizetype count);
+
+    // Calls work(shard, begin, end) for consecutive ranges covering
+    // [0, count), shard 0 first; returns once every shard has finished.
+    // Shards that find no free pool thread run on the caller.
+    static void forEachShard(qsizetype count, const std::function<void(int, qsizetype, qsizetype)> &work);
+};
+
+#endif // SUBSTRINGSCANNER_H
@@ -0,0 +1,487 @@
+#include "ThumbnailCache.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
+#include <QDebug>
+
+namespace {
+constexpr const char *kIndexFileName = "index.json";
+constexpr const char *kThumbnailSuffix = ".thumb";
+
+// <cache>/<first two hex digits>/<sha1>-<bucket>.thumb
+QString thumbnailFilePath(const QString &directory, const QString &hash, int bucket)
+{
+    return directory + QLatin1Char('/') + hash.left(2) + QLatin1Char('/') + hash
+           + QLatin1Char('-') + QString::number(bucket) + QLatin1String(kThumbnailSuffix);
+}
+
+// Hashes one cover and writes every missing size bucket for it. Runs on the
+// cache's private pool; the index is only touched back on the owner's thread.
+class ThumbnailJob : public QRunnable
+{
+public:
+    ThumbnailJob(ThumbnailCache *cache, const QString &imagePath, const QString &directory, bool force)
+        : m_cache(cache)
+        , m_imagePath(imagePath)
+        , m_directory(directory)
+        , m_force(force)
+    {
+    }
+
+    void run() override
+    {
+        QString hash;
+        const QFileInfo info(m_imagePath);
+
+        QFile file(m_imagePath);
+        if (file.open(QIODevice::ReadOnly)) {
+            QCryptographicHash hasher(QCryptographicHash::Sha1);
+            if (hasher.addData(&file)) {
+                hash = QString::fromLatin1(hasher.result().toHex());
+            }
+            file.close();
+        }
+
+        if (hash.isEmpty()) {
+            qWarning() << "ThumbnailCache: Cannot read cover:" << m_imagePath;
+        } else if (!writeThumbnails(hash)) {
+            hash.clear();
+        }
+
+        QMetaObject::invokeMethod(m_cache, "finishJob", Qt::QueuedConnection,
+                                  Q_ARG(QString, m_imagePath),
+                                  Q_ARG(QString, hash),
+                                  Q_ARG(qint64, info.lastModified().toMSecsSinceEpoch()),
+                                  Q_ARG(qint64, info.size()));
+    }
+
+private:
+    bool writeThumbnails(const QString &hash)
+    {
+        QDir dir(m_directory);
+        const QString shard = hash.left(2);
+        if (!dir.mkpath(shard)) {
+            qWarning() << "ThumbnailCache: Cannot create cache directory:" << dir.filePath(shard);
+            return false;
+        }
+
+        // Identical content was already processed for another book
+        QStringList missing;
+        QVector<int> missingBuckets;
+        for (int bucket : ThumbnailCache::buckets()) {
+            const QString target = thumbnailFilePath(m_directory, hash, bucket);
+            if (m_force || !QFileInfo::exists(target)) {
+                missing.append(target);
+                missingBuckets.append(bucket);
+            }
+        }
+
+        if (missing.isEmpty()) {
+            return true;
+        }
+
+        QImageReader reader(m_imagePath);
+        reader.setAutoTransform(true);
+        const QImage source = reader.read();
+        if (source.isNull()) {
+            qWarning() << "ThumbnailCache: Failed to decode cover:" << m_imagePath << reader.errorString();
+            return false;
+        }
+
+        const char *format = source.hasAlphaChannel() ? "PNG" : "JPG";
+        for (int i = 0; i < missing.size(); ++i) {
+            const int bucket = missingBuckets.at(i);
+            const QImage thumbnail = (source.width() <= bucket && source.height() <= bucket)
+                ? source
+                : source.scaled(bucket, bucket, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+            // Write atomically so readers never observe a half-written file
+            QSaveFile out(missing.at(i));
+            if (!out.open(QIODevice::WriteOnly) || !thumbnail.save(&out, format, 85) || !out.commit()) {
+                qWarning() << "ThumbnailCache: Failed to write thumbnail:" << missing.at(i);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    ThumbnailCache *m_cache;
+    QString m_imagePath;
+    QString m_directory;
+    bool m_force;
+};
+
+// Deletes thumbnail files whose hash is not in `liveHashes`
+class SweepJob : public QRunnable
+{
+public:
+    SweepJob(ThumbnailCache *cache, const QString &directory, const QSet<QString> &liveHashes)
+        : m_cache(cache)
+        , m_directory(directory)
+        , m_liveHashes(liveHashes)
+    {
+    }
+
+    void run() override
+    {
+        int removed = 0;
+        QDirIterator files(m_directory, { QStringLiteral("*") + QLatin1String(kThumbnailSuffix) },
+                           QDir::Files, QDirIterator::Subdirectories);
+        while (files.hasNext()) {
+            const QString file = files.next();
+            const QString hash = QFileInfo(file).fileName().section(QLatin1Char('-'), 0, 0);
+            if (!m_liveHashes.contains(hash) && QFile::remove(file)) {
+                ++removed;
+            }
+        }
+
+        QMetaObject::invokeMethod(m_cache, "finishSweep", Qt::QueuedConnection, Q_ARG(int, removed));
+    }
+
+private:
+    ThumbnailCache *m_cache;
+    QString m_directory;
+    QSet<QString> m_liveHashes;
+};
+}
+
+ThumbnailCache::ThumbnailCache(QObject *parent)
+    : QObject(parent)
+    , m_sweepRunning(false)
+    , m_sweepWanted(false)
+    , m_indexDirty(false)
+{
+    m_pool.setMaxThreadCount(kMaxJobs);
+    m_pool.setThreadPriority(QThread::LowPriority);
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(kSaveDelayMs);
+    connect(&m_saveTimer, &QTimer::timeout, this, &ThumbnailCache::flushIndex);
+
+    // Write the last batch while the application is still fully alive
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        connect(app, &QCoreApplication::aboutToQuit, this, &ThumbnailCache::flushIndex);
+    }
+
+    setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+                      + QStringLiteral("/thumbnails"));
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    // Jobs post back to this object; covers not started yet are dropped
+    m_pool.clear();
+    m_pool.waitForDone();
+    flushIndex();
+}
+
+ThumbnailCache *ThumbnailCache::instance()
+{
+    static ThumbnailCache cache;
+    return &cache;
+}
+
+const QVector<int> &ThumbnailCache::buckets()
+{
+    static const QVector<int> sizes = { 64, 128, 256, 512 };
+    return sizes;
+}
+
+void ThumbnailCache::setCacheDirectory(const QString &directory)
+{
+    // Unsaved entries belong to the previous directory
+    flushIndex();
+    m_directory = directory;
+    m_index.clear();
+    QDir().mkpath(m_directory);
+    loadIndex();
+}
+
+QString ThumbnailCache::normalizePath(const QString &imagePath)
+{
+    const QString trimmed = imagePath.trimmed();
+    if (trimmed.isEmpty()) {
+        return QString();
+    }
+
+    // QML hands over file:// URLs, the database may hold either form
+    const QUrl url(trimmed);
+    const QString local = url.isLocalFile() ? url.toLocalFile() : trimmed;
+    return QFileInfo(local).absoluteFilePath();
+}
+
+void ThumbnailCache::submit(const QString &imagePath)
+{
+    schedule(normalizePath(imagePath), false);
+}
+
+void ThumbnailCache::regenerateAll(const QStringList &imagePaths)
+{
+    for (const QString &path : imagePaths) {
+        schedule(normalizePath(path), true);
+    }
+}
+
+void ThumbnailCache::schedule(const QString &imagePath, bool force)
+{
+    if (imagePath.isEmpty() || m_pending.contains(imagePath)) {
+        return;
+    }
+
+    const QFileInfo info(imagePath);
+    if (!info.exists()) {
+        return;
+    }
+
+    // Skip work when the indexed content is still current
+    const auto it = m_index.constFind(imagePath);
+    if (!force && it != m_index.constEnd()
+        && it->modified == info.lastModified().toMSecsSinceEpoch()
+        && it->size == info.size()) {
+        return;
+    }
+
+    m_pending.insert(imagePath);
+
+    // Started once the sweep is done, or it could delete this cover's files
+    if (m_sweepRunning) {
+        m_deferred.insert(imagePath, force);
+        return;
+    }
+    m_pool.start(new ThumbnailJob(this, imagePath, m_directory, force));
+}
+
+void ThumbnailCache::finishJob(const QString &imagePath, const QString &hash, qint64 modified, qint64 fileSize)
+{
+    m_pending.remove(imagePath);
+
+    if (!hash.isEmpty()) {
+        Entry entry;
+        entry.hash = hash;
+        entry.modified = modified;
+        entry.size = fileSize;
+        m_index.insert(imagePath, entry);
+        scheduleSave();
+    }
+
+    // A sweep held back by running jobs; this cover's hash is indexed now
+    if (m_pending.isEmpty() && m_sweepWanted) {
+        sweepOrphans();
+    }
+
+    if (!hash.isEmpty()) {
+        emit thumbnailsReady(imagePath);
+    }
+}
+
+QString ThumbnailCache::thumbnailPath(const QString &hash, int bucket) const
+{
+    return thumbnailFilePath(m_directory, hash, bucket);
+}
+
+QString ThumbnailCache::resolve(const QString &imagePath, int size)
+{
+    const QString path = normalizePath(imagePath);
+    if (path.isEmpty()) {
+        return QString();
+    }
+
+    const auto it = m_index.constFind(path);
+    if (it == m_index.constEnd()) {
+        submit(path);
+        return path;
+    }
+
+    // The source changed on disk since it was hashed; serve it directly
+    // while a fresh set is generated in the background
+    const QFileInfo info(path);
+    if (it->modified != info.lastModified().toMSecsSinceEpoch() || it->size != info.size()) {
+        submit(path);
+        return path;
+    }
+
+    // Smallest bucket that still covers the requested size
+    for (int bucket : buckets()) {
+        if (bucket >= size) {
+            const QString candidate = thumbnailPath(it->hash, bucket);
+            if (QFileInfo::exists(candidate)) {
+                return candidate;
+            }
+            break;
+        }
+    }
+
+    // Displayed larger than the biggest bucket: the original is the best fit
+    return path;
+}
+
+QUrl ThumbnailCache::thumbnailUrl(const QString &imagePath, int size)
+{
+    const QString path = resolve(imagePath, size);
+    return path.isEmpty() ? QUrl() : QUrl::fromLocalFile(path);
+}
+
+void ThumbnailCache::collectGarbage(const QStringList &livePaths)
+{
+    QSet<QString> live;
+    for (const QString &path : livePaths) {
+        live.insert(normalizePath(path));
+    }
+
+    bool pruned = false;
+    for (auto it = m_index.begin(); it != m_index.end();) {
+        if (!live.contains(it.key())) {
+            it = m_index.erase(it);
+            pruned = true;
+        } else {
+            ++it;
+        }
+    }
+    if (pruned) {
+        scheduleSave();
+    }
+
+    sweepOrphans();
+}
+
+void ThumbnailCache::sweepOrphans()
+{
+    // Thumbnails still being generated have no index entry yet
+    if (m_sweepRunning || !m_pending.isEmpty()) {
+        m_sweepWanted = true;
+        return;
+    }
+
+    QSet<QString> liveHashes;
+    for (const Entry &entry : m_index) {
+        liveHashes.insert(entry.hash);
+    }
+
+    m_sweepWanted = false;
+    m_sweepRunning = true;
+    m_pool.start(new SweepJob(this, m_directory, liveHashes));
+}
+
+void ThumbnailCache::finishSweep(int removed)
+{
+    m_sweepRunning = false;
+    if (removed > 0) {
+        qDebug() << "ThumbnailCache: Removed" << removed << "orphaned thumbnails";
+    }
+
+    for (auto it = m_deferred.constBegin(); it != m_deferred.constEnd(); ++it) {
+        m_pool.start(new ThumbnailJob(this, it.key(), m_directory, it.value()));
+    }
+    m_deferred.clear();
+
+    if (m_sweepWanted && m_pending.isEmpty()) {
+        sweepOrphans();
+    }
+}
+
+QVariantMap ThumbnailCache::cacheReport() const
+{
+    qint64 totalBytes = 0;
+    int fileCount = 0;
+    QVariantMap bytesPerBucket;
+
+    QDirIterator files(m_directory, { QStringLiteral("*") + QLatin1String(kThumbnailSuffix) },
+                       QDir::Files, QDirIterator::Subdirectories);
+    while (files.hasNext()) {
+        files.next();
+        const QFileInfo info = files.fileInfo();
+        const QString bucket = info.completeBaseName().section(QLatin1Char('-'), 1, 1);
+        bytesPerBucket[bucket] = bytesPerBucket.value(bucket).toLongLong() + info.size();
+        totalBytes += info.size();
+        ++fileCount;
+    }
+
+    QSet<QString> hashes;
+    for (const Entry &entry : m_index) {
+        hashes.insert(entry.hash);
+    }
+
+    QVariantMap report;
+    report.insert("directory", m_directory);
+    report.insert("sourceCount", m_index.size());
+    report.insert("uniqueCovers", hashes.size());
+    report.insert("fileCount", fileCount);
+    report.insert("totalBytes", totalBytes);
+    report.insert("bytesPerBucket", bytesPerBucket);
+    report.insert("pending", m_pending.size());
+    return report;
+}
+
+void ThumbnailCache::loadIndex()
+{
+    QFile file(QDir(m_directory).filePath(QLatin1String(kIndexFileName)));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonArray entries = QJsonDocument::fromJson(file.readAll()).array();
+    for (const QJsonValue &value : entries) {
+        const QJsonObject object = value.toObject();
+        Entry entry;
+        entry.hash = object.value("hash").toString();
+        entry.modified = static_cast<qint64>(object.value("modified").toDouble());
+        entry.size = static_cast<qint64>(object.value("size").toDouble());
+        if (!entry.hash.isEmpty()) {
+            m_index.insert(object.value("path").toString(), entry);
+        }
+    }
+}
+
+// Starts the save timer without restarting it, so a steady stream of
+// finished jobs still reaches disk every kSaveDelayMs
+void ThumbnailCache::scheduleSave()
+{
+    m_indexDirty = true;
+    if (!m_saveTimer.isActive()) {
+        m_saveTimer.start();
+    }
+}
+
+void ThumbnailCache::flushIndex()
+{
+    m_saveTimer.stop();
+    if (!m_indexDirty) {
+        return;
+    }
+    m_indexDirty = false;
+    saveIndex();
+}
+
+void ThumbnailCache::saveIndex() const
+{
+    QJsonArray entries;
+    for (auto it = m_index.constBegin(); it != m_index.constEnd(); ++it) {
+        QJsonObject object;
+        object.insert("path", it.key());
+        object.insert("hash", it->hash);
+        object.insert("modified", static_cast<double>(it->modified));
+        object.insert("size", static_cast<double>(it->size));
+        entries.append(object);
+    }
+
+    QSaveFile file(QDir(m_directory).filePath(QLatin1String(kIndexFileName)));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "ThumbnailCache: Cannot write index:" << file.fileName();
+        return;
+    }
+    file.write(QJsonDocument(entries).toJson(QJsonDocument::Compact));
+    file.commit();
+}
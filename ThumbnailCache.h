@@ -0,0 +1,97 @@
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+#include <QVariantMap>
+#include <QVector>
+
+// On-disk, content-addressed thumbnail store for book covers. Each source
+// image is hashed once; thumbnails are written per size bucket under that hash,
+// so duplicate covers share the same files no matter how many books use them.
+// Jobs run on a private pool of kMaxJobs threads, so a catalog load that
+// submits every cover leaves the global pool to search shards and avatar
+// renders.
+class ThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Finished jobs are folded into index.json at most this often
+    static constexpr int kSaveDelayMs = 1000;
+    static constexpr int kMaxJobs = 2;
+
+    static ThumbnailCache *instance();
+    ~ThumbnailCache();
+
+    // Size buckets (edge length in pixels) that thumbnails are generated for
+    static const QVector<int> &buckets();
+
+    QString cacheDirectory() const { return m_directory; }
+    void setCacheDirectory(const QString &directory);
+
+    // Schedules hashing and thumbnail generation for a cover in the background
+    void submit(const QString &imagePath);
+
+    // Regenerates thumbnails for every path, even when they look current
+    void regenerateAll(const QStringList &imagePaths);
+
+
+    // Best-fitting thumbnail for a cover displayed at `size` pixels, or the
+    // original path when no current thumbnail exists yet
+    QString resolve(const QString &imagePath, int size);
+
+    Q_INVOKABLE QUrl thumbnailUrl(const QString &imagePath, int size);
+    Q_INVOKABLE QVariantMap cacheReport() const;
+
+    static QString normalizePath(const QString &imagePath);
+
+public slots:
+    // Drops index entries for paths no longer referenced by any book, then
+    // deletes thumbnails whose content hash became unreferenced on the pool.
+    // The sweep waits for running jobs, and covers submitted meanwhile wait
+    // for the sweep, so it never deletes a set that is still being written.
+    void collectGarbage(const QStringList &livePaths);
+
+signals:
+    void thumbnailsReady(const QString &imagePath);
+
+private slots:
+    void finishJob(const QString &imagePath, const QString &hash, qint64 modified, qint64 fileSize);
+    void flushIndex();
+    void finishSweep(int removed);
+
+private:
+    explicit ThumbnailCache(QObject *parent = nullptr);
+
+    struct Entry {
+        QString hash;
+        qint64 modified = 0;
+        qint64 size = 0;
+    };
+
+    void schedule(const QString &imagePath, bool force);
+    void sweepOrphans();
+    void loadIndex();
+    void scheduleSave();
+    void saveIndex() const;
+    QString thumbnailPath(const QString &hash, int bucket) const;
+
+    QString m_directory;
+    QHash<QString, Entry> m_index;   // normalized source path -> content entry
+    QSet<QString> m_pending;
+    QHash<QString, bool> m_deferred;   // submitted during a sweep -> force
+    bool m_sweepRunning;
+    bool m_sweepWanted;
+    QThreadPool m_pool;
+    QTimer m_saveTimer;
+    bool m_indexDirty;
+};
+
+#endif // THUMBNAILCACHE_H
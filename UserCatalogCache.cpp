@@ -0,0 +1,140 @@
+#include "UserCatalogCache.h"
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+
+// ============================================================================
+// Constructor
+// ============================================================================
+
+UserCatalogCache::UserCatalogCache(QObject *parent)
+    : QObject(parent)
+    , m_entries(kDefaultBudgetBytes)
+    , m_idleSeconds(kDefaultIdleSeconds)
+    , m_hits(0)
+    , m_misses(0)
+    , m_stale(0)
+    , m_purged(0)
+{
+    m_purgeTimer.setSingleShot(true);
+    connect(&m_purgeTimer, &QTimer::timeout, this, &UserCatalogCache::purgeIdle);
+}
+
+void UserCatalogCache::setLimits(qint64 budgetBytes, int idleSeconds)
+{
+    // Shrinking the budget evicts right away
+    m_entries.setMaxCost(qMax<qint64>(0, budgetBytes));
+    m_idleSeconds = qMax(0, idleSeconds);
+    purgeIdle();
+}
+
+// ============================================================================
+// Entries
+// ============================================================================
+
+void UserCatalogCache::store(int userId, std::unique_ptr<Entry> entry)
+{
+    m_entries.remove(userId);
+    m_storedAt.remove(userId);
+    if (!entry || entry->revision < 0 || m_idleSeconds == 0 || m_entries.maxCost() == 0) {
+        return;
+    }
+
+    const qint64 bytes = estimateBytes(*entry);
+    // QCache deletes an entry over budget instead of storing it
+    if (!m_entries.insert(userId, entry.release(), qMax<qint64>(1, bytes))) {
+        qDebug() << "UserCatalogCache: Catalog of user" << userId << "exceeds the budget";
+        return;
+    }
+    m_storedAt.insert(userId, QDateTime::currentMSecsSinceEpoch());
+    arm();
+}
+
+std::unique_ptr<UserCatalogCache::Entry> UserCatalogCache::take(int userId, qint64 revision)
+{
+    m_storedAt.remove(userId);
+    std::unique_ptr<Entry> entry(m_entries.take(userId));
+    if (!entry) {
+        ++m_misses;
+        return nullptr;
+    }
+
+    // Books were written since logout, here or from another connection
+    if (revision < 0 || entry->revision != revision) {
+        ++m_stale;
+        return nullptr;
+    }
+
+    ++m_hits;
+    return entry;
+}
+
+void UserCatalogCache::clear()
+{
+    m_entries.clear();
+    m_storedAt.clear();
+    m_purgeTimer.stop();
+}
+
+QVariantMap UserCatalogCache::stats() const
+{
+    QVariantMap map;
+    map.insert("users", m_entries.count());
+    map.insert("bytes", m_entries.totalCost());
+    map.insert("budgetBytes", m_entries.maxCost());
+    map.insert("idleSeconds", m_idleSeconds);
+    map.insert("hits", m_hits);
+    map.insert("misses", m_misses);
+    map.insert("stale", m_stale);
+    map.insert("purged", m_purged);
+    return map;
+}
+
+// ============================================================================
+// Idle Purge
+// ============================================================================
+
+void UserCatalogCache::purgeIdle()
+{
+    const qint64 cutoff = QDateTime::currentMSecsSinceEpoch() - qint64(m_idleSeconds) * 1000;
+    for (auto it = m_storedAt.begin(); it != m_storedAt.end();) {
+        // Entries evicted for the budget leave their timestamp behind
+        if (!m_entries.contains(it.key())) {
+            it = m_storedAt.erase(it);
+        } else if (it.value() <= cutoff) {
+            m_entries.remove(it.key());
+            ++m_purged;
+            it = m_storedAt.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    arm();
+}
+
+void UserCatalogCache::arm()
+{
+    if (m_storedAt.isEmpty()) {
+        m_purgeTimer.stop();
+        return;
+    }
+
+    const qint64 oldest = *std::min_element(m_storedAt.cbegin(), m_storedAt.cend());
+    const qint64 delay = oldest + qint64(m_idleSeconds) * 1000 - QDateTime::currentMSecsSinceEpoch();
+    m_purgeTimer.start(int(qBound<qint64>(0, delay, std::numeric_limits<int>::max())));
+}
+
+qint64 UserCatalogCache::estimateBytes(const Entry &entry)
+{
+    qint64 bytes = entry.arena ? entry.arena->reservedBytes() : 0;
+    bytes += entry.books.capacity() * qint64(sizeof(Database::Book));
+    for (const Database::Book &book : entry.books) {
+        bytes += book.searchKeys.capacity() * qint64(sizeof(QChar));
+    }
+    for (auto it = entry.genreGraph.cbegin(); it != entry.genreGraph.cend(); ++it) {
+        bytes += it.key().size() * qint64(sizeof(QChar)) + it.value().capacity() * qint64(sizeof(int));
+    }
+    bytes += entry.duplicates.size() * qint64(sizeof(DuplicateDetector::Signature) * 2);
+    return bytes;
+}
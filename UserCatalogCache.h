@@ -0,0 +1,78 @@
+#ifndef USERCATALOGCACHE_H
+#define USERCATALOGCACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+#include <memory>
+#include "Database.h"
+
+// Catalogs of logged-out users, kept so switching accounts on a shared
+// terminal does not reload and re-index the whole catalog.
+// - An entry is a user's loaded books with their arena and derived
+//   indexes, stamped with the user's catalog revision (bumped by triggers
+//   on every books write). take() only hands it back while the revision in
+//   the database still matches; otherwise it is dropped and the caller
+//   reloads.
+// - Entries share an LRU byte budget; the user who logged out longest ago
+//   is evicted first.
+// - Entries idle longer than the idle timeout are purged, so a terminal
+//   left alone does not keep other staff's catalogs in memory.
+class UserCatalogCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 kDefaultBudgetBytes = 256LL * 1024 * 1024;
+    static constexpr int kDefaultIdleSeconds = 15 * 60;
+
+    struct Entry {
+        QVector<Database::Book> books;
+        std::shared_ptr<CatalogArena> arena;   // owns the books' strings
+        QMap<QString, QVector<int>> genreGraph;
+        DuplicateDetector duplicates;
+        bool duplicatesStale = true;
+        bool sortedByTitle = false;
+        bool sortedByYear = false;
+        qint64 catalogPeakBytes = 0;
+        qint64 revision = -1;
+    };
+
+    explicit UserCatalogCache(QObject *parent = nullptr);
+
+    // Budget 0 or an idle timeout of 0 disables caching
+    void setLimits(qint64 budgetBytes, int idleSeconds);
+
+    // Replaces any entry of userId; dropped when larger than the budget
+    void store(int userId, std::unique_ptr<Entry> entry);
+
+    // The entry of userId if it was stored at `revision`, else null
+    std::unique_ptr<Entry> take(int userId, qint64 revision);
+
+    void clear();
+
+    // { users, bytes, budgetBytes, idleSeconds, hits, misses, stale, purged }
+    QVariantMap stats() const;
+
+private slots:
+    void purgeIdle();
+
+private:
+    static qint64 estimateBytes(const Entry &entry);
+    void arm();
+
+    QCache<int, Entry> m_entries;      // cost in estimated bytes
+    QHash<int, qint64> m_storedAt;     // user id -> ms since epoch; may outlive evicted entries
+    int m_idleSeconds;
+    QTimer m_purgeTimer;
+    int m_hits;
+    int m_misses;
+    int m_stale;
+    int m_purged;
+};
+
+#endif // USERCATALOGCACHE_H
@@ -0,0 +1,107 @@
+#ifndef BENCHSUPPORT_H
+#define BENCHSUPPORT_H
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QString>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVariantMap>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include "Database.h"
+#include "ThumbnailCache.h"
+
+// Helpers shared by the sigmaterial-bench-* tools. Each tool runs against
+// scratch databases in a temporary directory and never touches the user's
+// perpustakaan.db or thumbnail cache.
+namespace Bench {
+
+inline const QString kUsername = QStringLiteral("bench");
+inline const QString kPassword = QStringLiteral("bench-password");
+
+// Keeps thumbnails out of the user's cache and Database's per-call
+// diagnostics (refused checkouts, empty searches) out of the timings
+inline void setUp(const QTemporaryDir &workDir)
+{
+    ThumbnailCache::instance()->setCacheDirectory(workDir.filePath("thumbnails"));
+    QLoggingCategory::setFilterRules(QStringLiteral("default.debug=false"));
+}
+
+// Opens `filePath` on its own connection and logs the bench user in,
+// creating the user on first use
+inline bool openSession(Database &database, const QString &filePath, const QString &connectionName)
+{
+    database.setDatabaseLocation(filePath, connectionName);
+    if (!database.initDatabase()) {
+        return false;
+    }
+    if (!database.loginUser(kUsername, kPassword)) {
+        return database.createUser(kUsername, kPassword) && database.loginUser(kUsername, kPassword);
+    }
+    return true;
+}
+
+inline QSqlDatabase connection(const Database &database)
+{
+    return QSqlDatabase::database(database.connectionName());
+}
+
+// Plain product rows at zero stock; Database has no API to create them
+inline QVector<int> createProducts(const Database &database, int count, const QString &namePrefix)
+{
+    QVector<int> productIds;
+    QSqlQuery query(connection(database));
+    query.prepare("INSERT INTO products (user_id, name, category, stock, price) VALUES (?, ?, ?, 0, 1000)");
+    for (int i = 0; i < count; ++i) {
+        query.addBindValue(database.getCurrentUserId());
+        query.addBindValue(QStringLiteral("%1 %2").arg(namePrefix).arg(i));
+        query.addBindValue(QStringLiteral("Category %1").arg(i % 17));
+        if (!query.exec()) {
+            qWarning() << "Bench: Could not create a product:" << query.lastError().text();
+            return {};
+        }
+        productIds.append(query.lastInsertId().toInt());
+    }
+    return productIds;
+}
+
+// Nearest rank over unsorted samples
+inline double percentileMs(QVector<qint64> samplesNs, double percentile)
+{
+    if (samplesNs.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(samplesNs.begin(), samplesNs.end());
+    const qsizetype rank = qsizetype(std::ceil(percentile / 100.0 * samplesNs.size()));
+    return samplesNs.at(qBound<qsizetype>(0, rank - 1, samplesNs.size() - 1)) / 1000000.0;
+}
+
+inline QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+inline bool writeJson(const QString &filePath, const QVariantMap &report)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Bench: Could not write" << filePath;
+        return false;
+    }
+    file.write(QJsonDocument(QJsonObject::fromVariantMap(report)).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
+
+} // namespace Bench
+
+#endif // BENCHSUPPORT_H
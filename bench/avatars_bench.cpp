@@ -0,0 +1,273 @@
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QGuiApplication>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QQmlEngine>
+#include <QQuickItem>
+#include <QQuickView>
+#include <QTimer>
+#include "BenchSupport.h"
+#include "CircularImage.h"
+#include "CircularImageCache.h"
+#include "CircularImageItem.h"
+#include "ThumbnailCache.h"
+
+// sigmaterial-bench-avatars [--items n] [--frames n] [--variant painted|scenegraph|both] [--json file]
+//
+// A grid of avatars showing one large photo, drawn once with the painted
+// CircularImage and once with the scene-graph CircularImageItem. Reports how
+// long the grid takes until every avatar is Ready, then resizes the whole
+// grid every frame and reports frame, sync and render times. The render loop
+// is forced to "basic" so sync and render run on this thread and can be
+// timed; run with QT_QPA_PLATFORM=offscreen to take vsync out of the frame
+// times.
+namespace {
+constexpr const char *kSceneQml = R"(
+import QtQuick
+import CircularImage 1.0
+
+Item {
+    id: root
+    property real edge: 48
+    property url imageSource
+    property int count: 0
+
+    Flow {
+        anchors.fill: parent
+        spacing: 4
+        Repeater {
+            model: root.count
+            delegate: %1 {
+                width: root.edge
+                height: root.edge
+                source: root.imageSource
+                borderWidth: 2
+                borderColor: "#3366cc"
+            }
+        }
+    }
+}
+)";
+
+// Stand-in for a camera photo: large, non-square, with detail to scale
+bool writeSourceImage(const QString &filePath)
+{
+    QImage image(1600, 1200, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, image.width(), image.height());
+    gradient.setColorAt(0.0, QColor("#1d3557"));
+    gradient.setColorAt(0.5, QColor("#e63946"));
+    gradient.setColorAt(1.0, QColor("#f1faee"));
+    painter.fillRect(image.rect(), gradient);
+    for (int i = 0; i < image.width(); i += 40) {
+        painter.drawLine(i, 0, image.width() - i, image.height());
+    }
+    painter.end();
+    return image.save(filePath, "JPG", 90);
+}
+
+QVector<QQuickItem *> avatars(QQuickItem *root, const char *typeName)
+{
+    QVector<QQuickItem *> result;
+    const QList<QQuickItem *> items = root->findChildren<QQuickItem *>();
+    for (QQuickItem *item : items) {
+        if (item->inherits(typeName)) {
+            result.append(item);
+        }
+    }
+    return result;
+}
+
+struct FrameTimes {
+    QVector<qint64> frameNs;
+    QVector<qint64> syncNs;
+    QVector<qint64> renderNs;
+};
+
+QVariantMap runVariant(const QString &variant, const QString &imagePath, const QString &workPath,
+                       int count, int frames)
+{
+    const bool sceneGraph = variant == QLatin1String("scenegraph");
+    const char *typeName = sceneGraph ? "CircularImageItem" : "CircularImage";
+
+    const QString qmlPath = workPath + QStringLiteral("/%1.qml").arg(variant);
+    QFile qml(qmlPath);
+    if (!qml.open(QIODevice::WriteOnly)
+        || qml.write(QString::fromLatin1(kSceneQml).arg(QLatin1String(typeName)).toUtf8()) < 0) {
+        return {};
+    }
+    qml.close();
+
+    // Nothing carried over from the previous variant
+    CircularImageCache::instance()->clear();
+    ThumbnailCache::instance()->setCacheDirectory(workPath + QStringLiteral("/thumbnails-") + variant);
+
+    QQuickView view;
+    view.setResizeMode(QQuickView::SizeRootObjectToView);
+    view.resize(1280, 800);
+    view.setSource(QUrl::fromLocalFile(qmlPath));
+    if (view.status() != QQuickView::Ready || !view.rootObject()) {
+        qWarning() << "Bench:" << view.errors();
+        return {};
+    }
+
+    QQuickItem *root = view.rootObject();
+    root->setProperty("imageSource", QUrl::fromLocalFile(imagePath));
+
+    QElapsedTimer load;
+    load.start();
+    root->setProperty("count", count);
+    view.show();
+
+    // Ready once every avatar reports Ready (1 in both Status enums)
+    const QVector<QQuickItem *> items = avatars(root, typeName);
+    const auto allReady = [&items]() {
+        return std::all_of(items.cbegin(), items.cend(),
+                           [](QQuickItem *item) { return item->property("status").toInt() == 1; });
+    };
+    while (!allReady() && load.elapsed() < 30000) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 5);
+    }
+    const qint64 loadNs = load.nsecsElapsed();
+    const bool ready = allReady();
+
+    FrameTimes times;
+    QElapsedTimer syncTimer;
+    QElapsedTimer renderTimer;
+    QObject::connect(&view, &QQuickWindow::beforeSynchronizing, &view, [&]() { syncTimer.start(); },
+                     Qt::DirectConnection);
+    QObject::connect(&view, &QQuickWindow::afterSynchronizing, &view,
+                     [&]() { times.syncNs.append(syncTimer.nsecsElapsed()); }, Qt::DirectConnection);
+    QObject::connect(&view, &QQuickWindow::beforeRendering, &view, [&]() { renderTimer.start(); },
+                     Qt::DirectConnection);
+    QObject::connect(&view, &QQuickWindow::afterRendering, &view,
+                     [&]() { times.renderNs.append(renderTimer.nsecsElapsed()); }, Qt::DirectConnection);
+
+    const quint64 missesBefore = CircularImageCache::instance()->misses();
+    QElapsedTimer wall;
+    wall.start();
+    for (int frame = 0; frame < frames; ++frame) {
+        // Sweep 40..96 px and back so every size bucket is crossed
+        const int phase = frame % 56;
+        root->setProperty("edge", 40 + (frame / 56 % 2 == 0 ? phase : 56 - phase));
+
+        QElapsedTimer frameTimer;
+        frameTimer.start();
+        QEventLoop loop;
+        QObject::connect(&view, &QQuickWindow::frameSwapped, &loop, &QEventLoop::quit);
+        QTimer::singleShot(1000, &loop, &QEventLoop::quit);
+        view.update();
+        loop.exec();
+        times.frameNs.append(frameTimer.nsecsElapsed());
+    }
+    const double wallSeconds = wall.nsecsElapsed() / 1e9;
+
+    QVariantMap result;
+    result.insert("variant", variant);
+    result.insert("items", items.size());
+    result.insert("allReady", ready);
+    result.insert("loadMs", loadNs / 1e6);
+    result.insert("framesPerSecond", frames / qMax(1e-9, wallSeconds));
+    result.insert("frameP50Ms", Bench::percentileMs(times.frameNs, 50));
+    result.insert("frameP95Ms", Bench::percentileMs(times.frameNs, 95));
+    result.insert("frameP99Ms", Bench::percentileMs(times.frameNs, 99));
+    result.insert("syncP50Ms", Bench::percentileMs(times.syncNs, 50));
+    result.insert("syncP95Ms", Bench::percentileMs(times.syncNs, 95));
+    result.insert("renderP50Ms", Bench::percentileMs(times.renderNs, 50));
+    result.insert("renderP95Ms", Bench::percentileMs(times.renderNs, 95));
+    result.insert("cacheMisses", qint64(CircularImageCache::instance()->misses() - missesBefore));
+    return result;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    // Sync and render on this thread, so both can be timed per frame
+    qputenv("QSG_RENDER_LOOP", "basic");
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sigmaterial-bench-avatars");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Painted CircularImage against scene-graph CircularImageItem.");
+    parser.addHelpOption();
+    QCommandLineOption itemsOption("items", "Avatars in the grid.", "n", "200");
+    QCommandLineOption framesOption("frames", "Resized frames per variant.", "n", "300");
+    QCommandLineOption variantOption("variant", "painted, scenegraph or both.", "name", "both");
+    QCommandLineOption jsonOption("json", "Also write the report as JSON.", "file");
+    parser.addOptions({ itemsOption, framesOption, variantOption, jsonOption });
+    parser.process(app);
+
+    const int count = qMax(1, parser.value(itemsOption).toInt());
+    const int frames = qMax(1, parser.value(framesOption).toInt());
+    const QString variant = parser.value(variantOption);
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        qWarning() << "Bench: Could not create a working directory";
+        return 1;
+    }
+    Bench::setUp(workDir);
+
+    const QString imagePath = workDir.filePath("avatar.jpg");
+    if (!writeSourceImage(imagePath)) {
+        qWarning() << "Bench: Could not write" << imagePath;
+        return 1;
+    }
+
+    qmlRegisterType<CircularImage>("CircularImage", 1, 0, "CircularImage");
+    qmlRegisterType<CircularImageItem>("CircularImage", 1, 0, "CircularImageItem");
+
+    QStringList variants;
+    if (variant == QLatin1String("both")) {
+        variants = { QStringLiteral("painted"), QStringLiteral("scenegraph") };
+    } else {
+        variants = { variant };
+    }
+
+    Bench::out() << count << " avatars, " << frames << " resized frames per variant\n\n"
+                 << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                        .arg(QStringLiteral("variant"), -12)
+                        .arg(QStringLiteral("load ms"), 9)
+                        .arg(QStringLiteral("frames/s"), 9)
+                        .arg(QStringLiteral("frame p50"), 10)
+                        .arg(QStringLiteral("frame p99"), 10)
+                        .arg(QStringLiteral("sync p50"), 9)
+                        .arg(QStringLiteral("render p50"), 11)
+                        .arg(QStringLiteral("misses"), 8)
+                 << Qt::flush;
+
+    QVariantList results;
+    bool ok = true;
+    for (const QString &name : std::as_const(variants)) {
+        const QVariantMap result = runVariant(name, imagePath, workDir.path(), count, frames);
+        if (result.isEmpty() || !result.value("allReady").toBool()) {
+            qWarning() << "Bench: Variant" << name << "did not get ready";
+            ok = false;
+            continue;
+        }
+        results.append(result);
+        Bench::out() << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                            .arg(name, -12)
+                            .arg(result.value("loadMs").toDouble(), 9, 'f', 1)
+                            .arg(result.value("framesPerSecond").toDouble(), 9, 'f', 1)
+                            .arg(result.value("frameP50Ms").toDouble(), 10, 'f', 3)
+                            .arg(result.value("frameP99Ms").toDouble(), 10, 'f', 3)
+                            .arg(result.value("syncP50Ms").toDouble(), 9, 'f', 3)
+                            .arg(result.value("renderP50Ms").toDouble(), 11, 'f', 3)
+                            .arg(result.value("cacheMisses").toLongLong(), 8)
+                     << Qt::flush;
+    }
+
+    QVariantMap report;
+    report.insert("items", count);
+    report.insert("frames", frames);
+    report.insert("variants", results);
+    if (parser.isSet(jsonOption) && !Bench::writeJson(parser.value(jsonOption), report)) {
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <memory>
+#include <vector>
+#include "ApiTraceReplayer.h"
+#include "BenchSupport.h"
+
+// sigmaterial-bench-circulation [--desks n] [--ops n] [--books n] [--copies n] [--json file]
+//
+// Many circulation desks hammering one catalog file. Each desk is a worker
+// process with its own Database and connection, checking random books out
+// and returning its own loans. Few copies per book keep the desks fighting
+// over the last copy, which the conditional UPDATE must never lend twice.
+// Afterwards every book's available count is checked against its open
+// loans.
+namespace {
+bool runDesk(const QString &databasePath, int ops, quint32 seed, ApiTraceReplayer::Samples &samples)
+{
+    Database database;
+    if (!Bench::openSession(database, databasePath, QStringLiteral("desk"))) {
+        return false;
+    }
+
+    QVector<int> bookIds;
+    for (const QVariant &book : database.getAllBooks()) {
+        bookIds.append(book.toMap().value("id").toInt());
+    }
+    if (bookIds.isEmpty()) {
+        return false;
+    }
+
+    QRandomGenerator random(seed);
+    QVector<int> loans;
+    QElapsedTimer wall;
+    wall.start();
+
+    for (int i = 0; i < ops; ++i) {
+        QElapsedTimer timer;
+        // Return about as often as lend, so shelves drain and refill
+        if (!loans.isEmpty() && random.bounded(2) == 0) {
+            const int loanId = loans.takeAt(random.bounded(int(loans.size())));
+            timer.start();
+            const bool ok = database.checkinBook(loanId);
+            samples.replayedNs[ok ? "checkinBook" : "checkinBook (failed)"].append(timer.nsecsElapsed());
+        } else {
+            const int bookId = bookIds.at(random.bounded(int(bookIds.size())));
+            timer.start();
+            const int loanId = database.checkoutBook(bookId, QStringLiteral("Desk %1").arg(seed));
+            samples.replayedNs[loanId > 0 ? "checkoutBook" : "checkoutBook (no copy)"].append(timer.nsecsElapsed());
+            if (loanId > 0) {
+                loans.append(loanId);
+            }
+        }
+    }
+
+    samples.wallNs = wall.nsecsElapsed();
+    return true;
+}
+
+// Books whose available count disagrees with copies minus open loans
+int countViolations(const QString &databasePath)
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", QStringLiteral("audit"));
+    db.setDatabaseName(databasePath);
+    if (!db.open()) {
+        return -1;
+    }
+
+    QSqlQuery query(db);
+    const bool ok = query.exec(
+        "SELECT COUNT(*) FROM books WHERE available < 0 OR available <> copies -"
+        " (SELECT COUNT(*) FROM loans WHERE loans.book_id = books.id AND loans.returned_at IS NULL)");
+    return ok && query.next() ? query.value(0).toInt() : -1;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sigmaterial-bench-circulation");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Concurrent checkout/checkin throughput over one catalog file.");
+    parser.addHelpOption();
+    QCommandLineOption desksOption("desks", "Concurrent desks (worker processes).", "n", "8");
+    QCommandLineOption opsOption("ops", "Checkouts plus checkins per desk.", "n", "2000");
+    QCommandLineOption booksOption("books", "Books in the catalog.", "n", "50");
+    QCommandLineOption copiesOption("copies", "Copies of each book.", "n", "2");
+    QCommandLineOption jsonOption("json", "Also write the report as JSON.", "file");
+    QCommandLineOption workerOption("worker", "Internal: run one desk on <database>.", "database");
+    QCommandLineOption samplesOption("samples", "Internal: where a desk writes its samples.", "file");
+    QCommandLineOption seedOption("seed", "Internal: desk number.", "n", "0");
+    for (QCommandLineOption *option : { &workerOption, &samplesOption, &seedOption }) {
+        option->setFlags(QCommandLineOption::HiddenFromHelp);
+    }
+    parser.addOptions({ desksOption, opsOption, booksOption, copiesOption, jsonOption,
+                        workerOption, samplesOption, seedOption });
+    parser.process(app);
+
+    const int desks = qMax(1, parser.value(desksOption).toInt());
+    const int ops = qMax(1, parser.value(opsOption).toInt());
+    const int books = qMax(1, parser.value(booksOption).toInt());
+    const int copies = qMax(1, parser.value(copiesOption).toInt());
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        qWarning() << "Bench: Could not create a working directory";
+        return 1;
+    }
+    Bench::setUp(workDir);
+
+    // Desk worker: the parent owns the file
+    if (parser.isSet(workerOption)) {
+        ApiTraceReplayer::Samples samples;
+        if (!runDesk(parser.value(workerOption), ops, parser.value(seedOption).toUInt(), samples)) {
+            qWarning() << "Bench: Desk" << parser.value(seedOption) << "could not start";
+            return 1;
+        }
+        return ApiTraceReplayer::writeSamples(parser.value(samplesOption), samples) ? 0 : 1;
+    }
+
+    const QString databasePath = workDir.filePath("circulation.db");
+    {
+        Database database;
+        if (!Bench::openSession(database, databasePath, QStringLiteral("seed")) || !database.beginBatch()) {
+            qWarning() << "Bench: Could not create" << databasePath;
+            return 1;
+        }
+        for (int i = 0; i < books; ++i) {
+            database.addBook(QStringLiteral("Circulation Title %1").arg(i), QStringLiteral("Author %1").arg(i % 97),
+                             QStringLiteral("Genre %1").arg(i % 13), QStringLiteral("Publisher"), 2000 + i % 25,
+                             copies, QString());
+        }
+        if (!database.commitBatch()) {
+            return 1;
+        }
+    }
+
+    Bench::out() << desks << " desks x " << ops << " operations over " << books << " books x " << copies
+                 << " copies\n" << Qt::flush;
+
+    std::vector<std::unique_ptr<QProcess>> workers;
+    for (int i = 0; i < desks; ++i) {
+        auto worker = std::make_unique<QProcess>();
+        worker->setProcessChannelMode(QProcess::ForwardedChannels);
+        worker->start(QCoreApplication::applicationFilePath(),
+                      { "--worker", databasePath, "--ops", QString::number(ops), "--seed", QString::number(i + 1),
+                        "--samples", workDir.filePath(QStringLiteral("desk-%1.bin").arg(i)) });
+        workers.push_back(std::move(worker));
+    }
+
+    ApiTraceReplayer::Samples samples;
+    for (int i = 0; i < desks; ++i) {
+        ApiTraceReplayer::Samples desk;
+        workers[i]->waitForFinished(-1);
+        if (workers[i]->exitCode() != 0
+            || !ApiTraceReplayer::readSamples(workDir.filePath(QStringLiteral("desk-%1.bin").arg(i)), desk)) {
+            qWarning() << "Bench: Desk" << i + 1 << "failed";
+            return 1;
+        }
+        samples.merge(desk);
+    }
+
+    QVariantMap report = ApiTraceReplayer::report(samples, desks);
+    const int violations = countViolations(databasePath);
+    report.insert("availabilityViolations", violations);
+
+    Bench::out() << ApiTraceReplayer::formatReport(report)
+                 << "\nBooks with available != copies - open loans: " << violations << "\n";
+
+    if (parser.isSet(jsonOption) && !Bench::writeJson(parser.value(jsonOption), report)) {
+        return 1;
+    }
+    return violations == 0 ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSqlQuery>
+#include <QThread>
+#include <QTimeZone>
+#include "ApiTraceReplayer.h"
+#include "BenchSupport.h"
+
+// sigmaterial-bench-ledger [--movements n] [--products n] [--batch n] [--checkpoints n] [--lookups n] [--json file]
+//
+// Grows the stock_movements ledger to --movements rows through
+// recordStockMovement() and reports insert throughput per slice of the run,
+// so a slowdown as the ledger grows shows up. At --checkpoints points the
+// run waits for the clock to pass a second boundary and keeps every
+// product's level; getStockAt() is then asked for random products at those
+// times, checked against the kept levels, and timed against a full replay
+// of the product's movements.
+namespace {
+constexpr const char *kFullReplaySql =
+    "SELECT COALESCE(SUM(quantity_added), 0) FROM stock_movements"
+    " WHERE user_id = ? AND product_id = ? AND created_at <= ?";
+
+struct Checkpoint {
+    QDateTime at;
+    QVector<int> levels;
+};
+
+// Movements up to `now` carry its second; later ones a later second
+QDateTime closeSecond()
+{
+    const qint64 second = QDateTime::currentSecsSinceEpoch();
+    while (QDateTime::currentSecsSinceEpoch() == second) {
+        QThread::msleep(10);
+    }
+    return QDateTime::fromSecsSinceEpoch(second, QTimeZone::UTC);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sigmaterial-bench-ledger");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Stock ledger insert throughput and point-in-time lookups.");
+    parser.addHelpOption();
+    QCommandLineOption movementsOption("movements", "Movements recorded in total.", "n", "10000000");
+    QCommandLineOption productsOption("products", "Products the movements are spread over.", "n", "1000");
+    QCommandLineOption batchOption("batch", "Movements per transaction.", "n", "10000");
+    QCommandLineOption checkpointsOption("checkpoints", "Points in time the lookups ask about.", "n", "10");
+    QCommandLineOption lookupsOption("lookups", "getStockAt() calls.", "n", "2000");
+    QCommandLineOption jsonOption("json", "Also write the report as JSON.", "file");
+    parser.addOptions({ movementsOption, productsOption, batchOption, checkpointsOption, lookupsOption,
+                        jsonOption });
+    parser.process(app);
+
+    const qint64 movements = qMax<qint64>(1, parser.value(movementsOption).toLongLong());
+    const int products = qMax(1, parser.value(productsOption).toInt());
+    const int batch = qMax(1, parser.value(batchOption).toInt());
+    const int checkpoints = qMax(1, parser.value(checkpointsOption).toInt());
+    const int lookups = qMax(1, parser.value(lookupsOption).toInt());
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        qWarning() << "Bench: Could not create a working directory";
+        return 1;
+    }
+    Bench::setUp(workDir);
+
+    Database database;
+    if (!Bench::openSession(database, workDir.filePath("ledger.db"), QStringLiteral("ledger"))) {
+        qWarning() << "Bench: Could not create the ledger";
+        return 1;
+    }
+    const QVector<int> productIds = Bench::createProducts(database, products, QStringLiteral("Ledger Product"));
+    if (productIds.isEmpty()) {
+        return 1;
+    }
+
+    Bench::out() << movements << " movements over " << products << " products, " << batch
+                 << " per transaction\n\n"
+                 << QStringLiteral("%1 %2 %3\n")
+                        .arg(QStringLiteral("ledger rows"), 12)
+                        .arg(QStringLiteral("movements/s"), 12)
+                        .arg(QStringLiteral("commit p99 ms"), 14)
+                 << Qt::flush;
+
+    // Insert phase: one slice per checkpoint
+    QRandomGenerator random(1);
+    QVector<int> levels(products, 0);
+    QVector<Checkpoint> kept;
+    QVariantList slices;
+    ApiTraceReplayer::Samples samples;
+    qint64 recorded = 0;
+    qint64 refused = 0;
+    QElapsedTimer insertWall;
+    insertWall.start();
+
+    for (int slice = 0; slice < checkpoints; ++slice) {
+        const qint64 sliceEnd = movements * (slice + 1) / checkpoints;
+        const qint64 sliceStart = recorded;
+        QVector<qint64> commitNs;
+        QElapsedTimer sliceTimer;
+        sliceTimer.start();
+
+        while (recorded < sliceEnd) {
+            if (!database.beginBatch()) {
+                return 1;
+            }
+            const qint64 batchEnd = qMin(sliceEnd, recorded + batch);
+            for (; recorded < batchEnd; ++recorded) {
+                const int index = random.bounded(products);
+                const int level = levels.at(index);
+                // About one in three movements takes stock out again
+                const int quantity = level > 0 && random.bounded(3) == 0 ? -1 - random.bounded(qMin(level, 20))
+                                                                          : 1 + random.bounded(20);
+                const int newLevel = database.recordStockMovement(productIds.at(index), quantity,
+                                                                  quantity > 0 ? "restock" : "sale", QString());
+                if (newLevel != level + quantity) {
+                    ++refused;
+                    continue;
+                }
+                levels[index] = newLevel;
+            }
+            QElapsedTimer commitTimer;
+            commitTimer.start();
+            if (!database.commitBatch()) {
+                return 1;
+            }
+            commitNs.append(commitTimer.nsecsElapsed());
+            samples.replayedNs["commitBatch"].append(commitNs.constLast());
+        }
+
+        const double sliceSeconds = sliceTimer.nsecsElapsed() / 1e9;
+        const double rate = (recorded - sliceStart) / qMax(1e-9, sliceSeconds);
+        QVariantMap sliceReport;
+        sliceReport.insert("ledgerRows", recorded);
+        sliceReport.insert("movementsPerSecond", rate);
+        sliceReport.insert("commitP99Ms", Bench::percentileMs(commitNs, 99));
+        slices.append(sliceReport);
+        Bench::out() << QStringLiteral("%1 %2 %3\n")
+                            .arg(recorded, 12)
+                            .arg(rate, 12, 'f', 0)
+                            .arg(Bench::percentileMs(commitNs, 99), 14, 'f', 3)
+                     << Qt::flush;
+
+        kept.append({ closeSecond(), levels });
+    }
+    const double insertSeconds = insertWall.nsecsElapsed() / 1e9;
+
+    // Lookup phase: snapshot-bounded replay against replaying everything
+    QSqlQuery fullReplay(Bench::connection(database));
+    fullReplay.prepare(kFullReplaySql);
+    qint64 wrong = 0;
+    QElapsedTimer lookupWall;
+    lookupWall.start();
+    for (int i = 0; i < lookups; ++i) {
+        const Checkpoint &checkpoint = kept.at(random.bounded(int(kept.size())));
+        const int index = random.bounded(products);
+
+        QElapsedTimer timer;
+        timer.start();
+        const int level = database.getStockAt(productIds.at(index), checkpoint.at.toString(Qt::ISODate));
+        samples.replayedNs["getStockAt"].append(timer.nsecsElapsed());
+        if (level != checkpoint.levels.at(index)) {
+            ++wrong;
+        }
+
+        // The baseline is slow by design; a tenth of the lookups is enough
+        if (i % 10 == 0) {
+            timer.start();
+            fullReplay.addBindValue(database.getCurrentUserId());
+            fullReplay.addBindValue(productIds.at(index));
+            fullReplay.addBindValue(checkpoint.at.toString(QStringLiteral("yyyy-MM-dd HH:mm:ss")));
+            if (fullReplay.exec() && fullReplay.next() && fullReplay.value(0).toInt() != checkpoint.levels.at(index)) {
+                ++wrong;
+            }
+            samples.replayedNs["full replay (baseline)"].append(timer.nsecsElapsed());
+        }
+    }
+    samples.wallNs = lookupWall.nsecsElapsed();
+
+    QVariantMap report = ApiTraceReplayer::report(samples, 1);
+    report.insert("movements", recorded);
+    report.insert("refusedMovements", refused);
+    report.insert("products", products);
+    report.insert("insertSeconds", insertSeconds);
+    report.insert("movementsPerSecond", recorded / qMax(1e-9, insertSeconds));
+    report.insert("slices", slices);
+    report.insert("wrongLevels", wrong);
+
+    Bench::out() << QStringLiteral("\nRecorded %1 movements in %2 s (%3/s), %4 refused\n\n")
+                        .arg(recorded)
+                        .arg(insertSeconds, 0, 'f', 1)
+                        .arg(recorded / qMax(1e-9, insertSeconds), 0, 'f', 0)
+                        .arg(refused)
+                 << ApiTraceReplayer::formatReport(report)
+                 << "\nLevels that disagree with the recorded history: " << wrong << "\n";
+
+    if (parser.isSet(jsonOption) && !Bench::writeJson(parser.value(jsonOption), report)) {
+        return 1;
+    }
+    return wrong == 0 && refused == 0 ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include "ApiTraceReplayer.h"
+#include "BenchSupport.h"
+
+// sigmaterial-bench-load [--sizes n,n,...] [--runs n] [--json file]
+//
+// Times loadBooks() on catalogs of 10k, 100k and 1M rows by default. The
+// catalog grows in place between sizes, so each size reloads the same file
+// the previous one left behind. Reports rows/s at the median and worst run
+// and which decoder the build uses.
+namespace {
+bool growCatalog(const Database &database, int from, int to)
+{
+    QSqlDatabase db = Bench::connection(database);
+    if (!db.transaction()) {
+        return false;
+    }
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO books (user_id, title, author, genre, publisher, year, copies, available, image_path)"
+                  " VALUES (?, ?, ?, ?, ?, ?, ?, ?, '')");
+    for (int i = from; i < to; ++i) {
+        query.addBindValue(database.getCurrentUserId());
+        query.addBindValue(QStringLiteral("Load Title %1 of the Collected Works").arg(i));
+        query.addBindValue(QStringLiteral("Author %1").arg(i % 4999));
+        query.addBindValue(QStringLiteral("Genre %1").arg(i % 23));
+        query.addBindValue(QStringLiteral("Publisher %1").arg(i % 41));
+        query.addBindValue(1900 + i % 125);
+        query.addBindValue(1 + i % 3);
+        query.addBindValue(1 + i % 3);
+        if (!query.exec()) {
+            qWarning() << "Bench: Could not insert a book:" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    return db.commit();
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sigmaterial-bench-load");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("loadBooks() rows/s by catalog size.");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma-separated catalog sizes.", "n,n,...", "10000,100000,1000000");
+    QCommandLineOption runsOption("runs", "Loads per size.", "n", "5");
+    QCommandLineOption jsonOption("json", "Also write the report as JSON.", "file");
+    parser.addOptions({ sizesOption, runsOption, jsonOption });
+    parser.process(app);
+
+    QVector<int> sizes;
+    for (const QString &size : parser.value(sizesOption).split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        if (size.toInt() > 0) {
+            sizes.append(size.toInt());
+        }
+    }
+    std::sort(sizes.begin(), sizes.end());
+    const int runs = qMax(1, parser.value(runsOption).toInt());
+    if (sizes.isEmpty()) {
+        qWarning() << "Bench: No catalog sizes given";
+        return 1;
+    }
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        qWarning() << "Bench: Could not create a working directory";
+        return 1;
+    }
+    Bench::setUp(workDir);
+
+    Database database;
+    if (!Bench::openSession(database, workDir.filePath("load.db"), QStringLiteral("load"))) {
+        qWarning() << "Bench: Could not create the catalog";
+        return 1;
+    }
+
+#ifdef SIGMATERIAL_SQLITE_DIRECT
+    const QString decoder = QStringLiteral("sqlite3 (SIGMATERIAL_SQLITE_DIRECT)");
+#else
+    const QString decoder = QStringLiteral("QSqlQuery");
+#endif
+    Bench::out() << runs << " loads per size, " << decoder << " decoder\n\n"
+                 << QStringLiteral("%1 %2 %3 %4\n")
+                        .arg(QStringLiteral("rows"), 10)
+                        .arg(QStringLiteral("p50 ms"), 10)
+                        .arg(QStringLiteral("rows/s p50"), 12)
+                        .arg(QStringLiteral("rows/s worst"), 13)
+                 << Qt::flush;
+
+    QVariantList results;
+    ApiTraceReplayer::Samples samples;
+    QElapsedTimer wall;
+    wall.start();
+    bool ok = true;
+    int loaded = 0;
+    for (int size : std::as_const(sizes)) {
+        if (!growCatalog(database, loaded, size)) {
+            return 1;
+        }
+        loaded = size;
+
+        QVector<qint64> loadNs;
+        for (int run = 0; run < runs; ++run) {
+            QElapsedTimer timer;
+            timer.start();
+            database.loadBooks();
+            loadNs.append(timer.nsecsElapsed());
+        }
+        samples.replayedNs[QByteArray("loadBooks (") + QByteArray::number(size) + " rows)"] += loadNs;
+
+        const qint64 rows = database.catalogSnapshot()->books.size();
+        ok = ok && rows == size;
+        const double p50 = Bench::percentileMs(loadNs, 50);
+        const double worst = Bench::percentileMs(loadNs, 100);
+        QVariantMap result;
+        result.insert("rows", rows);
+        result.insert("p50Ms", p50);
+        result.insert("worstMs", worst);
+        result.insert("rowsPerSecondP50", rows / qMax(1e-9, p50 / 1000.0));
+        result.insert("rowsPerSecondWorst", rows / qMax(1e-9, worst / 1000.0));
+        results.append(result);
+
+        Bench::out() << QStringLiteral("%1 %2 %3 %4\n")
+                            .arg(rows, 10)
+                            .arg(p50, 10, 'f', 1)
+                            .arg(result.value("rowsPerSecondP50").toDouble(), 12, 'f', 0)
+                            .arg(result.value("rowsPerSecondWorst").toDouble(), 13, 'f', 0)
+                     << Qt::flush;
+    }
+    samples.wallNs = wall.nsecsElapsed();
+
+    QVariantMap report = ApiTraceReplayer::report(samples, 1);
+    report.insert("decoder", decoder);
+    report.insert("sizes", results);
+
+    Bench::out() << "\n" << ApiTraceReplayer::formatReport(report);
+
+    if (parser.isSet(jsonOption) && !Bench::writeJson(parser.value(jsonOption), report)) {
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTimer>
+#include "ApiTraceReplayer.h"
+#include "BenchSupport.h"
+#include "CoOccurrenceRecommender.h"
+
+// sigmaterial-bench-recommender [--transactions n] [--customers n] [--products n] [--queries n] [--json file]
+//
+// Fills purchases with synthetic transactions, rebuilds the co-occurrence
+// recommender over them and reports the build time, the recommender's own
+// size estimate and what the process actually grew by. Customers buy
+// mostly inside one of a few taste groups, so baskets overlap the way real
+// ones do. Afterwards related() is timed on the built matrix and again
+// while incremental purchases keep dirtying its rows.
+namespace {
+constexpr int kTasteGroups = 50;
+
+// Resident and peak resident set from /proc; -1 where unavailable
+qint64 processKb(const QByteArray &field)
+{
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith(field)) {
+            return line.mid(field.size()).trimmed().split(' ').value(0).toLongLong();
+        }
+    }
+    return -1;
+}
+
+int pickProduct(QRandomGenerator &random, int customer, int products)
+{
+    // Four in five purchases come from the customer's taste group
+    const int groupSize = qMax(1, products / kTasteGroups);
+    if (random.bounded(5) != 0) {
+        const int group = customer % kTasteGroups;
+        return qMin(products - 1, group * groupSize + random.bounded(groupSize));
+    }
+    return random.bounded(products);
+}
+
+bool fillPurchases(Database &database, qint64 transactions, int customers, int products,
+                   const QVector<int> &productIds, QRandomGenerator &random)
+{
+    QSqlDatabase db = Bench::connection(database);
+    if (!db.transaction()) {
+        return false;
+    }
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO purchases (user_id, product_id, customer_name, quantity, total_price)"
+                  " VALUES (?, ?, ?, 1, 1000)");
+    for (qint64 i = 0; i < transactions; ++i) {
+        const int customer = random.bounded(customers);
+        query.addBindValue(database.getCurrentUserId());
+        query.addBindValue(productIds.at(pickProduct(random, customer, products)));
+        query.addBindValue(QStringLiteral("Customer %1").arg(customer));
+        if (!query.exec()) {
+            qWarning() << "Bench: Could not insert a purchase:" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    return db.commit();
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sigmaterial-bench-recommender");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Co-occurrence recommender build time and memory.");
+    parser.addHelpOption();
+    QCommandLineOption transactionsOption("transactions", "Synthetic purchases.", "n", "1000000");
+    QCommandLineOption customersOption("customers", "Distinct customers.", "n", "100000");
+    QCommandLineOption productsOption("products", "Distinct products.", "n", "5000");
+    QCommandLineOption queriesOption("queries", "related() calls per phase.", "n", "10000");
+    QCommandLineOption jsonOption("json", "Also write the report as JSON.", "file");
+    parser.addOptions({ transactionsOption, customersOption, productsOption, queriesOption, jsonOption });
+    parser.process(app);
+
+    const qint64 transactions = qMax<qint64>(1, parser.value(transactionsOption).toLongLong());
+    const int customers = qMax(1, parser.value(customersOption).toInt());
+    const int products = qMax(1, parser.value(productsOption).toInt());
+    const int queries = qMax(1, parser.value(queriesOption).toInt());
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        qWarning() << "Bench: Could not create a working directory";
+        return 1;
+    }
+    Bench::setUp(workDir);
+
+    Database database;
+    if (!Bench::openSession(database, workDir.filePath("recommender.db"), QStringLiteral("recommender"))) {
+        qWarning() << "Bench: Could not create the database";
+        return 1;
+    }
+    QRandomGenerator random(1);
+    const QVector<int> productIds = Bench::createProducts(database, products, QStringLiteral("Recommender Product"));
+    if (productIds.isEmpty()
+        || !fillPurchases(database, transactions, customers, products, productIds, random)) {
+        return 1;
+    }
+
+    Bench::out() << transactions << " purchases by " << customers << " customers over " << products
+                 << " products\n" << Qt::flush;
+
+    // Build: the same worker-thread rebuild the app runs at login
+    CoOccurrenceRecommender recommender;
+    const qint64 rssBefore = processKb("VmRSS:");
+    QEventLoop loop;
+    QObject::connect(&recommender, &CoOccurrenceRecommender::rebuilt, &loop, &QEventLoop::quit);
+    QTimer::singleShot(600000, &loop, &QEventLoop::quit);
+    QElapsedTimer build;
+    build.start();
+    recommender.rebuild(database.connectionName(), database.getCurrentUserId());
+    loop.exec();
+    const qint64 buildWallMs = build.elapsed();
+    if (!recommender.isReady()) {
+        qWarning() << "Bench: The recommender did not build";
+        return 1;
+    }
+    const qint64 rssAfter = processKb("VmRSS:");
+    const QVariantMap stats = recommender.stats();
+
+    // Serving: clean rows, then rows dirtied by incremental purchases
+    ApiTraceReplayer::Samples samples;
+    QElapsedTimer wall;
+    wall.start();
+    qint64 empty = 0;
+    for (int i = 0; i < queries; ++i) {
+        const int productId = productIds.at(random.bounded(products));
+        QElapsedTimer timer;
+        timer.start();
+        if (recommender.related(productId, 5).isEmpty()) {
+            ++empty;
+        }
+        samples.replayedNs["related"].append(timer.nsecsElapsed());
+    }
+    for (int i = 0; i < queries; ++i) {
+        const int customer = random.bounded(customers);
+        const int productId = productIds.at(pickProduct(random, customer, products));
+        QElapsedTimer timer;
+        timer.start();
+        recommender.recordPurchase(int(transactions) + i + 1, QStringLiteral("Customer %1").arg(customer),
+                                   productId);
+        samples.replayedNs["recordPurchase"].append(timer.nsecsElapsed());
+
+        timer.start();
+        recommender.related(productId, 5);
+        samples.replayedNs["related (after update)"].append(timer.nsecsElapsed());
+    }
+    samples.wallNs = wall.nsecsElapsed();
+
+    QVariantMap report = ApiTraceReplayer::report(samples, 1);
+    report.insert("recommender", stats);
+    report.insert("buildWallMs", buildWallMs);
+    report.insert("rssGrowthBytes", rssBefore < 0 || rssAfter < 0 ? -1 : (rssAfter - rssBefore) * 1024);
+    report.insert("peakRssBytes", qMax<qint64>(-1, processKb("VmHWM:") * 1024));
+    report.insert("emptyRecommendations", empty);
+
+    Bench::out() << QStringLiteral("\nBuild: %1 ms in the job, %2 ms until adopted\n")
+                        .arg(stats.value("buildMs").toLongLong())
+                        .arg(buildWallMs)
+                 << QStringLiteral("Matrix: %1 items, %2 customers, %3 pairs, %4 pruned\n")
+                        .arg(stats.value("items").toLongLong())
+                        .arg(stats.value("customers").toLongLong())
+                        .arg(stats.value("pairs").toLongLong())
+                        .arg(stats.value("prunedEntries").toLongLong())
+                 << QStringLiteral("Memory: %1 MiB estimated, %2 MiB resident growth, %3 MiB peak resident\n\n")
+                        .arg(stats.value("estimatedBytes").toLongLong() / 1048576.0, 0, 'f', 1)
+                        .arg(report.value("rssGrowthBytes").toLongLong() / 1048576.0, 0, 'f', 1)
+                        .arg(report.value("peakRssBytes").toLongLong() / 1048576.0, 0, 'f', 1)
+                 << ApiTraceReplayer::formatReport(report)
+                 << "\nProducts without recommendations: " << empty << " of " << queries << " queries\n";
+
+    if (parser.isSet(jsonOption) && !Bench::writeJson(parser.value(jsonOption), report)) {
+        return 1;
+    }
+    return stats.value("transactions").toLongLong() == transactions ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QThreadPool>
+#include "ApiTraceReplayer.h"
+#include "BenchSupport.h"
+#include "SubstringScanner.h"
+
+// sigmaterial-bench-scan [--books n] [--queries n] [--kernel name|all] [--threads n] [--json file]
+//
+// Partial-match searchBook() over a large catalog, once per substring
+// kernel. Needles are fragments of the title words (a few hits each) and
+// strings no title contains (the scan runs to the end and only the kernel
+// is measured). The per-query scan time comes from getSearchScanStats(),
+// so turning hits into QVariantMaps does not count against the kernel.
+namespace {
+const char *const kWords[] = {
+    "garden", "winter", "shadow", "river", "empire", "silent", "harbor", "crimson",
+    "lantern", "orchard", "meridian", "falcon", "copper", "whisper", "northern", "atlas",
+    "ember", "voyage", "marble", "thistle", "cathedral", "quartz", "tundra", "saffron",
+};
+constexpr int kWordCount = int(sizeof(kWords) / sizeof(kWords[0]));
+
+QString word(QRandomGenerator &random)
+{
+    return QString::fromLatin1(kWords[random.bounded(kWordCount)]);
+}
+
+// Half the needles hit a few titles, half hit none
+QStringList makeNeedles(int count, QRandomGenerator &random)
+{
+    QStringList needles;
+    for (int i = 0; i < count; ++i) {
+        if (i % 2 == 0) {
+            const QString first = word(random);
+            const QString second = word(random);
+            needles.append(first.right(3) + QLatin1Char(' ') + second.left(2 + random.bounded(3)));
+        } else {
+            needles.append(QStringLiteral("zq%1x").arg(i));
+        }
+    }
+    return needles;
+}
+
+bool fillCatalog(const Database &database, int books)
+{
+    QRandomGenerator random(2);
+    QSqlDatabase db = Bench::connection(database);
+    if (!db.transaction()) {
+        return false;
+    }
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO books (user_id, title, author, genre, publisher, year, copies, available)"
+                  " VALUES (?, ?, ?, ?, ?, ?, 1, 1)");
+    for (int i = 0; i < books; ++i) {
+        query.addBindValue(database.getCurrentUserId());
+        query.addBindValue(QStringLiteral("%1 %2 %3 %4").arg(word(random), word(random), word(random)).arg(i));
+        query.addBindValue(QStringLiteral("Author %1").arg(i % 4999));
+        query.addBindValue(QStringLiteral("Genre %1").arg(i % 23));
+        query.addBindValue(QStringLiteral("Publisher %1").arg(i % 41));
+        query.addBindValue(1900 + i % 125);
+        if (!query.exec()) {
+            qWarning() << "Bench: Could not insert a book:" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    return db.commit();
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sigmaterial-bench-scan");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Partial-match search scan time per substring kernel.");
+    parser.addHelpOption();
+    QCommandLineOption booksOption("books", "Books in the catalog.", "n", "1000000");
+    QCommandLineOption queriesOption("queries", "Searches per kernel.", "n", "100");
+    QCommandLineOption kernelOption("kernel", "Kernel to measure, or all.", "name", "all");
+    QCommandLineOption threadsOption("threads", "Pool threads for the shards; 0 keeps the default.", "n", "0");
+    QCommandLineOption jsonOption("json", "Also write the report as JSON.", "file");
+    parser.addOptions({ booksOption, queriesOption, kernelOption, threadsOption, jsonOption });
+    parser.process(app);
+
+    const int books = qMax(1, parser.value(booksOption).toInt());
+    const int queries = qMax(2, parser.value(queriesOption).toInt());
+    const int threads = parser.value(threadsOption).toInt();
+    if (threads > 0) {
+        QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    }
+
+    QStringList kernels = SubstringScanner::availableKernels();
+    if (parser.value(kernelOption) != QLatin1String("all")) {
+        if (!kernels.contains(parser.value(kernelOption))) {
+            qWarning() << "Bench: Kernel" << parser.value(kernelOption) << "cannot run here; have" << kernels;
+            return 1;
+        }
+        kernels = { parser.value(kernelOption) };
+    }
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        qWarning() << "Bench: Could not create a working directory";
+        return 1;
+    }
+    Bench::setUp(workDir);
+
+    Database database;
+    if (!Bench::openSession(database, workDir.filePath("scan.db"), QStringLiteral("scan"))
+        || !fillCatalog(database, books)) {
+        qWarning() << "Bench: Could not create the catalog";
+        return 1;
+    }
+
+    QRandomGenerator random(1);
+    const QStringList needles = makeNeedles(queries, random);
+
+    Bench::out() << books << " books, " << queries << " searches per kernel, "
+                 << QThreadPool::globalInstance()->maxThreadCount() << " pool threads\n\n"
+                 << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+                        .arg(QStringLiteral("kernel"), -8)
+                        .arg(QStringLiteral("shards"), 7)
+                        .arg(QStringLiteral("miss p50 ms"), 12)
+                        .arg(QStringLiteral("miss p95 ms"), 12)
+                        .arg(QStringLiteral("hit p50 ms"), 11)
+                        .arg(QStringLiteral("M titles/s"), 11)
+                 << Qt::flush;
+
+    QVariantList results;
+    ApiTraceReplayer::Samples samples;
+    QElapsedTimer wall;
+    wall.start();
+    for (const QString &kernel : std::as_const(kernels)) {
+        SubstringScanner::setKernel(kernel);
+
+        // A fresh load drops the previous kernel's cached results; the
+        // first search pays for the sort
+        database.loadBooks();
+        database.searchBook(QStringLiteral("warm up"));
+
+        QVector<qint64> missNs;
+        QVector<qint64> hitNs;
+        qint64 hits = 0;
+        int shards = 0;
+        for (const QString &needle : needles) {
+            QElapsedTimer timer;
+            timer.start();
+            const QVariantList found = database.searchBook(needle);
+            samples.replayedNs[QStringLiteral("searchBook (%1)").arg(kernel).toUtf8()].append(timer.nsecsElapsed());
+
+            const QVariantMap stats = database.getSearchScanStats();
+            const qint64 scanNs = qint64(stats.value("lastScanMs").toDouble() * 1000000.0);
+            shards = stats.value("lastShards").toInt();
+            (found.isEmpty() ? missNs : hitNs).append(scanNs);
+            hits += found.size();
+        }
+
+        const double missP50 = Bench::percentileMs(missNs, 50);
+        QVariantMap result;
+        result.insert("kernel", kernel);
+        result.insert("shards", shards);
+        result.insert("missScans", missNs.size());
+        result.insert("missP50Ms", missP50);
+        result.insert("missP95Ms", Bench::percentileMs(missNs, 95));
+        result.insert("hitScans", hitNs.size());
+        result.insert("hitP50Ms", Bench::percentileMs(hitNs, 50));
+        result.insert("hits", hits);
+        result.insert("titlesPerSecond", missP50 > 0 ? books / (missP50 / 1000.0) : 0.0);
+        results.append(result);
+
+        Bench::out() << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+                            .arg(kernel, -8)
+                            .arg(shards, 7)
+                            .arg(missP50, 12, 'f', 3)
+                            .arg(result.value("missP95Ms").toDouble(), 12, 'f', 3)
+                            .arg(result.value("hitP50Ms").toDouble(), 11, 'f', 3)
+                            .arg(result.value("titlesPerSecond").toDouble() / 1e6, 11, 'f', 1)
+                     << Qt::flush;
+    }
+    samples.wallNs = wall.nsecsElapsed();
+
+    // Every kernel must find the same books
+    bool agree = true;
+    for (const QVariant &result : std::as_const(results)) {
+        agree = agree && result.toMap().value("hits") == results.constFirst().toMap().value("hits");
+    }
+
+    QVariantMap report = ApiTraceReplayer::report(samples, 1);
+    report.insert("books", books);
+    report.insert("threads", QThreadPool::globalInstance()->maxThreadCount());
+    report.insert("kernels", results);
+    report.insert("kernelsAgree", agree);
+
+    Bench::out() << "\n" << ApiTraceReplayer::formatReport(report)
+                 << "\nKernels agree on every result: " << (agree ? "yes" : "no") << "\n";
+
+    if (parser.isSet(jsonOption) && !Bench::writeJson(parser.value(jsonOption), report)) {
+        return 1;
+    }
+    return agree ? 0 : 1;
+}
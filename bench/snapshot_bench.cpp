@@ -0,0 +1,200 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSqlQuery>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "ApiTraceReplayer.h"
+#include "BenchSupport.h"
+
+// sigmaterial-bench-snapshot [--books n] [--readers n] [--seconds n] [--export-every n] [--json file]
+//
+// Reader threads keep taking Database::catalogSnapshot() and walking every
+// book while the GUI thread edits, searches (which re-sorts after each
+// edit) and, every few operations, asks for a snapshot the way an export
+// does. Readers check that versions only move forward and that every
+// record they see is whole; the report gives writer latencies and reader
+// throughput.
+namespace {
+struct ReaderStats {
+    qint64 snapshots = 0;
+    qint64 records = 0;
+    qint64 violations = 0;
+    quint64 lastVersion = 0;
+    quint64 checksum = 0;
+};
+
+void runReader(const Database &database, const std::atomic<bool> &stop, ReaderStats &stats)
+{
+    while (!stop.load(std::memory_order_relaxed)) {
+        const std::shared_ptr<const CatalogSnapshot> snapshot = database.catalogSnapshot();
+        if (!snapshot) {
+            continue;
+        }
+        if (snapshot->version < stats.lastVersion) {
+            ++stats.violations;
+        }
+        stats.lastVersion = snapshot->version;
+
+        qsizetype seen = 0;
+        snapshot->books.forEach([&](const Database::Book &book) {
+            if (book.id <= 0 || book.available < 0 || book.available > book.copies || book.title.isEmpty()) {
+                ++stats.violations;
+            } else {
+                // Text is read so a retired arena would show up under sanitizers
+                stats.checksum += book.title.back().unicode();
+            }
+            ++seen;
+        });
+        if (seen != snapshot->books.size()) {
+            ++stats.violations;
+        }
+        ++stats.snapshots;
+        stats.records += seen;
+    }
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sigmaterial-bench-snapshot");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Catalog snapshot readers against a GUI-thread writer.");
+    parser.addHelpOption();
+    QCommandLineOption booksOption("books", "Books in the catalog.", "n", "50000");
+    QCommandLineOption readersOption("readers", "Reader threads.", "n", "4");
+    QCommandLineOption secondsOption("seconds", "How long the writer runs.", "n", "5");
+    QCommandLineOption exportOption("export-every", "Writer operations between exporter snapshots.", "n", "50");
+    QCommandLineOption jsonOption("json", "Also write the report as JSON.", "file");
+    parser.addOptions({ booksOption, readersOption, secondsOption, exportOption, jsonOption });
+    parser.process(app);
+
+    const int books = qMax(1, parser.value(booksOption).toInt());
+    const int readers = qMax(1, parser.value(readersOption).toInt());
+    const int seconds = qMax(1, parser.value(secondsOption).toInt());
+    const int exportEvery = qMax(1, parser.value(exportOption).toInt());
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        qWarning() << "Bench: Could not create a working directory";
+        return 1;
+    }
+    Bench::setUp(workDir);
+
+    Database database;
+    if (!Bench::openSession(database, workDir.filePath("snapshot.db"), QStringLiteral("snapshot"))
+        || !database.beginBatch()) {
+        qWarning() << "Bench: Could not create the catalog";
+        return 1;
+    }
+    for (int i = 0; i < books; ++i) {
+        database.addBook(QStringLiteral("Snapshot Title %1").arg(i), QStringLiteral("Author %1").arg(i % 997),
+                         QStringLiteral("Genre %1").arg(i % 23), QStringLiteral("Publisher %1").arg(i % 41),
+                         1950 + i % 70, 1 + i % 3, QString());
+    }
+    if (!database.commitBatch()) {
+        return 1;
+    }
+
+    QVector<int> bookIds;
+    for (const QVariant &book : database.getAllBooks()) {
+        bookIds.append(book.toMap().value("id").toInt());
+    }
+
+    Bench::out() << readers << " readers over " << books << " books, writer for " << seconds << " s\n"
+                 << Qt::flush;
+
+    std::atomic<bool> stop(false);
+    std::vector<ReaderStats> readerStats(readers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; ++i) {
+        threads.emplace_back(runReader, std::cref(database), std::cref(stop), std::ref(readerStats[i]));
+    }
+
+    const quint64 firstVersion = database.catalogSnapshot()->version;
+    QRandomGenerator random(1);
+    ApiTraceReplayer::Samples samples;
+    QElapsedTimer wall;
+    wall.start();
+
+    const auto timed = [&samples](const char *name, auto call) {
+        QElapsedTimer timer;
+        timer.start();
+        call();
+        samples.replayedNs[name].append(timer.nsecsElapsed());
+    };
+
+    for (int op = 0; wall.elapsed() < seconds * 1000; ++op) {
+        const int index = random.bounded(int(bookIds.size()));
+        const int bookId = bookIds.at(index);
+
+        if (op % 10 == 9) {
+            // Churn: a new book replaces a random one
+            timed("addBook", [&]() {
+                database.addBook(QStringLiteral("Snapshot Title new %1").arg(op), QStringLiteral("Author"),
+                                 QStringLiteral("Genre"), QStringLiteral("Publisher"), 2024, 1, QString());
+            });
+            timed("deleteBook", [&]() { database.deleteBook(bookId); });
+            bookIds.remove(index);
+            QSqlQuery newest(Bench::connection(database));
+            if (newest.exec("SELECT MAX(id) FROM books") && newest.next()) {
+                bookIds.append(newest.value(0).toInt());
+            }
+        } else {
+            timed("updateBook", [&]() {
+                database.updateBook(bookId, QStringLiteral("Snapshot Title %1").arg(index),
+                                    QStringLiteral("Author"), QStringLiteral("Genre"), QStringLiteral("Publisher"),
+                                    1950 + op % 70, 3, QString());
+            });
+        }
+
+        // Re-sorts the catalog edited just above
+        timed("searchBook", [&]() { database.searchBook(QStringLiteral("Title %1").arg(op % books)); });
+
+        if (op % exportEvery == 0) {
+            timed("catalogSnapshot (exporter)", [&]() { database.catalogSnapshot(); });
+        }
+        QCoreApplication::processEvents();
+    }
+    samples.wallNs = wall.nsecsElapsed();
+
+    stop.store(true);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    const quint64 published = database.catalogSnapshot()->version - firstVersion;
+    qint64 snapshots = 0;
+    qint64 records = 0;
+    qint64 violations = 0;
+    for (const ReaderStats &stats : readerStats) {
+        snapshots += stats.snapshots;
+        records += stats.records;
+        violations += stats.violations;
+    }
+    const double wallSeconds = samples.wallNs / 1e9;
+
+    QVariantMap report = ApiTraceReplayer::report(samples, 1);
+    report.insert("readers", readers);
+    report.insert("books", books);
+    report.insert("versionsPublished", published);
+    report.insert("readerSnapshotsPerSecond", snapshots / wallSeconds);
+    report.insert("readerRecordsPerSecond", records / wallSeconds);
+    report.insert("readerViolations", violations);
+
+    Bench::out() << ApiTraceReplayer::formatReport(report)
+                 << QStringLiteral("\nVersions published: %1\n").arg(published)
+                 << QStringLiteral("Readers: %1 snapshots/s, %2 records/s\n")
+                        .arg(snapshots / wallSeconds, 0, 'f', 1)
+                        .arg(records / wallSeconds, 0, 'f', 0)
+                 << "Reader violations: " << violations << "\n";
+
+    if (parser.isSet(jsonOption) && !Bench::writeJson(parser.value(jsonOption), report)) {
+        return 1;
+    }
+    return violations == 0 ? 0 : 1;
+}
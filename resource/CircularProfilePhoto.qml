@@ -1,17 +1,21 @@
 import QtQuick 2.15
 import CircularImage 1.0
 
-// High-performance circular profile photo component using QImage
+// High-performance circular profile photo component using QImage.
+// With sceneGraph set (SIGMATERIAL_SCENEGRAPH_AVATARS=1 sets it for every
+// instance) local sources are drawn by CircularImageItem as a texture on
+// circle geometry instead; remote URLs always use CircularImage.
 Item {
     id: root
     
     // Public properties
-    property alias source: circularImage.source
-    property alias borderWidth: circularImage.borderWidth
-    property alias borderColor: circularImage.borderColor
-    property alias smooth: circularImage.smooth
-    property alias antialiasing: circularImage.antialiasing
-    property alias status: circularImage.status
+    property url source
+    property real borderWidth: 0
+    property color borderColor: Qt.rgba(0, 0, 0, 0)
+    property bool sceneGraph: typeof sceneGraphAvatars !== "undefined" && sceneGraphAvatars
+    readonly property int status: circularImage.item ? circularImage.item.status : CircularImage.Null
+    smooth: true
+    antialiasing: true
     
     // Avatar fallback properties
     property string fallbackText: ""
@@ -26,18 +30,37 @@ Item {
     implicitWidth: 40
     implicitHeight: 40
     
-    // Main circular image using C++ QImage implementation
-    CircularImage {
+    // Main circular image; both items report the same Status values
+    Loader {
         id: circularImage
         anchors.fill: parent
-        smooth: true
-        antialiasing: true
-        borderWidth: 0
-        borderColor: Qt.rgba(0, 0, 0, 0)
-        
+        sourceComponent: root.sceneGraph && !/^https?:/.test(root.source.toString())
+                         ? sceneGraphImage : paintedImage
+    }
+
+    Component {
+        id: paintedImage
+
         // High-performance rendering with QImage and QPainter
         // This provides much better performance than QML clipping
         // and ensures perfect circular clipping regardless of image size
+        CircularImage {
+            source: root.source
+            smooth: root.smooth
+            antialiasing: root.antialiasing
+            borderWidth: root.borderWidth
+            borderColor: root.borderColor
+        }
+    }
+
+    Component {
+        id: sceneGraphImage
+
+        CircularImageItem {
+            source: root.source
+            borderWidth: root.borderWidth
+            borderColor: root.borderColor
+        }
     }
     
     // Fallback avatar when no image is loaded or image failed to load
@@ -45,7 +68,7 @@ Item {
         anchors.fill: parent
         radius: width / 2
         color: fallbackBackgroundColor
-        visible: circularImage.status !== CircularImage.Ready && fallbackText !== ""
+        visible: root.status !== CircularImage.Ready && fallbackText !== ""
         
         Text {
             anchors.centerIn: parent
@@ -62,7 +85,7 @@ Item {
         radius: width / 2
         color: loadingColor
         opacity: 0.3
-        visible: showLoadingIndicator && circularImage.status === CircularImage.Loading
+        visible: showLoadingIndicator && root.status === CircularImage.Loading
         
         // Simple loading animation
         RotationAnimation on rotation {
@@ -91,7 +114,7 @@ Item {
         color: "transparent"
         border.width: 2
         border.color: "#EF4444"
-        visible: circularImage.status === CircularImage.Error && fallbackText === ""
+        visible: root.status === CircularImage.Error && fallbackText === ""
         
         Text {
             anchors.centerIn: parent
@@ -9,7 +9,10 @@ Rectangle {
     color: "#F8FAFC"
     
     // Properties
-    property var books: database ? database.getAllBooks() : []
+    property var books: []
+    // Set by the shell while the page is hidden; changes are caught up on resume
+    property bool suspended: false
+    property bool stale: false
     property int totalBooks: books.length
     property int totalCopies: {
         var sum = 0
@@ -75,15 +78,23 @@ Rectangle {
     }
     
     // Initialize
-    Component.onCompleted: {
-        updateData()
-        refreshTimer.start()
+    Component.onCompleted: updateData()
+
+    onSuspendedChanged: {
+        if (!suspended && stale) {
+            stale = false
+            updateData()
+        }
     }
     
     // Connections
     Connections {
         target: database
         function onBooksChanged() {
+            if (root.suspended) {
+                root.stale = true
+                return
+            }
             updateData()
         }
     }
@@ -93,6 +104,7 @@ Rectangle {
         id: refreshTimer
         interval: 30000 // Refresh every 30 seconds
         repeat: true
+        running: !root.suspended
         onTriggered: updateData()
     }
     
@@ -26,14 +26,112 @@ Window {
     property string currentPageTitle: "Dashboard"
     property bool isUserLoggedIn: appLogic ? appLogic.loggedIn : false
 
+    // Pages are created lazily: the current one on demand, the rest one at a
+    // time after the first frame (prewarmIndex walks the page list). AppLogic
+    // keeps recently used pages alive within its page budget, evicts the
+    // rest and asks for likely next pages to be preloaded while idle.
+    property int prewarmIndex: 0
+    readonly property int pageCount: 5
+    readonly property var pageNames: ["dashboard", "stock", "managestore", "overview", "settings"]
+    readonly property var dashboardPage: dashboardLoader.item
+    readonly property var stockPage: stockLoader.item
+    readonly property var managePage: manageLoader.item
+    readonly property var statsPage: statsLoader.item
+    readonly property var settingsPage: settingsLoader.item
+
+    onCurrentIndexChanged: {
+        if (!appLogic || !isUserLoggedIn)
+            return
+        var page = pageNames[currentIndex]
+        appLogic.navigateToPage(page)
+        // A live page is visible as soon as the layout switches
+        if (pageLoaders()[currentIndex].status === Loader.Ready)
+            Qt.callLater(function() { appLogic.pageShown(page) })
+    }
+
     onIsUserLoggedInChanged: {
         if (isUserLoggedIn) {
             currentIndex = 0
             currentPageTitle = "Dashboard"
+            Qt.callLater(function() { appLogic.pageShown("dashboard") })
         }
     }
 
     // Functions
+    function pageLoaders() {
+        return [dashboardLoader, stockLoader, manageLoader, statsLoader, settingsLoader]
+    }
+
+    function loaderFor(page) {
+        var index = pageNames.indexOf(page)
+        return index >= 0 ? pageLoaders()[index] : null
+    }
+
+    function navigateToPage(page) {
+        var index = pageNames.indexOf(page)
+        if (index >= 0)
+            currentIndex = index
+    }
+
+    function advancePrewarm() {
+        // Skip pages that were already opened by navigation, and stop once
+        // live pages fill the page budget
+        var loaders = pageLoaders()
+        var next = prewarmIndex + 1
+        while (next < pageCount && loaders[next].status === Loader.Ready)
+            ++next
+        if (next < pageCount && appLogic && !appLogic.fitsPageBudget())
+            next = pageCount
+        prewarmIndex = next
+        if (next < pageCount) {
+            loaders[next].wanted = true
+        } else if (startupTrace) {
+            startupTrace.mark("prewarmed")
+            startupTrace.finish()
+        }
+    }
+
+    // Prewarm the remaining pages once the first frame is on screen
+    Connections {
+        target: startupTrace
+        enabled: mainWindow.prewarmIndex === 0
+        function onInteractive() { mainWindow.advancePrewarm() }
+    }
+
+    // Page lifecycle hooks from AppLogic
+    Connections {
+        target: appLogic
+        function onPageSuspended(page) {
+            var loader = mainWindow.loaderFor(page)
+            if (loader && loader.item && loader.item.suspended !== undefined)
+                loader.item.suspended = true
+        }
+        function onPageResumed(page) {
+            var loader = mainWindow.loaderFor(page)
+            if (loader && loader.item && loader.item.suspended !== undefined)
+                loader.item.suspended = false
+        }
+        function onPageEvicted(page) {
+            var loader = mainWindow.loaderFor(page)
+            if (loader && loader.pageIndex !== mainWindow.currentIndex)
+                loader.wanted = false
+        }
+        function onPreloadRequested(page) {
+            var loader = mainWindow.loaderFor(page)
+            if (loader)
+                loader.wanted = true
+        }
+    }
+
+    // Near-duplicate warning after a book is added
+    Connections {
+        target: database
+        function onPossibleDuplicatesFound(bookId, candidates) {
+            if (candidates.length > 0)
+                toast.show("Kemungkinan duplikat dari #" + candidates[0].id + " " + candidates[0].title, 4000)
+        }
+    }
+
     function logoutSystem() {
         if (database) database.logoutUser()
         if (appLogic) appLogic.logout()
@@ -407,11 +505,40 @@ Window {
                     anchors.fill: parent
                     currentIndex: mainWindow.currentIndex
 
-                    Dashboard { id: dashboardPage }
-                    Stock { id: stockPage }
-                    ManageStore { id: managePage }
-                    Overview { id: statsPage }
-                    Settings { id: settingsPage }
+                    // Only the initial page is built synchronously with the window
+                    component PageLoader: Loader {
+                        required property int pageIndex
+                        required property string pageName
+                        // Prewarmed, preloaded or visited; cleared on eviction
+                        property bool wanted: false
+
+                        asynchronous: pageIndex !== 0
+                        active: wanted || pageIndex === currentIndex
+
+                        onStatusChanged: {
+                            if (status !== Loader.Ready)
+                                return
+                            wanted = true
+                            // Pages created in the background start suspended
+                            if (item.suspended !== undefined)
+                                item.suspended = pageIndex !== currentIndex
+                            if (startupTrace)
+                                startupTrace.mark("page:" + pageName)
+                            if (appLogic) {
+                                appLogic.pageReady(pageName, item)
+                                if (pageIndex === currentIndex)
+                                    appLogic.pageShown(pageName)
+                            }
+                            if (pageIndex === prewarmIndex && prewarmIndex > 0)
+                                advancePrewarm()
+                        }
+                    }
+
+                    PageLoader { id: dashboardLoader; pageIndex: 0; pageName: "dashboard"; sourceComponent: Dashboard {} }
+                    PageLoader { id: stockLoader; pageIndex: 1; pageName: "stock"; sourceComponent: Stock {} }
+                    PageLoader { id: manageLoader; pageIndex: 2; pageName: "managestore"; sourceComponent: ManageStore {} }
+                    PageLoader { id: statsLoader; pageIndex: 3; pageName: "overview"; sourceComponent: Overview {} }
+                    PageLoader { id: settingsLoader; pageIndex: 4; pageName: "settings"; sourceComponent: Settings {} }
                 }
             }
         }
@@ -11,6 +11,11 @@ Rectangle {
     color: "#f0f1f3"
     readonly property real spacing: 24
     readonly property real sidebarWidth: 280
+
+    // Set by the shell while the page is hidden; a product picked meanwhile
+    // is loaded on resume instead of on every show
+    property bool suspended: false
+    property bool stale: false
     
     // Search functionality
     property string searchText: ""
@@ -25,8 +30,7 @@ Rectangle {
         }
     }
     
-    // Purchase list model
-    property var purchaseList: []    // Edit mode properties
+    // Purchases come from purchaseModel (C++, SQL-paged); edit mode properties
     property bool isEditing: false
     property var editingPurchase: null
 
@@ -92,11 +96,10 @@ Rectangle {
         console.log("Overview component completed, selectedProduct:", mainWindow.selectedProduct);
         // Use a timer to ensure everything is initialized
         loadTimer.start();
-    }    // Load purchases when selectedProduct changes
-    onVisibleChanged: {
-        console.log("Overview visibility changed to:", visible);
-        if (visible && mainWindow.selectedProduct) {
-            console.log("Page became visible - loading purchases");
+    }    // purchaseModel stays current while hidden; only a product change needs a reload
+    onSuspendedChanged: {
+        if (!suspended && stale) {
+            stale = false;
             loadPurchases();
         }
     }    // Watch for selectedProduct changes
@@ -104,28 +107,34 @@ Rectangle {
         target: mainWindow
         function onSelectedProductChanged() {
             console.log("Selected product changed to:", mainWindow.selectedProduct);
-            if (root.visible) {
-                loadPurchases();
+            if (root.suspended) {
+                root.stale = true;
+                return;
             }
+            loadPurchases();
         }
     }// Function to load purchases from database
     function loadPurchases() {
         console.log("loadPurchases called, selectedProduct:", mainWindow.selectedProduct);
 
-        if (!mainWindow.selectedProduct) {
-            console.log("No selected product, clearing purchase list");
-            purchaseList = [];
-            updateSummary();
-            return;
+        // Searching spans every product; otherwise show the selected one.
+        // Later adds, edits and deletes patch the model row by row.
+        if (isSearching) {
+            purchaseModel.setFilter(0, searchText);
+        } else if (mainWindow.selectedProduct) {
+            purchaseModel.setFilter(parseInt(mainWindow.selectedProduct.id), "");
+        } else {
+            purchaseModel.setFilter(-1, "");
         }
-
-        console.log("Loading purchases for product ID:", mainWindow.selectedProduct.id);
-        var purchases = database.getPurchasesByProduct(parseInt(mainWindow.selectedProduct.id));
-        console.log("Retrieved purchases:", purchases.length, "items");
-
-        purchaseList = purchases;
         updateSummary();
     }
+
+    Connections {
+        target: purchaseModel
+        function onTotalsChanged() {
+            updateSummary();
+        }
+    }
       // Function to add purchase
     function addPurchase(name, quantity, notes) {
         // Validate stock before adding purchase
@@ -174,8 +183,7 @@ Rectangle {
                     console.log("Warning: Failed to record income transaction");
                 }
 
-                // Reload purchases from database
-                loadPurchases();
+                // purchaseModel picks the new row up from database.purchaseAdded
                 refreshStockPageStats(); // Refresh stock statistics
                 showMessageToUser("Pembelian berhasil ditambahkan", true);
                 return true;
@@ -201,15 +209,9 @@ Rectangle {
         var newTotalPrice = newQuantity * unitPrice;
 
         // Find the existing purchase
-        var oldPurchase = null;
-        for (var i = 0; i < purchaseList.length; i++) {
-            if (purchaseList[i].id === purchaseId) {
-                oldPurchase = purchaseList[i];
-                break;
-            }
-        }
+        var oldPurchase = database.getPurchase(purchaseId);
 
-        if (!oldPurchase) {
+        if (!oldPurchase.id) {
             showMessageToUser("Pembelian tidak ditemukan", false);
             return false;
         }
@@ -240,8 +242,7 @@ Rectangle {
                     stock: newStock,
                     image_path: mainWindow.selectedProduct.image_path || ""
                 };
-                mainWindow.selectedProduct = updatedProduct;                // Reload purchases from database
-                loadPurchases();
+                mainWindow.selectedProduct = updatedProduct;                // purchaseModel patches the row from database signals
                 refreshStockPageStats(); // Refresh stock statistics
                 showMessageToUser("Pembelian berhasil diupdate", true);
                 return true;
@@ -262,15 +263,9 @@ Rectangle {
         }
 
         // Find the purchase to remove
-        var purchaseToRemove = null;
-        for (var i = 0; i < purchaseList.length; i++) {
-            if (purchaseList[i].id === purchaseId) {
-                purchaseToRemove = purchaseList[i];
-                break;
-            }
-        }
+        var purchaseToRemove = database.getPurchase(purchaseId);
 
-        if (!purchaseToRemove) {
+        if (!purchaseToRemove.id) {
             showMessageToUser("Pembelian tidak ditemukan", false);
             return false;
         }
@@ -292,8 +287,7 @@ Rectangle {
                     stock: newStock,
                     image_path: mainWindow.selectedProduct.image_path || ""
                 };
-                mainWindow.selectedProduct = updatedProduct;                // Reload purchases from database
-                loadPurchases();
+                mainWindow.selectedProduct = updatedProduct;                // purchaseModel patches the row from database signals
                 refreshStockPageStats(); // Refresh stock statistics
                 showMessageToUser("Pembelian berhasil dihapus", true);
                 return true;
@@ -307,11 +301,9 @@ Rectangle {
         }
     }    // Function to update summary
     function updateSummary() {
-        var totalOrders = purchaseList.length;
-        var totalRevenue = purchaseList.reduce(function(sum, item) {
-            return sum + item.total_price; // Note: database returns total_price, not totalPrice
-        }, 0);        totalOrdersText.text = totalOrders + " pesanan";
-        totalRevenueText.text = "Rp " + formatRupiah(totalRevenue);
+        // Running totals over the whole filtered set, kept by the model
+        totalOrdersText.text = purchaseModel.totalCount + " pesanan";
+        totalRevenueText.text = "Rp " + formatRupiah(purchaseModel.totalRevenue);
     }
 
     // Function to add stock
@@ -1202,21 +1194,38 @@ Rectangle {
                                 // Purchase list or empty state
                                 Item {
                                     width: parent.width
-                                    height: purchaseList.length > 0 ? listColumn.height : 150
+                                    height: purchaseModel.count > 0 ? listColumn.height : 150
 
-                                    // Dynamic purchase list
-                                    Column {
+                                    // Dynamic purchase list; ListView only creates visible
+                                    // rows and pulls further pages through fetchMore()
+                                    ListView {
                                         id: listColumn
                                         width: parent.width
-                                        visible: purchaseList.length > 0
+                                        height: Math.min(contentHeight, 48 * 10)
+                                        visible: purchaseModel.count > 0
+                                        clip: true
+                                        boundsBehavior: Flickable.StopAtBounds
+                                        model: purchaseModel
 
-                                        Repeater {
-                                            model: purchaseList
                                             delegate: Rectangle {
-                                                width: parent.width
+                                                required property int index
+                                                required property var model
+                                                // Rebuilt from the roles, so it follows dataChanged
+                                                readonly property var modelData: ({
+                                                    id: model.id,
+                                                    product_id: model.product_id,
+                                                    customer_name: model.customer_name,
+                                                    quantity: model.quantity,
+                                                    total_price: model.total_price,
+                                                    notes: model.notes,
+                                                    income_id: model.income_id,
+                                                    created_at: model.created_at
+                                                })
+
+                                                width: ListView.view.width
                                                 height: 48
                                                 color: index % 2 === 0 ? "#FFFFFF" : "#F9FAFB"
-                                                border.width: index === purchaseList.length - 1 ? 0 : 1
+                                                border.width: index === purchaseModel.count - 1 ? 0 : 1
                                                 border.color: "#F3F4F6"
 
                                                 Row {
@@ -1344,14 +1353,13 @@ Rectangle {
                                                     }
                                                 }
                                             }
-                                        }
                                     }
 
                                     // Empty state message
                                     Column {
                                         anchors.centerIn: parent
                                         spacing: 12
-                                        visible: purchaseList.length === 0
+                                        visible: purchaseModel.count === 0
 
                                         Image {
                                             anchors.horizontalCenter: parent.horizontalCenter
@@ -2377,7 +2385,6 @@ Rectangle {
                                             };
                                             mainWindow.selectedProduct = updatedProduct;
                                             
-                                            loadPurchases();
                                             refreshStockPageStats();
                                             showMessageToUser("Pembelian berhasil dihapus dan stok dipulihkan", true);
                                         } else {
@@ -2406,30 +2413,12 @@ Rectangle {
     
     // Function to perform actual search with timer debouncing
     function performSearchWithTimer(text) {
-        var searchQuery = text.toLowerCase().trim()
+        var searchQuery = text.trim()
         isSearching = searchQuery !== ""
-        
-        if (database) {
-            if (searchQuery !== "") {
-                // Search in purchase data
-                var allPurchases = database.loadPurchaseData()
-                var filteredPurchases = allPurchases.filter(function(item) {
-                    var nameMatch = item.productName && item.productName.toLowerCase().indexOf(searchQuery) !== -1
-                    var supplierMatch = item.supplier && item.supplier.toLowerCase().indexOf(searchQuery) !== -1
-                    var quantityMatch = item.quantity && item.quantity.toString().indexOf(searchQuery) !== -1
-                    var priceMatch = item.price && item.price.toString().indexOf(searchQuery) !== -1
-                    var dateMatch = item.purchaseDate && item.purchaseDate.toLowerCase().indexOf(searchQuery) !== -1
-                    return nameMatch || supplierMatch || quantityMatch || priceMatch || dateMatch
-                })
-                
-                purchaseList = filteredPurchases
-                searchResultCount = filteredPurchases.length
-            } else {
-                // Reset to original data
-                loadPurchaseData()
-                searchResultCount = 0
-            }
-        }
+
+        // Filtering over product, customer, notes and date runs in SQL
+        loadPurchases()
+        searchResultCount = isSearching ? purchaseModel.totalCount : 0
     }
     
     // Function to clear search
@@ -2437,7 +2426,7 @@ Rectangle {
         searchText = ""
         isSearching = false
         searchResultCount = 0
-        loadPurchaseData()
+        loadPurchases()
     }
     
     // Settings Popup
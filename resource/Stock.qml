@@ -2,6 +2,7 @@ import QtQuick 2.15
 import QtQuick.Controls 2.15
 import QtQuick.Layouts 1.15
 import QtQuick.Controls.Material 2.15
+import QtQuick.Window 2.15
 
 Rectangle {
     id: root
@@ -15,6 +16,9 @@ Rectangle {
     property var relatedBooks: []
     property bool sortedByTitle: database ? database.isSortedByTitle() : false
     property bool sortedByYear: database ? database.isSortedByYear() : false
+    // Set by the shell while the page is hidden; changes are caught up on resume
+    property bool suspended: false
+    property bool stale: false
     
     // Theme
     property color primaryColor: "#1565C0"
@@ -71,11 +75,27 @@ Rectangle {
     
     // Initialize
     Component.onCompleted: refreshBooks()
+
+    onSuspendedChanged: {
+        if (suspended) {
+            if (coverPrefetcher) coverPrefetcher.cancelAll()
+            return
+        }
+        if (stale) {
+            stale = false
+            refreshBooks()
+        }
+        bookGrid.updatePrefetch()
+    }
     
     // Connections
     Connections {
         target: database
         function onBooksChanged() {
+            if (root.suspended) {
+                root.stale = true
+                return
+            }
             refreshBooks()
         }
         function onSortStatusChanged() {
@@ -335,6 +355,37 @@ Rectangle {
             cellHeight: 380
             model: displayedBooks
             visible: displayedBooks.length > 0
+
+            // Cover edge in device pixels; prefetched covers and delegates
+            // must ask for the same size to share decodes
+            readonly property int coverPixels: Math.ceil((cellWidth - 42) * Screen.devicePixelRatio)
+
+            // Feeds the cover prefetcher the visible range and scroll speed
+            function updatePrefetch() {
+                if (!coverPrefetcher || root.suspended || count === 0) return
+                var columns = Math.max(1, Math.floor(width / cellWidth))
+                var first = Math.max(0, indexAt(contentX + 1, contentY + 1))
+                var last = indexAt(contentX + width - 1, contentY + height - 1)
+                if (last < 0) {
+                    // Bottom-right cell is empty on a partial last row
+                    last = Math.min(count - 1, first + columns * Math.ceil(height / cellHeight) - 1)
+                }
+                coverPrefetcher.updateViewport(first, last, verticalVelocity / cellHeight * columns, coverPixels)
+            }
+
+            onModelChanged: {
+                if (coverPrefetcher) {
+                    coverPrefetcher.setImagePaths(displayedBooks.map(function(book) {
+                        return book.image_path || ""
+                    }))
+                }
+                Qt.callLater(bookGrid.updatePrefetch)
+            }
+            onContentYChanged: Qt.callLater(bookGrid.updatePrefetch)
+            onWidthChanged: Qt.callLater(bookGrid.updatePrefetch)
+            onHeightChanged: Qt.callLater(bookGrid.updatePrefetch)
+            // Velocity is back to zero: re-centre the window
+            onMovementEnded: updatePrefetch()
             
             delegate: Rectangle {
                 width: bookGrid.cellWidth - 10
@@ -362,10 +413,26 @@ Rectangle {
                         Layout.preferredHeight: 150
                         radius: 8
                         color: primaryLight
+                        clip: true
+                        
+                        // Pre-scaled thumbnail, usually already decoded by
+                        // the prefetcher before the tile scrolls in
+                        Image {
+                            id: coverImage
+                            anchors.fill: parent
+                            fillMode: Image.PreserveAspectCrop
+                            asynchronous: true
+                            sourceSize.width: width * Screen.devicePixelRatio
+                            source: modelData.image_path && coverPrefetcher
+                                    ? coverPrefetcher.coverUrl(modelData.image_path, bookGrid.coverPixels)
+                                    : ""
+                            visible: status === Image.Ready
+                        }
                         
                         ColumnLayout {
                             anchors.centerIn: parent
                             spacing: 8
+                            visible: !coverImage.visible
                             
                             Text {
                                 text: "📚"
@@ -1,18 +1,28 @@
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQuickWindow>
+#include "../ApiTraceRecorder.h"
 #include "../AppLogic.h"
 #include "../Database.h"
+#include "../CatalogExporter.h"
+#include "../PurchaseListModel.h"
 #include "../CircularImage.h"
+#include "../CircularImageItem.h"
+#include "../CoverPrefetcher.h"
+#include "../StartupTrace.h"
+#include "../ThumbnailCache.h"
 #include <QtQuickControls2/QQuickStyle>
 
 int main(int argc, char *argv[])
 {
     QQuickStyle::setStyle("Fusion");
     QGuiApplication app(argc, argv);
+    StartupTrace::instance()->mark("appCreated");
 
     // Register CircularImage component for QML
     qmlRegisterType<CircularImage>("CircularImage", 1, 0, "CircularImage");
+    qmlRegisterType<CircularImageItem>("CircularImage", 1, 0, "CircularImageItem");
 
     QQmlApplicationEngine engine;
     AppLogic appLogic;
@@ -22,12 +32,33 @@ int main(int argc, char *argv[])
         qDebug() << "Failed to initialize database";
         return -1;
     }
+    StartupTrace::instance()->mark("databaseReady");
+
+    // Opt-in API trace for sigmaterial-replay; starts after initDatabase(),
+    // which the replayer runs itself
+    if (ApiTraceRecorder::instance()->startFromEnvironment()) {
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, []() { ApiTraceRecorder::instance()->stop(); });
+    }
 
     // Connect AppLogic with Database
     appLogic.setDatabase(&database);
 
+    CatalogExporter catalogExporter(&database);
+    PurchaseListModel purchaseModel(&database);
+    CoverPrefetcher coverPrefetcher;
+    engine.addImageProvider(QStringLiteral("covers"), coverPrefetcher.createImageProvider());
+
     engine.rootContext()->setContextProperty("appLogic", &appLogic);
     engine.rootContext()->setContextProperty("database", &database);
+    engine.rootContext()->setContextProperty("catalogExporter", &catalogExporter);
+    engine.rootContext()->setContextProperty("purchaseModel", &purchaseModel);
+    engine.rootContext()->setContextProperty("thumbnails", ThumbnailCache::instance());
+    engine.rootContext()->setContextProperty("coverPrefetcher", &coverPrefetcher);
+    engine.rootContext()->setContextProperty("startupTrace", StartupTrace::instance());
+
+    // Opt-in scene-graph avatars (CircularImageItem) in CircularProfilePhoto
+    engine.rootContext()->setContextProperty("sceneGraphAvatars",
+                                             qEnvironmentVariableIntValue("SIGMATERIAL_SCENEGRAPH_AVATARS") != 0);
 
     QObject::connect(
         &engine,
@@ -35,7 +66,16 @@ int main(int argc, char *argv[])
         &app,
         []() { QCoreApplication::exit(-1); },
         Qt::QueuedConnection);
-    engine.load(QUrl(QStringLiteral("qrc:/Main.qml")));
+
+    // The AppSigmaterial module lives under qrc:/AppSigmaterial (RESOURCE_PREFIX /),
+    // so pages keep resolving ../assets against the qrc root
+    engine.addImportPath(QStringLiteral(":/"));
+    engine.loadFromModule("AppSigmaterial", "Main");
+    StartupTrace::instance()->mark("rootLoaded");
+
+    if (!engine.rootObjects().isEmpty()) {
+        StartupTrace::instance()->attach(qobject_cast<QQuickWindow *>(engine.rootObjects().first()));
+    }
 
     return app.exec();
 }
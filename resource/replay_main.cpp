@@ -0,0 +1,131 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSaveFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include "../ApiTraceReplayer.h"
+#include "../ThumbnailCache.h"
+#include <memory>
+#include <vector>
+
+// sigmaterial-replay <trace> <database> [--speed f] [--sessions n] [--json file]
+//
+// Replays a trace recorded with SIGMATERIAL_API_TRACE=<file> against a copy
+// of <database> and prints throughput and latency percentiles per method.
+// Extra sessions run as worker processes of this tool on the same copy:
+// Database and the thumbnail cache belong to one thread each, so separate
+// processes are how several clients share one file.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sigmaterial-replay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a Database API trace and reports per-method latency.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("trace", "Trace file recorded with SIGMATERIAL_API_TRACE.");
+    parser.addPositionalArgument("database", "Database file; the replay runs against a copy.");
+
+    QCommandLineOption speedOption("speed", "0 replays as fast as possible (default), 1 at the recorded pace, "
+                                            "2 twice as fast.", "factor", "0");
+    QCommandLineOption sessionsOption("sessions", "Concurrent sessions, each replaying the whole trace.", "n", "1");
+    QCommandLineOption jsonOption("json", "Also write the report as JSON.", "file");
+    QCommandLineOption workerOption("worker-samples", "Internal: replay one session and write raw samples.", "file");
+    workerOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOptions({ speedOption, sessionsOption, jsonOption, workerOption });
+    parser.process(app);
+
+    const QStringList positional = parser.positionalArguments();
+    if (positional.size() != 2) {
+        parser.showHelp(1);
+    }
+    const QString tracePath = positional.at(0);
+    const QString databasePath = positional.at(1);
+    const double speed = qMax(0.0, parser.value(speedOption).toDouble());
+    const int sessions = qMax(1, parser.value(sessionsOption).toInt());
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        qDebug() << "Error: Could not create a working directory";
+        return 1;
+    }
+    // Keep generated thumbnails out of the user's cache
+    ThumbnailCache::instance()->setCacheDirectory(workDir.filePath("thumbnails"));
+
+    ApiTraceReplayer replayer;
+    if (!replayer.load(tracePath)) {
+        qDebug() << "Error:" << qPrintable(replayer.errorString());
+        return 1;
+    }
+
+    // Worker: the parent already made the copy
+    if (parser.isSet(workerOption)) {
+        ApiTraceReplayer::Samples samples;
+        if (!replayer.replay(databasePath, QStringLiteral("replay"), speed, samples)) {
+            qDebug() << "Error:" << qPrintable(replayer.errorString());
+            return 1;
+        }
+        return ApiTraceReplayer::writeSamples(parser.value(workerOption), samples) ? 0 : 1;
+    }
+
+    const QString copyPath = workDir.filePath(QFileInfo(databasePath).fileName());
+    if (!QFile::copy(databasePath, copyPath)) {
+        qDebug() << "Error: Could not copy" << databasePath;
+        return 1;
+    }
+    // Committed pages may still sit in the write-ahead log
+    if (QFile::exists(databasePath + "-wal")) {
+        QFile::copy(databasePath + "-wal", copyPath + "-wal");
+    }
+
+    qDebug() << "Replaying" << replayer.callCount() << "calls," << sessions << "session(s)";
+
+    ApiTraceReplayer::Samples samples;
+    if (sessions == 1) {
+        if (!replayer.replay(copyPath, QStringLiteral("replay"), speed, samples)) {
+            qDebug() << "Error:" << qPrintable(replayer.errorString());
+            return 1;
+        }
+    } else {
+        std::vector<std::unique_ptr<QProcess>> workers;
+        for (int i = 0; i < sessions; ++i) {
+            auto worker = std::make_unique<QProcess>();
+            worker->setProcessChannelMode(QProcess::ForwardedChannels);
+            worker->start(QCoreApplication::applicationFilePath(),
+                          { tracePath, copyPath, "--speed", QString::number(speed),
+                            "--worker-samples", workDir.filePath(QStringLiteral("session-%1.bin").arg(i)) });
+            workers.push_back(std::move(worker));
+        }
+
+        for (int i = 0; i < sessions; ++i) {
+            ApiTraceReplayer::Samples session;
+            workers[i]->waitForFinished(-1);
+            if (workers[i]->exitCode() != 0
+                || !ApiTraceReplayer::readSamples(workDir.filePath(QStringLiteral("session-%1.bin").arg(i)), session)) {
+                qDebug() << "Error: Session" << i << "failed";
+                return 1;
+            }
+            samples.merge(session);
+        }
+    }
+
+    const QVariantMap report = ApiTraceReplayer::report(samples, sessions);
+    QTextStream(stdout) << ApiTraceReplayer::formatReport(report);
+
+    if (parser.isSet(jsonOption)) {
+        QSaveFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qDebug() << "Error: Could not write" << parser.value(jsonOption);
+            return 1;
+        }
+        file.write(QJsonDocument(QJsonObject::fromVariantMap(report)).toJson(QJsonDocument::Indented));
+        file.commit();
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#version 440
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 1) in float alpha;
+
+layout(location = 0) out vec4 fragColor;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+};
+
+layout(binding = 1) uniform sampler2D source;
+
+void main()
+{
+    // Texture is premultiplied, so scaling all channels fades the rim correctly
+    fragColor = texture(source, texCoord) * (alpha * qt_Opacity);
+}
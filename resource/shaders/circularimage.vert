@@ -0,0 +1,22 @@
+#version 440
+
+layout(location = 0) in vec4 vertexCoord;
+layout(location = 1) in vec2 textureCoord;
+layout(location = 2) in float vertexAlpha;
+
+layout(location = 0) out vec2 texCoord;
+layout(location = 1) out float alpha;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+};
+
+out gl_PerVertex { vec4 gl_Position; };
+
+void main()
+{
+    texCoord = textureCoord;
+    alpha = vertexAlpha;
+    gl_Position = qt_Matrix * vertexCoord;
+}
@@ -0,0 +1,341 @@
+#include <QRandomGenerator>
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QtTest>
+#include "CoOccurrenceRecommender.h"
+
+// Incremental recordPurchase()/removePurchase() against a rebuild from the
+// purchases table. After every checkpoint a fresh recommender is built from
+// what the table then holds, and the co-occurrence counts, the customers per
+// item and the served top-K rows must all be the same.
+class TestCoOccurrenceRecommender : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanupTestCase();
+    void repeatPurchases();
+    void basketCrossesTheLimit();
+    void randomAgainstRebuild_data();
+    void randomAgainstRebuild();
+
+private:
+    struct Purchase {
+        int id;
+        QString customer;
+        int productId;
+    };
+
+    void startEmpty(CoOccurrenceRecommender &recommender);
+    void buy(CoOccurrenceRecommender &recommender, const QString &customer, int productId);
+    void giveBack(CoOccurrenceRecommender &recommender, int index);
+    int indexOf(const QString &customer, int productId) const;
+    void compareWithRebuild(CoOccurrenceRecommender &incremental, int products);
+
+    QTemporaryDir m_dir;
+    QVector<Purchase> m_purchases;   // what the table holds, oldest first
+};
+
+namespace {
+const QString kConnection = QStringLiteral("tst-recommender");
+constexpr int kUserId = 1;
+constexpr int kMaxBasket = CoOccurrenceRecommender::kMaxBasketItems;
+
+QSqlDatabase connection()
+{
+    return QSqlDatabase::database(kConnection);
+}
+}
+
+void TestCoOccurrenceRecommender::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    // A file, not :memory:, so the build job's cloned connection sees it
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", kConnection);
+    db.setDatabaseName(m_dir.filePath("purchases.db"));
+    QVERIFY2(db.open(), qPrintable(db.lastError().text()));
+
+    QSqlQuery query(db);
+    QVERIFY2(query.exec("CREATE TABLE purchases (id INTEGER PRIMARY KEY AUTOINCREMENT, user_id INTEGER,"
+                        " product_id INTEGER, customer_name TEXT)"),
+             qPrintable(query.lastError().text()));
+}
+
+void TestCoOccurrenceRecommender::init()
+{
+    QSqlQuery query(connection());
+    QVERIFY2(query.exec("DELETE FROM purchases"), qPrintable(query.lastError().text()));
+    m_purchases.clear();
+}
+
+void TestCoOccurrenceRecommender::cleanupTestCase()
+{
+    QSqlDatabase::database(kConnection).close();
+    QSqlDatabase::removeDatabase(kConnection);
+}
+
+void TestCoOccurrenceRecommender::startEmpty(CoOccurrenceRecommender &recommender)
+{
+    QSignalSpy built(&recommender, &CoOccurrenceRecommender::rebuilt);
+    recommender.rebuild(kConnection, kUserId);
+    QVERIFY(built.wait(10000));
+    QVERIFY(recommender.isReady());
+}
+
+void TestCoOccurrenceRecommender::buy(CoOccurrenceRecommender &recommender, const QString &customer,
+                                      int productId)
+{
+    QSqlQuery query(connection());
+    query.prepare("INSERT INTO purchases (user_id, product_id, customer_name) VALUES (?, ?, ?)");
+    query.addBindValue(kUserId);
+    query.addBindValue(productId);
+    query.addBindValue(customer);
+    QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+
+    const int id = query.lastInsertId().toInt();
+    recommender.recordPurchase(id, customer, productId);
+    m_purchases.append({ id, customer, productId });
+}
+
+void TestCoOccurrenceRecommender::giveBack(CoOccurrenceRecommender &recommender, int index)
+{
+    const Purchase purchase = m_purchases.takeAt(index);
+    QSqlQuery query(connection());
+    query.prepare("DELETE FROM purchases WHERE id = ?");
+    query.addBindValue(purchase.id);
+    QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+
+    recommender.removePurchase(purchase.customer, purchase.productId);
+}
+
+int TestCoOccurrenceRecommender::indexOf(const QString &customer, int productId) const
+{
+    for (int i = 0; i < m_purchases.size(); ++i) {
+        if (m_purchases.at(i).customer == customer && m_purchases.at(i).productId == productId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Products are 1..products. Scores come from the same counts through the
+// same arithmetic and ties break on the product id, so the rows must match
+// exactly, order included.
+void TestCoOccurrenceRecommender::compareWithRebuild(CoOccurrenceRecommender &incremental, int products)
+{
+    CoOccurrenceRecommender rebuilt;
+    startEmpty(rebuilt);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+
+    const QVariantMap expected = rebuilt.stats();
+    const QVariantMap actual = incremental.stats();
+    for (const char *key : { "transactions", "items", "customers", "pairs" }) {
+        QVERIFY2(actual.value(key) == expected.value(key),
+                 qPrintable(QStringLiteral("%1: %2, rebuild has %3")
+                                .arg(QLatin1String(key), actual.value(key).toString(),
+                                     expected.value(key).toString())));
+    }
+
+    for (int x = 1; x <= products; ++x) {
+        QCOMPARE(incremental.customerCount(x), rebuilt.customerCount(x));
+        for (int y = 1; y <= products; ++y) {
+            if (incremental.sharedCustomers(x, y) != rebuilt.sharedCustomers(x, y)) {
+                QFAIL(qPrintable(QStringLiteral("shared customers of %1 and %2: %3, rebuild has %4")
+                                     .arg(x)
+                                     .arg(y)
+                                     .arg(incremental.sharedCustomers(x, y))
+                                     .arg(rebuilt.sharedCustomers(x, y))));
+            }
+        }
+
+        const auto actualRow = incremental.related(x, CoOccurrenceRecommender::kTopK);
+        const auto expectedRow = rebuilt.related(x, CoOccurrenceRecommender::kTopK);
+        QCOMPARE(actualRow.size(), expectedRow.size());
+        for (int i = 0; i < actualRow.size(); ++i) {
+            QCOMPARE(actualRow.at(i).productId, expectedRow.at(i).productId);
+            QCOMPARE(actualRow.at(i).sharedCustomers, expectedRow.at(i).sharedCustomers);
+            QCOMPARE(actualRow.at(i).score, expectedRow.at(i).score);
+        }
+    }
+}
+
+// A second purchase of the same product neither counts the customer twice
+// nor adds pairs, and only the last return of it takes them away
+void TestCoOccurrenceRecommender::repeatPurchases()
+{
+    CoOccurrenceRecommender recommender;
+    startEmpty(recommender);
+    QVERIFY(!QTest::currentTestFailed());
+
+    buy(recommender, QStringLiteral("Ann"), 1);
+    buy(recommender, QStringLiteral("  ann "), 1);   // the same customer
+    buy(recommender, QStringLiteral("ANN"), 2);
+    buy(recommender, QStringLiteral("Bob"), 2);
+    QVERIFY(!QTest::currentTestFailed());
+    QCOMPARE(recommender.customerCount(1), 1);
+    QCOMPARE(recommender.customerCount(2), 2);
+    QCOMPARE(recommender.sharedCustomers(1, 2), 1);
+    compareWithRebuild(recommender, 2);
+    QVERIFY(!QTest::currentTestFailed());
+
+    giveBack(recommender, indexOf(QStringLiteral("Ann"), 1));
+    QCOMPARE(recommender.customerCount(1), 1);
+    QCOMPARE(recommender.sharedCustomers(1, 2), 1);
+    compareWithRebuild(recommender, 2);
+    QVERIFY(!QTest::currentTestFailed());
+
+    giveBack(recommender, indexOf(QStringLiteral("  ann "), 1));
+    QCOMPARE(recommender.customerCount(1), 0);
+    QCOMPARE(recommender.sharedCustomers(1, 2), 0);
+    QVERIFY(recommender.related(2, 5).isEmpty());
+    compareWithRebuild(recommender, 2);
+}
+
+// A basket withdraws its pairs when it grows past kMaxBasketItems and
+// gives them back when it shrinks to the limit again. Other customers
+// share some of its products, so the withdrawn counts are not all zero.
+void TestCoOccurrenceRecommender::basketCrossesTheLimit()
+{
+    const int products = kMaxBasket + 5;
+    const QString walkIn = QStringLiteral("Walk-in");
+    CoOccurrenceRecommender recommender;
+    startEmpty(recommender);
+    QVERIFY(!QTest::currentTestFailed());
+
+    for (int product = 1; product <= 10; ++product) {
+        buy(recommender, QStringLiteral("Regular"), product * 3);
+    }
+    for (int product = 1; product <= kMaxBasket; ++product) {
+        buy(recommender, walkIn, product);
+    }
+    QVERIFY(!QTest::currentTestFailed());
+    QCOMPARE(recommender.sharedCustomers(1, kMaxBasket), 1);
+    QCOMPARE(recommender.sharedCustomers(3, 6), 2);
+    compareWithRebuild(recommender, products);
+    QVERIFY(!QTest::currentTestFailed());
+
+    // Over the limit: only the regular's pairs are left
+    buy(recommender, walkIn, kMaxBasket + 1);
+    QCOMPARE(recommender.sharedCustomers(1, kMaxBasket), 0);
+    QCOMPARE(recommender.sharedCustomers(3, 6), 1);
+    QCOMPARE(recommender.customerCount(kMaxBasket + 1), 1);
+    compareWithRebuild(recommender, products);
+    QVERIFY(!QTest::currentTestFailed());
+
+    // Further up, a repeat purchase, and back down to one over the limit
+    buy(recommender, walkIn, kMaxBasket + 2);
+    buy(recommender, walkIn, 3);
+    giveBack(recommender, indexOf(walkIn, kMaxBasket + 2));
+    QVERIFY(!QTest::currentTestFailed());
+    QCOMPARE(recommender.sharedCustomers(3, 6), 1);
+    compareWithRebuild(recommender, products);
+    QVERIFY(!QTest::currentTestFailed());
+
+    // Returning one of two purchases of a product keeps the basket size
+    giveBack(recommender, indexOf(walkIn, 3));
+    QCOMPARE(recommender.sharedCustomers(3, 6), 1);
+
+    // Back at the limit: the pairs return
+    giveBack(recommender, indexOf(walkIn, kMaxBasket + 1));
+    QVERIFY(!QTest::currentTestFailed());
+    QCOMPARE(recommender.sharedCustomers(1, kMaxBasket), 1);
+    QCOMPARE(recommender.sharedCustomers(3, 6), 2);
+    QCOMPARE(recommender.customerCount(kMaxBasket + 1), 0);
+    compareWithRebuild(recommender, products);
+}
+
+void TestCoOccurrenceRecommender::randomAgainstRebuild_data()
+{
+    QTest::addColumn<quint32>("seed");
+    for (quint32 seed : { 42u, 1031u, 77777u }) {
+        QTest::newRow(qPrintable(QStringLiteral("seed %1").arg(seed))) << seed;
+    }
+}
+
+// Regular customers buy from a small shelf, so repeat purchases and shared
+// products are common, and about a third of the steps return one of their
+// purchases. One catch-all customer buys new products, now and then buys
+// or returns one it already has, and returns while over kMaxBasketItems,
+// so its basket keeps crossing the limit.
+void TestCoOccurrenceRecommender::randomAgainstRebuild()
+{
+    QFETCH(quint32, seed);
+    const int products = kMaxBasket + 20;
+    const int shelf = 40;
+    const QString walkIn = QStringLiteral("Walk-in");
+    const QStringList names = { QStringLiteral("Ann"), QStringLiteral("ann "), QStringLiteral("Bob"),
+                                QStringLiteral("Carla"), QStringLiteral("Dev"), QStringLiteral("Edda"),
+                                QStringLiteral("Finn"), QStringLiteral("Gus"), QStringLiteral("Hana") };
+
+    CoOccurrenceRecommender recommender;
+    startEmpty(recommender);
+    QVERIFY(!QTest::currentTestFailed());
+
+    // Start the catch-all basket just under the limit
+    for (int product = 1; product <= kMaxBasket - 5; ++product) {
+        buy(recommender, walkIn, product);
+    }
+    QVERIFY(!QTest::currentTestFailed());
+
+    QRandomGenerator random(seed);
+    int crossings = 0;
+    bool wasOver = false;
+    for (int step = 1; step <= 3000; ++step) {
+        QVector<int> walkInPurchases;
+        QVector<int> regularPurchases;
+        QSet<int> walkInBasket;
+        for (int i = 0; i < m_purchases.size(); ++i) {
+            if (m_purchases.at(i).customer == walkIn) {
+                walkInPurchases.append(i);
+                walkInBasket.insert(m_purchases.at(i).productId);
+            } else {
+                regularPurchases.append(i);
+            }
+        }
+        const bool over = walkInBasket.size() > kMaxBasket;
+        if (over != wasOver) {
+            ++crossings;
+            wasOver = over;
+        }
+
+        const int kind = random.bounded(6);
+        if (kind < 2) {
+            const int roll = random.bounded(5);
+            if (over || (roll == 0 && !walkInPurchases.isEmpty())) {
+                giveBack(recommender, walkInPurchases.at(random.bounded(int(walkInPurchases.size()))));
+            } else if (roll == 1 && !walkInPurchases.isEmpty()) {
+                const int again = walkInPurchases.at(random.bounded(int(walkInPurchases.size())));
+                buy(recommender, walkIn, m_purchases.at(again).productId);
+            } else {
+                int product;
+                do {
+                    product = 1 + random.bounded(products);
+                } while (walkInBasket.contains(product));
+                buy(recommender, walkIn, product);
+            }
+        } else if (kind < 4 && !regularPurchases.isEmpty()) {
+            giveBack(recommender, regularPurchases.at(random.bounded(int(regularPurchases.size()))));
+        } else {
+            buy(recommender, names.at(random.bounded(int(names.size()))), 1 + random.bounded(shelf));
+        }
+        QVERIFY(!QTest::currentTestFailed());
+
+        if (step % 500 == 0) {
+            compareWithRebuild(recommender, products);
+            QVERIFY2(!QTest::currentTestFailed(), qPrintable(QStringLiteral("after step %1").arg(step)));
+        }
+    }
+
+    // The sequence is only worth something if the limit was crossed both ways
+    QVERIFY2(crossings >= 2, qPrintable(QStringLiteral("%1 crossings").arg(crossings)));
+}
+
+QTEST_GUILESS_MAIN(TestCoOccurrenceRecommender)
+#include "tst_cooccurrencerecommender.moc"
@@ -0,0 +1,310 @@
+#include <QDir>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtTest>
+#include <algorithm>
+#include "RemoteImageLoader.h"
+
+// Minimal HTTP/1.1 server on 127.0.0.1. Serves registered resources with
+// optional ETag, answers If-None-Match with 304 and records every request.
+class LoopbackServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    struct Resource {
+        QByteArray body;
+        QByteArray etag;
+        int delayMs = 0;
+    };
+
+    struct Request {
+        QByteArray path;
+        QByteArray ifNoneMatch;
+    };
+
+    QHash<QByteArray, Resource> resources;
+    QVector<Request> requests;
+    int inFlight = 0;
+    int maxInFlight = 0;
+    int notModified = 0;
+
+    bool start() { return listen(QHostAddress::LocalHost); }
+
+    QUrl url(const QByteArray &path) const
+    {
+        return QUrl(QStringLiteral("http://127.0.0.1:%1%2").arg(serverPort()).arg(QString::fromLatin1(path)));
+    }
+
+    int requestsFor(const QByteArray &path) const
+    {
+        return int(std::count_if(requests.cbegin(), requests.cend(),
+                                 [&path](const Request &request) { return request.path == path; }));
+    }
+
+protected:
+    void incomingConnection(qintptr descriptor) override
+    {
+        auto *socket = new QTcpSocket(this);
+        socket->setSocketDescriptor(descriptor);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { readRequests(socket); });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+
+private:
+    // Requests carry no body (GET only), so the header block is all of it
+    void readRequests(QTcpSocket *socket)
+    {
+        QByteArray &buffer = m_buffers[socket];
+        buffer += socket->readAll();
+
+        qsizetype end;
+        while ((end = buffer.indexOf("\r\n\r\n")) >= 0) {
+            const QList<QByteArray> lines = buffer.left(end).split('\n');
+            buffer.remove(0, end + 4);
+
+            Request request;
+            request.path = lines.value(0).split(' ').value(1);
+            for (const QByteArray &line : lines) {
+                if (line.toLower().startsWith("if-none-match:")) {
+                    request.ifNoneMatch = line.mid(line.indexOf(':') + 1).trimmed();
+                }
+            }
+            requests.append(request);
+
+            maxInFlight = qMax(maxInFlight, ++inFlight);
+            const Resource resource = resources.value(request.path);
+            QPointer<QTcpSocket> target(socket);
+            QTimer::singleShot(resource.delayMs, this, [this, target, request, resource]() {
+                --inFlight;
+                if (target) {
+                    target->write(response(request, resource));
+                }
+            });
+        }
+    }
+
+    QByteArray response(const Request &request, const Resource &resource)
+    {
+        if (resource.body.isEmpty()) {
+            return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        }
+
+        QByteArray headers = "Cache-Control: max-age=0\r\n";
+        if (!resource.etag.isEmpty()) {
+            headers += "ETag: " + resource.etag + "\r\n";
+        }
+
+        if (!resource.etag.isEmpty() && request.ifNoneMatch == resource.etag) {
+            ++notModified;
+            return "HTTP/1.1 304 Not Modified\r\n" + headers + "Content-Length: 0\r\n\r\n";
+        }
+
+        return "HTTP/1.1 200 OK\r\nContent-Type: image/png\r\n" + headers
+               + "Content-Length: " + QByteArray::number(resource.body.size()) + "\r\n\r\n" + resource.body;
+    }
+
+    QHash<QTcpSocket *, QByteArray> m_buffers;
+};
+
+class TestRemoteImageLoader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void fetchDeliversBytesAndEtag();
+    void coalescesIdenticalUrls();
+    void revalidatesWithEtag();
+    void changedContentGetsNewVersion();
+    void versionFallsBackToContentHash();
+    void limitsRequestsPerHost();
+    void cancelAbortsRequest();
+    void reportsHttpErrors();
+    // Must stay last: the loader cannot be revived
+    void shutdownFailsLaterFetches();
+
+private:
+    // Waits for the loader's answer for `url`; returns its arguments
+    QList<QVariant> waitForFetch(QSignalSpy &spy, const QUrl &url, int timeoutMs = 5000);
+
+    LoopbackServer m_server;
+    QObject m_requester;
+    QObject m_otherRequester;
+};
+
+QList<QVariant> TestRemoteImageLoader::waitForFetch(QSignalSpy &spy, const QUrl &url, int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < timeoutMs) {
+        for (const QList<QVariant> &arguments : std::as_const(spy)) {
+            if (arguments.value(0).toUrl() == url) {
+                return arguments;
+            }
+        }
+        spy.wait(50);
+    }
+    return {};
+}
+
+void TestRemoteImageLoader::initTestCase()
+{
+    // Keeps the loader's disk cache out of the user's cache directory
+    QStandardPaths::setTestModeEnabled(true);
+    QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).removeRecursively();
+    QVERIFY(m_server.start());
+}
+
+void TestRemoteImageLoader::fetchDeliversBytesAndEtag()
+{
+    m_server.resources.insert("/a.png", { "first image", "\"a1\"" });
+    QSignalSpy spy(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched);
+
+    RemoteImageLoader::instance()->fetch(m_server.url("/a.png"), &m_requester);
+    const QList<QVariant> fetched = waitForFetch(spy, m_server.url("/a.png"));
+
+    QCOMPARE(fetched.value(1).toByteArray(), QByteArray("first image"));
+    QCOMPARE(fetched.value(2).toString(), QStringLiteral("\"a1\""));
+    QVERIFY(fetched.value(3).toString().isEmpty());
+}
+
+void TestRemoteImageLoader::coalescesIdenticalUrls()
+{
+    m_server.resources.insert("/shared.png", { "shared image", "\"s1\"", 100 });
+    QSignalSpy spy(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched);
+
+    RemoteImageLoader::instance()->fetch(m_server.url("/shared.png"), &m_requester);
+    RemoteImageLoader::instance()->fetch(m_server.url("/shared.png"), &m_otherRequester);
+    QVERIFY(!waitForFetch(spy, m_server.url("/shared.png")).isEmpty());
+
+    // Broadcast once to both requesters, fetched once
+    QTest::qWait(50);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(m_server.requestsFor("/shared.png"), 1);
+}
+
+void TestRemoteImageLoader::revalidatesWithEtag()
+{
+    m_server.resources.insert("/stale.png", { "stale image", "\"r1\"" });
+    const QUrl url = m_server.url("/stale.png");
+
+    QSignalSpy first(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched);
+    RemoteImageLoader::instance()->fetch(url, &m_requester);
+    QVERIFY(!waitForFetch(first, url).isEmpty());
+
+    // max-age=0: the disk cache entry is stale at once and revalidated
+    const int notModified = m_server.notModified;
+    QSignalSpy second(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched);
+    RemoteImageLoader::instance()->fetch(url, &m_requester);
+    const QList<QVariant> fetched = waitForFetch(second, url);
+
+    QCOMPARE(m_server.requestsFor("/stale.png"), 2);
+    QCOMPARE(m_server.requests.constLast().ifNoneMatch, QByteArray("\"r1\""));
+    QCOMPARE(m_server.notModified, notModified + 1);
+    QCOMPARE(fetched.value(1).toByteArray(), QByteArray("stale image"));
+    QCOMPARE(fetched.value(2).toString(), QStringLiteral("\"r1\""));
+}
+
+void TestRemoteImageLoader::changedContentGetsNewVersion()
+{
+    m_server.resources.insert("/changing.png", { "old image", "\"c1\"" });
+    const QUrl url = m_server.url("/changing.png");
+
+    QSignalSpy first(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched);
+    RemoteImageLoader::instance()->fetch(url, &m_requester);
+    QCOMPARE(waitForFetch(first, url).value(2).toString(), QStringLiteral("\"c1\""));
+
+    m_server.resources.insert("/changing.png", { "new image", "\"c2\"" });
+    QSignalSpy second(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched);
+    RemoteImageLoader::instance()->fetch(url, &m_requester);
+    const QList<QVariant> fetched = waitForFetch(second, url);
+
+    QCOMPARE(fetched.value(1).toByteArray(), QByteArray("new image"));
+    QCOMPARE(fetched.value(2).toString(), QStringLiteral("\"c2\""));
+}
+
+void TestRemoteImageLoader::versionFallsBackToContentHash()
+{
+    const QByteArray body = "image without validators";
+    m_server.resources.insert("/plain.png", { body, QByteArray() });
+    QSignalSpy spy(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched);
+
+    RemoteImageLoader::instance()->fetch(m_server.url("/plain.png"), &m_requester);
+    const QList<QVariant> fetched = waitForFetch(spy, m_server.url("/plain.png"));
+
+    QCOMPARE(fetched.value(1).toByteArray(), body);
+    QCOMPARE(fetched.value(2).toString(), QString::number(qHash(body), 16));
+}
+
+void TestRemoteImageLoader::limitsRequestsPerHost()
+{
+    RemoteImageLoader *loader = RemoteImageLoader::instance();
+    const int previousLimit = loader->maxRequestsPerHost();
+    loader->setMaxRequestsPerHost(1);
+
+    QSignalSpy spy(loader, &RemoteImageLoader::imageFetched);
+    m_server.maxInFlight = 0;
+    const QByteArrayList paths = { "/slow1.png", "/slow2.png", "/slow3.png" };
+    for (const QByteArray &path : paths) {
+        m_server.resources.insert(path, { "slow image " + path, "\"" + path + "\"", 100 });
+        loader->fetch(m_server.url(path), &m_requester);
+    }
+    for (const QByteArray &path : paths) {
+        QVERIFY(!waitForFetch(spy, m_server.url(path)).isEmpty());
+    }
+
+    QCOMPARE(m_server.maxInFlight, 1);
+    loader->setMaxRequestsPerHost(previousLimit);
+}
+
+void TestRemoteImageLoader::cancelAbortsRequest()
+{
+    m_server.resources.insert("/cancelled.png", { "never delivered", "\"x1\"", 300 });
+    QSignalSpy spy(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched);
+
+    RemoteImageLoader::instance()->fetch(m_server.url("/cancelled.png"), &m_requester);
+    RemoteImageLoader::instance()->fetch(m_server.url("/cancelled.png"), &m_otherRequester);
+    RemoteImageLoader::instance()->cancel(m_server.url("/cancelled.png"), &m_requester);
+    RemoteImageLoader::instance()->cancel(m_server.url("/cancelled.png"), &m_otherRequester);
+
+    QVERIFY(waitForFetch(spy, m_server.url("/cancelled.png"), 600).isEmpty());
+}
+
+void TestRemoteImageLoader::reportsHttpErrors()
+{
+    QSignalSpy spy(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched);
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("RemoteImageLoader: Failed to fetch"));
+
+    RemoteImageLoader::instance()->fetch(m_server.url("/missing.png"), &m_requester);
+    const QList<QVariant> fetched = waitForFetch(spy, m_server.url("/missing.png"));
+
+    QVERIFY(!fetched.isEmpty());
+    QVERIFY(fetched.value(1).toByteArray().isEmpty());
+    QVERIFY(!fetched.value(3).toString().isEmpty());
+}
+
+void TestRemoteImageLoader::shutdownFailsLaterFetches()
+{
+    m_server.resources.insert("/late.png", { "too late", "\"l1\"" });
+    RemoteImageLoader::instance()->shutdown();
+
+    QSignalSpy spy(RemoteImageLoader::instance(), &RemoteImageLoader::imageFetched);
+    RemoteImageLoader::instance()->fetch(m_server.url("/late.png"), &m_requester);
+
+    // Answered synchronously, without touching the network
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(spy.at(0).value(1).toByteArray().isEmpty());
+    QVERIFY(!spy.at(0).value(3).toString().isEmpty());
+    QCOMPARE(m_server.requestsFor("/late.png"), 0);
+}
+
+QTEST_GUILESS_MAIN(TestRemoteImageLoader)
+#include "tst_remoteimageloader.moc"
@@ -0,0 +1,236 @@
+#include <QRandomGenerator>
+#include <QtTest>
+#include "SubstringScanner.h"
+
+// Every kernel this machine can run against QStringView::indexOf. The
+// lengths sweep across the 8- and 16-unit vector steps so the scalar tail,
+// partial last steps and every lane of the match mask are exercised.
+class TestSubstringScanner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    void scalarIsAlwaysAvailable();
+    void unknownKernelIsRefused();
+    void edgeCases_data();
+    void edgeCases();
+    void everyOffsetAndLength_data();
+    void everyOffsetAndLength();
+    void firstOfSeveralMatches_data();
+    void firstOfSeveralMatches();
+    void falseCandidatesInEveryLane_data();
+    void falseCandidatesInEveryLane();
+    void highCodeUnits_data();
+    void highCodeUnits();
+    void randomAgainstIndexOf_data();
+    void randomAgainstIndexOf();
+
+private:
+    void addKernelRows();
+    void useKernel();
+
+    QString m_defaultKernel;
+};
+
+namespace {
+qsizetype reference(const QString &haystack, const QString &needle)
+{
+    return QStringView(haystack).indexOf(QStringView(needle));
+}
+}
+
+void TestSubstringScanner::initTestCase()
+{
+    m_defaultKernel = QString::fromLatin1(SubstringScanner::kernelName());
+    QCOMPARE(SubstringScanner::availableKernels().constFirst(), m_defaultKernel);
+    qInfo() << "Kernels:" << SubstringScanner::availableKernels();
+}
+
+void TestSubstringScanner::cleanup()
+{
+    QVERIFY(SubstringScanner::setKernel(m_defaultKernel));
+}
+
+void TestSubstringScanner::addKernelRows()
+{
+    QTest::addColumn<QString>("kernel");
+    for (const QString &name : SubstringScanner::availableKernels()) {
+        QTest::newRow(qPrintable(name)) << name;
+    }
+}
+
+void TestSubstringScanner::useKernel()
+{
+    QFETCH(QString, kernel);
+    QVERIFY(SubstringScanner::setKernel(kernel));
+    QCOMPARE(QString::fromLatin1(SubstringScanner::kernelName()), kernel);
+}
+
+void TestSubstringScanner::scalarIsAlwaysAvailable()
+{
+    QVERIFY(SubstringScanner::availableKernels().contains(QStringLiteral("scalar")));
+}
+
+void TestSubstringScanner::unknownKernelIsRefused()
+{
+    QVERIFY(!SubstringScanner::setKernel(QStringLiteral("avx512")));
+    QCOMPARE(QString::fromLatin1(SubstringScanner::kernelName()), m_defaultKernel);
+}
+
+void TestSubstringScanner::edgeCases_data()
+{
+    addKernelRows();
+}
+
+void TestSubstringScanner::edgeCases()
+{
+    useKernel();
+    QCOMPARE(SubstringScanner::find(u"", u""), 0);
+    QCOMPARE(SubstringScanner::find(u"abc", u""), 0);
+    QCOMPARE(SubstringScanner::find(u"", u"a"), -1);
+    QCOMPARE(SubstringScanner::find(u"ab", u"abc"), -1);
+    QCOMPARE(SubstringScanner::find(u"abc", u"abc"), 0);
+    QCOMPARE(SubstringScanner::find(u"a", u"a"), 0);
+    QCOMPARE(SubstringScanner::find(u"a", u"b"), -1);
+    QVERIFY(SubstringScanner::contains(u"the quick brown fox", u"brown"));
+    QVERIFY(!SubstringScanner::contains(u"the quick brown fox", u"browm"));
+}
+
+void TestSubstringScanner::everyOffsetAndLength_data()
+{
+    addKernelRows();
+}
+
+// Needle planted once at every offset of haystacks up to 80 units; the
+// filler never contains the needle's first unit
+void TestSubstringScanner::everyOffsetAndLength()
+{
+    useKernel();
+    for (int needleSize = 1; needleSize <= 20; ++needleSize) {
+        QString needle;
+        for (int i = 0; i < needleSize; ++i) {
+            needle.append(QChar(u'A' + i));
+        }
+        for (int haystackSize = needleSize; haystackSize <= 80; ++haystackSize) {
+            const QString filler(haystackSize, u'x');
+            QCOMPARE(SubstringScanner::find(filler, needle), -1);
+            for (int at = 0; at + needleSize <= haystackSize; ++at) {
+                const QString haystack = QString(filler).replace(at, needleSize, needle);
+                if (SubstringScanner::find(haystack, needle) != at) {
+                    QFAIL(qPrintable(QStringLiteral("needle %1 in %2 units at %3: got %4")
+                                         .arg(needleSize)
+                                         .arg(haystackSize)
+                                         .arg(at)
+                                         .arg(SubstringScanner::find(haystack, needle))));
+                }
+            }
+        }
+    }
+}
+
+void TestSubstringScanner::firstOfSeveralMatches_data()
+{
+    addKernelRows();
+}
+
+// Several matches inside one vector step must report the lowest lane
+void TestSubstringScanner::firstOfSeveralMatches()
+{
+    useKernel();
+    for (int lead = 0; lead < 40; ++lead) {
+        const QString haystack = QString(lead, u'-') + QStringLiteral("abababababababababababab");
+        QCOMPARE(SubstringScanner::find(haystack, u"ab"), lead);
+        QCOMPARE(SubstringScanner::find(haystack, u"aba"), lead);
+        QCOMPARE(SubstringScanner::find(haystack, u"bab"), lead + 1);
+        QCOMPARE(SubstringScanner::find(haystack, u"b"), lead + 1);
+    }
+}
+
+void TestSubstringScanner::falseCandidatesInEveryLane_data()
+{
+    addKernelRows();
+}
+
+// First and last units match at every position but the middle only at
+// `at`, so every lane yields a candidate the middle compare must reject
+void TestSubstringScanner::falseCandidatesInEveryLane()
+{
+    useKernel();
+    const QString needle = QStringLiteral("aXa");
+    for (int haystackSize = 3; haystackSize <= 70; ++haystackSize) {
+        const QString filler(haystackSize, u'a');
+        QCOMPARE(SubstringScanner::find(filler, needle), -1);
+        for (int at = 0; at + 3 <= haystackSize; ++at) {
+            QString haystack = filler;
+            haystack[at + 1] = u'X';
+            QCOMPARE(SubstringScanner::find(haystack, needle), at);
+        }
+    }
+
+    // Long needle whose middle differs in its last-but-one unit
+    const QString longNeedle = QString(30, u'a') + u'b' + u'a';
+    const QString nearMiss = QString(31, u'a') + u'a';
+    QCOMPARE(SubstringScanner::find(QString(100, u'a'), longNeedle), -1);
+    QCOMPARE(SubstringScanner::find(nearMiss + longNeedle, longNeedle), nearMiss.size());
+}
+
+void TestSubstringScanner::highCodeUnits_data()
+{
+    addKernelRows();
+}
+
+// Units above 0x7fff are negative as signed 16-bit lanes
+void TestSubstringScanner::highCodeUnits()
+{
+    useKernel();
+    const QString needle = QString(QChar(0xffff)) + QChar(0x8000) + QChar(0xd83d) + QChar(0xde00);
+    for (int lead = 0; lead < 40; ++lead) {
+        QString haystack(lead, QChar(0x7fff));
+        haystack += needle;
+        haystack += QString(5, QChar(0xfffe));
+        QCOMPARE(SubstringScanner::find(haystack, needle), lead);
+        QCOMPARE(SubstringScanner::find(haystack, QString(QChar(0xd83d)) + QChar(0xde00)), lead + 2);
+        QCOMPARE(SubstringScanner::find(haystack, QString(QChar(0x8000)) + QChar(0xffff)), -1);
+    }
+}
+
+void TestSubstringScanner::randomAgainstIndexOf_data()
+{
+    addKernelRows();
+}
+
+// Small alphabets make partial and overlapping matches common
+void TestSubstringScanner::randomAgainstIndexOf()
+{
+    useKernel();
+    QRandomGenerator random(45);
+    for (int round = 0; round < 20000; ++round) {
+        const int alphabet = 2 + random.bounded(3);
+        const auto text = [&](int size) {
+            QString result(size, Qt::Uninitialized);
+            for (QChar &unit : result) {
+                unit = QChar(u'a' + random.bounded(alphabet));
+            }
+            return result;
+        };
+        const QString haystack = text(random.bounded(100));
+        QString needle = text(1 + random.bounded(12));
+        // Half the rounds take the needle from the haystack itself
+        if (haystack.size() >= needle.size() && random.bounded(2) == 0) {
+            needle = haystack.mid(random.bounded(int(haystack.size() - needle.size()) + 1), needle.size());
+        }
+        const qsizetype expected = reference(haystack, needle);
+        const qsizetype actual = SubstringScanner::find(haystack, needle);
+        if (actual != expected) {
+            QFAIL(qPrintable(QStringLiteral("find(\"%1\", \"%2\") = %3, expected %4")
+                                 .arg(haystack, needle)
+                                 .arg(actual)
+                                 .arg(expected)));
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(TestSubstringScanner)
+#include "tst_substringscanner.moc"